@@ -0,0 +1,62 @@
+-- large-mesh.lua -- Startup benchmark: one large mesh
+--
+--  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+--
+-- This source code is free software; you can redistribute it and/or
+-- modify it under the terms of the GNU General Public License as
+-- published by the Free Software Foundation; either version 3, or (at
+-- your option) any later version.  See the file COPYING for more details.
+--
+-- Written by Miles Bader <miles@gnu.org>
+--
+
+-- A single large height-field mesh, built with duplicate vertices at
+-- each grid cell so that vertex welding has work to do, and without
+-- normals, which are computed after welding.
+--
+
+-- Number of grid cells on each side.
+--
+local GRID_SIZE = 700
+
+local mat = material.lambert (0.6)
+local mesh = surface.mesh ()
+local part = mesh:add_part (mat)
+
+local function height (x, z)
+   return 0.05 * (math.sin (x * 17) + math.cos (z * 13))
+end
+
+local verts, tris = {}, {}
+local step = 1 / GRID_SIZE
+
+for i = 0, GRID_SIZE - 1 do
+   for j = 0, GRID_SIZE - 1 do
+      local x0, z0 = i * step - 0.5, j * step - 0.5
+      local x1, z1 = x0 + step, z0 + step
+      local base = #verts / 3
+      for k, c in ipairs { {x0, z0}, {x1, z0}, {x1, z1}, {x0, z1} } do
+	 local x, z = c[1], c[2]
+	 verts[#verts + 1] = x
+	 verts[#verts + 1] = height (x, z)
+	 verts[#verts + 1] = z
+      end
+      local nt = #tris
+      tris[nt + 1] = base;     tris[nt + 2] = base + 1; tris[nt + 3] = base + 2
+      tris[nt + 4] = base;     tris[nt + 5] = base + 2; tris[nt + 6] = base + 3
+   end
+end
+
+local base_vert = mesh:add_vertices (verts)
+mesh:add_triangles (part, tris, base_vert)
+verts, tris = nil, nil
+
+mesh:weld_vertices ()
+mesh:compute_vertex_normals ()
+
+scene:add (mesh)
+
+scene:add (light.point (pos (0, 2, -1), 10))
+
+camera:move (pos (0, 1, -1.2))
+camera:point (pos (0, 0, 0), vec (0, 1, 0))
@@ -0,0 +1,38 @@
+-- many-instances.lua -- Startup benchmark: many instances of a model
+--
+--  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+--
+-- This source code is free software; you can redistribute it and/or
+-- modify it under the terms of the GNU General Public License as
+-- published by the Free Software Foundation; either version 3, or (at
+-- your option) any later version.  See the file COPYING for more details.
+--
+-- Written by Miles Bader <miles@gnu.org>
+--
+
+-- A grid of instances of a single tessellated-sphere model, which
+-- mostly measures the cost of setting up instances and building the
+-- scene's acceleration structure.
+--
+
+-- Number of instances on each side of the grid.
+--
+local GRID_SIZE = 100
+
+local mat = material.cook_torrance (0.4, 0.6, 0.1)
+local model
+   = surface.model (surface.tessel_sphere (mat, pos (0, 0, 0), vec (0, 1, 0),
+					   0.4, 0.001))
+
+for i = 0, GRID_SIZE - 1 do
+   for j = 0, GRID_SIZE - 1 do
+      scene:add (surface.instance (model,
+				   transform.translate (i - GRID_SIZE / 2, 0,
+							j - GRID_SIZE / 2)))
+   end
+end
+
+scene:add (light.far (vec (1, 2, -1), 0.1, 1))
+
+camera:move (pos (0, GRID_SIZE / 2, -GRID_SIZE))
+camera:point (pos (0, 0, 0), vec (0, 1, 0))
@@ -0,0 +1,36 @@
+-- many-lights.lua -- Startup benchmark: many lights
+--
+--  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+--
+-- This source code is free software; you can redistribute it and/or
+-- modify it under the terms of the GNU General Public License as
+-- published by the Free Software Foundation; either version 3, or (at
+-- your option) any later version.  See the file COPYING for more details.
+--
+-- Written by Miles Bader <miles@gnu.org>
+--
+
+-- A floor lit by a grid of point lights, above a grid of spheres,
+-- which mostly measures the cost of setting up light samplers.
+--
+
+-- Number of lights on each side of the grid.
+--
+local GRID_SIZE = 40
+
+local mat = material.lambert (0.6)
+
+scene:add (surface.rectangle (mat, pos (-GRID_SIZE, 0, -GRID_SIZE),
+			      vec (GRID_SIZE * 2, 0, 0),
+			      vec (0, 0, GRID_SIZE * 2)))
+
+for i = 0, GRID_SIZE - 1 do
+   for j = 0, GRID_SIZE - 1 do
+      local x, z = i - GRID_SIZE / 2, j - GRID_SIZE / 2
+      scene:add (light.point (pos (x, 2, z), 0.5))
+      scene:add (surface.sphere (mat, pos (x + 0.5, 0.25, z + 0.5), 0.25))
+   end
+end
+
+camera:move (pos (0, GRID_SIZE / 2, -GRID_SIZE))
+camera:point (pos (0, 0, 0), vec (0, 1, 0))
@@ -0,0 +1,50 @@
+-- many-materials.lua -- Rendering benchmark: many materials
+--
+--  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+--
+-- This source code is free software; you can redistribute it and/or
+-- modify it under the terms of the GNU General Public License as
+-- published by the Free Software Foundation; either version 3, or (at
+-- your option) any later version.  See the file COPYING for more details.
+--
+-- Written by Miles Bader <miles@gnu.org>
+--
+
+-- A grid of spheres using every sort of material with a non-trivial
+-- BSDF, lit by a few lights, which mostly measures the cost of
+-- setting up and evaluating BSDFs during rendering.
+--
+
+-- Number of spheres on each side of the grid.
+--
+local GRID_SIZE = 12
+
+local mats = {
+   material.lambert (0.6),
+   material.cook_torrance {diff = 0.3, spec = 0.6, m = 0.1},
+   material.cook_torrance {diff = 0.1, spec = 0.8, m = 0.6},
+   material.mirror {reflect = 0.8, under = material.lambert (0.2)},
+   material.glass (1.5),
+   material.thin_glass (1.5),
+   material.stencil (0.5, material.cook_torrance (0.5, 0.5, 0.2)),
+}
+
+scene:add (surface.rectangle (material.lambert (0.5),
+			      pos (-GRID_SIZE, 0, -GRID_SIZE),
+			      vec (GRID_SIZE * 2, 0, 0),
+			      vec (0, 0, GRID_SIZE * 2)))
+
+for i = 0, GRID_SIZE - 1 do
+   for j = 0, GRID_SIZE - 1 do
+      local x, z = i - GRID_SIZE / 2, j - GRID_SIZE / 2
+      local mat = mats[(i + j * GRID_SIZE) % #mats + 1]
+      scene:add (surface.sphere (mat, pos (x + 0.5, 0.45, z + 0.5), 0.45))
+   end
+end
+
+scene:add (light.point (pos (-GRID_SIZE, GRID_SIZE, -GRID_SIZE), 200))
+scene:add (light.point (pos (GRID_SIZE, GRID_SIZE / 2, -GRID_SIZE / 2), 100))
+scene:add (light.far (vec (1, 1, -1), 0.05, 0.5))
+
+camera:move (pos (0, GRID_SIZE / 2, -GRID_SIZE))
+camera:point (pos (0, 0, 0), vec (0, 1, 0))
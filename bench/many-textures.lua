@@ -0,0 +1,74 @@
+-- many-textures.lua -- Startup benchmark: many image textures
+--
+--  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+--
+-- This source code is free software; you can redistribute it and/or
+-- modify it under the terms of the GNU General Public License as
+-- published by the Free Software Foundation; either version 3, or (at
+-- your option) any later version.  See the file COPYING for more details.
+--
+-- Written by Miles Bader <miles@gnu.org>
+--
+
+-- A grid of rectangles, each with its own image texture, which
+-- mostly measures the cost of loading image textures.
+--
+-- The texture images are generated the first time the scene is
+-- loaded, in the directory named by the environment variable
+-- SNOGRAY_BENCH_DIR (default /tmp), and reused afterwards.  As
+-- generating them is slow, it's recorded as a separate phase in the
+-- startup profile.
+--
+
+local image = require 'snogray.image'
+local color = require 'snogray.color'
+local sys = require 'snogray.sys'
+local file = require 'snogray.file'
+
+-- Number of textures on each side of the grid.
+--
+local GRID_SIZE = 8
+
+-- Size of each texture image, in pixels.
+--
+local TEX_SIZE = 256
+
+local tex_dir = os.getenv ("SNOGRAY_BENCH_DIR") or "/tmp"
+
+-- Return the name of texture image NUM, generating it if necessary.
+--
+local function tex_file (num)
+   local filename = tex_dir.."/snogray-bench-tex-"..num..".pfm"
+
+   if not file.exists (filename) then
+      sys.begin_phase "bench texture generation"
+
+      local img = image.new (TEX_SIZE, TEX_SIZE)
+      local r, g, b = (num % 3) / 2, (num % 5) / 4, (num % 7) / 6
+      for y = 0, TEX_SIZE - 1 do
+	 for x = 0, TEX_SIZE - 1 do
+	    local f = ((x * (num + 1) + y) % 64) / 64
+	    img:set (x, y, color.rgb (r * f, g * f, b * (1 - f)))
+	 end
+      end
+      img:save (filename)
+
+      sys.end_phase ()
+   end
+
+   return filename
+end
+
+for i = 0, GRID_SIZE - 1 do
+   for j = 0, GRID_SIZE - 1 do
+      local mat = material.lambert (texture.image (tex_file (i * GRID_SIZE + j)))
+      scene:add (surface.rectangle (mat, pos (i - GRID_SIZE / 2, 0,
+					     j - GRID_SIZE / 2),
+				    vec (0.9, 0, 0), vec (0, 0, 0.9)))
+   end
+end
+
+scene:add (light.far (vec (1, 2, -1), 0.1, 1))
+
+camera:move (pos (0, GRID_SIZE, -GRID_SIZE))
+camera:point (pos (0, 0, 0), vec (0, 1, 0))
@@ -0,0 +1,284 @@
+// bsdfbench.cc -- Benchmark for BSDF sampling and evaluation
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <getopt.h>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "cli/build-info.h"
+#include "util/timeval.h"
+#include "util/radical-inverse.h"
+#include "util/val-table.h"
+#include "surface/surface-group.h"
+#include "material/lambert.h"
+#include "material/cook-torrance.h"
+#include "material/phong.h"
+#include "material/mirror.h"
+#include "material/glass.h"
+#include "material/thin-glass.h"
+#include "material/media.h"
+#include "material/cos-dist.h"
+#include "render/global-render-state.h"
+#include "render/render-context.h"
+#include "render/intersect.h"
+
+using namespace snogray;
+
+
+
+// usage/help messages
+
+static void
+usage (const char *prog_name, std::ostream &os)
+{
+  os << "Usage: " << prog_name << " [OPTION...]" << std::endl;
+}
+
+static void
+try_help (const char *prog_name, std::ostream &os)
+{
+  os << "Try '" << prog_name << " --help' for more information."
+     << std::endl;
+}
+
+static void
+help (const char *prog_name, std::ostream &os)
+{
+  usage (prog_name, os);
+
+  // These macros just makes the source code for help output easier to line up
+  //
+#define s  << std::endl <<
+#define n  << std::endl
+
+  os <<
+  "Measure the speed of BSDF setup, sampling, and evaluation, for each"
+s "type of material."
+n
+s "  -n, --samples=NUM          Take NUM samples (default 1000000)"
+s "  -a, --angle=DEGREES        Use a view angle of DEGREES from the"
+s "                               surface normal (default 45)"
+n
+s "      --help                 Output this help message"
+s "      --version              Output program version"
+n
+    ;
+
+#undef s
+#undef n
+}
+
+#define OPT_HELP	-10
+#define OPT_VERSION	-11
+
+static struct option long_options[] = {
+  { "samples",		required_argument, 0, 'n' },
+  { "angle",		required_argument, 0, 'a' },
+  { "help",		no_argument, 	   0, OPT_HELP },
+  { "version",		no_argument, 	   0, OPT_VERSION },
+  { 0, 0, 0, 0 }
+};
+static char short_options[] = "n:a:";
+
+
+
+// Benchmarking
+
+// Time BSDF setup for MATERIAL, and sampling and evaluation of the
+// resulting BSDF, using the sample parameters in PARAMS and evaluation
+// directions in DIRS, and print the results on std::cout, labelled
+// with NAME.  The view ray used is VIEW_RAY, and intersects the
+// surface at the origin, where the surface normal is the Z-axis.
+//
+static void
+bench (const char *name, const Material &material, RenderContext &context,
+       const Ray &view_ray,
+       const std::vector<UV> &params, const std::vector<Vec> &dirs)
+{
+  Media media (context.default_medium);
+  Frame normal_frame;
+  UV uv (0, 0), dTds (1, 0), dTdt (0, 1);
+
+  // BSDF setup is much more expensive than sampling or evaluation,
+  // so we do it fewer times.
+  //
+  unsigned num_setups = max (unsigned (params.size () / 10), 1u);
+
+  // Accumulate results, so the compiler can't optimize the loops away.
+  //
+  double check_sum = 0;
+
+  Timeval beg_time (Timeval::TIME_OF_DAY);
+
+  for (unsigned i = 0; i < num_setups; i++)
+    {
+      {
+	Intersect isec (view_ray, media, context, material, normal_frame,
+			uv, dTds, dTdt);
+	check_sum += isec.bsdf ? 1 : 0;
+      }
+
+      // The BSDF is stored in the Intersect, so the only thing setup
+      // allocates from the context's mempool is the texture evaluation
+      // cache, and only for expensive textures.  None of the materials
+      // here use any, so the setup times include no cache cost, and
+      // this reset frees nothing.  It's kept so that materials with
+      // expensive textures can be added without memory growing on each
+      // setup (the renderer also resets the mempool after each sample).
+      //
+      context.mempool.reset ();
+    }
+
+  Timeval setup_time (Timeval::TIME_OF_DAY);
+
+  Intersect isec (view_ray, media, context, material, normal_frame,
+		  uv, dTds, dTdt);
+  if (! isec.bsdf)
+    {
+      std::cout << std::setw (16) << std::left << name << std::right
+		<< "  (no BSDF)" << std::endl;
+      return;
+    }
+
+  const Bsdf &bsdf = *isec.bsdf;
+
+  Timeval sample_beg_time (Timeval::TIME_OF_DAY);
+
+  for (unsigned i = 0; i < params.size (); i++)
+    {
+      Bsdf::Sample samp = bsdf.sample (params[i], Bsdf::ALL);
+      check_sum += double (samp.val.intensity () + samp.pdf);
+    }
+
+  Timeval sampled_time (Timeval::TIME_OF_DAY);
+
+  for (unsigned i = 0; i < dirs.size (); i++)
+    {
+      Bsdf::Value val = bsdf.eval (dirs[i], Bsdf::ALL);
+      check_sum += double (val.val.intensity () + val.pdf);
+    }
+
+  Timeval end_time (Timeval::TIME_OF_DAY);
+
+  double setup = setup_time - beg_time;
+  double sample = sampled_time - sample_beg_time;
+  double eval = end_time - sampled_time;
+
+  std::cout << std::setw (16) << std::left << name << std::right
+	    << std::fixed << std::setprecision (1)
+	    << "  setup " << std::setw (7) << setup * 1e9 / num_setups << " ns"
+	    << "  sample " << std::setw (6) << sample * 1e9 / params.size ()
+	    << " ns (" << std::setw (6) << std::setprecision (2)
+	    << params.size () / sample * 1e-6 << " M/s)"
+	    << std::setprecision (1)
+	    << "  eval " << std::setw (6) << eval * 1e9 / dirs.size ()
+	    << " ns (" << std::setw (6) << std::setprecision (2)
+	    << dirs.size () / eval * 1e-6 << " M/s)"
+	    << "  [" << std::setprecision (0) << check_sum << "]"
+	    << std::endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+  const char *prog_name = argv[0];
+  unsigned num_samples = 1000000;
+  float view_angle = 45;
+
+  int opt;
+  while ((opt = getopt_long (argc, argv, short_options, long_options, 0)) != -1)
+    switch (opt)
+      {
+      case 'n':
+	num_samples = atoi (optarg);
+	break;
+      case 'a':
+	view_angle = atof (optarg);
+	if (view_angle < 0 || view_angle >= 90)
+	  {
+	    std::cerr << prog_name << ": " << optarg
+		      << ": Invalid view angle" << std::endl;
+	    exit (1);
+	  }
+	break;
+      case OPT_HELP:
+	help (prog_name, std::cout);
+	exit (0);
+      case OPT_VERSION:
+	std::cout << prog_name << " (" << PACKAGE_NAME << ") "
+		  << build_info.get_string ("version", "???")
+		  << std::endl;
+	exit (0);
+      default:
+	try_help (prog_name, std::cerr);
+	exit (1);
+      }
+
+  if (optind < argc || num_samples == 0)
+    {
+      usage (prog_name, std::cerr);
+      try_help (prog_name, std::cerr);
+      exit (1);
+    }
+
+  // Materials need a rendering context to make BSDFs, so make one
+  // for an empty scene with default parameters.
+  //
+  SurfaceGroup scene_contents;
+  ValTable render_params;
+  GlobalRenderState global_state (scene_contents, render_params);
+  RenderContext context (global_state);
+
+  // The view ray comes from VIEW_ANGLE degrees away from the surface
+  // normal (the Z-axis), and hits the surface at the origin.
+  //
+  float view_angle_rad = view_angle * PIf / 180;
+  Ray view_ray (Pos (-sin (view_angle_rad), 0, cos (view_angle_rad)),
+		Pos (0, 0, 0));
+
+  // Sample parameters and evaluation directions are calculated in
+  // advance, so that only the BSDF is timed.  Evaluation directions
+  // are cosine-distributed over the hemisphere above the surface,
+  // which is roughly what light sampling uses.
+  //
+  std::vector<UV> params (num_samples);
+  std::vector<Vec> dirs (num_samples);
+  CosDist dir_dist;
+  for (unsigned i = 0; i < num_samples; i++)
+    {
+      params[i] = UV (radical_inverse (i + 1, 2), radical_inverse (i + 1, 3));
+      dirs[i] = dir_dist.sample (UV (radical_inverse (i + 1, 5),
+				     radical_inverse (i + 1, 7)));
+    }
+
+  std::cout << "view angle " << view_angle << " degrees, "
+	    << num_samples << " samples" << std::endl;
+
+  Color white (1), grey (0.5f);
+
+  bench ("lambert", Lambert (grey), context, view_ray, params, dirs);
+  bench ("cook-torrance", CookTorrance (grey, white, 0.1f, 1.5f),
+	 context, view_ray, params, dirs);
+  bench ("cook-torrance-r", CookTorrance (grey, white, 0.8f, 1.5f),
+	 context, view_ray, params, dirs);
+  bench ("cook-torrance-m", CookTorrance (Color (0), white, 0.1f, Ior (0.2f, 3)),
+	 context, view_ray, params, dirs);
+  bench ("phong", Phong (grey, white, 50), context, view_ray, params, dirs);
+  bench ("mirror", Mirror (Ior (0.2f, 3), white, grey),
+	 context, view_ray, params, dirs);
+  bench ("glass", Glass (Medium (1.5f)), context, view_ray, params, dirs);
+  bench ("thin-glass", ThinGlass (1.5f), context, view_ray, params, dirs);
+
+  return 0;
+}
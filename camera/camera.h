@@ -331,6 +331,18 @@ public:
   //
   Ray eye_ray (const UV &film_loc, const UV &focus_param, dist_t len) const;
 
+  // Return the angle (in radians) between the eye-rays for film
+  // locations FILM_LOC and FILM_LOC + FILM_DELTA, ignoring
+  // depth-of-field.  This is used as the spread of a "ray cone" around
+  // an eye-ray, to estimate how much of a surface one pixel covers.
+  //
+  float eye_ray_spread (const UV &film_loc, const UV &film_delta) const
+  {
+    Vec dir = eye_vec (film_loc).unit ();
+    Vec delta_dir = eye_vec (film_loc + film_delta).unit ();
+    return float ((delta_dir - dir).length ());
+  }
+
   Format format;
 
   Pos pos;
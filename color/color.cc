@@ -16,6 +16,83 @@
 using namespace snogray;
 
 
+#if SPECTRAL_SAMPLES
+
+// In spectral mode, RGB values are converted using a very simple
+// "box" basis:  the spectral samples, which are in order of
+// increasing wavelength, are divided into three roughly equal bands,
+// corresponding to blue, green, and red, and every sample in a band
+// has the value of the corresponding primary.  Converting back
+// averages the samples in each band, so conversion of an RGB color to
+// a spectral color and back is exact.
+//
+// This is just a placeholder for real color-space conversion.
+
+namespace { // keep local to file
+
+// Return the RGB primary (0 = red, 1 = green, 2 = blue) corresponding
+// to spectral sample C.
+//
+inline unsigned
+sample_primary (unsigned c)
+{
+  return 2 - c * 3 / Color::NUM_COMPONENTS;
+}
+
+// Return the average of the spectral samples in COL corresponding to
+// the RGB primary PRIMARY.
+//
+Color::component_t
+primary_average (const Color &col, unsigned primary)
+{
+  Color::component_t sum = 0;
+  unsigned count = 0;
+  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
+    if (sample_primary (c) == primary)
+      {
+	sum += col[c];
+	count++;
+      }
+  return count == 0 ? 0 : sum / count;
+}
+
+} // namespace
+
+Color::Color (component_t r, component_t g, component_t b)
+{
+  set_rgb (r, g, b);
+}
+
+Color::component_t
+Color::r () const
+{
+  return primary_average (*this, 0);
+}
+
+Color::component_t
+Color::g () const
+{
+  return primary_average (*this, 1);
+}
+
+Color::component_t
+Color::b () const
+{
+  return primary_average (*this, 2);
+}
+
+void
+Color::set_rgb (component_t r, component_t g, component_t b)
+{
+  for (unsigned c = 0; c < NUM_COMPONENTS; c++)
+    {
+      unsigned primary = sample_primary (c);
+      _components[c] = (primary == 0) ? r : (primary == 1) ? g : b;
+    }
+}
+
+#else // !SPECTRAL_SAMPLES
+
 Color::Color (component_t r, component_t g, component_t b)
 {
   // XXX
@@ -51,5 +128,7 @@ Color::set_rgb (component_t r, component_t g, component_t b)
   _components[2] = b;
 }
 
+#endif // SPECTRAL_SAMPLES
+
 
 // arch-tag: 11e71f8e-3323-473e-95ce-e3e07e6197d8
@@ -13,9 +13,25 @@
 #ifndef SNOGRAY_COLOR_H
 #define SNOGRAY_COLOR_H
 
+#include "config.h"
+
 #include "util/snogmath.h"
 #include "image/tuple-adaptor.h"
 
+// Use SSE instructions for color arithmetic if possible.
+//
+#ifdef __SSE__
+# define USE_SSE_COLOR 1
+# include <xmmintrin.h>
+#endif
+
+// The RGB conversion functions need at least one spectral sample for
+// each primary.
+//
+#if SPECTRAL_SAMPLES && SPECTRAL_SAMPLES < 3
+# error "SPECTRAL_SAMPLES must be at least 3"
+#endif
+
 
 namespace snogray {
 
@@ -32,6 +48,15 @@ typedef float intens_t;
 // component independently), a Color can usually be treated like the
 // traditional C numeric types.
 //
+// Normally a color has three components, red, green, and blue, but if
+// snogray was configured using --with-spectral-samples=N, colors
+// instead have N components, which are samples of a spectral power
+// distribution at evenly spaced wavelengths.
+//
+// Components are stored in groups of four (the last group padded with
+// unused components if necessary), so that the common arithmetic
+// operations can be done using 4-wide vector instructions.
+//
 class Color
 {
 public:
@@ -42,7 +67,21 @@ public:
 
   // Number of color components stored.
   //
+#if SPECTRAL_SAMPLES
+  static const unsigned NUM_COMPONENTS = SPECTRAL_SAMPLES;
+#else
   static const unsigned NUM_COMPONENTS = 3; // RGB
+#endif
+
+  // Number of components operated on at once by vector operations, and
+  // the number of components actually allocated (which is
+  // NUM_COMPONENTS rounded up to a multiple of VECTOR_WIDTH).  The
+  // values of any extra components are undefined, and are ignored by
+  // all operations.
+  //
+  static const unsigned VECTOR_WIDTH = 4;
+  static const unsigned STORED_COMPONENTS
+    = (NUM_COMPONENTS + VECTOR_WIDTH - 1) / VECTOR_WIDTH * VECTOR_WIDTH;
 
   // Default constructor.
   //
@@ -66,48 +105,27 @@ public:
   // Scalar constructors; these are very handy for mixing colors and
   // scalars in expressions.
   //
-  Color (int grey)
-  {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] = grey;
-  }
-  Color (unsigned grey)
-  {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] = grey;
-  }
-  Color (float grey)
-  {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] = grey;
-  }
-  Color (double grey)
-  {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] = grey;
-  }
+  Color (int grey) { fill (component_t (grey)); }
+  Color (unsigned grey) { fill (component_t (grey)); }
+  Color (float grey) { fill (grey); }
+  Color (double grey) { fill (component_t (grey)); }
 
   const Color &operator+= (const Color &col2)
   {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] += col2[c];
+    add (_components, col2._components, _components);
     return *this;
   }
   void operator-= (const Color &col2)
   {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] -= col2[c];
+    sub (_components, col2._components, _components);
   }
   void operator*= (const Color &filter)
   {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] *= filter[c];
+    mul (_components, filter._components, _components);
   }
   void operator/= (const Color &filter)
   {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      if (filter[c] != 0)
-	_components[c] /= filter[c];
+    div (_components, filter._components, _components);
   }
 
   // Explicit handling of scaling (results in better code generation
@@ -116,23 +134,19 @@ public:
   // ambiguity.
   void operator*= (float scale)
   {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] *= scale;
+    scale_by (_components, scale, _components);
   }
   void operator*= (double scale)
   {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] *= component_t (scale);
+    scale_by (_components, component_t (scale), _components);
   }
   void operator*= (int scale)
   {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] *= scale;
+    scale_by (_components, component_t (scale), _components);
   }
   void operator*= (unsigned scale)
   {
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      _components[c] *= scale;
+    scale_by (_components, component_t (scale), _components);
   }
 
   // Doesn't make much sense physically, of course, but useful for some
@@ -141,8 +155,7 @@ public:
   Color operator- () const
   {
     Color rval;
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      rval[c] = -_components[c];
+    scale_by (_components, -1.f, rval._components);
     return rval;
   }
 
@@ -159,24 +172,20 @@ public:
 
   intens_t intensity () const
   {
-    component_t sum = _components[0];
-    for (unsigned c = 1; c < NUM_COMPONENTS; c++)
-      sum += _components[c];
-    return sum / NUM_COMPONENTS;
+    return sum () / NUM_COMPONENTS;
   }
 
   Color clamp (intens_t max_intens) const
   {
     Color rval;
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      rval[c] = min (_components[c], max_intens);
+    min (_components, Color (max_intens)._components, rval._components);
     return rval;
   }
   Color clamp (float min_intens, float max_intens) const
   {
     Color rval;
-    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
-      rval[c] = min (max (_components[c], min_intens), max_intens);
+    max (_components, Color (min_intens)._components, rval._components);
+    min (rval._components, Color (max_intens)._components, rval._components);
     return rval;
   }
 
@@ -192,17 +201,27 @@ public:
   {
     component_t min_comp = _components[0];
     for (unsigned c = 1; c < NUM_COMPONENTS; c++)
-      min_comp = min (_components[c], min_comp);
+      min_comp = snogray::min (_components[c], min_comp);
     return min_comp;
   }
   component_t max_component () const
   {
     component_t max_comp = _components[0];
     for (unsigned c = 1; c < NUM_COMPONENTS; c++)
-      max_comp = max (_components[c], max_comp);
+      max_comp = snogray::max (_components[c], max_comp);
     return max_comp;
   }
 
+  // Return the sum of all color components.
+  //
+  component_t sum () const
+  {
+    component_t sum = _components[0];
+    for (unsigned c = 1; c < NUM_COMPONENTS; c++)
+      sum += _components[c];
+    return sum;
+  }
+
   // Array access to color components.
   //
   component_t &operator[] (unsigned c) { return _components[c]; }
@@ -218,14 +237,165 @@ public:
   //
   void set_rgb (component_t r, component_t g, component_t b);
 
+  // Vector operations on whole component arrays, which are used to
+  // implement color arithmetic.  Each combines the components of X and
+  // Y (or X and the scalar S), and stores the result in RESULT, which
+  // may be the same as X or Y.  Padding components of X and Y are
+  // ignored, and those of RESULT are undefined.
+  //
+  // Division by a zero component yields zero.
+  //
+  static void add (const component_t *x, const component_t *y,
+		   component_t *result);
+  static void sub (const component_t *x, const component_t *y,
+		   component_t *result);
+  static void mul (const component_t *x, const component_t *y,
+		   component_t *result);
+  static void div (const component_t *x, const component_t *y,
+		   component_t *result);
+  static void min (const component_t *x, const component_t *y,
+		   component_t *result);
+  static void max (const component_t *x, const component_t *y,
+		   component_t *result);
+  static void scale_by (const component_t *x, component_t s,
+			component_t *result);
+
+  // Return a pointer to the component array.
+  //
+  component_t *components () { return _components; }
+  const component_t *components () const { return _components; }
+
 private:
 
+  // Set all components to VAL.
+  //
+  void fill (component_t val)
+  {
+    for (unsigned c = 0; c < NUM_COMPONENTS; c++)
+      _components[c] = val;
+  }
+
+#if USE_SSE_COLOR
+
+  // Return the VECTOR_WIDTH components starting at COMPS[C] as an SSE
+  // vector, with any padding components replaced by zero, so that
+  // their undefined values can't cause floating-point exceptions or
+  // slow denormal arithmetic.  As C is constant after the vector
+  // loops are unrolled, the masking disappears except in the last
+  // vector of a color with padding.
+  //
+  static __m128 load_vector (const component_t *comps, unsigned c)
+  {
+    __m128 v = _mm_loadu_ps (comps + c);
+    if (c + VECTOR_WIDTH > NUM_COMPONENTS)
+      v = _mm_and_ps (v, _mm_cmplt_ps (_mm_set_ps (3, 2, 1, 0),
+				       _mm_set1_ps (NUM_COMPONENTS - c)));
+    return v;
+  }
+
+#endif // USE_SSE_COLOR
+
   // Array components.
   //
-  component_t _components[NUM_COMPONENTS];
+  component_t _components[STORED_COMPONENTS];
 };
 
 
+
+// Vector operations
+
+#if USE_SSE_COLOR
+
+// Define the Color vector operation NAME using the SSE expression
+// EXPR, which can refer to the vector variables X and Y.
+//
+#define DEF_COLOR_VECTOR_OP(name, expr)					\
+  inline void								\
+  Color::name (const component_t *x_comps, const component_t *y_comps,	\
+	       component_t *result)					\
+  {									\
+    for (unsigned c = 0; c < STORED_COMPONENTS; c += VECTOR_WIDTH)	\
+      {									\
+	__m128 x = load_vector (x_comps, c);				\
+	__m128 y = load_vector (y_comps, c);				\
+	_mm_storeu_ps (result + c, expr);				\
+      }									\
+  }
+
+DEF_COLOR_VECTOR_OP (add, _mm_add_ps (x, y))
+DEF_COLOR_VECTOR_OP (sub, _mm_sub_ps (x, y))
+DEF_COLOR_VECTOR_OP (mul, _mm_mul_ps (x, y))
+DEF_COLOR_VECTOR_OP (min, _mm_min_ps (x, y))
+DEF_COLOR_VECTOR_OP (max, _mm_max_ps (x, y))
+
+#undef DEF_COLOR_VECTOR_OP
+
+// For division, zero components of Y are replaced with one before
+// dividing (so no division by zero actually happens), and the
+// corresponding result components are then masked to zero.
+//
+inline void
+Color::div (const component_t *x, const component_t *y, component_t *result)
+{
+  __m128 zero = _mm_setzero_ps (), one = _mm_set1_ps (1.f);
+  for (unsigned c = 0; c < STORED_COMPONENTS; c += VECTOR_WIDTH)
+    {
+      __m128 yv = load_vector (y, c);
+      __m128 y_zero = _mm_cmpeq_ps (yv, zero);
+      __m128 safe_y = _mm_or_ps (_mm_andnot_ps (y_zero, yv),
+				 _mm_and_ps (y_zero, one));
+      __m128 quot = _mm_div_ps (load_vector (x, c), safe_y);
+      _mm_storeu_ps (result + c, _mm_andnot_ps (y_zero, quot));
+    }
+}
+
+inline void
+Color::scale_by (const component_t *x, component_t s, component_t *result)
+{
+  __m128 sv = _mm_set1_ps (s);
+  for (unsigned c = 0; c < STORED_COMPONENTS; c += VECTOR_WIDTH)
+    _mm_storeu_ps (result + c, _mm_mul_ps (load_vector (x, c), sv));
+}
+
+#else // !USE_SSE_COLOR
+
+// Define the Color vector operation NAME using the scalar expression
+// EXPR, which can refer to the component values X and Y.
+//
+#define DEF_COLOR_VECTOR_OP(name, expr)					\
+  inline void								\
+  Color::name (const component_t *x_comps, const component_t *y_comps,	\
+	       component_t *result)					\
+  {									\
+    for (unsigned c = 0; c < NUM_COMPONENTS; c++)			\
+      {									\
+	component_t x = x_comps[c], y = y_comps[c];			\
+	result[c] = expr;						\
+      }									\
+  }
+
+DEF_COLOR_VECTOR_OP (add, x + y)
+DEF_COLOR_VECTOR_OP (sub, x - y)
+DEF_COLOR_VECTOR_OP (mul, x * y)
+DEF_COLOR_VECTOR_OP (div, (y == 0) ? 0 : x / y)
+DEF_COLOR_VECTOR_OP (min, snogray::min (x, y))
+DEF_COLOR_VECTOR_OP (max, snogray::max (x, y))
+
+#undef DEF_COLOR_VECTOR_OP
+
+inline void
+Color::scale_by (const component_t *x, component_t s, component_t *result)
+{
+  for (unsigned c = 0; c < NUM_COMPONENTS; c++)
+    result[c] = x[c] * s;
+}
+
+#endif // USE_SSE_COLOR
+
+
+
+// Comparison
+
 inline bool operator== (const Color &col1, const Color &col2)
 {
   for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
@@ -240,13 +410,7 @@ inline bool operator!= (const Color &col1, const Color &col2)
 
 inline bool operator> (const Color &col1, const Color &col2)
 {
-  Color::component_t sum1 = col1[0], sum2 = col2[0];
-  for (unsigned c = 1; c < Color::NUM_COMPONENTS; c++)
-    {
-      sum1 += col1[c];
-      sum2 += col2[c];
-    }
-  return sum1 > sum2;
+  return col1.sum () > col2.sum ();
 }
 inline bool operator<= (const Color &col1, const Color &col2)
 {
@@ -255,13 +419,7 @@ inline bool operator<= (const Color &col1, const Color &col2)
 
 inline bool operator< (const Color &col1, const Color &col2)
 {
-  Color::component_t sum1 = col1[0], sum2 = col2[0];
-  for (unsigned c = 1; c < Color::NUM_COMPONENTS; c++)
-    {
-      sum1 += col1[c];
-      sum2 += col2[c];
-    }
-  return sum1 < sum2;
+  return col1.sum () < col2.sum ();
 }
 inline bool operator>= (const Color &col1, const Color &col2)
 {
@@ -269,33 +427,32 @@ inline bool operator>= (const Color &col1, const Color &col2)
 }
 
 
+
+// Arithmetic
+
 inline Color operator+ (const Color &col1, const Color &col2)
 {
   Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col1[c] + col2[c];
+  Color::add (col1.components (), col2.components (), rval.components ());
   return rval;
 }
 inline Color operator- (const Color &col1, const Color &col2)
 {
   Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col1[c] - col2[c];
+  Color::sub (col1.components (), col2.components (), rval.components ());
   return rval;
 }
 
 inline Color operator* (const Color &col1, const Color &filter)
 {
   Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col1[c] * filter[c];
+  Color::mul (col1.components (), filter.components (), rval.components ());
   return rval;
 }
 inline Color operator/ (const Color &col1, const Color &filter)
 {
   Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = (filter[c] == 0) ? 0 : col1[c] / filter[c];
+  Color::div (col1.components (), filter.components (), rval.components ());
   return rval;
 }
 
@@ -306,44 +463,28 @@ inline Color operator/ (const Color &col1, const Color &filter)
 inline Color operator* (const Color &col, float scale)
 {
   Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col[c] * scale;
+  Color::scale_by (col.components (), scale, rval.components ());
   return rval;
 }
 inline Color operator* (float scale, const Color &col)
 {
-  Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col[c] * scale;
-  return rval;
+  return col * scale;
 }
 inline Color operator* (const Color &col, double scale)
 {
-  Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col[c] * Color::component_t (scale);
-  return rval;
+  return col * Color::component_t (scale);
 }
 inline Color operator* (double scale, const Color &col)
 {
-  Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col[c] * Color::component_t (scale);
-  return rval;
+  return col * Color::component_t (scale);
 }
 inline Color operator* (const Color &col, int scale)
 {
-  Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col[c] * scale;
-  return rval;
+  return col * Color::component_t (scale);
 }
 inline Color operator* (int scale, const Color &col)
 {
-  Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = col[c] * scale;
-  return rval;
+  return col * Color::component_t (scale);
 }
 
 // Similarly for division by a scalar.
@@ -392,14 +533,6 @@ inline Color fmod (const Color &col1, const Color &col2)
   return rval;
 }
 
-inline Color abs (const Color &col)
-{
-  Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = abs (col[c]);
-  return rval;
-}
-
 inline Color sqrt (const Color &col)
 {
   Color rval;
@@ -411,19 +544,22 @@ inline Color sqrt (const Color &col)
 inline Color max (const Color &col1, const Color &col2)
 {
   Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = max (col1[c], col2[c]);
+  Color::max (col1.components (), col2.components (), rval.components ());
   return rval;
 }
 
 inline Color min (const Color &col1, const Color &col2)
 {
   Color rval;
-  for (unsigned c = 0; c < Color::NUM_COMPONENTS; c++)
-    rval[c] = min (col1[c], col2[c]);
+  Color::min (col1.components (), col2.components (), rval.components ());
   return rval;
 }
 
+inline Color abs (const Color &col)
+{
+  return max (col, -col);
+}
+
 
 // An adaptor for converting Colors to/from tuples of type DT*.
 //
@@ -444,8 +580,14 @@ public:
 
   TupleAdaptor &operator= (const Color &col)
   {
+#if SPECTRAL_SAMPLES
+    tuple[0] = col.r ();
+    tuple[1] = col.g ();
+    tuple[2] = col.b ();
+#else
     for (unsigned c = 0; c < TUPLE_LEN; c++)
       tuple[c] = col[c];
+#endif
     return *this;
   }
 
@@ -0,0 +1,264 @@
+// distbench.cc -- Benchmark for 2d histogram sampling distributions
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <getopt.h>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+
+#include "cli/build-info.h"
+#include "image/image.h"
+#include "util/random.h"
+#include "util/timeval.h"
+#include "util/radical-inverse.h"
+#include "geometry/hist-2d.h"
+#include "geometry/hist-2d-dist.h"
+#include "geometry/hist-2d-alias-dist.h"
+
+using namespace snogray;
+
+
+// usage/help messages
+
+static void
+usage (const char *prog_name, std::ostream &os)
+{
+  os << "Usage: " << prog_name << " [OPTION...] [INPUT_IMAGE]" << std::endl;
+}
+
+static void
+try_help (const char *prog_name, std::ostream &os)
+{
+  os << "Try '" << prog_name << " --help' for more information."
+     << std::endl;
+}
+
+static void
+help (const char *prog_name, std::ostream &os)
+{
+  usage (prog_name, os);
+
+  // These macros just makes the source code for help output easier to line up
+  //
+#define s  << std::endl <<
+#define n  << std::endl
+
+  os <<
+  "Compare the speed of the 2d histogram sampling distributions used for"
+s "environment-map lighting (Hist2dDist and Hist2dAliasDist)."
+n
+s "If INPUT_IMAGE is given, it is used as a latitude-longitude environment"
+s "map, otherwise a synthetic HDR environment map is used."
+n
+s "  -n, --samples=NUM          Take NUM samples (default 10000000)"
+s "  -s, --size=WxH             Size of synthetic envmap (default 4096x2048)"
+n
+s "      --help                 Output this help message"
+s "      --version              Output program version"
+n
+    ;
+
+#undef s
+#undef n
+}
+
+#define OPT_HELP	-10
+#define OPT_VERSION	-11
+
+static struct option long_options[] = {
+  { "samples",		required_argument, 0, 'n' },
+  { "size",		required_argument, 0, 's' },
+  { "help",		no_argument, 	   0, OPT_HELP },
+  { "version",		no_argument, 	   0, OPT_VERSION },
+  { 0, 0, 0, 0 }
+};
+static char short_options[] = "n:s:";
+
+
+
+// Histogram setup
+
+// Return a histogram of the intensity of the latitude-longitude
+// environment map IMAGE, weighted to reflect the area distortion of
+// the mapping (as EnvmapLight does).
+//
+static Hist2d
+image_histogram (const Image &image)
+{
+  unsigned w = image.width, h = image.height;
+
+  Hist2d hist (w, h);
+
+  double row_lat_inc = PI / h;
+  double row_lat = -PI/2 + row_lat_inc/2;
+
+  for (unsigned row = 0; row < h; row++)
+    {
+      float row_scale = float (cos (row_lat));
+      for (unsigned col = 0; col < w; col++)
+	{
+	  Color color = image (col, row);
+	  hist.add (col, row, color.intensity () * row_scale);
+	}
+      row_lat += row_lat_inc;
+    }
+
+  return hist;
+}
+
+// Return a histogram for a synthetic W x H HDR environment map, with a
+// dim, noisy, sky, and a few very bright small "suns", which is the
+// sort of distribution that makes importance sampling worthwhile.
+//
+static Hist2d
+synthetic_histogram (unsigned w, unsigned h)
+{
+  Hist2d hist (w, h);
+
+  Random rng (1);
+
+  double row_lat_inc = PI / h;
+  double row_lat = -PI/2 + row_lat_inc/2;
+
+  for (unsigned row = 0; row < h; row++)
+    {
+      float row_scale = float (cos (row_lat));
+      for (unsigned col = 0; col < w; col++)
+	hist.add (col, row, (0.5f + rng ()) * row_scale);
+      row_lat += row_lat_inc;
+    }
+
+  for (unsigned i = 0; i < 4; i++)
+    {
+      unsigned sun_col = rng (w), sun_row = rng (h / 2);
+      unsigned radius = max (w / 512, 1u);
+
+      for (unsigned row = sun_row; row < min (sun_row + radius, h); row++)
+	for (unsigned col = sun_col; col < min (sun_col + radius, w); col++)
+	  hist.add (col, row, 50000.f);
+    }
+
+  return hist;
+}
+
+
+
+// Benchmarking
+
+// Time sampling, and PDF evaluation, of DIST using NUM_SAMPLES samples,
+// and print the results on std::cout, labelled with NAME.
+//
+template<class Dist>
+static void
+bench (const char *name, const Hist2d &hist, unsigned num_samples)
+{
+  Timeval beg_time (Timeval::TIME_OF_DAY);
+
+  Dist dist (hist);
+
+  Timeval built_time (Timeval::TIME_OF_DAY);
+
+  // Accumulate results, so the compiler can't optimize the loops away.
+  //
+  double check_sum = 0;
+
+  for (unsigned i = 0; i < num_samples; i++)
+    {
+      float pdf;
+      UV param (radical_inverse (i + 1, 2), radical_inverse (i + 1, 3));
+      UV pos = dist.sample (param, pdf);
+      check_sum += double (pos.u + pos.v + pdf);
+    }
+
+  Timeval sampled_time (Timeval::TIME_OF_DAY);
+
+  for (unsigned i = 0; i < num_samples; i++)
+    {
+      UV pos (radical_inverse (i + 1, 5), radical_inverse (i + 1, 7));
+      check_sum += double (dist.pdf (pos));
+    }
+
+  Timeval end_time (Timeval::TIME_OF_DAY);
+
+  double build = built_time - beg_time;
+  double sample = sampled_time - built_time;
+  double pdf = end_time - sampled_time;
+
+  std::cout << std::setw (16) << std::left << name << std::right
+	    << std::fixed << std::setprecision (3)
+	    << "  build " << std::setw (7) << build << "s"
+	    << "  sample " << std::setw (7) << sample << "s"
+	    << " (" << std::setw (6) << std::setprecision (1)
+	    << sample * 1e9 / num_samples << " ns)"
+	    << std::setprecision (3)
+	    << "  pdf " << std::setw (7) << pdf << "s"
+	    << " (" << std::setw (6) << std::setprecision (1)
+	    << pdf * 1e9 / num_samples << " ns)"
+	    << "  [" << std::setprecision (0) << check_sum << "]"
+	    << std::endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+  const char *prog_name = argv[0];
+  unsigned num_samples = 10000000;
+  unsigned width = 4096, height = 2048;
+
+  int opt;
+  while ((opt = getopt_long (argc, argv, short_options, long_options, 0)) != -1)
+    switch (opt)
+      {
+      case 'n':
+	num_samples = atoi (optarg);
+	break;
+      case 's':
+	if (sscanf (optarg, "%ux%u", &width, &height) != 2
+	    || width == 0 || height == 0)
+	  {
+	    std::cerr << prog_name << ": " << optarg
+		      << ": Invalid size" << std::endl;
+	    exit (1);
+	  }
+	break;
+      case OPT_HELP:
+	help (prog_name, std::cout);
+	exit (0);
+      case OPT_VERSION:
+	std::cout << prog_name << " (" << PACKAGE_NAME << ") "
+		  << build_info.get_string ("version", "???")
+		  << std::endl;
+	exit (0);
+      default:
+	try_help (prog_name, std::cerr);
+	exit (1);
+      }
+
+  if (optind < argc - 1)
+    {
+      usage (prog_name, std::cerr);
+      try_help (prog_name, std::cerr);
+      exit (1);
+    }
+
+  Hist2d hist = (optind < argc
+		 ? image_histogram (Image (argv[optind]))
+		 : synthetic_histogram (width, height));
+
+  std::cout << "histogram " << hist.width << " x " << hist.height
+	    << ", " << num_samples << " samples" << std::endl;
+
+  bench<Hist2dDist> ("Hist2dDist", hist, num_samples);
+  bench<Hist2dAliasDist> ("Hist2dAliasDist", hist, num_samples);
+
+  return 0;
+}
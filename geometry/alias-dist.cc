@@ -0,0 +1,106 @@
+// alias-dist.cc -- Discrete sampling distribution using the alias method
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "alias-dist.h"
+
+
+using namespace snogray;
+
+
+// Recalculate this distribution so that entry I has a probability
+// proportional to WEIGHTS[I].  No reference to WEIGHTS is kept.
+//
+// If all weights are zero, the distribution is empty.
+//
+void
+AliasDist::set_weights (const std::vector<float> &weights)
+{
+  unsigned num = weights.size ();
+
+  entries.assign (num, Entry ());
+  pdfs.assign (num, 0);
+
+  if (num == 0 || ! make_table (&weights[0], num, &entries[0], &pdfs[0]))
+    {
+      entries.clear ();
+      pdfs.clear ();
+    }
+}
+
+// Fill in the NUM alias-table entries in TABLE so that entry I has a
+// probability proportional to WEIGHTS[I], store the probability of
+// each entry in PDFS, and return true.  If all weights are zero,
+// TABLE and PDFS are left unchanged, and false is returned.
+//
+bool
+AliasDist::make_table (const float *weights, unsigned num,
+		       Entry *table, float *pdfs)
+{
+  double sum = 0;
+  for (unsigned i = 0; i < num; i++)
+    sum += double (weights[i]);
+
+  if (sum <= 0)
+    return false;
+
+  // SCALED[i] is the weight of entry I scaled so that the average is
+  // 1; entries with a scaled weight below 1 are "small", and must
+  // borrow some probability from a "large" entry (their alias).
+  //
+  std::vector<double> scaled (num);
+  std::vector<unsigned> small, large;
+
+  for (unsigned i = 0; i < num; i++)
+    {
+      pdfs[i] = float (double (weights[i]) / sum);
+      scaled[i] = double (weights[i]) * num / sum;
+      if (scaled[i] < 1)
+	small.push_back (i);
+      else
+	large.push_back (i);
+    }
+
+  while (!small.empty () && !large.empty ())
+    {
+      unsigned s = small.back ();
+      unsigned l = large.back ();
+      small.pop_back ();
+
+      table[s].threshold = float (scaled[s]);
+      table[s].alias = l;
+
+      // Entry L gave away the remainder of S's slot.
+      //
+      scaled[l] -= 1 - scaled[s];
+      if (scaled[l] < 1)
+	{
+	  large.pop_back ();
+	  small.push_back (l);
+	}
+    }
+
+  // Any entries left over (due to rounding errors) get their whole
+  // slot.
+  //
+  for (unsigned i = 0; i < small.size (); i++)
+    {
+      table[small[i]].threshold = 1;
+      table[small[i]].alias = small[i];
+    }
+  for (unsigned i = 0; i < large.size (); i++)
+    {
+      table[large[i]].threshold = 1;
+      table[large[i]].alias = large[i];
+    }
+
+  return true;
+}
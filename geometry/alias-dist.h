@@ -0,0 +1,196 @@
+// alias-dist.h -- Discrete sampling distribution using the alias method
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_ALIAS_DIST_H
+#define SNOGRAY_ALIAS_DIST_H
+
+#include <vector>
+
+
+namespace snogray {
+
+
+// A discrete sampling distribution over the integers 0 through N-1,
+// where each integer is chosen with a probability proportional to a
+// given weight.
+//
+// This uses Walker's "alias method", so sampling takes constant time,
+// regardless of the number of entries: an entry is chosen uniformly,
+// and then either it or its "alias" is returned, based on a
+// per-entry threshold.
+//
+class AliasDist
+{
+public:
+
+  // An entry in an alias table.  The probability of each entry is
+  // kept in a separate array, as sampling doesn't need it.
+  //
+  struct Entry
+  {
+    Entry () : threshold (1), alias (0) { }
+
+    // If the fractional sample parameter is less than THRESHOLD, this
+    // entry is chosen, otherwise ALIAS is.
+    //
+    float threshold;
+    unsigned alias;
+  };
+
+  // Construct an empty distribution.  Weights can later be added
+  // using AliasDist::set_weights.
+  //
+  AliasDist () { }
+
+  // Make a distribution where entry I has a probability proportional
+  // to WEIGHTS[I].  No reference to WEIGHTS is kept.
+  //
+  AliasDist (const std::vector<float> &weights) { set_weights (weights); }
+
+  // Recalculate this distribution so that entry I has a probability
+  // proportional to WEIGHTS[I].  No reference to WEIGHTS is kept.
+  //
+  // If all weights are zero, the distribution is empty.
+  //
+  void set_weights (const std::vector<float> &weights);
+
+  // Return an entry chosen using the parameter PARAM, which should be
+  // in the range [0, 1).
+  //
+  // A new parameter, which is also uniformly distributed in the range
+  // [0, 1), is returned in REMAINING_PARAM; this can be used for
+  // further sampling.
+  //
+  // As both the entry, and the choice between it and its alias, come
+  // from the single float PARAM, this loses accuracy for very large
+  // distributions (more than a few thousand entries); for those, the
+  // two-parameter variant below should be used instead.
+  //
+  unsigned sample (float param, float &remaining_param) const
+  {
+    unsigned num = entries.size ();
+
+    float scaled = param * num;
+    unsigned index = unsigned (scaled);
+    if (index >= num)
+      index = num - 1;
+
+    const Entry &entry = entries[index];
+
+    // Reuse the fractional part of SCALED to choose between INDEX and
+    // its alias.
+    //
+    float frac = scaled - index;
+    if (frac < entry.threshold || entry.threshold >= 1)
+      {
+	// Note that FRAC can only be 1 or more due to rounding errors,
+	// when PARAM is very close to 1.
+	//
+	remaining_param = frac < 1 ? frac / entry.threshold : 0;
+	return index;
+      }
+    else
+      {
+	remaining_param = (frac - entry.threshold) / (1 - entry.threshold);
+	return entry.alias;
+      }
+  }
+
+  // Return an entry chosen using the parameters INDEX_PARAM and
+  // ALIAS_PARAM, which should both be in the range [0, 1).  INDEX_PARAM
+  // is used to choose an entry, and ALIAS_PARAM to choose between it
+  // and its alias, so this variant works for distributions of any size.
+  //
+  // A new parameter derived from ALIAS_PARAM, which is also uniformly
+  // distributed in the range [0, 1), is returned in REMAINING_PARAM.
+  //
+  unsigned sample (float index_param, float alias_param,
+		   float &remaining_param)
+    const
+  {
+    return sample (&entries[0], entries.size (), index_param, alias_param,
+		   remaining_param);
+  }
+
+  // Return an entry chosen using the parameter PARAM, which should be
+  // in the range [0, 1).
+  //
+  unsigned sample (float param) const
+  {
+    float remaining_param;
+    return sample (param, remaining_param);
+  }
+
+  // Return the probability of choosing entry INDEX.
+  //
+  float pdf (unsigned index) const { return pdfs[index]; }
+
+  // Return the number of entries in this distribution.
+  //
+  unsigned size () const { return entries.size (); }
+
+  // Return true if sampling this distribution is not possible.
+  //
+  bool empty () const { return entries.empty (); }
+
+  // Fill in the NUM alias-table entries in TABLE so that entry I has
+  // a probability proportional to WEIGHTS[I], store the probability of
+  // each entry in PDFS, and return true.  If all weights are zero,
+  // TABLE and PDFS are left unchanged, and false is returned.
+  //
+  // This, and the static variant of AliasDist::sample below, are for
+  // classes which keep many alias tables in a single array, rather
+  // than using separate AliasDist objects.
+  //
+  static bool make_table (const float *weights, unsigned num,
+			  Entry *table, float *pdfs);
+
+  // Return an entry from the NUM alias-table entries in TABLE, chosen
+  // using the parameters INDEX_PARAM and ALIAS_PARAM, as with the
+  // two-parameter variant of AliasDist::sample.
+  //
+  static unsigned sample (const Entry *table, unsigned num,
+			  float index_param, float alias_param,
+			  float &remaining_param)
+  {
+    unsigned index = unsigned (index_param * num);
+    if (index >= num)
+      index = num - 1;
+
+    const Entry &entry = table[index];
+
+    if (alias_param < entry.threshold || entry.threshold >= 1)
+      {
+	remaining_param = alias_param < 1 ? alias_param / entry.threshold : 0;
+	return index;
+      }
+    else
+      {
+	remaining_param
+	  = (alias_param - entry.threshold) / (1 - entry.threshold);
+	return entry.alias;
+      }
+  }
+
+private:
+
+  std::vector<Entry> entries;
+
+  // The probability of choosing each entry.
+  //
+  std::vector<float> pdfs;
+};
+
+
+}
+
+#endif // SNOGRAY_ALIAS_DIST_H
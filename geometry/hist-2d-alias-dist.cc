@@ -0,0 +1,76 @@
+// hist-2d-alias-dist.cc -- Alias-method sampling distribution for a 2d histogram
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "hist-2d-alias-dist.h"
+
+
+using namespace snogray;
+
+
+// Calculate the PDF based from the histogram HIST.  No reference to
+// HIST is kept.
+//
+void
+Hist2dAliasDist::set_histogram (const Hist2d &hist)
+{
+  width = hist.width;
+  height = hist.height;
+  size = height * width;
+  column_width = width > 0 ? (1.f / width) : 0;
+  row_height = height > 0 ? (1.f / height) : 0;
+
+  col_tables.assign (size, AliasDist::Entry ());
+  bin_pdfs.assign (size, 0);
+
+  // Note, as with Hist2dDist, row sums are accumulated using
+  // double-precision floats, as HDR images can cause precision problems
+  // otherwise.
+  //
+  std::vector<float> row_sums (height);
+  std::vector<float> row_bins (width);
+
+  for (unsigned row = 0; row < height; row++)
+    {
+      double row_sum = 0;
+      for (unsigned col = 0; col < width; col++)
+	{
+	  float bin = hist (col, row);
+	  row_bins[col] = bin;
+	  row_sum += double (bin);
+	}
+
+      row_sums[row] = float (row_sum);
+
+      // A row whose bins are all zero can never be chosen, so its
+      // column table and pdfs are just left with the default values.
+      //
+      if (width > 0)
+	AliasDist::make_table (&row_bins[0], width,
+			       &col_tables[row * width], &bin_pdfs[row * width]);
+    }
+
+  row_dist.set_weights (row_sums);
+
+  // BIN_PDFS currently holds the probability of choosing each column
+  // within its row; turn that into the final pdf of each bin, which is
+  // the probability of choosing its row, times the probability of
+  // choosing its column within that row, divided by the bin area
+  // (1 / SIZE).
+  //
+  for (unsigned row = 0; row < height; row++)
+    {
+      float row_scale = row_dist.empty () ? 0 : row_dist.pdf (row) * size;
+      float *row_pdfs = &bin_pdfs[row * width];
+      for (unsigned col = 0; col < width; col++)
+	row_pdfs[col] *= row_scale;
+    }
+}
@@ -0,0 +1,189 @@
+// hist-2d-alias-dist.h -- Alias-method sampling distribution for a 2d histogram
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_HIST_2D_ALIAS_DIST_H
+#define SNOGRAY_HIST_2D_ALIAS_DIST_H
+
+#include <vector>
+
+#include "uv.h"
+#include "hist-2d.h"
+#include "alias-dist.h"
+
+
+namespace snogray {
+
+
+// A sampling distribution based on a 2d histogram, which is an
+// alternative to Hist2dDist with the same interface.
+//
+// Where Hist2dDist does binary searches over cumulative row and
+// column sums, this uses alias tables, one to choose a row, and then
+// one per row to choose a column within that row, so sampling takes
+// constant time, regardless of the size of the histogram.  It uses
+// somewhat more memory, and does not preserve the stratification of
+// the sample parameters as well.
+//
+// [A single alias table over all bins would be simpler, but with
+// typical environment-map sizes, a float sample parameter doesn't
+// have enough precision to both choose a bin and choose between the
+// bin and its alias.]
+//
+// The per-row column tables are all stored in a single array, and the
+// final pdf of every bin is stored in another, so PDF lookup is a
+// single access to a compact array.
+//
+class Hist2dAliasDist
+{
+public:
+
+  // Construct a default object, which is equivalent to all zeroes.
+  // A histogram can later be added using Hist2dAliasDist::set_histogram.
+  //
+  Hist2dAliasDist ()
+    : width (0), height (0), size (0), column_width (0), row_height (0)
+  { }
+
+  // This constructor copies the size from HIST, and calculates the
+  // PDF.  No reference to HIST is kept.
+  //
+  Hist2dAliasDist (const Hist2d &hist)
+    : width (0), height (0), size (0), column_width (0), row_height (0)
+  {
+    set_histogram (hist);
+  }
+
+  // Calculate the PDF based from the histogram HIST.  No reference to
+  // HIST is kept.
+  //
+  void set_histogram (const Hist2d &hist);
+
+  // Return a sample of this distribution based on the random
+  // variables in PARAM.  The PDF at the sample location is returned
+  // in _PDF.
+  //
+  // The returned UV coordinates should have roughly the same
+  // distribution as the input data (limited by the granularity of
+  // the histogram).
+  //
+  UV sample (const UV &param, float &_pdf) const
+  {
+    if (empty ())
+      {
+	_pdf = 0;
+	return UV (0, 0);
+      }
+
+    UV pos;
+    _pdf = bin_pdfs[sample_bin (param, pos)];
+    return pos;
+  }
+
+  // Return a sample of this distribution based on the random
+  // variables in PARAM.
+  //
+  // The returned UV coordinates should have roughly the same
+  // distribution as the input data (limited by the granularity of the
+  // histogram).
+  //
+  UV sample (const UV &param) const
+  {
+    if (empty ())
+      return UV (0, 0);
+
+    UV pos;
+    sample_bin (param, pos);
+    return pos;
+  }
+
+  // Return the PDF of this distribution at location POS.
+  //
+  float pdf (const UV &pos) const
+  {
+    if (empty ())
+      return 0;
+
+    unsigned col = clamp (int (pos.u * width), 0, int (width) - 1);
+    unsigned row = clamp (int (pos.v * height), 0, int (height) - 1);
+
+    return bin_pdfs[row * width + col];
+  }
+
+  // Return true if sampling this distribution will always return zero.
+  //
+  bool empty () const { return row_dist.empty (); }
+
+private:
+
+  // Choose a bin using PARAM, and return a uniformly distributed
+  // position within it in POS.  The bin's index is returned.
+  //
+  unsigned sample_bin (const UV &param, UV &pos) const
+  {
+    // Rows are chosen using PARAM.v alone, which leaves a new
+    // parameter, ROW_PARAM, for further use.
+    //
+    float row_param;
+    unsigned row = row_dist.sample (param.v, row_param);
+
+    // Rows may be several thousand bins wide, so columns are chosen
+    // using the two-parameter variant of AliasDist::sample:  PARAM.u
+    // chooses a column-table entry, and ROW_PARAM chooses between it
+    // and its alias.  What's left of ROW_PARAM is then used for the
+    // vertical position within the bin.
+    //
+    unsigned row_offs = row * width;
+    float v_offs;
+    unsigned col
+      = AliasDist::sample (&col_tables[row_offs], width,
+			   param.u, row_param, v_offs);
+
+    // The fractional part of PARAM.u within the chosen column-table
+    // entry is uniformly distributed, and independent of the alias
+    // choice, so is used for the horizontal position within the bin.
+    //
+    float u_scaled = param.u * width;
+    float u_offs = min (u_scaled - floor (u_scaled), 1.f);
+
+    pos = UV ((col + u_offs) * column_width, (row + v_offs) * row_height);
+
+    return row_offs + col;
+  }
+
+  // Size of input histogram.
+  //
+  unsigned width, height, size;
+
+  // Height/width of element in the input histogram, if the entire
+  // histogram occupies a 1-by-1 unit square.
+  //
+  float column_width, row_height;
+
+  // Distribution for choosing a row.
+  //
+  AliasDist row_dist;
+
+  // For each row, an alias table of WIDTH entries for choosing a
+  // column within that row (given that the row has been chosen), all
+  // stored consecutively.
+  //
+  std::vector<AliasDist::Entry> col_tables;
+
+  // The pdf of each bin, in row-major order.
+  //
+  std::vector<float> bin_pdfs;
+};
+
+
+}
+
+#endif // SNOGRAY_HIST_2D_ALIAS_DIST_H
@@ -30,35 +30,53 @@ class TRay
 public:
 
   TRay (TPos<T> _origin, TVec<T> _extent)
-    : origin (_origin), dir (_extent.unit ()), t0 (0), t1 (_extent.length ())
+    : origin (_origin), dir (_extent.unit ()), t0 (0), t1 (_extent.length ()),
+      cone_width (0), cone_spread (0)
   {
   }
   TRay (TPos<T> _origin, TVec<T> _dir, T _t1)
-    : origin (_origin), dir (_dir), t0 (0), t1 (_t1)
+    : origin (_origin), dir (_dir), t0 (0), t1 (_t1),
+      cone_width (0), cone_spread (0)
   {
   }
   TRay (TPos<T> _origin, TVec<T> _dir, T _t0, T _t1)
-    : origin (_origin), dir (_dir), t0 (_t0), t1 (_t1)
+    : origin (_origin), dir (_dir), t0 (_t0), t1 (_t1),
+      cone_width (0), cone_spread (0)
   {
   }
   TRay (TPos<T> _origin, TPos<T> _targ)
     : origin (_origin), dir ((_targ - _origin).unit ()),
-      t0 (0), t1 ((_targ - _origin).length ())
+      t0 (0), t1 ((_targ - _origin).length ()),
+      cone_width (0), cone_spread (0)
   {
   }
   TRay (const TRay &ray)
-    : origin (ray.origin), dir (ray.dir), t0 (ray.t0), t1 (ray.t1)
+    : origin (ray.origin), dir (ray.dir), t0 (ray.t0), t1 (ray.t1),
+      cone_width (ray.cone_width), cone_spread (ray.cone_spread)
   {
   }
   TRay (const TRay &ray, T _t1)
-    : origin (ray.origin), dir (ray.dir), t0 (ray.t0), t1 (_t1)
+    : origin (ray.origin), dir (ray.dir), t0 (ray.t0), t1 (_t1),
+      cone_width (ray.cone_width), cone_spread (ray.cone_spread)
   {
   }
   TRay (const TRay &ray, T _t0, T _t1)
-    : origin (ray.origin), dir (ray.dir), t0 (_t0), t1 (_t1)
+    : origin (ray.origin), dir (ray.dir), t0 (_t0), t1 (_t1),
+      cone_width (ray.cone_width), cone_spread (ray.cone_spread)
   {
   }
 
+  TRay &operator= (const TRay &ray)
+  {
+    origin = ray.origin;
+    dir = ray.dir;
+    t0 = ray.t0;
+    t1 = ray.t1;
+    cone_width = ray.cone_width;
+    cone_spread = ray.cone_spread;
+    return *this;
+  }
+
   // Returns the location of this ray with parameter T.
   //
   TPos<T> operator() (T t) const { return origin + dir * t; }
@@ -76,7 +94,10 @@ public:
   //
   TRay transformed (const XformBase<T> &xform) const
   {
-    return TRay (xform (origin), xform (dir), t0, t1);
+    TRay xf_ray (xform (origin), xform (dir), t0, t1);
+    xf_ray.cone_width = cone_width;
+    xf_ray.cone_spread = cone_spread;
+    return xf_ray;
   }
 
   // The ray starts at ORIGIN, and points in the direction DIR.
@@ -87,6 +108,16 @@ public:
   // The "extent" of the ray:  from ORIGIN+T0*DIR to ORIGIN+T1*DIR.
   //
   T t0, t1;
+
+  // An optional "ray cone" around the ray, used to estimate how much
+  // of a surface the ray represents (e.g., for texture filtering).
+  // The width of the cone at parameter T is
+  // (CONE_WIDTH + T * CONE_SPREAD) * DIR.length().  As this is in terms
+  // of the ray parameter, it stays correct when the ray is transformed
+  // (though a non-uniform scale will make the cone elliptical, which
+  // isn't represented).  If both are zero, the ray has no cone.
+  //
+  float cone_width, cone_spread;
 };
 
 
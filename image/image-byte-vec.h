@@ -280,6 +280,16 @@ public:
   //
   virtual intens_t max_intens () const { return 1; }
 
+  // Return the number of bits of precision in each sample component
+  // stored in the file.
+  //
+  virtual unsigned sample_bits () const { return bits_per_component; }
+
+  // Return the gamma used to convert sample components stored in the
+  // file to linear values.
+  //
+  virtual float sample_gamma () const { return target_gamma; }
+
   // We define this, and our superclass calls it.
   //
   virtual void read_row (ImageRow &row);
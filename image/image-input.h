@@ -40,6 +40,17 @@ public:
   //
   bool has_alpha_channel () const { return source->has_alpha_channel (); }
 
+  // Return the number of bits of precision in each sample component
+  // stored in the file, or zero if samples are stored in a
+  // floating-point format.
+  //
+  unsigned sample_bits () const { return source->sample_bits (); }
+
+  // Return the gamma used to convert sample components stored in the
+  // file to linear values, or 1 if they are linear already.
+  //
+  float sample_gamma () const { return source->sample_gamma (); }
+
   // Return the row-order of this image file.
   //
   ImageIo::RowOrder row_order () const { return source->row_order (); }
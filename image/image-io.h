@@ -300,6 +300,17 @@ public:
 
   virtual void read_row (ImageRow &row) = 0;
 
+  // Return the number of bits of precision in each sample component
+  // stored in the file, or zero if samples are stored in a
+  // floating-point format.
+  //
+  virtual unsigned sample_bits () const { return 0; }
+
+  // Return the gamma used to convert sample components stored in the
+  // file to linear values, or 1 if they are linear already.
+  //
+  virtual float sample_gamma () const { return 1; }
+
 protected:
 
   ImageSource (const std::string &filename, const ValTable &)
@@ -0,0 +1,49 @@
+// srgb-byte.cc -- 8-bit sRGB-encoded matrix storage element
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "util/snogmath.h"
+
+#include "srgb-byte.h"
+
+
+using namespace snogray;
+
+
+float snogray::srgb_byte_decode_table[256];
+float snogray::srgb_byte_encode_thresholds[255];
+
+namespace { // keep local to file
+
+// Initializer for SRGB_BYTE_DECODE_TABLE and SRGB_BYTE_ENCODE_THRESHOLDS.
+//
+struct SrgbByteTablesInit
+{
+  SrgbByteTablesInit ()
+  {
+    for (unsigned i = 0; i < 256; i++)
+      {
+	float enc = float (i) / 255;
+	srgb_byte_decode_table[i]
+	  = (enc <= 0.04045f
+	     ? enc / 12.92f
+	     : pow ((enc + 0.055f) / 1.055f, 2.4f));
+      }
+
+    for (unsigned i = 0; i < 255; i++)
+      srgb_byte_encode_thresholds[i]
+	= (srgb_byte_decode_table[i] + srgb_byte_decode_table[i + 1]) * 0.5f;
+  }
+};
+
+SrgbByteTablesInit srgb_byte_tables_init;
+
+} // namespace
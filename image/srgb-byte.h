@@ -0,0 +1,64 @@
+// srgb-byte.h -- 8-bit sRGB-encoded matrix storage element
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_SRGB_BYTE_H
+#define SNOGRAY_SRGB_BYTE_H
+
+#include <algorithm>
+
+
+namespace snogray {
+
+
+// Table of linear values for each 8-bit sRGB-encoded value.
+//
+extern float srgb_byte_decode_table[256];
+
+// Table of thresholds used for encoding linear values as sRGB bytes;
+// entry I is halfway between the linear values of bytes I and I + 1.
+//
+extern float srgb_byte_encode_thresholds[255];
+
+
+// A single-byte storage element for matrices holding values in the
+// range 0-1, which are stored using the sRGB transfer function, and so
+// keep most of their precision in dark values.  This is intended for
+// textures loaded from 8-bit images, and uses a quarter of the memory
+// of float storage.
+//
+// Values are converted to/from float, in linear space, using tables;
+// values outside the range 0-1 are clamped.  Converting a decoded
+// value back to an SrgbByte always yields the original byte.
+//
+class SrgbByte
+{
+public:
+
+  SrgbByte () { }
+  SrgbByte (float linear)
+    : val (std::upper_bound (srgb_byte_encode_thresholds,
+			     srgb_byte_encode_thresholds + 255,
+			     linear)
+	   - srgb_byte_encode_thresholds)
+  { }
+
+  operator float () const { return srgb_byte_decode_table[val]; }
+
+private:
+
+  unsigned char val;
+};
+
+
+}
+
+#endif // SNOGRAY_SRGB_BYTE_H
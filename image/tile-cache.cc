@@ -0,0 +1,360 @@
+// tile-cache.cc -- Memory-limited cache of image tiles
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <cstdlib>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util/excepts.h"
+
+#include "tile-cache.h"
+
+
+using namespace snogray;
+
+
+TileCache::TileCache (size_t budget, unsigned _num_shards)
+  : shards (new Shard[_num_shards]), num_shards (_num_shards), _budget (0)
+{
+  set_budget (budget);
+}
+
+TileCache::~TileCache ()
+{
+  for (unsigned i = 0; i < num_shards; i++)
+    for (std::list<Tile *>::iterator ti = shards[i].lru.begin ();
+	 ti != shards[i].lru.end (); ++ti)
+      delete *ti;
+
+  delete[] shards;
+}
+
+// Return the global tile-cache used for image textures.
+//
+TileCache &
+TileCache::global ()
+{
+  static TileCache global_cache;
+  return global_cache;
+}
+
+// Set this cache's memory budget to BUDGET bytes.  If the cache is
+// currently larger than that, tiles are discarded lazily, as new
+// tiles are loaded.
+//
+void
+TileCache::set_budget (size_t budget)
+{
+  _budget = budget;
+
+  for (unsigned i = 0; i < num_shards; i++)
+    {
+      LockGuard guard (shards[i].lock);
+      shards[i].budget = budget / num_shards;
+    }
+}
+
+
+// Add TILE, whose key has been set, to SHARD's hash table and LRU
+// list.  SHARD must be locked.
+//
+void
+TileCache::insert (Shard &shard, Tile *tile)
+{
+  // If the hash table is getting crowded, double its size.
+  //
+  if (shard.lru.size () >= shard.buckets.size ())
+    {
+      std::vector<Tile *> old_buckets (shard.buckets.size () * 2, 0);
+      old_buckets.swap (shard.buckets);
+
+      for (std::vector<Tile *>::iterator bi = old_buckets.begin ();
+	   bi != old_buckets.end (); ++bi)
+	while (*bi)
+	  {
+	    Tile *moved = *bi;
+	    *bi = moved->hash_next;
+
+	    Tile *&bucket = key_bucket (shard, moved->key);
+	    moved->hash_next = bucket;
+	    bucket = moved;
+	  }
+    }
+
+  Tile *&bucket = key_bucket (shard, tile->key);
+  tile->hash_next = bucket;
+  bucket = tile;
+
+  shard.lru.push_front (tile);
+  tile->lru_pos = shard.lru.begin ();
+
+  shard.stats.size += tile->size;
+  if (shard.stats.size > shard.stats.peak_size)
+    shard.stats.peak_size = shard.stats.size;
+}
+
+// Remove TILE from SHARD's hash table and LRU list, and delete it.
+// SHARD must be locked.
+//
+void
+TileCache::discard (Shard &shard, Tile *tile)
+{
+  Tile **link = &key_bucket (shard, tile->key);
+  while (*link != tile)
+    link = &(*link)->hash_next;
+  *link = tile->hash_next;
+
+  shard.lru.erase (tile->lru_pos);
+  shard.stats.size -= tile->size;
+
+  delete tile;
+}
+
+// Discard the least-recently used tiles in SHARD until it's within
+// its budget, but never discard a pinned tile.  SHARD must be locked.
+//
+void
+TileCache::evict (Shard &shard)
+{
+  std::list<Tile *>::iterator li = shard.lru.end ();
+
+  while (shard.stats.size > shard.budget && li != shard.lru.begin ())
+    {
+      Tile *victim = *--li;
+
+      if (victim->pins == 0)
+	{
+	  // Move LI to the following tile, as VICTIM's entry is about
+	  // to be erased.
+	  //
+	  ++li;
+
+	  discard (shard, victim);
+	  shard.stats.evictions++;
+	}
+    }
+}
+
+// Discard all tiles belonging to SOURCE.  This must be called before
+// SOURCE is destroyed, and no tile from SOURCE may be pinned.
+//
+void
+TileCache::flush (const Source &source)
+{
+  for (unsigned i = 0; i < num_shards; i++)
+    {
+      Shard &shard = shards[i];
+      LockGuard guard (shard.lock);
+
+      std::list<Tile *>::iterator li = shard.lru.begin ();
+      while (li != shard.lru.end ())
+	{
+	  Tile *tile = *li++;
+	  if (tile->key.source == &source)
+	    discard (shard, tile);
+	}
+    }
+}
+
+// Return statistics about cache usage, summed over all shards.
+//
+TileCache::Stats
+TileCache::stats () const
+{
+  Stats sum;
+
+  for (unsigned i = 0; i < num_shards; i++)
+    {
+      Shard &shard = shards[i];
+      LockGuard guard (shard.lock);
+
+      sum.hits += shard.stats.hits;
+      sum.misses += shard.stats.misses;
+      sum.evictions += shard.stats.evictions;
+      sum.size += shard.stats.size;
+      sum.peak_size += shard.stats.peak_size;
+    }
+
+  return sum;
+}
+
+
+// Tile files
+
+// Return a file-name for a tile file corresponding to the image file
+// IMAGE_FILENAME.  VARIANT is included in the name, to distinguish
+// different tile files made from the same image.  If TILE_DIR is
+// empty, the name of a new temporary file is returned, and TEMPORARY
+// is set to true; otherwise TEMPORARY is set to false.
+//
+std::string
+TileCache::tile_file_name (const std::string &image_filename,
+			   const std::string &variant, bool &temporary)
+  const
+{
+  if (tile_dir.empty ())
+    {
+      const char *tmp_dir = getenv ("TMPDIR");
+      std::string templ = tmp_dir ? tmp_dir : "/tmp";
+      templ += "/snogray-tiles-XXXXXX";
+
+      std::vector<char> name (templ.begin (), templ.end ());
+      name.push_back ('\0');
+
+      int fd = mkstemp (&name[0]);
+      if (fd < 0)
+	throw file_error (templ + ": Cannot create temporary tile file");
+      close (fd);
+
+      temporary = true;
+
+      return std::string (&name[0]);
+    }
+
+  // Use a hash of the whole image filename, so that identically
+  // named images in different directories don't collide.
+  //
+  unsigned long hash = 5381;
+  for (std::string::const_iterator ci = image_filename.begin ();
+       ci != image_filename.end (); ++ci)
+    hash = hash * 33 + (unsigned char)*ci;
+
+  std::string base = image_filename;
+  std::string::size_type last_slash = base.find_last_of ("/");
+  if (last_slash != std::string::npos)
+    base.erase (0, last_slash + 1);
+
+  std::ostringstream name;
+  name << tile_dir << "/" << base << "." << std::hex << (hash & 0xFFFFFFFF)
+       << "." << variant << ".sgtile";
+
+  temporary = false;
+
+  return name.str ();
+}
+
+// Return in SIZE and MTIME the size and modification time of the
+// file FILENAME, which are used to notice when a tile file is out of
+// date.  If FILENAME cannot be found, both are set to zero.
+//
+void
+TileCache::file_stamp (const std::string &filename,
+		       unsigned long long &size, unsigned long long &mtime)
+{
+  struct stat st;
+  if (stat (filename.c_str (), &st) == 0)
+    {
+      size = st.st_size;
+      mtime = st.st_mtime;
+    }
+  else
+    size = mtime = 0;
+}
+
+
+// Pinning
+
+// Return the tile identified by KEY, loading it if necessary, and
+// increment its pin count.
+//
+TileCache::Tile *
+TileCache::pin (const Key &key)
+{
+  Shard &shard = key_shard (key);
+
+  UniqueLock lock (shard.lock);
+
+  for (;;)
+    {
+      for (Tile *tile = key_bucket (shard, key); tile; tile = tile->hash_next)
+	if (tile->key == key)
+	  {
+	    tile->pins++;
+
+	    // Move TILE to the front of the LRU list.
+	    //
+	    shard.lru.splice (shard.lru.begin (), shard.lru, tile->lru_pos);
+
+	    shard.stats.hits++;
+
+	    return tile;
+	  }
+
+      // If some other thread is already loading this tile, wait for
+      // it to finish, and then try again.
+      //
+      if (std::find (shard.loading.begin (), shard.loading.end (), key)
+	  == shard.loading.end ())
+	break;
+
+      shard.loaded.wait (lock);
+    }
+
+  // Load the tile with SHARD unlocked, so that other threads can use
+  // the shard meanwhile.  KEY is added to SHARD's loading list so that
+  // nobody else loads the same tile at the same time.
+  //
+  shard.loading.push_back (key);
+
+  lock.unlock ();
+
+  Tile *tile;
+  try
+    {
+      tile = key.source->load_tile (key.level, key.tx, key.ty);
+    }
+  catch (...)
+    {
+      lock.lock ();
+      end_load (shard, key);
+      throw;
+    }
+
+  lock.lock ();
+  end_load (shard, key);
+
+  tile->key = key;
+  tile->pins = 1;
+
+  insert (shard, tile);
+
+  shard.stats.misses++;
+
+  evict (shard);
+
+  return tile;
+}
+
+// Remove KEY from SHARD's list of tiles being loaded, and wake up
+// any threads waiting for it.  SHARD must be locked.
+//
+void
+TileCache::end_load (Shard &shard, const Key &key)
+{
+  shard.loading.erase (std::find (shard.loading.begin (), shard.loading.end (),
+				  key));
+  shard.loaded.notify_all ();
+}
+
+// Decrement TILE's pin count.
+//
+void
+TileCache::unpin (Tile *tile)
+{
+  Shard &shard = key_shard (tile->key);
+  LockGuard guard (shard.lock);
+  tile->pins--;
+}
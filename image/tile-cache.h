@@ -0,0 +1,366 @@
+// tile-cache.h -- Memory-limited cache of image tiles
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_TILE_CACHE_H
+#define SNOGRAY_TILE_CACHE_H
+
+#include <list>
+#include <vector>
+#include <string>
+
+#include "util/mutex.h"
+#include "util/cond-var.h"
+
+
+namespace snogray {
+
+
+// A cache of fixed-size image "tiles", loaded on demand from some
+// backing store, and discarded in least-recently-used order when the
+// total size of cached tiles exceeds a memory budget.
+//
+// Tiles are identified by their source, and a mip-map level and tile
+// coordinates within that source.  The cache is split into a number of
+// independently locked "shards", so that lookups from multiple threads
+// rarely contend; each shard gets an equal part of the memory budget,
+// and keeps its tiles in a hash table.
+//
+// Users access tiles through a TileCache::Pin object, which keeps the
+// tile it refers to from being discarded, without holding any lock.
+// A Pin remembers the last tile it found, so consecutive lookups in
+// the same tile don't need to consult the cache at all.
+//
+class TileCache
+{
+public:
+
+  class Source;
+
+private:
+
+  // Key used to find a tile.
+  //
+  struct Key
+  {
+    Key (const Source *_source, unsigned _level, unsigned _tx, unsigned _ty)
+      : source (_source), level (_level), tx (_tx), ty (_ty)
+    { }
+
+    bool operator== (const Key &key) const
+    {
+      return (source == key.source && level == key.level
+	      && tx == key.tx && ty == key.ty);
+    }
+
+    // Return a hash value for this key.
+    //
+    size_t hash () const
+    {
+      size_t h = reinterpret_cast<size_t> (source) / sizeof (void *);
+      h = h * 31 + level;
+      h = h * 31 + ty;
+      h = h * 31 + tx;
+      return h;
+    }
+
+    const Source *source;
+    unsigned level, tx, ty;
+  };
+
+  struct Shard;
+
+public:
+
+  // A single cached tile.  Sources subclass this to hold tile data.
+  //
+  class Tile
+  {
+  public:
+
+    Tile (size_t _size)
+      : size (_size), key (0, 0, 0, 0), pins (0), hash_next (0)
+    { }
+    virtual ~Tile () { }
+
+    // Number of bytes of memory used by this tile.
+    //
+    const size_t size;
+
+  private:
+
+    friend class TileCache;
+    friend class Pin;
+
+    // The key identifying this tile.
+    //
+    Key key;
+
+    // Number of Pin objects currently referring to this tile; a tile
+    // is never discarded while this is non-zero.  Protected by the
+    // tile's shard lock.
+    //
+    unsigned pins;
+
+    // Next tile in the same hash bucket of this tile's shard.
+    //
+    Tile *hash_next;
+
+    // Position of this tile in its shard's LRU list.
+    //
+    std::list<Tile *>::iterator lru_pos;
+  };
+
+  // A source of tiles.
+  //
+  class Source
+  {
+  public:
+
+    virtual ~Source () { }
+
+    // Return a new tile containing the data for tile (TX, TY) of
+    // mip-map level LEVEL.  The caller takes ownership of the result.
+    //
+    virtual Tile *load_tile (unsigned level, unsigned tx, unsigned ty)
+      const = 0;
+  };
+
+  // A Pin refers to a single tile in the cache, which cannot be
+  // discarded as long as the Pin refers to it.  No lock is held while
+  // the tile is pinned.
+  //
+  // A Pin is typically a local variable used for a group of related
+  // lookups (e.g., all the texels used for a single texture lookup),
+  // and must not be shared between threads.
+  //
+  class Pin
+  {
+  public:
+
+    Pin () : tile (0), cache (0) { }
+    ~Pin () { release (); }
+
+    // Return the tile (TX, TY) of mip-map level LEVEL from SOURCE in
+    // CACHE, loading it if necessary, and pin it, releasing any tile
+    // previously pinned.  If that tile is already pinned, it is just
+    // returned, without consulting the cache.
+    //
+    const Tile *get (TileCache &_cache, const Source &source,
+		     unsigned level, unsigned tx, unsigned ty)
+    {
+      if (! (tile && tile->key == Key (&source, level, tx, ty)))
+	{
+	  release ();
+	  tile = _cache.pin (Key (&source, level, tx, ty));
+	  cache = &_cache;
+	}
+      return tile;
+    }
+
+    // Release the tile currently pinned, if any.
+    //
+    void release ()
+    {
+      if (tile)
+	{
+	  cache->unpin (tile);
+	  tile = 0;
+	}
+    }
+
+  private:
+
+    // Pins can't be copied.
+    //
+    Pin (const Pin &);
+    Pin &operator= (const Pin &);
+
+    // The currently pinned tile, or zero if none, and the cache it
+    // belongs to.
+    //
+    Tile *tile;
+    TileCache *cache;
+  };
+
+  // Statistics about cache usage.
+  //
+  struct Stats
+  {
+    Stats () : hits (0), misses (0), evictions (0), size (0), peak_size (0) { }
+
+    unsigned long long hits, misses, evictions;
+
+    // Current and maximum total size of cached tiles, in bytes.  As
+    // the maximum is tracked separately for each shard, the maximum
+    // returned by TileCache::stats is an upper bound.
+    //
+    size_t size, peak_size;
+  };
+
+  // Make a new cache with a memory budget of BUDGET bytes.  If BUDGET
+  // is zero, the cache is considered disabled, although lookups will
+  // still work (pinned tiles are never discarded).
+  //
+  TileCache (size_t budget = 0, unsigned num_shards = DEFAULT_NUM_SHARDS);
+  ~TileCache ();
+
+  // Return the global tile-cache used for image textures.
+  //
+  static TileCache &global ();
+
+  // Set this cache's memory budget to BUDGET bytes.  If the cache is
+  // currently larger than that, tiles are discarded lazily, as new
+  // tiles are loaded.
+  //
+  void set_budget (size_t budget);
+
+  // Return this cache's memory budget, in bytes.
+  //
+  size_t budget () const { return _budget; }
+
+  // Return true if this cache is enabled (has a non-zero budget).
+  //
+  bool enabled () const { return _budget != 0; }
+
+  // Discard all tiles belonging to SOURCE.  This must be called before
+  // SOURCE is destroyed, and no tile from SOURCE may be pinned.
+  //
+  void flush (const Source &source);
+
+  // Return statistics about cache usage, summed over all shards.
+  //
+  Stats stats () const;
+
+  // Directory where converted "tile files" for image textures are
+  // stored, so that they may be reused by later runs.  If empty,
+  // temporary files are used instead, and deleted when no longer
+  // needed.
+  //
+  std::string tile_dir;
+
+  // Return a file-name for a tile file corresponding to the image file
+  // IMAGE_FILENAME.  VARIANT is included in the name, to distinguish
+  // different tile files made from the same image.  If TILE_DIR is
+  // empty, the name of a new temporary file is returned, and TEMPORARY
+  // is set to true; otherwise TEMPORARY is set to false.
+  //
+  std::string tile_file_name (const std::string &image_filename,
+			      const std::string &variant, bool &temporary)
+    const;
+
+  // Return in SIZE and MTIME the size and modification time of the
+  // file FILENAME, which are used to notice when a tile file is out of
+  // date.  If FILENAME cannot be found, both are set to zero.
+  //
+  static void file_stamp (const std::string &filename,
+			  unsigned long long &size, unsigned long long &mtime);
+
+private:
+
+  static const unsigned DEFAULT_NUM_SHARDS = 64;
+
+  // Initial number of hash buckets in each shard; must be a power of
+  // two.
+  //
+  static const unsigned INITIAL_NUM_BUCKETS = 16;
+
+  // One independently locked part of the cache.
+  //
+  struct Shard
+  {
+    Shard () : buckets (INITIAL_NUM_BUCKETS, 0), budget (0) { }
+
+    Mutex lock;
+
+    // Hash table of tiles in this shard, chained through
+    // Tile::hash_next.  The number of buckets is always a power of
+    // two, and is doubled when there are more tiles than buckets.
+    //
+    std::vector<Tile *> buckets;
+
+    // Tiles in this shard, most recently used first.
+    //
+    std::list<Tile *> lru;
+
+    // Keys of tiles currently being loaded by some thread.  Threads
+    // wanting one of these tiles wait on LOADED, which is notified
+    // whenever a load finishes.
+    //
+    std::vector<Key> loading;
+    CondVar loaded;
+
+    // Memory budget for this shard, in bytes.
+    //
+    size_t budget;
+
+    Stats stats;
+  };
+
+  friend class Pin;
+
+  // Return the shard which holds the tile identified by KEY.
+  //
+  Shard &key_shard (const Key &key)
+  {
+    return shards[key.hash () % num_shards];
+  }
+
+  // Return the hash bucket in SHARD for the tile identified by KEY.
+  // The shard index is removed from the hash value first, as all keys
+  // in the same shard have the same value for it.
+  //
+  Tile *&key_bucket (Shard &shard, const Key &key) const
+  {
+    size_t hash = key.hash () / num_shards;
+    return shard.buckets[hash & (shard.buckets.size () - 1)];
+  }
+
+  // Return the tile identified by KEY, loading it if necessary, and
+  // increment its pin count.
+  //
+  Tile *pin (const Key &key);
+
+  // Decrement TILE's pin count.
+  //
+  void unpin (Tile *tile);
+
+  // Remove KEY from SHARD's list of tiles being loaded, and wake up
+  // any threads waiting for it.  SHARD must be locked.
+  //
+  static void end_load (Shard &shard, const Key &key);
+
+  // Add TILE, whose key has been set, to SHARD's hash table and LRU
+  // list.  SHARD must be locked.
+  //
+  void insert (Shard &shard, Tile *tile);
+
+  // Remove TILE from SHARD's hash table and LRU list, and delete it.
+  // SHARD must be locked.
+  //
+  void discard (Shard &shard, Tile *tile);
+
+  // Discard the least-recently used tiles in SHARD until it's within
+  // its budget, but never discard a pinned tile.  SHARD must be
+  // locked.
+  //
+  void evict (Shard &shard);
+
+  Shard *shards;
+  unsigned num_shards;
+
+  size_t _budget;
+};
+
+
+}
+
+#endif // SNOGRAY_TILE_CACHE_H
@@ -0,0 +1,267 @@
+// tiled-matrix.h -- Out-of-core tiled, mip-mapped matrix storage
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_TILED_MATRIX_H
+#define SNOGRAY_TILED_MATRIX_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "util/ref.h"
+#include "util/mutex.h"
+#include "util/val-table.h"
+#include "tuple-matrix.h"
+#include "tile-cache.h"
+
+
+namespace snogray {
+
+
+class ImageInput;
+
+
+// ----------------------------------------------------------------
+// TiledMatrixData
+
+
+// This is the low-level storage class for tiled matrices, which hold a
+// matrix of "data" values of type DT, grouped into fixed-length tuples,
+// like TupleMatrixData, but don't keep the data in memory.
+//
+// Instead, the source image is converted once into a "tile file",
+// holding a mip-map pyramid of the image, each level of which is split
+// into square tiles of TILE_SIZE x TILE_SIZE tuples.  Tiles are then
+// read from the file on demand into the global TileCache, which limits
+// the total amount of memory used for tiles.
+//
+// Tile files are kept in the directory TileCache::global().tile_dir,
+// if set, and reused by later runs if the source image hasn't changed;
+// otherwise a temporary file is used.  The "tile_file" parameter may
+// be used to give an explicit tile-file name.
+//
+// Tile files use the native byte order and data type, so are only
+// useful on the machine where they were created.
+//
+template<typename DT = default_tuple_element_type>
+class TiledMatrixData : public RefCounted, public TileCache::Source
+{
+public:
+
+  // Width and height of each tile, in tuples.
+  //
+  static const unsigned TILE_SIZE = 64;
+
+  // Constructor for a matrix loaded from the image file FILENAME.
+  // PARAMS contains various image-format-specific parameters.
+  //
+  TiledMatrixData (unsigned _tuple_len, const std::string &filename,
+		   const ValTable &params = ValTable::NONE);
+  ~TiledMatrixData ();
+
+  // Return true if an image texture loaded using PARAMS should use
+  // tiled storage.  This is true if the global tile-cache is enabled,
+  // or if the "tiled" parameter is true.
+  //
+  static bool use_tiles (const ValTable &params);
+
+  // Return the number of mip-map levels; level 0 is the full-size
+  // image, and each following level is half the size of the previous
+  // one, down to 1 x 1.
+  //
+  unsigned num_levels () const { return levels.size (); }
+
+  // Return the width or height of mip-map level LEVEL.
+  //
+  unsigned level_width (unsigned level) const { return levels[level].width; }
+  unsigned level_height (unsigned level) const { return levels[level].height; }
+
+  // Copy the tuple at location X, Y of mip-map level LEVEL into TUPLE,
+  // which must have room for TUPLE_LEN elements.  PIN is used to find
+  // the tile containing the tuple, and is left pinning it, so that
+  // following calls using the same tile are fast.
+  //
+  void get_tuple (unsigned level, unsigned x, unsigned y, DT *tuple,
+		  TileCache::Pin &pin)
+    const;
+
+  // Return a new tile containing the data for tile (TX, TY) of
+  // mip-map level LEVEL.  This is called by the tile-cache.
+  //
+  virtual TileCache::Tile *load_tile (unsigned level,
+				      unsigned tx, unsigned ty)
+    const;
+
+  // Number of elements in each tuple tuple; should be greater than 0.
+  //
+  const unsigned tuple_len;
+
+  // The width and height of the full-size matrix (mip-map level 0).
+  //
+  const unsigned width, height;
+
+private:
+
+  // Tile-file header fields.  The header consists of the 8-byte magic
+  // string TILE_FILE_MAGIC, followed by HDR_NUM_FIELDS 64-bit integers.
+  //
+  enum {
+    HDR_BYTE_ORDER, HDR_ELEMENT_SIZE, HDR_TUPLE_LEN, HDR_WIDTH, HDR_HEIGHT,
+    HDR_TILE_SIZE, HDR_FLAGS, HDR_SRC_SIZE, HDR_SRC_MTIME,
+    HDR_NUM_FIELDS
+  };
+
+  // Bits in the HDR_FLAGS header field.
+  //
+  enum { FLAG_REVERSE_ROWS = 1 };
+
+  // Size of the tile-file header, in bytes.
+  //
+  static const unsigned HEADER_SIZE = 8 + HDR_NUM_FIELDS * 8;
+
+  // A tile of data in the tile-cache.
+  //
+  struct DataTile : TileCache::Tile
+  {
+    DataTile (size_t num_elements)
+      : Tile (num_elements * sizeof (DT)), data (num_elements)
+    { }
+
+    std::vector<DT> data;
+  };
+
+  // Description of a single mip-map level.
+  //
+  struct Level
+  {
+    Level (unsigned _width, unsigned _height, std::streamoff _offset)
+      : width (_width), height (_height),
+	tiles_x ((_width + TILE_SIZE - 1) / TILE_SIZE),
+	tiles_y ((_height + TILE_SIZE - 1) / TILE_SIZE),
+	offset (_offset)
+    { }
+
+    unsigned width, height;
+
+    // Number of tiles in each direction.
+    //
+    unsigned tiles_x, tiles_y;
+
+    // Offset of this level's first tile in the tile file.
+    //
+    std::streamoff offset;
+  };
+
+  // Number of data elements in each tile.
+  //
+  size_t tile_elements () const { return TILE_SIZE * TILE_SIZE * tuple_len; }
+
+  // Set WIDTH and HEIGHT to _WIDTH and _HEIGHT, and initialize LEVELS
+  // to match.
+  //
+  void init_levels (unsigned _width, unsigned _height);
+
+  // Return the header fields describing a tile file for the image file
+  // FILENAME loaded with PARAMS, in HDR; fields which depend on the
+  // image contents are left zero.
+  //
+  void expected_header (const std::string &filename, const ValTable &params,
+			unsigned long long hdr[HDR_NUM_FIELDS])
+    const;
+
+  // If TILE_FILENAME is a valid tile file for the image file FILENAME,
+  // open it, initialize our state from its header, and return true;
+  // otherwise, return false.
+  //
+  bool open_tile_file (const std::string &filename, const ValTable &params);
+
+  // Create a new tile file TILE_FILENAME from the image file FILENAME.
+  //
+  void make_tile_file (const std::string &filename, const ValTable &params);
+
+  // Write the mip-map level LEVEL of the tile file, by down-sampling
+  // the previous level.
+  //
+  void make_level (unsigned level);
+
+  // Write or read the tile (TX, TY) of mip-map level LEVEL to/from
+  // the tile file.  FILE_LOCK must be locked by the caller.
+  //
+  void write_tile (unsigned level, unsigned tx, unsigned ty, const DT *data);
+  void read_tile (unsigned level, unsigned tx, unsigned ty, DT *data) const;
+
+  // Mip-map levels, from largest to smallest.
+  //
+  std::vector<Level> levels;
+
+  // Name of our tile file, and whether it should be deleted when we're
+  // destroyed.
+  //
+  std::string tile_filename;
+  bool temporary;
+
+  // Stream for reading the tile file, and a lock protecting it.
+  //
+  mutable std::fstream file;
+  mutable Mutex file_lock;
+
+  // Cache where our tiles are kept.
+  //
+  TileCache &cache;
+};
+
+
+
+// ----------------------------------------------------------------
+// TiledMatrix
+
+
+// This is the high-level tiled-matrix class, a matrix of values of type T.
+//
+template<typename T, typename DT = default_tuple_element_type>
+class TiledMatrix : public TiledMatrixData<DT>
+{
+public:
+
+  typedef TupleAdaptor<T, DT> TA;
+  typedef TiledMatrixData<DT> TMD;
+
+  // Constructor for a matrix loaded from an image file.
+  //
+  TiledMatrix (const std::string &filename,
+	       const ValTable &params = ValTable::NONE)
+    : TMD (TA::TUPLE_LEN, filename, params)
+  { }
+
+  // Return the value at location X, Y of mip-map level LEVEL.  PIN
+  // is used as in TiledMatrixData::get_tuple.
+  //
+  T operator() (unsigned x, unsigned y, unsigned level,
+		TileCache::Pin &pin)
+    const
+  {
+    DT tuple[TA::TUPLE_LEN];
+    TMD::get_tuple (level, x, y, tuple, pin);
+    return TupleAdaptor<T, const DT> (tuple);
+  }
+};
+
+
+}
+
+
+// Include method definitions
+//
+#include "tiled-matrix.tcc"
+
+
+#endif // SNOGRAY_TILED_MATRIX_H
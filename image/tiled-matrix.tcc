@@ -0,0 +1,472 @@
+// tiled-matrix.tcc -- Out-of-core tiled, mip-mapped matrix storage
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef __TILED_MATRIX_TCC__
+#define __TILED_MATRIX_TCC__
+
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "util/globals.h"
+#include "util/excepts.h"
+
+#include "image-input.h"
+
+#include "tiled-matrix.h"
+
+
+namespace snogray {
+
+
+// Magic string at the start of every tile file.  A partially written
+// tile file has zeroes here instead.
+//
+#define SNOGRAY_TILE_FILE_MAGIC "SNOGTIL1"
+
+
+template<typename DT>
+TiledMatrixData<DT>::TiledMatrixData (unsigned _tuple_len,
+				      const std::string &filename,
+				      const ValTable &params)
+  : tuple_len (_tuple_len), width (0), height (0),
+    temporary (false), cache (TileCache::global ())
+{
+  if (params.contains ("tile_file"))
+    tile_filename = params.get_string ("tile_file");
+  else
+    {
+      std::ostringstream variant;
+      variant << tuple_len << "x" << sizeof (DT);
+      tile_filename
+	= cache.tile_file_name (filename, variant.str (), temporary);
+    }
+
+  if (temporary || !open_tile_file (filename, params))
+    make_tile_file (filename, params);
+}
+
+template<typename DT>
+TiledMatrixData<DT>::~TiledMatrixData ()
+{
+  cache.flush (*this);
+
+  file.close ();
+
+  if (temporary)
+    remove (tile_filename.c_str ());
+}
+
+// Return true if an image texture loaded using PARAMS should use
+// tiled storage.  This is true if the global tile-cache is enabled,
+// or if the "tiled" parameter is true.
+//
+template<typename DT>
+bool
+TiledMatrixData<DT>::use_tiles (const ValTable &params)
+{
+  // The "border" parameter isn't supported by tiled storage.
+  //
+  return (params.get_bool ("tiled", TileCache::global ().enabled ())
+	  && !params.contains ("border"));
+}
+
+// Set WIDTH and HEIGHT to _WIDTH and _HEIGHT, and initialize LEVELS
+// to match.
+//
+template<typename DT>
+void
+TiledMatrixData<DT>::init_levels (unsigned _width, unsigned _height)
+{
+  const_cast<unsigned &> (width) = _width;
+  const_cast<unsigned &> (height) = _height;
+
+  std::streamoff tile_bytes = tile_elements () * sizeof (DT);
+  std::streamoff offset = HEADER_SIZE;
+
+  levels.clear ();
+  levels.push_back (Level (width, height, offset));
+
+  while (levels.back ().width > 1 || levels.back ().height > 1)
+    {
+      const Level &prev = levels.back ();
+      offset += std::streamoff (prev.tiles_x) * prev.tiles_y * tile_bytes;
+      levels.push_back (Level ((prev.width + 1) / 2, (prev.height + 1) / 2,
+			       offset));
+    }
+}
+
+
+
+// ----------------------------------------------------------------
+// Tile access
+
+
+// Copy the tuple at location X, Y of mip-map level LEVEL into TUPLE,
+// which must have room for TUPLE_LEN elements.  PIN is used to find
+// the tile containing the tuple, and is left pinning it, so that
+// following calls using the same tile are fast.
+//
+template<typename DT>
+void
+TiledMatrixData<DT>::get_tuple (unsigned level, unsigned x, unsigned y,
+				DT *tuple, TileCache::Pin &pin)
+  const
+{
+  const DataTile *tile
+    = static_cast<const DataTile *> (
+	pin.get (cache, *this, level, x / TILE_SIZE, y / TILE_SIZE));
+  const DT *src
+    = &tile->data[((y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE) * tuple_len];
+
+  for (unsigned i = 0; i < tuple_len; i++)
+    tuple[i] = src[i];
+}
+
+// Return a new tile containing the data for tile (TX, TY) of
+// mip-map level LEVEL.  This is called by the tile-cache.
+//
+template<typename DT>
+TileCache::Tile *
+TiledMatrixData<DT>::load_tile (unsigned level, unsigned tx, unsigned ty)
+  const
+{
+  DataTile *tile = new DataTile (tile_elements ());
+
+  try
+    {
+      LockGuard guard (file_lock);
+      read_tile (level, tx, ty, &tile->data[0]);
+    }
+  catch (...)
+    {
+      delete tile;
+      throw;
+    }
+
+  return tile;
+}
+
+// Write or read the tile (TX, TY) of mip-map level LEVEL to/from
+// the tile file.  FILE_LOCK must be locked by the caller.
+//
+template<typename DT>
+void
+TiledMatrixData<DT>::write_tile (unsigned level, unsigned tx, unsigned ty,
+				 const DT *data)
+{
+  const Level &lev = levels[level];
+  std::streamoff tile_bytes = tile_elements () * sizeof (DT);
+
+  file.seekp (lev.offset + (std::streamoff (ty) * lev.tiles_x + tx)
+	      * tile_bytes);
+  file.write (reinterpret_cast<const char *> (data), tile_bytes);
+
+  if (! file)
+    throw file_error (tile_filename + ": Error writing tile file");
+}
+template<typename DT>
+void
+TiledMatrixData<DT>::read_tile (unsigned level, unsigned tx, unsigned ty,
+				DT *data)
+  const
+{
+  const Level &lev = levels[level];
+  std::streamoff tile_bytes = tile_elements () * sizeof (DT);
+
+  file.seekg (lev.offset + (std::streamoff (ty) * lev.tiles_x + tx)
+	      * tile_bytes);
+  file.read (reinterpret_cast<char *> (data), tile_bytes);
+
+  if (! file)
+    throw file_error (tile_filename + ": Error reading tile file");
+}
+
+
+
+// ----------------------------------------------------------------
+// Tile-file creation
+
+
+// Return the header fields describing a tile file for the image file
+// FILENAME loaded with PARAMS, in HDR; fields which depend on the
+// image contents are left zero.
+//
+template<typename DT>
+void
+TiledMatrixData<DT>::expected_header (const std::string &filename,
+				      const ValTable &params,
+				      unsigned long long hdr[HDR_NUM_FIELDS])
+  const
+{
+  for (unsigned i = 0; i < HDR_NUM_FIELDS; i++)
+    hdr[i] = 0;
+
+  hdr[HDR_BYTE_ORDER] = 0x01020304;
+  hdr[HDR_ELEMENT_SIZE] = sizeof (DT);
+  hdr[HDR_TUPLE_LEN] = tuple_len;
+  hdr[HDR_TILE_SIZE] = TILE_SIZE;
+
+  if (params.get_bool ("reverse_rows", false))
+    hdr[HDR_FLAGS] |= FLAG_REVERSE_ROWS;
+
+  TileCache::file_stamp (filename, hdr[HDR_SRC_SIZE], hdr[HDR_SRC_MTIME]);
+}
+
+// If TILE_FILENAME is a valid tile file for the image file FILENAME,
+// open it, initialize our state from its header, and return true;
+// otherwise, return false.
+//
+template<typename DT>
+bool
+TiledMatrixData<DT>::open_tile_file (const std::string &filename,
+				     const ValTable &params)
+{
+  file.open (tile_filename.c_str (), std::ios_base::in|std::ios_base::binary);
+  if (! file)
+    {
+      file.clear ();
+      return false;
+    }
+
+  char magic[8];
+  unsigned long long hdr[HDR_NUM_FIELDS];
+  unsigned long long expected[HDR_NUM_FIELDS];
+
+  file.read (magic, sizeof magic);
+  file.read (reinterpret_cast<char *> (hdr), sizeof hdr);
+
+  expected_header (filename, params, expected);
+  expected[HDR_WIDTH] = hdr[HDR_WIDTH];
+  expected[HDR_HEIGHT] = hdr[HDR_HEIGHT];
+
+  if (!file
+      || memcmp (magic, SNOGRAY_TILE_FILE_MAGIC, sizeof magic) != 0
+      || memcmp (hdr, expected, sizeof hdr) != 0
+      || hdr[HDR_WIDTH] == 0 || hdr[HDR_HEIGHT] == 0)
+    {
+      file.close ();
+      file.clear ();
+      return false;
+    }
+
+  init_levels (hdr[HDR_WIDTH], hdr[HDR_HEIGHT]);
+
+  return true;
+}
+
+// Create a new tile file TILE_FILENAME from the image file FILENAME.
+//
+template<typename DT>
+void
+TiledMatrixData<DT>::make_tile_file (const std::string &filename,
+				     const ValTable &params)
+{
+  ImageInput src (filename, params);
+
+  init_levels (src.width, src.height);
+
+  bool emit_note = (!quiet && width * height > 1024 * 1024);
+  if (emit_note)
+    {
+      std::string bn = filename;
+      std::string::size_type last_slash = bn.find_last_of ("/");
+      if (last_slash != std::string::npos)
+	bn.erase (0, last_slash + 1);
+
+      std::cout << "* converting image to tiles: " << bn
+		<< " (" << width << " x " << height << ")...";
+      std::cout.flush ();
+    }
+
+  file.open (tile_filename.c_str (),
+	     std::ios_base::in|std::ios_base::out|std::ios_base::binary
+	     |std::ios_base::trunc);
+  if (! file)
+    throw file_error (tile_filename + ": Cannot create tile file");
+
+  // Write a dummy header, which will be replaced by the real one once
+  // we're done.
+  //
+  std::vector<char> zero_header (HEADER_SIZE, 0);
+  file.write (&zero_header[0], HEADER_SIZE);
+
+  // Level 0 is made directly from the image, by reading it into a
+  // "strip" buffer one row of tiles high, and writing each strip once
+  // it is complete.  Images may be stored either top-to-bottom or
+  // bottom-to-top, but rows are always read in order, so only one
+  // strip is ever incomplete.
+  //
+  const Level &lev0 = levels[0];
+  std::vector<DT> strip (TILE_SIZE * lev0.tiles_x * TILE_SIZE * tuple_len, 0);
+  std::vector<DT> tile (tile_elements ());
+  unsigned strip_rows = 0;
+
+  unsigned copy_len = std::min (tuple_len, unsigned (Color::NUM_COMPONENTS));
+
+  ImageRow row (src.width);
+
+  ImageIo::RowIndices row_indices = src.row_indices ();
+  if (params.get_bool ("reverse_rows", false))
+    std::swap (row_indices.first, row_indices.last);
+
+  for (ImageIo::RowIndices::iterator i = row_indices.begin ();
+       i != row_indices.end (); ++i)
+    {
+      unsigned y = *i;
+      unsigned ty = y / TILE_SIZE;
+
+      src.read_row (row);
+
+      DT *dst = &strip[(y % TILE_SIZE) * lev0.tiles_x * TILE_SIZE * tuple_len];
+      for (unsigned x = 0; x < width; x++)
+	{
+	  const Color &col = row[x].color;
+	  for (unsigned c = 0; c < copy_len; c++)
+	    dst[c] = col[c];
+	  dst += tuple_len;
+	}
+
+      unsigned strip_height = std::min (TILE_SIZE, height - ty * TILE_SIZE);
+      if (++strip_rows == strip_height)
+	{
+	  for (unsigned tx = 0; tx < lev0.tiles_x; tx++)
+	    {
+	      for (unsigned ry = 0; ry < TILE_SIZE; ry++)
+		std::copy (&strip[((ry * lev0.tiles_x + tx) * TILE_SIZE)
+				  * tuple_len],
+			   &strip[((ry * lev0.tiles_x + tx + 1) * TILE_SIZE)
+				  * tuple_len],
+			   &tile[ry * TILE_SIZE * tuple_len]);
+
+	      write_tile (0, tx, ty, &tile[0]);
+	    }
+
+	  std::fill (strip.begin (), strip.end (), DT (0));
+	  strip_rows = 0;
+	}
+    }
+
+  for (unsigned level = 1; level < levels.size (); level++)
+    make_level (level);
+
+  // Now that everything else has been written, write the real header.
+  //
+  unsigned long long hdr[HDR_NUM_FIELDS];
+  expected_header (filename, params, hdr);
+  hdr[HDR_WIDTH] = width;
+  hdr[HDR_HEIGHT] = height;
+
+  file.seekp (0);
+  file.write (SNOGRAY_TILE_FILE_MAGIC, 8);
+  file.write (reinterpret_cast<const char *> (hdr), sizeof hdr);
+  file.flush ();
+
+  if (! file)
+    throw file_error (tile_filename + ": Error writing tile file");
+
+  if (emit_note)
+    {
+      std::cout << "done" << std::endl;
+      std::cout.flush ();
+    }
+}
+
+// Write the mip-map level LEVEL of the tile file, by down-sampling
+// the previous level.
+//
+template<typename DT>
+void
+TiledMatrixData<DT>::make_level (unsigned level)
+{
+  const Level &prev = levels[level - 1];
+  const Level &lev = levels[level];
+
+  // Each tile in LEVEL is made from a block of 2 x 2 tiles in PREV,
+  // which we read into BLOCK.
+  //
+  unsigned block_size = TILE_SIZE * 2;
+  std::vector<DT> block (block_size * block_size * tuple_len);
+  std::vector<DT> src_tile (tile_elements ());
+  std::vector<DT> tile (tile_elements ());
+
+  for (unsigned ty = 0; ty < lev.tiles_y; ty++)
+    for (unsigned tx = 0; tx < lev.tiles_x; tx++)
+      {
+	std::fill (block.begin (), block.end (), DT (0));
+
+	for (unsigned sy = 0; sy < 2; sy++)
+	  for (unsigned sx = 0; sx < 2; sx++)
+	    if (tx * 2 + sx < prev.tiles_x && ty * 2 + sy < prev.tiles_y)
+	      {
+		read_tile (level - 1, tx * 2 + sx, ty * 2 + sy, &src_tile[0]);
+
+		for (unsigned ry = 0; ry < TILE_SIZE; ry++)
+		  std::copy (&src_tile[ry * TILE_SIZE * tuple_len],
+			     &src_tile[(ry + 1) * TILE_SIZE * tuple_len],
+			     &block[((sy * TILE_SIZE + ry) * block_size
+				     + sx * TILE_SIZE) * tuple_len]);
+	      }
+
+	std::fill (tile.begin (), tile.end (), DT (0));
+
+	// Box-filter each 2 x 2 group of source tuples.  Tuples at the
+	// right or bottom edge of an odd-sized level are duplicated.
+	//
+	unsigned base_x = tx * block_size, base_y = ty * block_size;
+	unsigned max_x = std::min (block_size, prev.width - base_x) - 1;
+	unsigned max_y = std::min (block_size, prev.height - base_y) - 1;
+
+	for (unsigned y = 0; y < TILE_SIZE; y++)
+	  for (unsigned x = 0; x < TILE_SIZE; x++)
+	    if (tx * TILE_SIZE + x < lev.width && ty * TILE_SIZE + y < lev.height)
+	      {
+		unsigned x0 = x * 2, x1 = std::min (x0 + 1, max_x);
+		unsigned y0 = y * 2, y1 = std::min (y0 + 1, max_y);
+
+		const DT *s00 = &block[(y0 * block_size + x0) * tuple_len];
+		const DT *s01 = &block[(y0 * block_size + x1) * tuple_len];
+		const DT *s10 = &block[(y1 * block_size + x0) * tuple_len];
+		const DT *s11 = &block[(y1 * block_size + x1) * tuple_len];
+
+		DT *d = &tile[(y * TILE_SIZE + x) * tuple_len];
+
+		for (unsigned c = 0; c < tuple_len; c++)
+		  d[c] = (float (s00[c]) + float (s01[c])
+			  + float (s10[c]) + float (s11[c])) * 0.25f;
+	      }
+
+	write_tile (level, tx, ty, &tile[0]);
+      }
+}
+
+
+// If possible, suppress instantiation of classes which we will define
+// out-of-line.
+//
+// These declarations should be synchronized with the "template class"
+// declarations at the end of "tiled-matrix.cc".
+//
+#if HAVE_EXTERN_TEMPLATE
+EXTERN_TEMPLATE_EXTENSION extern template class TiledMatrixData<default_tuple_element_type>;
+EXTERN_TEMPLATE_EXTENSION extern template class TiledMatrixData<SrgbByte>;
+#if HAVE_LIBEXR
+EXTERN_TEMPLATE_EXTENSION extern template class TiledMatrixData<float>;
+#endif
+#endif
+
+
+} // namespace snogray
+
+#endif // __TILED_MATRIX_TCC__
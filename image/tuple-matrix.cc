@@ -14,12 +14,76 @@
 
 #include "color/color.h"
 
+#include <stdexcept>
+
+#include "util/snogmath.h"
+
+#include "image-input.h"
 #include "tuple-matrix.h"
 
 
 using namespace snogray;
 
 
+// Return true if samples with BITS bits of precision, converted to
+// linear values using gamma GAMMA, can be stored in SrgbByte elements
+// without changing their values.  This is only true for sources which
+// really use the sRGB transfer function; in particular, a simple
+// power-law gamma like 2.2 has far more resolution in dark values
+// than SrgbByte, so would lose dark levels.
+//
+static bool
+srgb_byte_lossless (unsigned bits, float gamma)
+{
+  if (bits == 0 || bits > 8)
+    return false;
+
+  unsigned max_sample = (1u << bits) - 1;
+
+  for (unsigned i = 0; i <= max_sample; i++)
+    {
+      float linear = pow (float (i) / float (max_sample), gamma);
+      float stored = SrgbByte (linear);
+      if (abs (stored - linear) > linear * 1e-4f)
+	return false;
+    }
+
+  return true;
+}
+
+// Return the kind of storage element which should be used for a
+// matrix loaded from the image file FILENAME using PARAMS.
+//
+TupleElementType
+snogray::tuple_element_type (const std::string &filename,
+			     const ValTable &params)
+{
+  std::string storage = params.get_string ("storage", "auto");
+
+  if (storage == "srgb8")
+    return TUPLE_ELEMENT_SRGB8;
+  else if (storage == "half")
+    return TUPLE_ELEMENT_HALF;
+  else if (storage == "float")
+    return TUPLE_ELEMENT_FLOAT;
+  else if (storage != "auto")
+    throw std::runtime_error ("Unknown image storage type \"" + storage + "\"");
+
+  // Only the image header is read here, so this is cheap.
+  //
+  ImageInput src (filename, params);
+
+  // Only use sRGB-encoded bytes if they represent the source samples
+  // exactly; otherwise use half, which has enough precision for any
+  // 8-bit source.
+  //
+  if (srgb_byte_lossless (src.sample_bits (), src.sample_gamma ()))
+    return TUPLE_ELEMENT_SRGB8;
+  else
+    return TUPLE_ELEMENT_HALF;
+}
+
+
 // If the compiler supports "extern template" syntax, we can define some
 // commonly used instantiations out-of-line here, which saves a lot of
 // space.
@@ -31,6 +95,14 @@ using namespace snogray;
 template class snogray::TupleMatrixData<default_tuple_element_type>;
 template class snogray::TupleMatrix<float>;
 template class snogray::TupleMatrix<Color>;
+template class snogray::TupleMatrixData<SrgbByte>;
+template class snogray::TupleMatrix<float, SrgbByte>;
+template class snogray::TupleMatrix<Color, SrgbByte>;
+#if HAVE_LIBEXR
+template class snogray::TupleMatrixData<float>;
+template class snogray::TupleMatrix<float, float>;
+template class snogray::TupleMatrix<Color, float>;
+#endif
 #endif
 
 
@@ -21,6 +21,7 @@
 #include "util/val-table.h"
 #include "color/color.h"
 #include "tuple-adaptor.h"
+#include "srgb-byte.h"
 
 // Use OpenEXR "half" datatype as default matrix storage element if possible.
 //
@@ -45,6 +46,31 @@ typedef float default_tuple_element_type;
 #endif
 
 
+// Kinds of storage element which may be used for matrices loaded from
+// image files.
+//
+enum TupleElementType
+{
+  TUPLE_ELEMENT_SRGB8,		// SrgbByte
+  TUPLE_ELEMENT_HALF,		// half if available, otherwise float
+  TUPLE_ELEMENT_FLOAT		// float
+};
+
+// Return the kind of storage element which should be used for a
+// matrix loaded from the image file FILENAME using PARAMS.
+//
+// The "storage" parameter may be used to choose one explicitly
+// ("srgb8", "half", or "float"); otherwise ("auto", the default), the
+// choice depends on the image's format:  images with 8-bit (or
+// smaller) samples which use the sRGB transfer function, and so can
+// be stored exactly in sRGB-encoded bytes, use TUPLE_ELEMENT_SRGB8,
+// and all others (including 8-bit images using a simple power-law
+// gamma) use TUPLE_ELEMENT_HALF.
+//
+extern TupleElementType tuple_element_type (const std::string &filename,
+					    const ValTable &params);
+
+
 
 // ----------------------------------------------------------------
 // TupleMatrixData
@@ -247,6 +247,14 @@ TupleMatrixData<DT>::TupleMatrixData (unsigned _tuple_len,
 EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrixData<default_tuple_element_type>;
 EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrix<Color>;
 EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrix<float>;
+EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrixData<SrgbByte>;
+EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrix<Color, SrgbByte>;
+EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrix<float, SrgbByte>;
+#if HAVE_LIBEXR
+EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrixData<float>;
+EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrix<Color, float>;
+EXTERN_TEMPLATE_EXTENSION extern template class TupleMatrix<float, float>;
+#endif
 #endif
 
 
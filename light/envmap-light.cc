@@ -13,7 +13,7 @@
 #include "render/scene.h"
 #include "texture/spheremap.h"
 #include "geometry/hist-2d.h"
-#include "geometry/hist-2d-dist.h"
+#include "geometry/hist-2d-alias-dist.h"
 #include "geometry/sphere-sample.h"
 #include "geometry/tangent-disk-sample.h"
 #include "light-sampler.h"
@@ -31,13 +31,7 @@ class EnvmapLight::Sampler : public Light::Sampler
 {
 public:
 
-  Sampler (const EnvmapLight &_light, const BBox &scene_bbox)
-    : light (_light),
-      scene_center (scene_bbox.center ()),
-      scene_radius (scene_bbox.radius ()),
-      intensity_dist (envmap_histogram (light.envmap))
-  {
-  }
+  Sampler (const EnvmapLight &_light, const BBox &scene_bbox);
 
   // Return a sample of this light from the viewpoint of ISEC (using a
   // surface-normal coordinate system, where the surface normal is
@@ -67,6 +61,10 @@ public:
     return light.envmap->map (light.frame.to (dir));
   }
 
+  // Return an estimate of the total power emitted by this light.
+  //
+  virtual float power () const;
+
 private:
 
   // Return a 2d histogram containing the intensity of ENVMAP, with the
@@ -84,12 +82,43 @@ private:
   Pos scene_center;
   dist_t scene_radius;
 
-  // Distribution for sampling the intensity of ENVMAP.
+  // Distribution for sampling the intensity of ENVMAP.  This is on the
+  // critical path when rendering scenes lit mainly by an environment
+  // map, so we use an alias-method distribution, which has constant
+  // sampling and PDF cost regardless of the envmap's size.
+  //
+  Hist2dAliasDist intensity_dist;
+
+  // The average radiance of ENVMAP over the entire sphere.
   //
-  Hist2dDist intensity_dist;
+  float avg_intensity;
 };
 
 
+EnvmapLight::Sampler::Sampler (const EnvmapLight &_light,
+			       const BBox &scene_bbox)
+  : light (_light),
+    scene_center (scene_bbox.center ()),
+    scene_radius (scene_bbox.radius ()),
+    avg_intensity (0)
+{
+  Hist2d hist = envmap_histogram (light.envmap);
+
+  intensity_dist.set_histogram (hist);
+
+  // The histogram bins are already scaled to reflect the area of each
+  // bin on the sphere, so summing them gives the total radiance.  Each
+  // bin covers (PI / height) * (2 * PI / width) steradians, and the
+  // whole sphere is 4 * PI steradians.
+  //
+  double sum = 0;
+  for (unsigned i = 0; i < hist.size; i++)
+    sum += double (hist.bins[i]);
+  if (hist.size != 0)
+    avg_intensity = float (sum * PI / (2 * hist.size));
+}
+
+
 // Add light-samplers for this light in SCENE to SAMPLERS.  Any
 // samplers added become owned by the owner of SAMPLERS, and will be
 // destroyed when it is.
@@ -267,6 +296,23 @@ EnvmapLight::Sampler::eval (const Intersect &isec, const Vec &dir) const
 }
 
 
+
+// EnvmapLight::Sampler::power
+
+// Return an estimate of the total power emitted by this light.
+//
+float
+EnvmapLight::Sampler::power () const
+{
+  // The irradiance due to a uniform environment of radiance
+  // AVG_INTENSITY is AVG_INTENSITY * 4 * PI, and all of it falls on a
+  // disk the size of the scene.
+  //
+  return (avg_intensity * 4 * PIf
+	  * float (scene_radius * scene_radius) * PIf);
+}
+
+
 
 // EnvmapLight::transform
 
@@ -62,6 +62,10 @@ public:
   //
   virtual Color eval_environ (const Vec &dir) const;
 
+  // Return an estimate of the total power emitted by this light.
+  //
+  virtual float power () const;
+
 private:
 
   const FarLight &light;
@@ -178,6 +182,28 @@ FarLight::Sampler::eval_environ (const Vec &dir) const
 }
 
 
+
+// FarLight::Sampler::power
+
+// Return an estimate of the total power emitted by this light.
+//
+float
+FarLight::Sampler::power () const
+{
+  // The irradiance due to this light anywhere in the scene.  Unless
+  // this is an infinitely-far point-light, INTENSITY is per steradian,
+  // so multiply by the solid angle the light subtends.
+  //
+  float irradiance = light.intensity.intensity ();
+  if (light.cos_half_angle < 1)
+    irradiance *= 2 * PIf * (1 - light.cos_half_angle);
+
+  // All of that light falls on a disk the size of the scene.
+  //
+  return irradiance * float (scene_radius * scene_radius) * PIf;
+}
+
+
 
 // FarLight::transform
 
@@ -0,0 +1,93 @@
+// light-power-dist.cc -- Light selection in proportion to emitted power
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <algorithm>
+
+#include "light-power-dist.h"
+
+
+using namespace snogray;
+
+
+// Make a distribution over all the light-samplers in SAMPLERS.  No
+// reference to SAMPLERS is kept, but the samplers themselves must
+// remain valid as long as the distribution is used.
+//
+LightPowerDist::LightPowerDist (
+		  const std::vector<const Light::Sampler *> &samplers)
+{
+  std::vector<float> powers;
+  double total_power = 0;
+
+  for (std::vector<const Light::Sampler *>::const_iterator si
+	 = samplers.begin ();
+       si != samplers.end (); ++si)
+    {
+      float power = (*si)->power ();
+
+      // Lights which emit no power can never be chosen, so just leave
+      // them out.
+      //
+      if (power > 0)
+	{
+	  lights.push_back (*si);
+	  powers.push_back (power);
+	  total_power += double (power);
+	}
+    }
+
+  // Accumulate in double precision, to avoid losing small lights when
+  // there are very many of them.
+  //
+  double sum = 0;
+  cdf.reserve (powers.size ());
+  for (std::vector<float>::const_iterator pi = powers.begin ();
+       pi != powers.end (); ++pi)
+    {
+      sum += double (*pi);
+      cdf.push_back (float (sum / total_power));
+    }
+
+  if (! cdf.empty ())
+    cdf.back () = 1;
+}
+
+
+// Choose a light-sampler to sample for the point POS, which has a
+// surface normal NORM (in world coordinates), using the parameter
+// PARAM.  The probability of having chosen the returned light is
+// returned in PDF.  If no light can possibly illuminate POS, zero is
+// returned.
+//
+const Light::Sampler *
+LightPowerDist::sample (const Pos &, const Vec &, float param, float &pdf)
+  const
+{
+  if (lights.empty ())
+    {
+      pdf = 0;
+      return 0;
+    }
+
+  // Find the first entry in CDF which is greater than PARAM.  As the
+  // last entry is 1, and PARAM is less than 1, there always is one
+  // (except for rounding errors, which we guard against anyway).
+  //
+  unsigned index
+    = std::upper_bound (cdf.begin (), cdf.end (), param) - cdf.begin ();
+  if (index >= cdf.size ())
+    index = cdf.size () - 1;
+
+  pdf = (index == 0) ? cdf[0] : cdf[index] - cdf[index - 1];
+
+  return lights[index];
+}
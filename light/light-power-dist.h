@@ -0,0 +1,70 @@
+// light-power-dist.h -- Light selection in proportion to emitted power
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_LIGHT_POWER_DIST_H
+#define SNOGRAY_LIGHT_POWER_DIST_H
+
+#include <vector>
+
+#include "light-selector.h"
+
+
+namespace snogray {
+
+
+// A LightSelector which chooses lights with probability proportional
+// to their total emitted power, regardless of the point being lit.
+//
+// The cumulative distribution is computed once, when the object is
+// created, so choosing a light takes time proportional to the log of
+// the number of lights.
+//
+class LightPowerDist : public LightSelector
+{
+public:
+
+  // Make a distribution over all the light-samplers in SAMPLERS.  No
+  // reference to SAMPLERS is kept, but the samplers themselves must
+  // remain valid as long as the distribution is used.
+  //
+  LightPowerDist (const std::vector<const Light::Sampler *> &samplers);
+
+  // Choose a light-sampler to sample for the point POS, which has a
+  // surface normal NORM (in world coordinates), using the parameter
+  // PARAM.  The probability of having chosen the returned light is
+  // returned in PDF.  If no light can possibly illuminate POS, zero is
+  // returned.
+  //
+  // POS and NORM are ignored, as the choice depends only on the
+  // power of each light.
+  //
+  virtual const Light::Sampler *sample (const Pos &pos, const Vec &norm,
+					float param, float &pdf)
+    const;
+
+private:
+
+  // Light-samplers with non-zero probability.
+  //
+  std::vector<const Light::Sampler *> lights;
+
+  // The cumulative distribution of LIGHTS; CDF[i] is the probability
+  // of choosing any of LIGHTS[0] through LIGHTS[i].  The last entry is
+  // always exactly 1.
+  //
+  std::vector<float> cdf;
+};
+
+
+}
+
+#endif // SNOGRAY_LIGHT_POWER_DIST_H
@@ -13,6 +13,8 @@
 #ifndef SNOGRAY_LIGHT_SAMPLER_H
 #define SNOGRAY_LIGHT_SAMPLER_H
 
+#include "geometry/bbox.h"
+
 #include "light.h"
 
 
@@ -111,6 +113,40 @@ public:
     dist_t dist;
   };
 
+  // A conservative description of where a light emits, and in which
+  // directions, used to estimate the light's importance for a point
+  // without actually sampling it.
+  //
+  // All emitting points of the light lie within BBOX.  The emitting
+  // normals (or directions, for point-lights) all lie within
+  // SPREAD_ANGLE of AXIS, and light is emitted only within
+  // FALLOFF_ANGLE of those normals.  So a lambertian surface has a
+  // FALLOFF_ANGLE of PI/2, and a light emitting in all directions has a
+  // SPREAD_ANGLE of PI.
+  //
+  struct EmissionBounds
+  {
+    EmissionBounds (const BBox &_bbox, const Vec &_axis,
+		    float _spread_angle, float _falloff_angle)
+      : bbox (_bbox), axis (_axis),
+	spread_angle (_spread_angle), falloff_angle (_falloff_angle)
+    { }
+    EmissionBounds (const BBox &_bbox)
+      : bbox (_bbox), axis (0, 0, 1),
+	spread_angle (PIf), falloff_angle (PIf / 2)
+    { }
+    EmissionBounds ()
+      : axis (0, 0, 1), spread_angle (PIf), falloff_angle (PIf / 2)
+    { }
+
+    BBox bbox;
+
+    Vec axis;
+    float spread_angle;
+
+    float falloff_angle;
+  };
+
   // Return a sample of this light from the viewpoint of ISEC (using a
   // surface-normal coordinate system, where the surface normal is
   // (0,0,1)), based on the parameter PARAM.
@@ -139,6 +175,21 @@ public:
   // Evaluate this environmental light in direction DIR (in world-coordinates).
   //
   virtual Color eval_environ (const Vec &/*dir*/) const { return 0; }
+
+  // Return an estimate of the total power emitted by this light (in
+  // watts, as a single intensity value).  This is used to decide how
+  // often to sample this light relative to other lights, so it needn't
+  // be exact, but it should be roughly comparable between different
+  // types of light.
+  //
+  virtual float power () const = 0;
+
+  // Return a conservative description of where, and in which
+  // directions, this light emits.  Environmental lights, which are not
+  // located anywhere in particular, may use the default, which is an
+  // empty bounding box emitting in all directions.
+  //
+  virtual EmissionBounds emission_bounds () const { return EmissionBounds (); }
 };
 
 
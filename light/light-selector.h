@@ -0,0 +1,50 @@
+// light-selector.h -- Interface for choosing a single light to sample
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_LIGHT_SELECTOR_H
+#define SNOGRAY_LIGHT_SELECTOR_H
+
+#include "geometry/pos.h"
+#include "geometry/vec.h"
+
+#include "light-sampler.h"
+
+
+namespace snogray {
+
+
+// An interface for randomly choosing one of a scene's light-samplers
+// to sample, instead of sampling every light.  To produce an unbiased
+// estimate of the contribution of all lights, the result of sampling
+// the chosen light should be divided by the probability of choosing it.
+//
+class LightSelector
+{
+public:
+
+  virtual ~LightSelector () { }
+
+  // Choose a light-sampler to sample for the point POS, which has a
+  // surface normal NORM (in world coordinates), using the parameter
+  // PARAM.  The probability of having chosen the returned light is
+  // returned in PDF.  If no light can possibly illuminate POS, zero is
+  // returned.
+  //
+  virtual const Light::Sampler *sample (const Pos &pos, const Vec &norm,
+					float param, float &pdf)
+    const = 0;
+};
+
+
+}
+
+#endif // SNOGRAY_LIGHT_SELECTOR_H
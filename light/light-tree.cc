@@ -0,0 +1,347 @@
+// light-tree.cc -- Hierarchy of lights for importance-based light selection
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <algorithm>
+
+#include "util/snogmath.h"
+
+#include "light-tree.h"
+
+
+using namespace snogray;
+
+
+
+namespace { // keep local to file
+
+// Return the angle between the unit vectors VEC1 and VEC2.
+//
+inline float
+angle_between (const Vec &vec1, const Vec &vec2)
+{
+  return acos (clamp (float (dot (vec1, vec2)), -1.f, 1.f));
+}
+
+// Extend the direction cone with axis AXIS and half-angle SPREAD so that
+// it also contains the cone with axis FROM_AXIS and half-angle
+// FROM_SPREAD.
+//
+void
+merge_cones (Vec &axis, float &spread, const Vec &from_axis, float from_spread)
+{
+  if (spread >= PIf)
+    return;
+  if (from_spread >= PIf)
+    {
+      spread = PIf;
+      return;
+    }
+
+  float between = angle_between (axis, from_axis);
+
+  // If one cone is entirely inside the other, just use the outer one.
+  //
+  if (min (between + from_spread, PIf) <= spread)
+    return;
+  if (min (between + spread, PIf) <= from_spread)
+    {
+      axis = from_axis;
+      spread = from_spread;
+      return;
+    }
+
+  // Otherwise, the new cone's half-angle covers both cones from edge to
+  // edge, and its axis is rotated from AXIS towards FROM_AXIS.
+  //
+  float new_spread = (spread + between + from_spread) / 2;
+  if (new_spread >= PIf)
+    {
+      spread = PIf;
+      return;
+    }
+
+  Vec rot_axis = cross (axis, from_axis);
+  if (rot_axis.length_squared () == 0)
+    {
+      spread = PIf;
+      return;
+    }
+  rot_axis = rot_axis.unit ();
+
+  // Rotate AXIS by ROT_ANGLE around ROT_AXIS; as ROT_AXIS is
+  // perpendicular to AXIS, Rodrigues' rotation formula reduces to this.
+  //
+  float rot_angle = new_spread - spread;
+  axis = (axis * cos (rot_angle) + cross (rot_axis, axis) * sin (rot_angle));
+  axis = axis.unit ();
+  spread = new_spread;
+}
+
+// Extend BOUNDS so that it also contains FROM.
+//
+void
+merge_bounds (Light::Sampler::EmissionBounds &bounds,
+	      const Light::Sampler::EmissionBounds &from)
+{
+  bounds.bbox += from.bbox;
+  merge_cones (bounds.axis, bounds.spread_angle,
+	       from.axis, from.spread_angle);
+  bounds.falloff_angle = max (bounds.falloff_angle, from.falloff_angle);
+}
+
+} // namespace
+
+
+
+// LightTree construction
+
+// Comparison functor for ordering build entries by the position of
+// their centroids along one axis.
+//
+struct LightTree::CentroidLess
+{
+  CentroidLess (unsigned _axis) : axis (_axis) { }
+
+  bool operator() (const BuildEntry &e1, const BuildEntry &e2) const
+  {
+    return e1.centroid[axis] < e2.centroid[axis];
+  }
+
+  unsigned axis;
+};
+
+
+// Make a tree containing all the light-samplers in SAMPLERS.  No
+// reference to SAMPLERS is kept, but the samplers themselves must
+// remain valid as long as the tree is used.
+//
+LightTree::LightTree (const std::vector<const Light::Sampler *> &samplers)
+{
+  std::vector<BuildEntry> entries;
+
+  for (std::vector<const Light::Sampler *>::const_iterator si
+	 = samplers.begin ();
+       si != samplers.end (); ++si)
+    {
+      const Light::Sampler *light = *si;
+
+      if (light->is_environ_light ())
+	environ_lights.push_back (light);
+      else
+	{
+	  // Lights which emit no power can never be chosen, so just
+	  // leave them out of the tree entirely.
+	  //
+	  BuildEntry entry (light);
+	  if (entry.power > 0)
+	    entries.push_back (entry);
+	}
+    }
+
+  if (! entries.empty ())
+    {
+      nodes.reserve (entries.size () * 2 - 1);
+      build (entries.begin (), entries.end ());
+    }
+}
+
+// Add nodes for the lights in BEG through END to NODES, and return the
+// index of the topmost node added.
+//
+unsigned
+LightTree::build (const std::vector<BuildEntry>::iterator &beg,
+		  const std::vector<BuildEntry>::iterator &end)
+{
+  unsigned node_index = nodes.size ();
+  nodes.push_back (Node ());
+
+  if (end - beg == 1)
+    {
+      Node &leaf = nodes[node_index];
+      leaf.bounds = beg->bounds;
+      leaf.power = beg->power;
+      leaf.light = beg->light;
+      return node_index;
+    }
+
+  // Split the lights in half along the axis where their centroids are
+  // most spread out.
+  //
+  BBox centroid_bbox;
+  for (std::vector<BuildEntry>::iterator ei = beg; ei != end; ++ei)
+    centroid_bbox += ei->centroid;
+
+  Vec extent = centroid_bbox.extent ();
+  unsigned axis = 0;
+  if (extent.y > extent[axis])
+    axis = 1;
+  if (extent.z > extent[axis])
+    axis = 2;
+
+  std::vector<BuildEntry>::iterator mid = beg + (end - beg) / 2;
+  std::nth_element (beg, mid, end, CentroidLess (axis));
+
+  // Note that the first child always immediately follows its parent.
+  //
+  unsigned first_child = build (beg, mid);
+  unsigned second_child = build (mid, end);
+
+  // NODES may have been reallocated by the recursive calls, so only get
+  // a reference to our node now.
+  //
+  Node &node = nodes[node_index];
+  const Node &child1 = nodes[first_child];
+  const Node &child2 = nodes[second_child];
+
+  node.bounds = child1.bounds;
+  merge_bounds (node.bounds, child2.bounds);
+  node.power = child1.power + child2.power;
+  node.second_child = second_child;
+
+  return node_index;
+}
+
+
+
+// LightTree::importance
+
+// Return an estimate of the relative contribution of the lights below
+// NODE to the point POS with surface normal NORM.
+//
+// The estimate is the node's power, scaled by the inverse square of the
+// distance from POS to the node's bounds, and by conservative bounds on
+// the cosine factors of the emitting surfaces and of the receiving
+// surface at POS.
+//
+float
+LightTree::importance (const Node &node, const Pos &pos, const Vec &norm)
+{
+  const Light::Sampler::EmissionBounds &bounds = node.bounds;
+
+  Pos center = bounds.bbox.center ();
+  dist_t radius = bounds.bbox.radius ();
+
+  Vec from_center = pos - center;
+  dist_t dist_sq = from_center.length_squared ();
+  dist_t radius_sq = radius * radius;
+
+  // The half-angle of a cone from POS containing the node's bounds.  If
+  // POS is inside the bounds, any direction is possible.
+  //
+  float bounds_angle
+    = (dist_sq > radius_sq) ? asin (float (radius / sqrt (dist_sq))) : PIf;
+
+  // Avoid huge importance values for points very close to, or inside,
+  // the bounds.
+  //
+  dist_t clamped_dist_sq = max (dist_sq, max (radius_sq, dist_t (Eps)));
+
+  // The minimum angle between POS and any possible emitting direction.
+  //
+  Vec dir = dist_sq > 0 ? from_center / sqrt (dist_sq) : bounds.axis;
+  float emit_angle
+    = max (angle_between (bounds.axis, dir)
+	   - bounds.spread_angle - bounds_angle,
+	   0.f);
+
+  // If POS is outside the range of directions any light below NODE
+  // emits in, it receives no light from them at all.
+  //
+  if (emit_angle > bounds.falloff_angle)
+    return 0;
+
+  // The minimum angle between NORM and the direction towards the
+  // lights.  We don't know whether the surface at POS reflects or
+  // transmits, so treat both sides the same.
+  //
+  float norm_angle = angle_between (norm, -dir);
+  norm_angle = min (norm_angle, PIf - norm_angle);
+  float recv_angle = max (norm_angle - bounds_angle, 0.f);
+
+  return (node.power * cos (emit_angle) * cos (recv_angle)
+	  / float (clamped_dist_sq));
+}
+
+
+
+// LightTree::sample
+
+// Choose a light-sampler to sample for the point POS, which has a
+// surface normal NORM (in world coordinates), using the parameter
+// PARAM.  The probability of having chosen the returned light is
+// returned in PDF.  If no light can possibly illuminate POS, zero is
+// returned.
+//
+const Light::Sampler *
+LightTree::sample (const Pos &pos, const Vec &norm, float param, float &pdf)
+  const
+{
+  pdf = 1;
+
+  // First decide whether to choose an environmental light or a light
+  // from the tree.  Environmental lights are each given the same
+  // weight as the entire tree.
+  //
+  unsigned num_environ = environ_lights.size ();
+  if (num_environ != 0)
+    {
+      unsigned num_choices = num_environ + (nodes.empty () ? 0 : 1);
+      float choice_prob = 1 / float (num_choices);
+      unsigned choice = min (unsigned (param * num_choices), num_choices - 1);
+
+      pdf = choice_prob;
+
+      if (choice < num_environ)
+	return environ_lights[choice];
+
+      // Rescale PARAM so that it can be reused for descending the tree.
+      //
+      param = clamp01 (param * num_choices - choice);
+    }
+
+  if (nodes.empty () || importance (nodes[0], pos, norm) == 0)
+    return 0;
+
+  // Descend the tree, choosing between each node's two children in
+  // proportion to their estimated importance.
+  //
+  unsigned node_index = 0;
+  while (! nodes[node_index].light)
+    {
+      unsigned child1 = node_index + 1;
+      unsigned child2 = nodes[node_index].second_child;
+
+      float imp1 = importance (nodes[child1], pos, norm);
+      float imp2 = importance (nodes[child2], pos, norm);
+      float imp_sum = imp1 + imp2;
+
+      if (imp_sum == 0)
+	return 0;
+
+      float prob1 = imp1 / imp_sum;
+
+      if (param < prob1 || imp2 == 0)
+	{
+	  node_index = child1;
+	  pdf *= prob1;
+	  param = min (param / prob1, 1.f);
+	}
+      else
+	{
+	  node_index = child2;
+	  pdf *= 1 - prob1;
+	  param = clamp01 ((param - prob1) / (1 - prob1));
+	}
+    }
+
+  return nodes[node_index].light;
+}
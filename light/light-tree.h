@@ -0,0 +1,124 @@
+// light-tree.h -- Hierarchy of lights for importance-based light selection
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_LIGHT_TREE_H
+#define SNOGRAY_LIGHT_TREE_H
+
+#include <vector>
+
+#include "light-selector.h"
+
+
+namespace snogray {
+
+
+// A bounding-volume hierarchy of light-samplers, where each node
+// records the total power and the emission bounds of the lights below
+// it.  This allows choosing a single light for a point, with
+// probability roughly proportional to that light's contribution at the
+// point, in time proportional to the log of the number of lights.
+//
+// Environmental lights, which have no location, are kept outside the
+// hierarchy, and chosen uniformly.
+//
+class LightTree : public LightSelector
+{
+public:
+
+  // Make a tree containing all the light-samplers in SAMPLERS.  No
+  // reference to SAMPLERS is kept, but the samplers themselves must
+  // remain valid as long as the tree is used.
+  //
+  LightTree (const std::vector<const Light::Sampler *> &samplers);
+
+  // Choose a light-sampler to sample for the point POS, which has a
+  // surface normal NORM (in world coordinates), using the parameter
+  // PARAM.  The probability of having chosen the returned light is
+  // returned in PDF.  If no light can possibly illuminate POS, zero is
+  // returned.
+  //
+  virtual const Light::Sampler *sample (const Pos &pos, const Vec &norm,
+					float param, float &pdf)
+    const;
+
+private:
+
+  // A node in the tree.  The first child of an internal node always
+  // immediately follows it in LightTree::nodes, and the index of the
+  // second child is recorded in the node.
+  //
+  struct Node
+  {
+    Node () : power (0), light (0), second_child (0) { }
+
+    // Conservative emission bounds of all lights below this node.
+    //
+    Light::Sampler::EmissionBounds bounds;
+
+    // The total power of all lights below this node.
+    //
+    float power;
+
+    // If this is a leaf node, the light-sampler it holds, otherwise zero.
+    //
+    const Light::Sampler *light;
+
+    // For internal nodes, the index in LightTree::nodes of the second
+    // child node.
+    //
+    unsigned second_child;
+  };
+
+  // A light-sampler and its bounds, used during tree construction.
+  //
+  struct BuildEntry
+  {
+    BuildEntry (const Light::Sampler *_light)
+      : light (_light), bounds (_light->emission_bounds ()),
+	power (_light->power ()), centroid (bounds.bbox.center ())
+    { }
+
+    const Light::Sampler *light;
+    Light::Sampler::EmissionBounds bounds;
+    float power;
+    Pos centroid;
+  };
+
+  // Comparison functor for ordering build entries by centroid.
+  //
+  struct CentroidLess;
+
+  // Add nodes for the lights in BEG through END to NODES, and return
+  // the index of the topmost node added.
+  //
+  unsigned build (const std::vector<BuildEntry>::iterator &beg,
+		  const std::vector<BuildEntry>::iterator &end);
+
+  // Return an estimate of the relative contribution of the lights
+  // below NODE to the point POS with surface normal NORM.
+  //
+  static float importance (const Node &node, const Pos &pos, const Vec &norm);
+
+  // Nodes in the tree; the root is the first node.
+  //
+  std::vector<Node> nodes;
+
+  // Environmental lights, which are not located anywhere in
+  // particular, and so are not in the tree.
+  //
+  std::vector<const Light::Sampler *> environ_lights;
+};
+
+
+}
+
+#endif // SNOGRAY_LIGHT_TREE_H
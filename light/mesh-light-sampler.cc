@@ -0,0 +1,481 @@
+// mesh-light-sampler.cc -- Light sampler for light-emitting meshes
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <algorithm>
+#include <limits>
+
+#include "util/snogmath.h"
+#include "geometry/tripar-isec.h"
+#include "material/cos-dist.h"
+#include "render/intersect.h"
+
+#include "mesh-light-sampler.h"
+
+
+using namespace snogray;
+
+
+// Maximum number of triangles in a BVH leaf node.
+//
+static const unsigned MAX_LEAF_TRIANGLES = 4;
+
+// Maximum depth of the BVH.  As it is built by median splits, this is
+// far more than will ever be needed.
+//
+static const unsigned MAX_BVH_DEPTH = 64;
+
+// Meshes with at most this many triangles use the left-over bits of
+// the parameter used to choose a triangle when choosing a point on
+// it; larger meshes instead split another parameter into
+// SPLIT_PARAM_STEPS steps (see MeshLightSampler::sample_triangle).
+//
+static const unsigned MAX_UNSPLIT_PARAM_TRIANGLES = 4096;
+static const unsigned SPLIT_PARAM_STEPS = 4096;
+
+
+namespace { // keep local to file
+
+// Return the centroid of TRI.
+//
+inline Pos
+centroid (const MeshLightSampler::Triangle &tri)
+{
+  return tri.point (1.f / 3, 1.f / 3);
+}
+
+// Return true if a ray from POS in direction DIR, with inverse
+// direction INV_DIR, hits BBOX at a distance less than MAX_T.
+//
+inline bool
+ray_hits_bbox (const BBox &bbox, const Pos &pos, const Vec &inv_dir,
+	       dist_t max_t)
+{
+  dist_t t0 = 0, t1 = max_t;
+
+  for (unsigned axis = 0; axis < 3; axis++)
+    {
+      dist_t near_t = (bbox.min[axis] - pos[axis]) * inv_dir[axis];
+      dist_t far_t = (bbox.max[axis] - pos[axis]) * inv_dir[axis];
+      if (near_t > far_t)
+	std::swap (near_t, far_t);
+      if (near_t > t0)
+	t0 = near_t;
+      if (far_t < t1)
+	t1 = far_t;
+      if (t0 > t1)
+	return false;
+    }
+
+  return true;
+}
+
+} // namespace
+
+
+// Comparison functor for ordering triangles by the position of their
+// centroids along one axis.
+//
+struct MeshLightSampler::CentroidLess
+{
+  CentroidLess (unsigned _axis) : axis (_axis) { }
+
+  bool operator() (const Triangle &tri1, const Triangle &tri2) const
+  {
+    return centroid (tri1)[axis] < centroid (tri2)[axis];
+  }
+
+  unsigned axis;
+};
+
+
+
+// MeshLightSampler constructor
+
+// Make a light-sampler for the triangles in TRIANGLES, which emit
+// radiance INTENSITY.  INTENSITY may be textured.
+//
+MeshLightSampler::MeshLightSampler (const std::vector<Triangle> &_triangles,
+				    const TexVal<Color> &_intensity)
+  : intensity (_intensity), total_power (0)
+{
+  // Degenerate triangles can never be sampled, so just leave them out.
+  //
+  triangles.reserve (_triangles.size ());
+  for (std::vector<Triangle>::const_iterator ti = _triangles.begin ();
+       ti != _triangles.end (); ++ti)
+    if (ti->area > 0)
+      triangles.push_back (*ti);
+
+  if (triangles.empty ())
+    return;
+
+  // Note that building the BVH reorders TRIANGLES, so it must be done
+  // before anything else refers to triangle indices.
+  //
+  nodes.reserve (2 * triangles.size () / MAX_LEAF_TRIANGLES + 1);
+  build_bvh (0, triangles.size ());
+
+  // Weight each triangle by its area times an estimate of its average
+  // emitted radiance.  If INTENSITY is not textured, this is exact.
+  //
+  std::vector<float> weights (triangles.size ());
+  double total_weight = 0, total_area = 0;
+  for (unsigned i = 0; i < triangles.size (); i++)
+    {
+      const Triangle &tri = triangles[i];
+
+      float radiance_est;
+      if (intensity.tex)
+	radiance_est = (radiance (tri, 0, 0).intensity ()
+			+ radiance (tri, 1, 0).intensity ()
+			+ radiance (tri, 0, 1).intensity ()
+			+ radiance (tri, 1.f / 3, 1.f / 3).intensity ()) / 4;
+      else
+	radiance_est = intensity.default_val.intensity ();
+
+      weights[i] = tri.area * radiance_est;
+      total_weight += double (weights[i]);
+      total_area += double (tri.area);
+    }
+
+  // A lambertian emitter with radiance L emits L * PI watts per unit
+  // area.
+  //
+  total_power = float (total_weight * PI);
+
+  // With a textured intensity, our estimate may be zero for triangles
+  // which actually do emit some light, so give every triangle at least
+  // a small probability of being chosen, to avoid bias.
+  //
+  if (intensity.tex && total_weight > 0)
+    {
+      float min_weight_per_area = float (total_weight / total_area) * 0.01f;
+      for (unsigned i = 0; i < triangles.size (); i++)
+	weights[i] += triangles[i].area * min_weight_per_area;
+    }
+
+  triangle_dist.set_weights (weights);
+
+  // Calculate emission bounds:  the emission directions are bounded by
+  // a cone around the area-weighted average normal, containing all
+  // triangle normals.
+  //
+  Vec normal_sum (0, 0, 0);
+  for (unsigned i = 0; i < triangles.size (); i++)
+    normal_sum += triangles[i].normal * triangles[i].area;
+
+  bounds.bbox = nodes[0].bbox;
+  bounds.falloff_angle = PIf / 2;
+
+  if (normal_sum.length_squared () > 0)
+    {
+      bounds.axis = normal_sum.unit ();
+
+      float min_cos = 1;
+      for (unsigned i = 0; i < triangles.size (); i++)
+	min_cos = min (min_cos,
+		       float (dot (bounds.axis, triangles[i].normal)));
+
+      bounds.spread_angle = acos (clamp (min_cos, -1.f, 1.f));
+    }
+  else
+    bounds.spread_angle = PIf;
+}
+
+
+
+// MeshLightSampler::build_bvh
+
+// Add BVH nodes for TRIANGLES[BEG] through TRIANGLES[END - 1] to NODES
+// (reordering them as necessary), and return the index of the topmost
+// node added.
+//
+unsigned
+MeshLightSampler::build_bvh (unsigned beg, unsigned end)
+{
+  unsigned node_index = nodes.size ();
+  nodes.push_back (Node ());
+
+  BBox bbox, centroid_bbox;
+  for (unsigned i = beg; i < end; i++)
+    {
+      const Triangle &tri = triangles[i];
+      bbox += tri.v0;
+      bbox += tri.v0 + tri.e1;
+      bbox += tri.v0 + tri.e2;
+      centroid_bbox += centroid (tri);
+    }
+
+  nodes[node_index].bbox = bbox;
+
+  if (end - beg <= MAX_LEAF_TRIANGLES)
+    {
+      nodes[node_index].num_triangles = end - beg;
+      nodes[node_index].index = beg;
+      return node_index;
+    }
+
+  // Split the triangles in half along the axis where their centroids
+  // are most spread out.
+  //
+  Vec extent = centroid_bbox.extent ();
+  unsigned axis = 0;
+  if (extent.y > extent[axis])
+    axis = 1;
+  if (extent.z > extent[axis])
+    axis = 2;
+
+  unsigned mid = beg + (end - beg) / 2;
+  std::nth_element (triangles.begin () + beg, triangles.begin () + mid,
+		    triangles.begin () + end, CentroidLess (axis));
+
+  // Note that the first child always immediately follows its parent.
+  //
+  build_bvh (beg, mid);
+  unsigned second_child = build_bvh (mid, end);
+
+  nodes[node_index].index = second_child;
+
+  return node_index;
+}
+
+
+
+// MeshLightSampler::intersect
+
+// If a ray from POS in direction DIR hits one of our triangles, return
+// its index, and return the distance, and the barycentric coordinates
+// of the intersection in T, U, and V.  Otherwise, return
+// TRIANGLES.size().
+//
+unsigned
+MeshLightSampler::intersect (const Pos &pos, const Vec &dir,
+			     dist_t &t, float &u, float &v)
+  const
+{
+  unsigned hit = triangles.size ();
+
+  if (nodes.empty ())
+    return hit;
+
+  Vec inv_dir (1 / dir.x, 1 / dir.y, 1 / dir.z);
+
+  dist_t max_t = std::numeric_limits<dist_t>::max ();
+
+  unsigned stack[MAX_BVH_DEPTH];
+  unsigned stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0)
+    {
+      const Node &node = nodes[stack[--stack_size]];
+
+      if (! ray_hits_bbox (node.bbox, pos, inv_dir, max_t))
+	continue;
+
+      if (node.num_triangles)
+	{
+	  for (unsigned i = 0; i < node.num_triangles; i++)
+	    {
+	      const Triangle &tri = triangles[node.index + i];
+	      dist_t tri_t;
+	      float tri_u, tri_v;
+	      if (tripar_intersects (tri.v0, tri.e1, tri.e2, false,
+				     pos, dir, dist_t (0), tri_t, tri_u, tri_v)
+		  && tri_t < max_t)
+		{
+		  max_t = tri_t;
+		  u = tri_u;
+		  v = tri_v;
+		  hit = node.index + i;
+		}
+	    }
+	}
+      else
+	{
+	  unsigned first_child = &node - &nodes[0] + 1;
+	  stack[stack_size++] = node.index;
+	  stack[stack_size++] = first_child;
+	}
+    }
+
+  t = max_t;
+
+  return hit;
+}
+
+
+
+// MeshLightSampler::sample_triangle
+
+// Choose a triangle using PARAM, and return its index, and the
+// barycentric coordinates of a point uniformly distributed on it in U
+// and V.
+//
+unsigned
+MeshLightSampler::sample_triangle (const UV &param, float &u, float &v) const
+{
+  // Meshes may have very many triangles, so use separate parameters to
+  // choose a triangle index and to choose between it and its alias.
+  //
+  float alias_rem;
+  unsigned num_tris = triangle_dist.size ();
+  unsigned tri_index = triangle_dist.sample (param.u, param.v, alias_rem);
+
+  // We need two more parameters to choose a point on the triangle.
+  // ALIAS_REM, which is derived from PARAM.v, is the first.
+  //
+  // For small meshes, the fractional part of PARAM.u within the
+  // chosen index is the second; it's also uniformly distributed, and
+  // using it preserves any stratification of PARAM.  However with
+  // many triangles, it has very few bits of precision left, so for
+  // large meshes we instead split ALIAS_REM into two parameters of
+  // half its precision each.
+  //
+  float pos_param1, pos_param2;
+  if (num_tris <= MAX_UNSPLIT_PARAM_TRIANGLES)
+    {
+      float index_scaled = param.u * num_tris;
+      pos_param1 = alias_rem;
+      pos_param2 = clamp01 (index_scaled - floor (index_scaled));
+    }
+  else
+    {
+      float split = alias_rem * SPLIT_PARAM_STEPS;
+      float split_int = min (floor (split), float (SPLIT_PARAM_STEPS - 1));
+      pos_param1 = (split_int + 0.5f) / SPLIT_PARAM_STEPS;
+      pos_param2 = clamp01 (split - split_int);
+    }
+
+  float sqrt_pos_param1 = sqrt (pos_param1);
+  u = sqrt_pos_param1 * (1 - pos_param2);
+  v = sqrt_pos_param1 * pos_param2;
+
+  return tri_index;
+}
+
+
+
+// MeshLightSampler::sample
+
+// Return a sample of this light from the viewpoint of ISEC (using a
+// surface-normal coordinate system, where the surface normal is
+// (0,0,1)), based on the parameter PARAM.
+//
+Light::Sampler::Sample
+MeshLightSampler::sample (const Intersect &isec, const UV &param) const
+{
+  if (triangle_dist.empty ())
+    return Sample ();
+
+  // Choose a triangle, and then a point uniformly distributed on it.
+  //
+  float u, v;
+  unsigned tri_index = sample_triangle (param, u, v);
+  const Triangle &tri = triangles[tri_index];
+
+  Pos ipos = isec.normal_frame.origin;
+  Vec view_vec = tri.point (u, v) - ipos;
+  dist_t dist = view_vec.length ();
+
+  if (dist > 0)
+    {
+      Vec wdir = view_vec / dist;
+
+      // Only the front side of the triangle emits light.
+      //
+      float cos_light = -dot (tri.normal, wdir);
+
+      if (cos_light > 0)
+	{
+	  // Convert the area-based PDF to a solid-angle PDF.
+	  //
+	  float pdf = area_pdf (tri_index) * float (dist * dist) / cos_light;
+
+	  // Convert the sample direction to ISEC's normal-space.
+	  //
+	  Vec dir = isec.normal_frame.to (wdir);
+
+	  // Only process samples which are in front of ISEC.
+	  //
+	  if (dir.z > 0)
+	    return Sample (radiance (tri, u, v), pdf, dir, dist);
+	}
+    }
+
+  return Sample ();
+}
+
+
+
+// MeshLightSampler::sample, free-sampling variant
+
+// Return a "free sample" of this light.
+//
+Light::Sampler::FreeSample
+MeshLightSampler::sample (const UV &param, const UV &dir_param) const
+{
+  if (triangle_dist.empty ())
+    return FreeSample ();
+
+  float u, v;
+  unsigned tri_index = sample_triangle (param, u, v);
+  const Triangle &tri = triangles[tri_index];
+
+  // Choose a direction in the triangle's normal-frame-of-reference
+  // according to DIR_PARAM, and convert it to the world
+  // frame-of-reference.
+  //
+  CosDist dist;
+  Vec dir = Frame (tri.normal).from (dist.sample (dir_param));
+
+  // As with SurfaceLightSampler, the cosine terms of the direction PDF
+  // and the angular-to-area conversion cancel out.
+  //
+  float pdf = area_pdf (tri_index) * INV_PIf;
+
+  return FreeSample (radiance (tri, u, v), pdf, tri.point (u, v), dir);
+}
+
+
+
+// MeshLightSampler::eval
+
+// Evaluate this light in direction DIR from the viewpoint of ISEC
+// (using a surface-normal coordinate system, where the surface normal
+// is (0,0,1)).
+//
+Light::Sampler::Value
+MeshLightSampler::eval (const Intersect &isec, const Vec &dir) const
+{
+  Pos ipos = isec.normal_frame.origin;
+  Vec wdir = isec.normal_frame.from (dir);
+
+  dist_t t;
+  float u, v;
+  unsigned tri_index = intersect (ipos, wdir, t, u, v);
+
+  if (tri_index < triangles.size ())
+    {
+      const Triangle &tri = triangles[tri_index];
+
+      float cos_light = -dot (tri.normal, wdir);
+
+      if (cos_light > 0)
+	{
+	  float pdf = area_pdf (tri_index) * float (t * t) / cos_light;
+	  return Value (radiance (tri, u, v), pdf, t);
+	}
+    }
+
+  return Value ();
+}
@@ -0,0 +1,190 @@
+// mesh-light-sampler.h -- Light sampler for light-emitting meshes
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_MESH_LIGHT_SAMPLER_H
+#define SNOGRAY_MESH_LIGHT_SAMPLER_H
+
+#include <vector>
+
+#include "color/color.h"
+#include "geometry/uv.h"
+#include "geometry/alias-dist.h"
+#include "texture/tex.h"
+
+#include "light-sampler.h"
+
+
+namespace snogray {
+
+
+// A light-sampler for a set of light-emitting triangles, typically
+// all the triangles in one part of a mesh.
+//
+// Triangles are chosen in proportion to their emitted power (area
+// times emitted radiance) using an alias table, and then sampled
+// uniformly by area.  All per-triangle data is stored in a single flat
+// array, so the originating mesh is not referenced after construction.
+//
+class MeshLightSampler : public Light::Sampler
+{
+public:
+
+  // A single light-emitting triangle.  Light is emitted only from the
+  // side which NORMAL points towards.
+  //
+  struct Triangle
+  {
+    Triangle (const Pos &_v0, const Pos &v1, const Pos &v2,
+	      const Vec &_normal,
+	      const UV &uv0, const UV &uv1, const UV &uv2)
+      : v0 (_v0), e1 (v1 - _v0), e2 (v2 - _v0), normal (_normal),
+	T0 (uv0), dTdu (uv1 - uv0), dTdv (uv2 - uv0),
+	area (cross (e1, e2).length () * 0.5f)
+    { }
+
+    // Return the position with barycentric coordinates U and V.
+    //
+    Pos point (float u, float v) const { return v0 + e1 * u + e2 * v; }
+
+    // Return the texture coordinates at barycentric coordinates U and V.
+    //
+    UV uv (float u, float v) const { return T0 + dTdu * u + dTdv * v; }
+
+    // Vertex 0, and the edges from it to vertices 1 and 2.
+    //
+    Pos v0;
+    Vec e1, e2;
+
+    // Unit normal of the emitting side.
+    //
+    Vec normal;
+
+    // Texture coordinates of vertex 0, and their change along each edge.
+    //
+    UV T0, dTdu, dTdv;
+
+    float area;
+  };
+
+  // Make a light-sampler for the triangles in TRIANGLES, which emit
+  // radiance INTENSITY.  INTENSITY may be textured.
+  //
+  MeshLightSampler (const std::vector<Triangle> &triangles,
+		    const TexVal<Color> &intensity);
+
+  // Return a sample of this light from the viewpoint of ISEC (using a
+  // surface-normal coordinate system, where the surface normal is
+  // (0,0,1)), based on the parameter PARAM.
+  //
+  virtual Sample sample (const Intersect &isec, const UV &param) const;
+
+  // Return a "free sample" of this light.
+  //
+  virtual FreeSample sample (const UV &param, const UV &dir_param) const;
+
+  // Evaluate this light in direction DIR from the viewpoint of ISEC (using
+  // a surface-normal coordinate system, where the surface normal is
+  // (0,0,1)).
+  //
+  virtual Value eval (const Intersect &isec, const Vec &dir) const;
+
+  // Return an estimate of the total power emitted by this light.
+  //
+  virtual float power () const { return total_power; }
+
+  // Return a conservative description of where, and in which
+  // directions, this light emits.
+  //
+  virtual EmissionBounds emission_bounds () const { return bounds; }
+
+private:
+
+  // A node in a bounding-volume hierarchy over TRIANGLES, used to find
+  // which triangle (if any) a ray hits.  Leaf nodes refer to a range of
+  // entries in TRIANGLES; the first child of an internal node always
+  // immediately follows it.
+  //
+  struct Node
+  {
+    Node () : num_triangles (0), index (0) { }
+
+    BBox bbox;
+
+    // If non-zero, this is a leaf node containing NUM_TRIANGLES
+    // triangles starting at TRIANGLES[INDEX].  Otherwise, it is an
+    // internal node, and INDEX is the index of the second child.
+    //
+    unsigned num_triangles;
+    unsigned index;
+  };
+
+  struct CentroidLess;
+
+  // Add BVH nodes for TRIANGLES[BEG] through TRIANGLES[END - 1] to
+  // NODES (reordering them as necessary), and return the index of the
+  // topmost node added.
+  //
+  unsigned build_bvh (unsigned beg, unsigned end);
+
+  // If a ray from POS in direction DIR hits one of our triangles,
+  // return its index, and return the distance, and the barycentric
+  // coordinates of the intersection in T, U, and V.  Otherwise, return
+  // TRIANGLES.size().
+  //
+  unsigned intersect (const Pos &pos, const Vec &dir,
+		      dist_t &t, float &u, float &v)
+    const;
+
+  // Choose a triangle using PARAM, and return its index, and the
+  // barycentric coordinates of a point uniformly distributed on it in
+  // U and V.
+  //
+  unsigned sample_triangle (const UV &param, float &u, float &v) const;
+
+  // Return the emitted radiance at barycentric coordinates U, V of
+  // triangle TRI.
+  //
+  Color radiance (const Triangle &tri, float u, float v) const
+  {
+    return intensity.eval (TexCoords (tri.point (u, v), tri.uv (u, v)));
+  }
+
+  // Return the area-based PDF of sampling a point on triangle TRI_INDEX.
+  //
+  float area_pdf (unsigned tri_index) const
+  {
+    return triangle_dist.pdf (tri_index) / triangles[tri_index].area;
+  }
+
+  std::vector<Triangle> triangles;
+
+  // Distribution for choosing triangles.
+  //
+  AliasDist triangle_dist;
+
+  // Bounding-volume hierarchy over TRIANGLES.
+  //
+  std::vector<Node> nodes;
+
+  // Radiance emitted by the triangles.
+  //
+  TexVal<Color> intensity;
+
+  float total_power;
+
+  EmissionBounds bounds;
+};
+
+
+}
+
+#endif // SNOGRAY_MESH_LIGHT_SAMPLER_H
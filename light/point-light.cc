@@ -49,6 +49,15 @@ public:
   //
   virtual bool is_point_light () const { return true; }
 
+  // Return an estimate of the total power emitted by this light.
+  //
+  virtual float power () const;
+
+  // Return a conservative description of where, and in which
+  // directions, this light emits.
+  //
+  virtual EmissionBounds emission_bounds () const;
+
 private:
 
   const PointLight &light;
@@ -133,6 +142,43 @@ PointLight::Sampler::eval (const Intersect &, const Vec &) const
 }
 
 
+
+// PointLight::Sampler::power
+
+// Return an estimate of the total power emitted by this light.
+//
+float
+PointLight::Sampler::power () const
+{
+  // The light's intensity is per steradian, so just multiply by the
+  // solid angle of the light's cone (4 * PI for an omni-directional
+  // point-light).  We ignore the fringe, as this is only an estimate.
+  //
+  return light.color.intensity () * 2 * PIf * (1 - light.cos_half_angle);
+}
+
+// Return a conservative description of where, and in which
+// directions, this light emits.
+//
+Light::Sampler::EmissionBounds
+PointLight::Sampler::emission_bounds () const
+{
+  BBox bbox (light.frame.origin);
+
+  if (light.cos_half_angle == -1)
+    return EmissionBounds (bbox);
+
+  // A spotlight emits at full intensity inside its core angle, and
+  // falls off to zero at the edge of the fringe.
+  //
+  float core_angle = acos (clamp (light.cos_half_core_angle, -1.f, 1.f));
+  float angle = acos (clamp (light.cos_half_angle, -1.f, 1.f));
+
+  return EmissionBounds (bbox, light.frame.z,
+			 core_angle, max (angle - core_angle, 0.f));
+}
+
+
 
 // PointLight::transform
 
@@ -46,6 +46,25 @@ public:
   //
   virtual Value eval (const Intersect &isec, const Vec &dir) const;
 
+  // Return an estimate of the total power emitted by this light.
+  //
+  virtual float power () const
+  {
+    // A lambertian emitter with radiance L emits L * PI watts per
+    // unit area.
+    //
+    return intensity.intensity () * (4 * PIf * radius * radius) * PIf;
+  }
+
+  // Return a conservative description of where, and in which
+  // directions, this light emits.
+  //
+  virtual EmissionBounds emission_bounds () const
+  {
+    Vec rvec (radius, radius, radius);
+    return EmissionBounds (BBox (pos - rvec, pos + rvec));
+  }
+
 private:
 
   // Location and size of the light.
@@ -25,7 +25,8 @@ using namespace snogray;
 
 SurfaceLightSampler::SurfaceLightSampler (const Surface &surface,
 					  const TexVal<Color> &_intensity)
-  : sampler (surface.make_sampler ()), intensity (_intensity.default_val)
+  : sampler (surface.make_sampler ()), intensity (_intensity.default_val),
+    area (0), bbox (surface.bbox ())
 {
   if (! sampler)
     throw std::runtime_error
@@ -34,6 +35,8 @@ SurfaceLightSampler::SurfaceLightSampler (const Surface &surface,
   if (_intensity.tex)
     throw std::runtime_error
       ("textured intensity not supported by SurfaceLight");
+
+  area = sampler->area ();
 }
 
 
@@ -132,4 +135,19 @@ SurfaceLightSampler::eval (const Intersect &isec, const Vec &dir) const
 }
 
 
+
+// SurfaceLightSampler::power
+
+// Return an estimate of the total power emitted by this light.
+//
+float
+SurfaceLightSampler::power () const
+{
+  // A lambertian emitter with radiance L emits L * PI watts per unit
+  // area.
+  //
+  return intensity.intensity () * area * PIf;
+}
+
+
 // arch-tag: 60165b73-d34e-4f49-9a90-958daefdeb78
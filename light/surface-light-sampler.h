@@ -46,6 +46,18 @@ public:
   //
   virtual Value eval (const Intersect &isec, const Vec &dir) const;
 
+  // Return an estimate of the total power emitted by this light.
+  //
+  virtual float power () const;
+
+  // Return a conservative description of where, and in which
+  // directions, this light emits.
+  //
+  virtual EmissionBounds emission_bounds () const
+  {
+    return EmissionBounds (bbox);
+  }
+
   // A sampler for the surface which is lit.
   //
   UniquePtr<const Surface::Sampler> sampler;
@@ -55,6 +67,14 @@ private:
   // Radiant emittance of this light (W / m^2).
   //
   Color intensity;
+
+  // Area of the surface which is lit.
+  //
+  float area;
+
+  // Bounding box of the surface which is lit.
+  //
+  BBox bbox;
 };
 
 
@@ -242,6 +242,10 @@ local mesh_geometry_loaders = {}
 -- otherwise it should be a material, for which a new part will be
 -- added.
 --
+-- If PARAMS.compress is true, the mesh's vertices are compressed
+-- after loading (see Mesh::compress_vertices), which greatly reduces
+-- memory use for large meshes, at the cost of some precision.
+--
 -- Return true for a successful load, false if SCENE_FILE is not
 -- recognized as loadable, or an error string if an error occured
 -- during loading.
@@ -271,6 +275,9 @@ function load.mesh_geometry (mesh_file, mesh, part_or_material, params)
       local loader = mesh_geometry_loaders[fmt]
       if loader then
 	 loader (mesh_file, mesh, part, params)
+	 if params.compress then
+	    mesh:compress_vertices ()
+	 end
       else
 	 error ("unknown mesh format \""..fmt.."\"", 0)
       end
@@ -318,6 +325,8 @@ local mesh_loaders = {}
 
 -- Load mesh from SCENE_FILE into MESH.
 --
+-- PARAMS.compress is handled as for load.mesh_geometry.
+--
 -- Return true for a successful load, false if SCENE_FILE is not
 -- recognized as loadable, or an error string if an error occured
 -- during loading.
@@ -334,6 +343,9 @@ function load.mesh (mesh_file, mesh, params)
       local loader = mesh_loaders[fmt]
       if loader then
 	 loader (mesh_file, mesh, params)
+	 if params.compress then
+	    mesh:compress_vertices ()
+	 end
       else
 	 error ("unknown mesh format \""..fmt.."\"", 0)
       end
@@ -404,18 +416,19 @@ add_scene_loader ("3ds", function (scene_file, environ)
 
 -- Mesh formats with Lua loaders.
 --
--- "obj" should actually be a full mesh loader, not a geometry loader,
--- as .obj files can have embedded materials, but our current loader
--- only handles geometry.
---
-add_mesh_geometry_loader_autoload ("obj", "snogray.loader.mesh.obj")
 add_mesh_geometry_loader_autoload ("stl", "snogray.loader.mesh.stl")
 add_mesh_loader_autoload ("ug", "snogray.loader.mesh.ug")
 
 -- Mesh geometry formats with C loaders.
 --
+-- "obj" should actually be a full mesh loader, not a geometry loader,
+-- as .obj files can have embedded materials, but our current loader
+-- only handles geometry.
+--
+add_mesh_geometry_loader ("obj", raw.load_obj_file)
 add_mesh_geometry_loader ("ply", raw.load_ply_file)
 add_mesh_geometry_loader ("msh", raw.load_msh_file)
+add_mesh_geometry_loader ("snogmesh", raw.load_snogmesh_file)
 add_mesh_loader ("3ds", raw.load_3ds_file)
 
 
@@ -0,0 +1,865 @@
+// load-obj.cc -- Load a .obj format mesh file
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "config.h"
+
+#include "util/excepts.h"
+#include "util/hash-bits.h"
+#include "util/mapped-file.h"
+#include "util/num-cores.h"
+#include "util/string-funs.h"
+#if USE_THREADS
+#include "util/thread.h"
+#endif
+#include "surface/mesh.h"
+
+#include "load-obj.h"
+
+
+using namespace snogray;
+
+
+namespace { // keep local to file
+
+
+// Low-level parsing
+
+inline bool
+is_digit (char ch)
+{
+  return ch >= '0' && ch <= '9';
+}
+
+inline bool
+is_horiz_space (char ch)
+{
+  return ch == ' ' || ch == '\t';
+}
+
+inline bool
+is_eol (char ch)
+{
+  return ch == '\n' || ch == '\r';
+}
+
+// Return the position of the first non-whitespace character at or
+// after P.
+//
+inline const char *
+skip_horiz_space (const char *p, const char *end)
+{
+  while (p != end && is_horiz_space (*p))
+    p++;
+  return p;
+}
+
+// Return the position of the beginning of the line following the one
+// containing P.
+//
+inline const char *
+skip_line (const char *p, const char *end)
+{
+  const char *nl
+    = static_cast<const char *> (std::memchr (p, '\n', end - p));
+  return nl ? nl + 1 : end;
+}
+
+// Powers of ten which are exactly representable as doubles.
+//
+const double exact_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+  1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int MAX_EXACT_POW10 = 22;
+
+// Parse a floating-point number using strtod, which handles unusual
+// forms such as "nan" or "inf".  Returns the position after the
+// number, or zero if there's no number at P.
+//
+const char *
+parse_float_slow (const char *p, const char *end, float &val)
+{
+  // As the text may not be null-terminated, copy it to a buffer first.
+  //
+  char buf[64];
+  unsigned len = 0;
+  while (p + len != end && len < sizeof buf - 1
+	 && ! is_horiz_space (p[len]) && ! is_eol (p[len]))
+    {
+      buf[len] = p[len];
+      len++;
+    }
+  buf[len] = '\0';
+
+  char *num_end;
+  double d = strtod (buf, &num_end);
+  if (num_end == buf)
+    return 0;
+
+  val = float (d);
+  return p + (num_end - buf);
+}
+
+// Parse a floating-point number at P, storing it in VAL.  Returns the
+// position after the number, or zero if there's no number at P.
+//
+// This is much faster than strtod, and handles all the forms of
+// numbers normally found in .obj files; the result may differ from a
+// correctly rounded conversion only in very rare cases, by at most one
+// unit in the last place of VAL.
+//
+const char *
+parse_float (const char *p, const char *end, float &val)
+{
+  const char *start = p;
+
+  bool neg = false;
+  if (p != end && (*p == '-' || *p == '+'))
+    neg = (*p++ == '-');
+
+  // Accumulate up to 19 significant digits (which is all that fit in
+  // MANT); any further digits only affect the exponent.
+
+  unsigned long long mant = 0;
+  unsigned num_sig_digits = 0;
+  int exp10 = 0;
+  bool any_digits = false;
+
+  for (; p != end && is_digit (*p); p++)
+    {
+      if (num_sig_digits < 19)
+	{
+	  mant = mant * 10 + unsigned (*p - '0');
+	  if (mant != 0)
+	    num_sig_digits++;
+	}
+      else
+	exp10++;
+      any_digits = true;
+    }
+
+  if (p != end && *p == '.')
+    for (p++; p != end && is_digit (*p); p++)
+      {
+	if (num_sig_digits < 19)
+	  {
+	    mant = mant * 10 + unsigned (*p - '0');
+	    if (mant != 0)
+	      num_sig_digits++;
+	    exp10--;
+	  }
+	any_digits = true;
+      }
+
+  if (! any_digits)
+    return parse_float_slow (start, end, val);
+
+  if (p != end && (*p == 'e' || *p == 'E'))
+    {
+      const char *q = p + 1;
+
+      bool exp_neg = false;
+      if (q != end && (*q == '-' || *q == '+'))
+	exp_neg = (*q++ == '-');
+
+      if (q != end && is_digit (*q))
+	{
+	  int exp = 0;
+	  for (; q != end && is_digit (*q); q++)
+	    if (exp < 10000)
+	      exp = exp * 10 + (*q - '0');
+
+	  exp10 += exp_neg ? -exp : exp;
+	  p = q;
+	}
+    }
+
+  double d = double (mant);
+  if (exp10 < 0)
+    {
+      if (exp10 >= -MAX_EXACT_POW10)
+	d /= exact_pow10[-exp10];
+      else
+	d *= std::pow (10., exp10);
+    }
+  else if (exp10 > 0)
+    {
+      if (exp10 <= MAX_EXACT_POW10)
+	d *= exact_pow10[exp10];
+      else
+	d *= std::pow (10., exp10);
+    }
+
+  val = float (neg ? -d : d);
+
+  return p;
+}
+
+// Parse a (possibly negative) integer at P, storing it in VAL.
+// Returns the position after the number, or zero if there's no number
+// at P.
+//
+const char *
+parse_int (const char *p, const char *end, int &val)
+{
+  bool neg = false;
+  if (p != end && (*p == '-' || *p == '+'))
+    neg = (*p++ == '-');
+
+  if (p == end || ! is_digit (*p))
+    return 0;
+
+  int num = 0;
+  for (; p != end && is_digit (*p); p++)
+    num = num * 10 + (*p - '0');
+
+  val = neg ? -num : num;
+
+  return p;
+}
+
+
+// ObjChunk
+
+// The kinds of index used in a face vertex.
+//
+enum { POS_INDEX, UV_INDEX, NORM_INDEX, NUM_INDEX_KINDS };
+
+// A single vertex of a face, holding an index for each kind of
+// element:  position, texture coordinate (UV), and normal.
+//
+// While parsing, each index is the 1-based index from the file, or zero
+// if omitted.  Relative (negative) indices are converted to an index
+// relative to the beginning of the chunk, and recorded in
+// ObjChunk::relative_indices.  After ObjChunk::resolve, each index is
+// a 0-based index into the whole file's data, or -1 if omitted.
+//
+struct FaceVert
+{
+  int index[NUM_INDEX_KINDS];
+};
+
+// A range of lines from a .obj file, and the data parsed from them.
+//
+// Different chunks can be parsed in parallel, as each chunk's data is
+// kept separate until all are done.
+//
+class ObjChunk
+{
+public:
+
+  ObjChunk () : begin (0), end (0), error_pos (0) { }
+
+  // Parse the text from BEGIN to END.  If an error occurs, ERROR and
+  // ERROR_POS are set, and parsing stops.
+  //
+  void parse ();
+
+  // Convert the indices in TRI_VERTS into 0-based indices into the
+  // whole file's data, where BASE[K] is the number of elements of kind
+  // K in all previous chunks, and TOTAL[K] the number in the whole
+  // file.  If any index is out of range, ERROR is set.
+  //
+  void resolve ();
+
+  // Text of this chunk.  It always begins at the start of a line.
+  //
+  const char *begin, *end;
+
+  // Number of elements of each kind in all previous chunks, and in the
+  // whole file; these are set before calling ObjChunk::resolve.
+  //
+  int base[NUM_INDEX_KINDS];
+  int total[NUM_INDEX_KINDS];
+
+  // Vertex data parsed from this chunk:  3 floats per position and
+  // normal, and 2 per texture coordinate.
+  //
+  std::vector<float> positions, normals, uvs;
+
+  // Vertices of triangles, three per triangle.
+  //
+  std::vector<FaceVert> tri_verts;
+
+  // Indices in TRI_VERTS which are relative to the beginning of this
+  // chunk, each encoded as TRI_VERT_INDEX * NUM_INDEX_KINDS + KIND.
+  // These are relatively rare, so are kept separately.
+  //
+  std::vector<unsigned> relative_indices;
+
+  // After ObjChunk::resolve, these are true if any vertex in
+  // TRI_VERTS is missing a UV or normal index, respectively, and if
+  // any vertex uses a UV or normal index different from its position
+  // index.
+  //
+  bool missing[NUM_INDEX_KINDS];
+  bool distinct[NUM_INDEX_KINDS];
+
+  // If an error occurs, a description of it, and where it happened
+  // (zero if that isn't known).
+  //
+  std::string error;
+  const char *error_pos;
+
+private:
+
+  // Parse the face description at P, which should be just after the
+  // "f" command, and add its triangles to TRI_VERTS.  Returns false if
+  // there's an error.
+  //
+  bool parse_face (const char *p);
+
+  // Parse NUM floats at P, adding them to VEC; missing trailing values
+  // are set to zero, but at least MIN_NUM must be present.  Returns
+  // false if there's an error.
+  //
+  bool parse_floats (const char *p, unsigned num, unsigned min_num,
+		     std::vector<float> &vec);
+
+  // Set ERROR to MSG, and ERROR_POS to POS_INDEX.  Always returns false.
+  //
+  bool set_error (const char *pos, const std::string &msg)
+  {
+    error_pos = pos;
+    error = msg;
+    return false;
+  }
+
+  // Vertices of the face being parsed, and a bit-mask of which
+  // indices are relative for each.
+  //
+  std::vector<FaceVert> face;
+  std::vector<unsigned char> face_relative;
+};
+
+void
+ObjChunk::parse ()
+{
+  try
+    {
+      const char *p = begin;
+
+      while (p != end)
+	{
+	  const char *cmd = skip_horiz_space (p, end);
+
+	  if (cmd + 1 < end && is_horiz_space (cmd[1]))
+	    {
+	      if (cmd[0] == 'v')
+		{
+		  if (! parse_floats (cmd + 1, 3, 3, positions))
+		    return;
+		}
+	      else if (cmd[0] == 'f')
+		{
+		  if (! parse_face (cmd + 1))
+		    return;
+		}
+	    }
+	  else if (cmd + 2 < end && cmd[0] == 'v' && is_horiz_space (cmd[2]))
+	    {
+	      if (cmd[1] == 'n')
+		{
+		  if (! parse_floats (cmd + 2, 3, 3, normals))
+		    return;
+		}
+	      else if (cmd[1] == 't')
+		{
+		  if (! parse_floats (cmd + 2, 2, 1, uvs))
+		    return;
+		}
+	    }
+
+	  // Anything else (comments, groups, materials, smoothing
+	  // groups, etc.) is ignored.
+
+	  p = skip_line (cmd, end);
+	}
+    }
+  catch (std::exception &err)
+    {
+      set_error (0, err.what ());
+    }
+}
+
+bool
+ObjChunk::parse_floats (const char *p, unsigned num, unsigned min_num,
+			std::vector<float> &vec)
+{
+  for (unsigned i = 0; i < num; i++)
+    {
+      p = skip_horiz_space (p, end);
+
+      float val = 0;
+      if (p == end || is_eol (*p) || *p == '#')
+	{
+	  if (i < min_num)
+	    return set_error (p, "missing coordinate");
+	}
+      else
+	{
+	  const char *num_end = parse_float (p, end, val);
+	  if (! num_end)
+	    return set_error (p, "invalid number");
+	  p = num_end;
+	}
+
+      vec.push_back (val);
+    }
+
+  return true;
+}
+
+bool
+ObjChunk::parse_face (const char *p)
+{
+  // Number of elements of each kind parsed so far in this chunk, used
+  // to resolve relative indices.
+  //
+  int count[NUM_INDEX_KINDS];
+  count[POS_INDEX] = positions.size () / 3;
+  count[UV_INDEX] = uvs.size () / 2;
+  count[NORM_INDEX] = normals.size () / 3;
+
+  face.clear ();
+  face_relative.clear ();
+
+  for (;;)
+    {
+      p = skip_horiz_space (p, end);
+      if (p == end || is_eol (*p) || *p == '#')
+	break;
+
+      // A face vertex has the form POS, POS/UV, POS//NORM, or
+      // POS/UV/NORM.
+
+      FaceVert fv;
+      unsigned char relative = 0;
+
+      for (unsigned kind = 0; kind < NUM_INDEX_KINDS; kind++)
+	{
+	  fv.index[kind] = 0;
+
+	  if (kind != POS_INDEX)
+	    {
+	      if (p == end || *p != '/')
+		continue;
+	      p++;
+	      if (kind == UV_INDEX && p != end && *p == '/')
+		continue;
+	    }
+
+	  int index;
+	  const char *num_end = parse_int (p, end, index);
+	  if (! num_end || index == 0)
+	    return set_error (p, "invalid face vertex index");
+	  p = num_end;
+
+	  if (index < 0)
+	    {
+	      relative |= (1 << kind);
+	      index += count[kind];
+	    }
+
+	  fv.index[kind] = index;
+	}
+
+      if (p != end && ! is_horiz_space (*p) && ! is_eol (*p) && *p != '#')
+	return set_error (p, "invalid face vertex");
+
+      face.push_back (fv);
+      face_relative.push_back (relative);
+    }
+
+  if (face.size () < 3)
+    return set_error (p, "face has fewer than three vertices");
+
+  // Add the face as a fan of triangles.
+
+  for (unsigned i = 2; i < face.size (); i++)
+    {
+      unsigned corners[3] = { 0, i - 1, i };
+
+      for (unsigned c = 0; c < 3; c++)
+	{
+	  unsigned fv = corners[c];
+	  unsigned tri_vert_index = tri_verts.size ();
+
+	  if (face_relative[fv])
+	    for (unsigned kind = 0; kind < NUM_INDEX_KINDS; kind++)
+	      if (face_relative[fv] & (1 << kind))
+		relative_indices.push_back (tri_vert_index * NUM_INDEX_KINDS
+					    + kind);
+
+	  tri_verts.push_back (face[fv]);
+	}
+    }
+
+  return true;
+}
+
+void
+ObjChunk::resolve ()
+{
+  for (unsigned kind = 0; kind < NUM_INDEX_KINDS; kind++)
+    missing[kind] = distinct[kind] = false;
+
+  // Relative indices are already 0-based, relative to the chunk start,
+  // so just add the chunk base.  We then mark them by negating them
+  // (minus one, so even 0 can be marked), so the loop below can
+  // tell them apart.
+  //
+  for (std::vector<unsigned>::const_iterator ri = relative_indices.begin ();
+       ri != relative_indices.end (); ++ri)
+    {
+      unsigned kind = *ri % NUM_INDEX_KINDS;
+      int &index = tri_verts[*ri / NUM_INDEX_KINDS].index[kind];
+
+      // A relative index reaching back before the first vertex would
+      // otherwise be mistaken for an absolute or omitted index below.
+      //
+      if (index + base[kind] < 0)
+	{
+	  set_error (0, "face vertex index out of range");
+	  return;
+	}
+
+      index = -(index + base[kind]) - 1;
+    }
+
+  for (std::vector<FaceVert>::iterator fvi = tri_verts.begin ();
+       fvi != tri_verts.end (); ++fvi)
+    {
+      for (unsigned kind = 0; kind < NUM_INDEX_KINDS; kind++)
+	{
+	  int &index = fvi->index[kind];
+
+	  if (index > 0)
+	    index--;		// absolute 1-based index
+	  else if (index < 0)
+	    index = -(index + 1); // marked relative index
+	  else
+	    {
+	      index = -1;	// omitted
+	      missing[kind] = true;
+	      continue;
+	    }
+
+	  if (index < 0 || index >= total[kind])
+	    {
+	      set_error (0, "face vertex index out of range");
+	      return;
+	    }
+	}
+
+      if (fvi->index[UV_INDEX] != fvi->index[POS_INDEX])
+	distinct[UV_INDEX] = true;
+      if (fvi->index[NORM_INDEX] != fvi->index[POS_INDEX])
+	distinct[NORM_INDEX] = true;
+    }
+}
+
+
+// Parallel chunk processing
+
+// Call METH for every chunk in CHUNKS, in parallel if possible.
+//
+void
+for_all_chunks (std::vector<ObjChunk> &chunks, void (ObjChunk::*meth) ())
+{
+#if USE_THREADS
+
+  std::vector<Thread *> threads;
+  for (unsigned i = 1; i < chunks.size (); i++)
+    threads.push_back (new Thread (meth, &chunks[i]));
+
+  (chunks[0].*meth) ();
+
+  for (unsigned i = 0; i < threads.size (); i++)
+    {
+      threads[i]->join ();
+      delete threads[i];
+    }
+
+#else // !USE_THREADS
+
+  for (unsigned i = 0; i < chunks.size (); i++)
+    (chunks[i].*meth) ();
+
+#endif // USE_THREADS
+}
+
+// If any chunk in CHUNKS has an error, throw an exception describing
+// the first one.
+//
+void
+check_chunk_errors (const std::vector<ObjChunk> &chunks,
+		    const std::string &filename, const char *file_begin)
+{
+  for (unsigned i = 0; i < chunks.size (); i++)
+    if (! chunks[i].error.empty ())
+      {
+	std::string loc = filename;
+	if (chunks[i].error_pos)
+	  {
+	    unsigned line_num
+	      = std::count (file_begin, chunks[i].error_pos, '\n') + 1;
+	    loc += ":" + stringify (line_num);
+	  }
+	throw bad_format (loc + ": " + chunks[i].error);
+      }
+}
+
+// Append all elements of FROM to TO, and free FROM's memory.
+//
+void
+move_append (std::vector<float> &from, std::vector<float> &to)
+{
+  to.insert (to.end (), from.begin (), from.end ());
+  std::vector<float> ().swap (from);
+}
+
+
+} // namespace
+
+
+// load_obj_file
+
+// Load mesh geometry from a .obj format mesh file into MESH part PART.
+//
+void
+snogray::load_obj_file (const std::string &filename,
+			Mesh &mesh, Mesh::part_index_t part,
+			const ValTable &)
+{
+  MappedFile contents (filename, true);
+
+  // .obj files use a right-handed coordinate system by convention.
+  //
+  mesh.left_handed = false;
+
+  const char *file_begin = contents.begin ();
+  const char *file_end = contents.end ();
+  size_t size = file_end - file_begin;
+
+  // Split the file into chunks at line boundaries, one per core,
+  // except that small files aren't split up as much.
+  //
+  const size_t MIN_CHUNK_SIZE = 1024 * 1024;
+  unsigned num_chunks = num_cores ();
+  if (size / MIN_CHUNK_SIZE + 1 < num_chunks)
+    num_chunks = size / MIN_CHUNK_SIZE + 1;
+
+  std::vector<ObjChunk> chunks (num_chunks);
+  const char *chunk_begin = file_begin;
+  for (unsigned i = 0; i < num_chunks; i++)
+    {
+      const char *chunk_end = file_end;
+      if (i + 1 < num_chunks)
+	{
+	  chunk_end = file_begin + size / num_chunks * (i + 1);
+	  if (chunk_end < chunk_begin)
+	    chunk_end = chunk_begin;
+	  else if (chunk_end != file_begin)
+	    chunk_end = skip_line (chunk_end - 1, file_end);
+	}
+
+      chunks[i].begin = chunk_begin;
+      chunks[i].end = chunk_end;
+
+      chunk_begin = chunk_end;
+    }
+
+  for_all_chunks (chunks, &ObjChunk::parse);
+  check_chunk_errors (chunks, filename, file_begin);
+
+  // Now that we know how much data each chunk contains, resolve all
+  // face-vertex indices into indices into the whole file's data.
+
+  int total[NUM_INDEX_KINDS] = { 0, 0, 0 };
+  for (unsigned i = 0; i < num_chunks; i++)
+    {
+      ObjChunk &chunk = chunks[i];
+
+      for (unsigned kind = 0; kind < NUM_INDEX_KINDS; kind++)
+	chunk.base[kind] = total[kind];
+
+      total[POS_INDEX] += chunk.positions.size () / 3;
+      total[UV_INDEX] += chunk.uvs.size () / 2;
+      total[NORM_INDEX] += chunk.normals.size () / 3;
+    }
+  for (unsigned i = 0; i < num_chunks; i++)
+    for (unsigned kind = 0; kind < NUM_INDEX_KINDS; kind++)
+      chunks[i].total[kind] = total[kind];
+
+  for_all_chunks (chunks, &ObjChunk::resolve);
+  check_chunk_errors (chunks, filename, file_begin);
+
+  // Normals and UVs are only used if every face vertex has them.  If
+  // they always use the same index as the position, vertex data can be
+  // used directly; otherwise we need to make a separate mesh vertex for
+  // each distinct combination of indices.
+  //
+  bool use_kind[NUM_INDEX_KINDS], need_split = false;
+  for (unsigned kind = 0; kind < NUM_INDEX_KINDS; kind++)
+    {
+      use_kind[kind] = total[kind] > 0;
+      for (unsigned i = 0; i < num_chunks; i++)
+	if (chunks[i].missing[kind])
+	  use_kind[kind] = false;
+
+      if (use_kind[kind] && kind != POS_INDEX)
+	{
+	  if (total[kind] != total[POS_INDEX])
+	    need_split = true;
+	  for (unsigned i = 0; i < num_chunks; i++)
+	    if (chunks[i].distinct[kind])
+	      need_split = true;
+	}
+    }
+
+  std::vector<float> positions, normals, uvs;
+  std::vector<Mesh::vert_index_t> tri_vert_indices;
+
+  unsigned num_tri_verts = 0;
+  for (unsigned i = 0; i < num_chunks; i++)
+    num_tri_verts += chunks[i].tri_verts.size ();
+  tri_vert_indices.reserve (num_tri_verts);
+
+  if (! need_split)
+    {
+      // Simple case, just use the data as-is.
+
+      positions.reserve (total[POS_INDEX] * 3);
+      if (use_kind[NORM_INDEX])
+	normals.reserve (total[NORM_INDEX] * 3);
+      if (use_kind[UV_INDEX])
+	uvs.reserve (total[UV_INDEX] * 2);
+
+      for (unsigned i = 0; i < num_chunks; i++)
+	{
+	  ObjChunk &chunk = chunks[i];
+
+	  move_append (chunk.positions, positions);
+	  if (use_kind[NORM_INDEX])
+	    move_append (chunk.normals, normals);
+	  if (use_kind[UV_INDEX])
+	    move_append (chunk.uvs, uvs);
+
+	  for (std::vector<FaceVert>::const_iterator
+		 fvi = chunk.tri_verts.begin ();
+	       fvi != chunk.tri_verts.end (); ++fvi)
+	    tri_vert_indices.push_back (fvi->index[POS_INDEX]);
+
+	  std::vector<FaceVert> ().swap (chunk.tri_verts);
+	}
+    }
+  else
+    {
+      // Make a mesh vertex for each distinct combination of position,
+      // normal, and UV index, using an open-addressed hash table,
+      // VERT_TABLE, to find existing vertices.  The table holds
+      // mesh-vertex indices plus one, with zero meaning an empty slot,
+      // and is always at most half full.
+
+      std::vector<float> all_positions, all_normals, all_uvs;
+      for (unsigned i = 0; i < num_chunks; i++)
+	{
+	  move_append (chunks[i].positions, all_positions);
+	  if (use_kind[NORM_INDEX])
+	    move_append (chunks[i].normals, all_normals);
+	  if (use_kind[UV_INDEX])
+	    move_append (chunks[i].uvs, all_uvs);
+	}
+
+      unsigned table_size = 64;
+      while (table_size < num_tri_verts * 2)
+	table_size *= 2;
+
+      std::vector<unsigned> vert_table (table_size, 0);
+      std::vector<FaceVert> vert_indices;
+
+      for (unsigned i = 0; i < num_chunks; i++)
+	{
+	  ObjChunk &chunk = chunks[i];
+
+	  for (std::vector<FaceVert>::const_iterator
+		 fvi = chunk.tri_verts.begin ();
+	       fvi != chunk.tri_verts.end (); ++fvi)
+	    {
+	      FaceVert fv = *fvi;
+	      if (! use_kind[UV_INDEX])
+		fv.index[UV_INDEX] = -1;
+	      if (! use_kind[NORM_INDEX])
+		fv.index[NORM_INDEX] = -1;
+
+	      unsigned pos = fv.index[POS_INDEX];
+	      unsigned uv = fv.index[UV_INDEX];
+	      unsigned norm = fv.index[NORM_INDEX];
+
+	      unsigned slot
+		= mix_bits (pos ^ mix_bits (uv ^ mix_bits (norm)))
+		& (table_size - 1);
+	      unsigned vert;
+	      for (;;)
+		{
+		  vert = vert_table[slot];
+		  if (vert == 0)
+		    break;
+
+		  const FaceVert &old = vert_indices[vert - 1];
+		  if (old.index[POS_INDEX] == fv.index[POS_INDEX]
+		      && old.index[UV_INDEX] == fv.index[UV_INDEX]
+		      && old.index[NORM_INDEX] == fv.index[NORM_INDEX])
+		    break;
+
+		  slot = (slot + 1) & (table_size - 1);
+		}
+
+	      if (vert == 0)
+		{
+		  vert_indices.push_back (fv);
+		  vert = vert_indices.size ();
+		  vert_table[slot] = vert;
+
+		  for (unsigned c = 0; c < 3; c++)
+		    positions.push_back (all_positions[pos * 3 + c]);
+		  if (use_kind[NORM_INDEX])
+		    for (unsigned c = 0; c < 3; c++)
+		      normals.push_back (all_normals[norm * 3 + c]);
+		  if (use_kind[UV_INDEX])
+		    for (unsigned c = 0; c < 2; c++)
+		      uvs.push_back (all_uvs[uv * 2 + c]);
+		}
+
+	      vert--;
+
+	      tri_vert_indices.push_back (vert);
+	    }
+
+	  std::vector<FaceVert> ().swap (chunk.tri_verts);
+	}
+    }
+
+  Mesh::vert_index_t base_vert = mesh.add_vertices (positions);
+  if (! normals.empty ())
+    mesh.add_normals (normals, base_vert);
+  if (! uvs.empty ())
+    mesh.add_uvs (uvs, base_vert);
+  mesh.add_triangles (part, tri_vert_indices, base_vert);
+}
@@ -0,0 +1,42 @@
+// load-obj.h -- Load a .obj format mesh file
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_LOAD_OBJ_H
+#define SNOGRAY_LOAD_OBJ_H
+
+
+#include <string>
+
+#include "surface/mesh.h"
+
+
+namespace snogray {
+
+class ValTable;
+
+
+// Load mesh geometry from a .obj format mesh file into MESH part PART.
+//
+// Vertex positions ("v"), normals ("vn"), and texture coordinates
+// ("vt") are supported, as are polygonal faces ("f") using any
+// combination of position, normal, and texture-coordinate indices
+// (including negative, i.e., relative, indices).  Materials, groups,
+// and other commands are ignored.
+//
+extern void load_obj_file (const std::string &filename,
+			   Mesh &mesh, Mesh::part_index_t part,
+			   const ValTable &params);
+
+
+}
+
+#endif // SNOGRAY_LOAD_OBJ_H
@@ -0,0 +1,352 @@
+// snogmesh.cc -- Load/save snogray's native binary mesh format
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "util/excepts.h"
+#include "util/mapped-file.h"
+#include "surface/mesh.h"
+
+#include "snogmesh.h"
+
+
+using namespace snogray;
+
+
+namespace { // keep local to file
+
+// File header.  All offsets are from the beginning of the file.
+//
+struct Header
+{
+  // Always MAGIC.
+  //
+  char magic[8];
+
+  // BYTE_ORDER_MARK, in the byte order of the machine writing the file.
+  //
+  unsigned byte_order_mark;
+
+  // Always FORMAT_VERSION.
+  //
+  unsigned version;
+
+  // A combination of the FLAG_* values below.
+  //
+  unsigned flags;
+
+  unsigned num_vertices;
+  unsigned num_parts;
+
+  unsigned reserved;
+
+  // A bounding box for all vertices.
+  //
+  float bbox_min[3], bbox_max[3];
+
+  // Offsets of arrays of NUM_VERTICES positions (3 floats each),
+  // normals (3 floats each), and UV values (2 floats each).  The
+  // normal and UV offsets are zero if the mesh doesn't have them.
+  //
+  unsigned long long positions_offset, normals_offset, uvs_offset;
+
+  // Offset of an array of NUM_PARTS PartEntry structures.
+  //
+  unsigned long long parts_offset;
+};
+
+// Per-part information.
+//
+struct PartEntry
+{
+  // Offset of an array of NUM_TRIANGLES * 3 vertex indices.
+  //
+  unsigned long long tri_verts_offset;
+
+  unsigned num_triangles;
+
+  unsigned reserved;
+};
+
+const char MAGIC[8] = { 'S', 'N', 'O', 'G', 'M', 'E', 'S', 'H' };
+const unsigned BYTE_ORDER_MARK = 0x01020304;
+const unsigned FORMAT_VERSION = 1;
+
+const unsigned FLAG_LEFT_HANDED = 0x1;
+
+// All arrays are aligned to this many bytes (which is more than
+// strictly needed, but keeps arrays on cache-line boundaries).
+//
+const unsigned ARRAY_ALIGNMENT = 64;
+
+// Return OFFS rounded up to a multiple of ARRAY_ALIGNMENT.
+//
+unsigned long long
+align_offset (unsigned long long offs)
+{
+  unsigned long long mask = ARRAY_ALIGNMENT - 1;
+  return (offs + mask) & ~mask;
+}
+
+// Return a pointer to the array of NUM elements of type T at offset
+// OFFS in FILE, or throw an exception if it isn't entirely inside
+// FILE, or is misaligned.
+//
+template<typename T>
+const T *
+file_array (const MappedFile &file, unsigned long long offs, size_t num,
+	    const std::string &filename)
+{
+  if (offs % sizeof (float) != 0
+      || offs > file.size ()
+      || num > (file.size () - offs) / sizeof (T))
+    throw bad_format (filename + ": invalid array offset in .snogmesh file");
+
+  return reinterpret_cast<const T *> (file.begin () + offs);
+}
+
+// Write the NUM_BYTES bytes at DATA to STREAM at offset OFFS, padding
+// with zeros from the current position if necessary.
+//
+void
+write_at (std::ofstream &stream, unsigned long long offs,
+	  const void *data, size_t num_bytes)
+{
+  unsigned long long pos = stream.tellp ();
+  while (pos < offs)
+    {
+      stream.put (0);
+      pos++;
+    }
+
+  stream.write (static_cast<const char *> (data), num_bytes);
+}
+
+} // namespace
+
+
+// load_snogmesh_file
+
+// Load mesh geometry from a .snogmesh format mesh file into MESH part
+// PART.  All parts in the file are loaded into PART.
+//
+void
+snogray::load_snogmesh_file (const std::string &filename,
+			     Mesh &mesh, Mesh::part_index_t part,
+			     const ValTable &)
+{
+  Ref<MappedFile> file = new MappedFile (filename);
+
+  Header header;
+  if (file->size () < sizeof header)
+    throw bad_format (filename + ": truncated .snogmesh file");
+  memcpy (&header, file->begin (), sizeof header);
+
+  if (memcmp (header.magic, MAGIC, sizeof MAGIC) != 0)
+    throw bad_format (filename + ": not a .snogmesh file");
+  if (header.byte_order_mark != BYTE_ORDER_MARK)
+    throw bad_format (filename + ": .snogmesh file has wrong byte order");
+  if (header.version != FORMAT_VERSION)
+    throw bad_format (filename + ": unsupported .snogmesh file version");
+
+  unsigned num_verts = header.num_vertices;
+
+  const Mesh::MPos *positions
+    = file_array<Mesh::MPos> (*file, header.positions_offset, num_verts,
+			      filename);
+  const Mesh::MVec *normals = 0;
+  if (header.normals_offset)
+    normals = file_array<Mesh::MVec> (*file, header.normals_offset,
+				      num_verts, filename);
+  const UV *uvs = 0;
+  if (header.uvs_offset)
+    uvs = file_array<UV> (*file, header.uvs_offset, num_verts, filename);
+
+  const PartEntry *parts
+    = file_array<PartEntry> (*file, header.parts_offset, header.num_parts,
+			     filename);
+
+  // Find the triangles for each part, and make sure they only refer
+  // to valid vertices (otherwise a corrupt file could cause a crash
+  // during rendering).
+  //
+  std::vector<const Mesh::vert_index_t *> part_tri_verts (header.num_parts);
+  for (unsigned p = 0; p < header.num_parts; p++)
+    {
+      unsigned num_tris = parts[p].num_triangles;
+
+      const Mesh::vert_index_t *tri_verts
+	= file_array<Mesh::vert_index_t> (*file, parts[p].tri_verts_offset,
+					  num_tris * 3ULL, filename);
+
+      Mesh::vert_index_t max_index = 0;
+      for (unsigned i = 0; i < num_tris * 3; i++)
+	if (tri_verts[i] > max_index)
+	  max_index = tri_verts[i];
+      if (num_tris != 0 && max_index >= num_verts)
+	throw bad_format (filename
+			  + ": invalid vertex index in .snogmesh file");
+
+      part_tri_verts[p] = tri_verts;
+    }
+
+  mesh.left_handed = (header.flags & FLAG_LEFT_HANDED);
+
+  BBox bbox (Pos (header.bbox_min[0], header.bbox_min[1], header.bbox_min[2]),
+	     Pos (header.bbox_max[0], header.bbox_max[1], header.bbox_max[2]));
+
+  Mesh::vert_index_t base_vert
+    = mesh.add_vertices (positions, normals, uvs, num_verts, bbox, file);
+
+  // All parts in the file go into PART, so parts whose triangles are
+  // adjacent in the file are added together.  If the mesh had no
+  // vertices before, and the file has only one run of triangles, the
+  // mesh can then use them directly from the file, without copying.
+  //
+  for (unsigned p = 0; p < header.num_parts; )
+    {
+      const Mesh::vert_index_t *run = part_tri_verts[p];
+      unsigned num_tris = parts[p].num_triangles;
+
+      for (p++;
+	   (p < header.num_parts
+	    && part_tri_verts[p] == run + num_tris * 3ULL);
+	   p++)
+	num_tris += parts[p].num_triangles;
+
+      mesh.add_triangles (part, run, num_tris, base_vert, file);
+    }
+}
+
+
+// save_snogmesh_file
+
+// Write the geometry of MESH to the .snogmesh format file FILENAME.
+//
+void
+snogray::save_snogmesh_file (const std::string &filename, const Mesh &mesh)
+{
+  unsigned num_verts = mesh.num_vertices ();
+  unsigned num_parts = mesh.num_parts ();
+
+  std::vector<Mesh::MPos> positions (num_verts);
+  std::vector<Mesh::MVec> normals;
+  std::vector<UV> uvs;
+
+  for (unsigned v = 0; v < num_verts; v++)
+    positions[v] = Mesh::MPos (mesh.vertex (v));
+
+  if (mesh.has_vertex_normals ())
+    {
+      normals.resize (num_verts);
+      for (unsigned v = 0; v < num_verts; v++)
+	normals[v] = Mesh::MVec (mesh.vertex_normal (v));
+    }
+
+  if (mesh.has_vertex_uvs ())
+    {
+      uvs.resize (num_verts);
+      for (unsigned v = 0; v < num_verts; v++)
+	uvs[v] = mesh.vertex_uv (v);
+    }
+
+  std::vector<std::vector<Mesh::vert_index_t> > part_tri_verts (num_parts);
+  for (unsigned p = 0; p < num_parts; p++)
+    mesh.get_triangles (p, part_tri_verts[p]);
+
+  // Lay out the file.
+
+  Header header;
+  memset (&header, 0, sizeof header);
+
+  memcpy (header.magic, MAGIC, sizeof MAGIC);
+  header.byte_order_mark = BYTE_ORDER_MARK;
+  header.version = FORMAT_VERSION;
+  header.flags = mesh.left_handed ? FLAG_LEFT_HANDED : 0;
+  header.num_vertices = num_verts;
+  header.num_parts = num_parts;
+
+  BBox bbox = mesh.bbox ();
+  header.bbox_min[0] = bbox.min.x;
+  header.bbox_min[1] = bbox.min.y;
+  header.bbox_min[2] = bbox.min.z;
+  header.bbox_max[0] = bbox.max.x;
+  header.bbox_max[1] = bbox.max.y;
+  header.bbox_max[2] = bbox.max.z;
+
+  unsigned long long offs = sizeof header;
+
+  header.parts_offset = align_offset (offs);
+  offs = header.parts_offset + num_parts * sizeof (PartEntry);
+
+  header.positions_offset = align_offset (offs);
+  offs = header.positions_offset + num_verts * sizeof (Mesh::MPos);
+
+  if (! normals.empty ())
+    {
+      header.normals_offset = align_offset (offs);
+      offs = header.normals_offset + num_verts * sizeof (Mesh::MVec);
+    }
+
+  if (! uvs.empty ())
+    {
+      header.uvs_offset = align_offset (offs);
+      offs = header.uvs_offset + num_verts * sizeof (UV);
+    }
+
+  std::vector<PartEntry> parts (num_parts);
+  for (unsigned p = 0; p < num_parts; p++)
+    {
+      memset (&parts[p], 0, sizeof parts[p]);
+      parts[p].num_triangles = part_tri_verts[p].size () / 3;
+      parts[p].tri_verts_offset = align_offset (offs);
+      offs = (parts[p].tri_verts_offset
+	      + part_tri_verts[p].size () * sizeof (Mesh::vert_index_t));
+    }
+
+  // Write it.
+
+  std::ofstream stream (filename.c_str (), std::ios::binary);
+  if (! stream)
+    throw file_error (filename + ": " + strerror (errno));
+
+  write_at (stream, 0, &header, sizeof header);
+
+  if (num_parts != 0)
+    write_at (stream, header.parts_offset,
+	      &parts[0], num_parts * sizeof (PartEntry));
+
+  if (num_verts != 0)
+    {
+      write_at (stream, header.positions_offset,
+		&positions[0], num_verts * sizeof (Mesh::MPos));
+      if (! normals.empty ())
+	write_at (stream, header.normals_offset,
+		  &normals[0], num_verts * sizeof (Mesh::MVec));
+      if (! uvs.empty ())
+	write_at (stream, header.uvs_offset,
+		  &uvs[0], num_verts * sizeof (UV));
+    }
+
+  for (unsigned p = 0; p < num_parts; p++)
+    if (! part_tri_verts[p].empty ())
+      write_at (stream, parts[p].tri_verts_offset,
+		&part_tri_verts[p][0],
+		part_tri_verts[p].size () * sizeof (Mesh::vert_index_t));
+
+  stream.close ();
+  if (! stream)
+    throw file_error (filename + ": error writing file");
+}
@@ -0,0 +1,58 @@
+// snogmesh.h -- Load/save snogray's native binary mesh format
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_SNOGMESH_H
+#define SNOGRAY_SNOGMESH_H
+
+
+#include <string>
+
+#include "surface/mesh.h"
+
+
+namespace snogray {
+
+class ValTable;
+
+
+// A ".snogmesh" file holds mesh geometry in exactly the in-memory
+// representation used by Mesh:  a header, followed by arrays of vertex
+// positions, optional vertex normals and UV values, and, for each mesh
+// part, an array of triangle vertex indices.  All arrays are suitably
+// aligned, and stored in the native byte order of the machine that
+// wrote the file (files with the wrong byte order are rejected).
+//
+// As no parsing is needed, a mesh can be loaded by memory-mapping the
+// file, and using the vertex arrays directly.  Mesh geometry in other
+// formats can be converted to this format using the "snogmesh"
+// program.
+
+
+// Load mesh geometry from a .snogmesh format mesh file into MESH part
+// PART.  All parts in the file are loaded into PART.
+//
+// If MESH has no vertices yet, its vertex data refers directly to the
+// memory-mapped file, which is kept mapped until the mesh is destroyed.
+//
+extern void load_snogmesh_file (const std::string &filename,
+				Mesh &mesh, Mesh::part_index_t part,
+				const ValTable &params);
+
+// Write the geometry of MESH to the .snogmesh format file FILENAME.
+//
+extern void save_snogmesh_file (const std::string &filename,
+				const Mesh &mesh);
+
+
+}
+
+#endif // SNOGRAY_SNOGMESH_H
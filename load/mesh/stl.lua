@@ -15,7 +15,6 @@ local stl = {} -- module
 
 local lpeg = require 'lpeg'
 local lpeg_utils = require 'snogray.lpeg-utils'
-local surface = require 'snogray.surface'
 local vector = require 'snogray.vector'
 
 
@@ -31,12 +30,21 @@ local WS_FLOAT = HWS * lpeg_utils.FLOAT
 
 function stl.load (filename, mesh, part)
    local facet_verts = {}
-   local vg = surface.mesh_vertex_group ()
+
+   -- Vertices are collected in bulk, with a separate vertex for every
+   -- facet corner, and identical vertices are merged afterwards using
+   -- Mesh:weld_vertices, which is much faster than looking up each
+   -- vertex as it's added.
+   --
+   local vertex_coords = vector.float ()
+   local num_verts = 0
 
    local triangle_vertex_indices = vector.unsigned ()
 
    local function add_vert (x, y, z)
-      facet_verts[#facet_verts + 1] = mesh:add_vertex (x, y, z, vg)
+      vertex_coords:add (x, y, z)
+      facet_verts[#facet_verts + 1] = num_verts
+      num_verts = num_verts + 1
    end
 
    local function add_facet ()
@@ -86,7 +94,9 @@ function stl.load (filename, mesh, part)
 
    lpeg_utils.parse_file (filename, SOLID)
 
-   mesh:add_triangles (part, triangle_vertex_indices, 0)
+   local base_vert = mesh:add_vertices (vertex_coords)
+   mesh:add_triangles (part, triangle_vertex_indices, base_vert)
+   mesh:weld_vertices (base_vert)
 end
 
 
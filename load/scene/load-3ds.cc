@@ -101,13 +101,13 @@ struct TdsLoader
   void convert (Lib3dsNode *node, const Xform &xform = Xform::identity,
 		const Name *enclosing_names = 0);
 
-  // Add triangles to MESH with the material named MAT_NAME, and the
-  // vertex indices from TRI_VERT_INDS.  If there's an existing mesh
-  // part with the same material, the triangles are added to that
-  // part, otherwise a new part is added.
+  // Add NUM_TRIS triangles to MESH with the material named MAT_NAME,
+  // and the vertex indices from TRI_VERT_INDS, relative to BASE_VERT.
+  // If there's an existing mesh part with the same material, the
+  // triangles are added to that part, otherwise a new part is added.
   //
-  void add_triangles (Mesh *mesh,
-		      const std::vector<Mesh::vert_index_t> &tri_vert_inds,
+  void add_triangles (Mesh *mesh, const Mesh::vert_index_t *tri_vert_inds,
+		      unsigned num_tris, Mesh::vert_index_t base_vert,
 		      const char *mat_name, const Name *hier_names);
 
   void set_camera (Camera &camera, Lib3dsCamera *c, const Xform &xform);
@@ -411,7 +411,8 @@ struct VertInfo
   //
   bool used;
 
-  // The vertex index in our mesh.  Only valid if USED is true.
+  // The index of this vertex in the new vertices added to our mesh.
+  // Only valid if USED is true.
   //
   Mesh::vert_index_t index;
 
@@ -492,43 +493,22 @@ TdsLoader::convert (Lib3dsNode *node, const Xform &xform,
 	  //
 	  std::vector<VertInfo> vert_info (m->points);
 
-	  // We accumulate runs of triangles (in the form of their
-	  // vertices) with the same material name, and add them all
-	  // at once when we see some other name (or we finish).
+	  // Positions of the vertices we add to the mesh, and the
+	  // vertex indices for each face, both relative to the first
+	  // new vertex.  These are accumulated and then added to the
+	  // mesh in bulk, which is much faster than adding each vertex
+	  // individually.
 	  //
-	  // CUR_MAT_NAME is the material name for the run we're
-	  // currently accumulating, and CUR_TRIANGLE_VERTEX_INDICES
-	  // are the triangle vertices.
-	  //
-	  char cur_mat_name[64]; // 64 is from the 3DS file standard
-	  cur_mat_name[0] = '\0';
-
-	  // Triangle vector indices for the current run of triangles.
-	  //
-	  std::vector<Mesh::vert_index_t> cur_triangle_vertex_indices;
+	  std::vector<Mesh::MPos> new_verts;
+	  std::vector<Mesh::vert_index_t> tri_vert_indices (m->faces * 3);
+	  new_verts.reserve (m->points);
 
-	  // Add all faces to the mesh.
+	  // Find the vertices used by each face.
 	  //
 	  for (unsigned t = 0; t < m->faces; t++)
 	    {
 	      Lib3dsFace *f = &m->faceL[t];
 
-	      // Find a material to use.  Faces _without_ materials are
-	      // ignored (not added to the mesh); in general 3ds files
-	      // define all their materials, so this should only occur
-	      // if the user has overridden some of the materials.
-	      //
-	      if (strcmp (f->material, cur_mat_name) != 0)
-		{
-		  if (! cur_triangle_vertex_indices.empty ())
-		    {
-		      add_triangles (mesh, cur_triangle_vertex_indices,
-				     cur_mat_name, &hier_names);
-		      cur_triangle_vertex_indices.clear ();
-		    }
-		  strcpy (cur_mat_name, f->material);
-		}
-
 	      // Indices into vert_info for the vertices in this face.
 	      //
 	      unsigned vind[3] = { f->points[0], f->points[1], f->points[2] };
@@ -584,33 +564,39 @@ TdsLoader::convert (Lib3dsNode *node, const Xform &xform,
 		      }
 
 		  // If this vertex has never been used before, add it
-		  // to the final mesh.
+		  // to the new vertices.
 		  //
 		  if (! vert_info[vi].used)
 		    {
-		      vert_info[vi].index
-			= mesh->add_vertex (
-				  vert_xform (pos (m->pointL[f->points[i]])));
+		      vert_info[vi].index = new_verts.size ();
+		      new_verts.push_back (
+			  Mesh::MPos (vert_xform (pos (m->pointL[f->points[i]]))));
 		      vert_info[vi].used = true;
 		    }
 
-		  // Update VIND
-		  //
-		  vind[i] = vi;
+		  tri_vert_indices[t * 3 + i] = vert_info[vi].index;
 		}
-
-	      // Add the triangle vertices.
-	      //
-	      for (unsigned i = 0; i < 3; i++)
-		cur_triangle_vertex_indices
-		  .push_back (vert_info[vind[0]].index);
 	    }
 
-	  // If there are any triangles we haven't added yet, add them now.
+	  Mesh::vert_index_t base_vert = mesh->add_vertices (new_verts);
+
+	  // Add the faces to the mesh, in runs of faces with the same
+	  // material name.  Faces _without_ materials are ignored (not
+	  // added to the mesh); in general 3ds files define all their
+	  // materials, so this should only occur if the user has
+	  // overridden some of the materials.
 	  //
-	  if (! cur_triangle_vertex_indices.empty ())
-	    add_triangles (mesh, cur_triangle_vertex_indices,
-			   cur_mat_name, &hier_names);
+	  unsigned run_start = 0;
+	  for (unsigned t = 1; t <= m->faces; t++)
+	    if (t == m->faces
+		|| strcmp (m->faceL[t].material,
+			   m->faceL[run_start].material) != 0)
+	      {
+		add_triangles (mesh, &tri_vert_indices[run_start * 3],
+			       t - run_start, base_vert,
+			       m->faceL[run_start].material, &hier_names);
+		run_start = t;
+	      }
 
 	  // Compute vertex normals.  This turns on smoothing for the
 	  // whole mesh, but we made sure that only faces which should
@@ -624,14 +610,14 @@ TdsLoader::convert (Lib3dsNode *node, const Xform &xform,
     }
 }
 
-// Add triangles to MESH with the material named MAT_NAME, and the
-// vertex indices from TRI_VERT_INDS.  If there's an existing mesh
-// part with the same material, the triangles are added to that
-// part, otherwise a new part is added.
+// Add NUM_TRIS triangles to MESH with the material named MAT_NAME,
+// and the vertex indices from TRI_VERT_INDS, relative to BASE_VERT.
+// If there's an existing mesh part with the same material, the
+// triangles are added to that part, otherwise a new part is added.
 //
 void
-TdsLoader::add_triangles (Mesh *mesh, 
-			  const std::vector<Mesh::vert_index_t> &tri_vert_inds,
+TdsLoader::add_triangles (Mesh *mesh, const Mesh::vert_index_t *tri_vert_inds,
+			  unsigned num_tris, Mesh::vert_index_t base_vert,
 			  const char *mat_name, const Name *hier_names)
 {
   // Get the actual material to use.
@@ -659,7 +645,7 @@ TdsLoader::add_triangles (Mesh *mesh,
 
   // Finally, actually add the triangles to the chosen part.
   //
-  mesh->add_triangles (part, tri_vert_inds);
+  mesh->add_triangles (part, tri_vert_inds, num_tris, base_vert);
 }
 
 
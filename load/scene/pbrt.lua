@@ -45,6 +45,7 @@ local surface = require 'snogray.surface'
 local light = require 'snogray.light'
 local image = require 'snogray.image'
 local transform = require 'snogray.transform'
+local vector = require 'snogray.vector'
 
 local pos, vec = coord.pos, coord.vec
 
@@ -66,6 +67,7 @@ local default_width, default_height = 640, 480
 -- we use this in various places
 --
 local smatch = string.match
+local ssub = string.sub
 
 local function push (stack, thing)
    stack[#stack + 1] = thing
@@ -260,9 +262,63 @@ local function accum_param (table, param, val)
    return table
 end
 
+-- Large numeric arrays, such as the "point P" and "integer indices"
+-- parameters of a big triangle mesh, are parsed in bulk by native
+-- code into C++ vectors (see snogray.vector), which are much faster
+-- to create than Lua tables, and can be passed directly to bulk mesh
+-- methods like Mesh:add_vertices.  Such parameter values support
+-- indexing and the # operator, like tables, but not ipairs etc.
+--
+-- Arrays with fewer than BULK_ARRAY_MIN_SIZE elements, or which the
+-- native parser can't handle completely (e.g., because of a syntax
+-- error), are parsed normally into Lua tables.
+--
+local BULK_ARRAY_MIN_SIZE = 256
+
+-- Functions to make an empty vector for each parameter type which can
+-- be parsed in bulk.
+--
+local bulk_array_vector_ctors = {
+   float = vector.float,
+   point = vector.float,
+   vector = vector.float,
+   normal = vector.float,
+   integer = vector.unsigned
+}
+
+-- Parameter types whose values must have a multiple of 3 elements.
+--
+local bulk_array_stride_3 = { point = true, vector = true, normal = true }
+
+-- lpeg match-time function for bulk parameter parsing.  TEXT is the
+-- text being parsed, POS is the position following the opening "["
+-- of the array, and NAME is the parameter name.
+--
+local function parse_bulk_array_param (text, pos, name)
+   local ptype = smatch (name, "%a*")
+   local vec_ctor = bulk_array_vector_ctors[ptype]
+   if not vec_ctor then
+      return false
+   end
+
+   local val = vec_ctor ()
+   local end_pos = val:parse (text, pos)
+
+   if #val < BULK_ARRAY_MIN_SIZE or ssub (text, end_pos, end_pos) ~= "]" then
+      return false
+   end
+
+   if bulk_array_stride_3[ptype] and #val % 3 ~= 0 then
+      parse_err ("parameter \""..name.."\" must have a multiple of 3 values")
+   end
+
+   return end_pos + 1, name, val
+end
+
 -- param grammar
 --
-local PARAM = (STRING * ARRAY) / validate_param
+local BULK_PARAM = lpeg.Cmt (STRING * WS * P"[", parse_bulk_array_param)
+local PARAM = BULK_PARAM + (STRING * ARRAY) / validate_param
 local PARAM_LIST = lpeg.Cf (lpeg.Cc{} * PARAM^0, accum_param)
 
 
@@ -773,13 +829,14 @@ end
 --
 function textures.imagemap (state, params, type)
    -- unsupported params: "string wrap" (non-default)
-   -- ignored params: "float maxanisotropy", "bool trilinear", "float gamma"
+   -- ignored params: "float gamma"
    local img_file = get_single_param (state, params, "string filename")
    local wrap = get_single_param (state, params, "string wrap", false)
    local scale = get_texture_param (state, params, "float/color scale", false)
+   local max_aniso
+      = get_single_param (state, params, "float maxanisotropy", false)
+   local trilinear = get_single_param (state, params, "bool trilinear", false)
 
-   params["float maxanisotropy"] = nil -- ignore
-   params["bool trilinear"] = nil      -- ignore
    params["float gamma"] = nil      -- ignore
    if wrap and wrap ~= "repeat" then
       parse_warn ("non-repeating texture-wrap mode \""..wrap.."\" ignored")
@@ -808,7 +865,11 @@ function textures.imagemap (state, params, type)
 
    -- Parameters we use for loading the texture image.
    --
-   local tex_image_params = { ["reverse_rows"] = reverse_rows }
+   local tex_image_params = {
+      ["reverse_rows"] = reverse_rows,
+      ["filter"] = (trilinear and "trilinear") or "ewa",
+      ["max_anisotropy"] = max_aniso or nil
+   }
 
    -- Load the image texture.
    --
@@ -1309,6 +1370,12 @@ function surface_integrators.path (state, params)
    state:set_param ("render.surface_integ.max_path_len", maxdepth)
 end
 
+function surface_integrators.bdpt (state, params)
+   local maxdepth = get_single_param (state, params, "integer maxdepth", 5)
+   state:set_param ("render.surface_integ.type", "bdpt")
+   state:set_param ("render.surface_integ.max_path_len", maxdepth)
+end
+
 function surface_integrators.photonmap (state, params)
    -- note that some of these params are only in PBRT v1 or v2 (noted below)
    -- ignored parameters: "float gatherangle"
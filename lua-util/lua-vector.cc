@@ -12,6 +12,8 @@
 
 #include "config.h"
 
+#include <cstdlib>
+
 #include "lua-compat.h"
 
 #include "lua-vector.h"
@@ -20,6 +22,80 @@
 using namespace snogray;
 
 
+// Return the first character at or after STR (and before END) which
+// is not whitespace or part of a "#" comment.
+//
+const char *
+snogray::lua_vec_skip_ws (const char *str, const char *end)
+{
+  while (str < end)
+    {
+      char ch = *str;
+      if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f')
+	str++;
+      else if (ch == '#')
+	while (str < end && *str != '\n')
+	  str++;
+      else
+	break;
+    }
+  return str;
+}
+
+// If the characters at STR (up to END) are a decimal number, store
+// its value in NUM and return a pointer to the character following
+// it; otherwise return zero.
+//
+// The accepted syntax is the same as lpeg-utils.FLOAT: an optional
+// sign, digits with an optional decimal point, and an optional
+// exponent.  Anything else, including things like hexadecimal
+// numbers or "inf" which strtod would accept, is rejected.
+//
+const char *
+snogray::lua_vec_read_number (const char *str, const char *end, double &num)
+{
+  const char *p = str;
+
+  if (p < end && (*p == '+' || *p == '-'))
+    p++;
+
+  unsigned num_digits = 0;
+  while (p < end && *p >= '0' && *p <= '9')
+    p++, num_digits++;
+  if (p < end && *p == '.')
+    {
+      p++;
+      while (p < end && *p >= '0' && *p <= '9')
+	p++, num_digits++;
+    }
+  if (num_digits == 0)
+    return 0;
+
+  if (p < end && *p == 'e')
+    {
+      const char *exp = p + 1;
+      if (exp < end && (*exp == '+' || *exp == '-'))
+	exp++;
+      if (exp < end && *exp >= '0' && *exp <= '9')
+	{
+	  p = exp;
+	  while (p < end && *p >= '0' && *p <= '9')
+	    p++;
+	}
+    }
+
+  // STR is always the contents of a Lua string, which is
+  // null-terminated, so strtod can't run past END.
+  //
+  char *num_end;
+  num = strtod (str, &num_end);
+  if (num_end != p)
+    return 0;
+
+  return p;
+}
+
+
 static luaL_Reg module_funs[] = {
   { "int", LuaVec<int>::make },
   { "float", LuaVec<float>::make },
@@ -83,6 +83,7 @@ private:
   static int clear (lua_State *L);
   static int resize (lua_State *L);
   static int reserve (lua_State *L);
+  static int parse (lua_State *L);
 
   static int fini (lua_State *L);
 
@@ -94,6 +95,20 @@ private:
 };
 
 
+// Helper functions for LuaVec<T>::parse.
+//
+// lua_vec_skip_ws returns the first character at or after STR (and
+// before END) which is not whitespace or part of a "#" comment.
+//
+// If the characters at STR (up to END) are a decimal number,
+// lua_vec_read_number stores its value in NUM and returns a pointer
+// to the character following it; otherwise it returns zero.
+//
+extern const char *lua_vec_skip_ws (const char *str, const char *end);
+extern const char *lua_vec_read_number (const char *str, const char *end,
+					double &num);
+
+
 // Create and return the "snogray.vector" module.
 //
 extern int luaopen_snogray_vector (lua_State *L);
@@ -13,6 +13,8 @@
 #ifndef SNOGRAY_LUA_VECTOR_TCC
 #define SNOGRAY_LUA_VECTOR_TCC
 
+#include <climits>
+
 extern "C"
 {
 #include "lua.h"
@@ -48,6 +50,13 @@ struct LuaVecType<int>
   {
     vec.push_back (luaL_checkinteger (L, pos));
   }
+  static bool from_number (double num, int &val)
+  {
+    if (num < INT_MIN || num > INT_MAX)
+      return false;
+    val = int (num);
+    return val == num;
+  }
   static const char *name ()
   {
     return "vector<int>";
@@ -80,6 +89,13 @@ struct LuaVecType<unsigned>
        luaL_argerror (L, pos, "value out of range");
     vec.push_back (val);
   }
+  static bool from_number (double num, unsigned &val)
+  {
+    if (num < 0 || num > UINT_MAX)
+      return false;
+    val = unsigned (num);
+    return val == num;
+  }
   static const char *name ()
   {
     return "vector<unsigned>";
@@ -106,6 +122,11 @@ struct LuaVecType<float>
   {
     vec.push_back (luaL_checknumber (L, pos));
   }
+  static bool from_number (double num, float &val)
+  {
+    val = num;
+    return true;
+  }
   static const char *name ()
   {
     return "vector<float>";
@@ -176,6 +197,7 @@ LuaVec<T>::register_metatable (lua_State *L)
       register_metatable_entry (L, "clear", clear);
       register_metatable_entry (L, "resize", resize);
       register_metatable_entry (L, "reserve", reserve);
+      register_metatable_entry (L, "parse", parse);
       register_metatable_entry (L, "__gc", fini);
       register_metatable_entry (L, "__tostring", tostring);
 
@@ -397,6 +419,53 @@ LuaVec<T>::reserve (lua_State *L)
   return 0;
 }
 
+// parse (VEC, STRING, POS = 1) => END_POS
+//
+// Append numbers from STRING, starting at position POS, to VEC.
+// Numbers may be separated by whitespace and "#" comments (extending
+// to the end of the line).  Parsing stops at the first thing that
+// isn't a number, or at a number which can't be stored in VEC (for
+// instance, a negative number for a vector<unsigned>), and the
+// position of its first character is returned.
+//
+// This is much faster than parsing the numbers in Lua and adding
+// them individually, and is intended for loading large numeric
+// arrays from scene and mesh files.
+//
+template<typename T>
+int
+LuaVec<T>::parse (lua_State *L)
+{
+  std::vector<T> *vec = _checkvec (L, 1);
+  size_t len;
+  const char *str = luaL_checklstring (L, 2, &len);
+  lua_Integer pos = luaL_optinteger (L, 3, 1);
+  if (pos < 1 || pos > lua_Integer (len) + 1)
+    luaL_argerror (L, 3, "position out of range");
+
+  const char *p = str + pos - 1, *end = str + len;
+
+  for (;;)
+    {
+      p = lua_vec_skip_ws (p, end);
+
+      double num;
+      const char *num_end = lua_vec_read_number (p, end, num);
+      if (! num_end)
+	break;
+
+      T val;
+      if (! VT::from_number (num, val))
+	break;
+
+      vec->push_back (val);
+      p = num_end;
+    }
+
+  lua_pushinteger (L, static_cast<lua_Integer> (p - str + 1));
+  return 1;
+}
+
 // fini (VEC)
 //
 // Call the C++ vector destructor on VEC's vector, freeing any
@@ -28,6 +28,49 @@ sys.rusage = raw.Rusage
 sys.num_cores = raw.num_cores
 
 
+----------------------------------------------------------------
+-- Phase profiling
+--
+
+-- Enable recording of the time and memory used by named phases of
+-- execution.  Some phases (such as building acceleration structures)
+-- are recorded internally, and others may be added using
+-- sys.begin_phase and sys.end_phase.
+--
+function sys.enable_phase_profile ()
+   raw.enable_phase_profile (true)
+end
+
+-- Begin and end a phase called NAME.  Phases may be nested, but must
+-- be ended in the reverse order they were begun.  If phase profiling
+-- isn't enabled, these do nothing.
+--
+sys.begin_phase = raw.begin_profile_phase
+sys.end_phase = raw.end_profile_phase
+
+-- Return a table of information about recorded phases, in the order
+-- they were first begun.  Each entry is a table with fields "name",
+-- "count" (number of times the phase occurred), "wall_time",
+-- "user_cpu_time", and "sys_cpu_time" (total times spent in the
+-- phase, in seconds), and "max_rss" (the peak memory use, in
+-- kilobytes, at the end of the phase).
+--
+function sys.phase_profile ()
+   local phases = {}
+   for i = 0, raw.num_profile_phases () - 1 do
+      phases[#phases + 1] = {
+	 name = raw.profile_phase_name (i),
+	 count = raw.profile_phase_count (i),
+	 wall_time = raw.profile_phase_wall_time (i),
+	 user_cpu_time = raw.profile_phase_user_cpu_time (i),
+	 sys_cpu_time = raw.profile_phase_sys_cpu_time (i),
+	 max_rss = raw.profile_phase_max_rss (i)
+      }
+   end
+   return phases
+end
+
+
 -- return the module
 --
 return sys
@@ -0,0 +1,96 @@
+// albedo-table.cc -- Table of precomputed directional albedos
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "util/snogmath.h"
+
+#include "albedo-table.h"
+
+
+using namespace snogray;
+
+
+AlbedoTable::AlbedoTable (unsigned _num_cos, unsigned _num_params,
+			  float _max_param)
+  : num_cos (_num_cos), num_params (_num_params), max_param (_max_param),
+    albedos (_num_cos * _num_params, 0), average_albedos (_num_params, 0)
+{
+}
+
+// Calculate the average albedos from the current table entries.
+// This should be called after all entries have been set.
+//
+void
+AlbedoTable::calc_average_albedos ()
+{
+  // The average albedo is 2 * integral (0, 1, E(mu) * mu dmu), where
+  // E is the directional albedo; as the table entries are at the
+  // midpoints of equal intervals, we just use the midpoint rule.
+  //
+  for (unsigned p = 0; p < num_params; p++)
+    {
+      float sum = 0;
+      for (unsigned c = 0; c < num_cos; c++)
+	sum += albedos[p * num_cos + c] * cos_at (c);
+      average_albedos[p] = clamp01 (2 * sum / num_cos);
+    }
+}
+
+// Return the table position corresponding to the value VAL, where
+// table entries are spaced every SPACING, and there are NUM entries.
+// The index of the lower entry is returned in INDEX, and the
+// fractional distance to the next entry as the return value.
+//
+float
+AlbedoTable::table_pos (float val, float spacing, unsigned num,
+			unsigned &index)
+{
+  // Entries are at the center of their interval, so values within
+  // half an interval of either end just use the end entry.
+  //
+  float pos = clamp (val / spacing - 0.5f, 0.f, float (num - 1));
+
+  index = min (unsigned (pos), num - 2);
+
+  return pos - index;
+}
+
+// Return the directional albedo for a direction whose angle to the
+// normal has cosine COS_THETA, with parameter value PARAM.
+//
+float
+AlbedoTable::albedo (float cos_theta, float param) const
+{
+  unsigned ci, pi;
+  float cf = table_pos (cos_theta, 1.f / num_cos, num_cos, ci);
+  float pf = table_pos (param, max_param / num_params, num_params, pi);
+
+  const float *row0 = &albedos[pi * num_cos + ci];
+  const float *row1 = row0 + num_cos;
+
+  float a0 = row0[0] + (row0[1] - row0[0]) * cf;
+  float a1 = row1[0] + (row1[1] - row1[0]) * cf;
+
+  return a0 + (a1 - a0) * pf;
+}
+
+// Return the cosine-weighted average of the directional albedo over
+// the hemisphere, with parameter value PARAM.
+//
+float
+AlbedoTable::average_albedo (float param) const
+{
+  unsigned pi;
+  float pf = table_pos (param, max_param / num_params, num_params, pi);
+
+  return
+    average_albedos[pi] + (average_albedos[pi + 1] - average_albedos[pi]) * pf;
+}
@@ -0,0 +1,113 @@
+// albedo-table.h -- Table of precomputed directional albedos
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_ALBEDO_TABLE_H
+#define SNOGRAY_ALBEDO_TABLE_H
+
+#include <vector>
+
+
+namespace snogray {
+
+
+// A table of the directional albedo of a BSDF (the fraction of light
+// arriving from a given direction which is reflected, in total), as a
+// function of the cosine of the angle between the incoming direction
+// and the normal, and a single BSDF parameter (for instance, the
+// roughness of a microfacet distribution).
+//
+// The table entries are calculated by the user (usually using
+// numerical integration) when the table is created, and lookups
+// interpolate between entries.  The cosine-weighted average albedo
+// over all directions is also kept for each parameter value.
+//
+// These are used for "energy compensation" of microfacet BSDFs, which
+// only model a single scattering event, and so lose energy, to an
+// increasing degree as roughness increases.
+//
+class AlbedoTable
+{
+public:
+
+  // Make a table with NUM_COS cosine entries and NUM_PARAMS parameter
+  // entries, where the parameter ranges from 0 to MAX_PARAM.  All
+  // albedos are initially zero.
+  //
+  AlbedoTable (unsigned num_cos, unsigned num_params, float max_param);
+
+  // Return the cosine and parameter value corresponding to table
+  // entries at index COS_INDEX and PARAM_INDEX respectively.  Table
+  // entries are at the center of the range they cover.
+  //
+  float cos_at (unsigned cos_index) const
+  {
+    return (cos_index + 0.5f) / num_cos;
+  }
+  float param_at (unsigned param_index) const
+  {
+    return (param_index + 0.5f) * max_param / num_params;
+  }
+
+  // Set the albedo at COS_INDEX and PARAM_INDEX to ALBEDO.
+  //
+  void set_albedo (unsigned cos_index, unsigned param_index, float albedo)
+  {
+    albedos[param_index * num_cos + cos_index] = albedo;
+  }
+
+  // Calculate the average albedos from the current table entries.
+  // This should be called after all entries have been set.
+  //
+  void calc_average_albedos ();
+
+  // Return the directional albedo for a direction whose angle to the
+  // normal has cosine COS_THETA, with parameter value PARAM.
+  //
+  float albedo (float cos_theta, float param) const;
+
+  // Return the cosine-weighted average of the directional albedo over
+  // the hemisphere, with parameter value PARAM.
+  //
+  float average_albedo (float param) const;
+
+  // Table size.
+  //
+  unsigned num_cos, num_params;
+
+  // Maximum parameter value; larger parameter values use the last
+  // table entry.
+  //
+  float max_param;
+
+private:
+
+  // Return the table position corresponding to the value VAL, where
+  // table entries are spaced every SPACING, and there are NUM
+  // entries.  The index of the lower entry is returned in INDEX, and
+  // the fractional distance to the next entry as the return value.
+  //
+  static float table_pos (float val, float spacing, unsigned num,
+			  unsigned &index);
+
+  // Albedo entries, with NUM_PARAMS rows, each with NUM_COS entries.
+  //
+  std::vector<float> albedos;
+
+  // The average albedo for each parameter entry.
+  //
+  std::vector<float> average_albedos;
+};
+
+
+}
+
+#endif // SNOGRAY_ALBEDO_TABLE_H
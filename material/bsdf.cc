@@ -0,0 +1,130 @@
+// bsdf.cc -- Bsdf lobe dispatch
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "lambert.h"
+#include "cook-torrance.h"
+#include "phong.h"
+#include "glass.h"
+#include "thin-glass.h"
+#include "mirror.h"
+#include "stencil.h"
+
+#include "bsdf.h"
+
+
+using namespace snogray;
+
+
+// Make a copy of BSDF, but belonging to the intersection ISEC.
+//
+Bsdf::Bsdf (const Bsdf &bsdf, const Intersect &isec)
+  : _isec (&isec), _num_lobes (bsdf._num_lobes)
+{
+  for (unsigned i = 0; i < _num_lobes; i++)
+    lobes[i] = bsdf.lobes[i];
+}
+
+
+
+// Lobe dispatch
+
+// Return a sample of the lobes of this BSDF starting from FIRST_LOBE,
+// based on the parameter PARAM.  FLAGS is the types of samples we'd
+// like.
+//
+Bsdf::Sample
+Bsdf::sample_lobes (unsigned first_lobe, const UV &param, unsigned flags)
+  const
+{
+  if (first_lobe >= _num_lobes)
+    return Sample ();
+
+  switch (lobes[first_lobe].kind)
+    {
+    case Lobe::LAMBERT:
+      return Lambert::sample_lobe (*this, first_lobe, param, flags);
+    case Lobe::COOK_TORRANCE:
+      return CookTorrance::sample_lobe (*this, first_lobe, param, flags);
+    case Lobe::PHONG:
+      return Phong::sample_lobe (*this, first_lobe, param, flags);
+    case Lobe::GLASS:
+      return Glass::sample_lobe (*this, first_lobe, param, flags);
+    case Lobe::THIN_GLASS:
+      return ThinGlass::sample_lobe (*this, first_lobe, param, flags);
+    case Lobe::MIRROR:
+      return Mirror::sample_lobe (*this, first_lobe, param, flags);
+    case Lobe::STENCIL:
+      return Stencil::sample_lobe (*this, first_lobe, param, flags);
+    }
+
+  return Sample ();
+}
+
+// Evaluate the lobes of this BSDF starting from FIRST_LOBE in
+// direction DIR, and return their value and pdf.  Only the types of
+// surface interaction in FLAGS are considered.
+//
+Bsdf::Value
+Bsdf::eval_lobes (unsigned first_lobe, const Vec &dir, unsigned flags) const
+{
+  if (first_lobe >= _num_lobes)
+    return Value ();
+
+  switch (lobes[first_lobe].kind)
+    {
+    case Lobe::LAMBERT:
+      return Lambert::eval_lobe (*this, first_lobe, dir, flags);
+    case Lobe::COOK_TORRANCE:
+      return CookTorrance::eval_lobe (*this, first_lobe, dir, flags);
+    case Lobe::PHONG:
+      return Phong::eval_lobe (*this, first_lobe, dir, flags);
+    case Lobe::STENCIL:
+      return Stencil::eval_lobe (*this, first_lobe, dir, flags);
+    case Lobe::GLASS:
+    case Lobe::THIN_GLASS:
+    case Lobe::MIRROR:
+      break;			// specular, so all evaluations fail
+    }
+
+  return Value ();
+}
+
+// Return a bitmask of flags from Bsdf::Flags, describing what types
+// of scatting the lobes of this BSDF starting from FIRST_LOBE
+// support.  The returned value will include only flags in LIMIT.
+//
+unsigned
+Bsdf::lobes_support (unsigned first_lobe, unsigned limit) const
+{
+  if (first_lobe >= _num_lobes)
+    return 0;
+
+  switch (lobes[first_lobe].kind)
+    {
+    case Lobe::LAMBERT:
+      return Lambert::lobe_supports (*this, first_lobe, limit);
+    case Lobe::COOK_TORRANCE:
+      return CookTorrance::lobe_supports (*this, first_lobe, limit);
+    case Lobe::PHONG:
+      return Phong::lobe_supports (*this, first_lobe, limit);
+    case Lobe::GLASS:
+      return Glass::lobe_supports (*this, first_lobe, limit);
+    case Lobe::THIN_GLASS:
+      return ThinGlass::lobe_supports (*this, first_lobe, limit);
+    case Lobe::MIRROR:
+      return Mirror::lobe_supports (*this, first_lobe, limit);
+    case Lobe::STENCIL:
+      return Stencil::lobe_supports (*this, first_lobe, limit);
+    }
+
+  return 0;
+}
@@ -28,20 +28,18 @@ class Intersect;
 // particular direction), and is used to calculate how light scatters
 // from the surface.
 //
-// Because Bsdf objects are allocated extremely often, they are
-// allocated using a special memory-arena, and only freed in bulk
-// later on.  Morever, their destructor is never called.
+// Because Bsdf objects are created extremely often, they are simple
+// value objects stored directly in the Intersect object they belong
+// to, and never allocate memory.  Rather than using a class hierarchy
+// with virtual methods, a Bsdf holds a short list of "lobes" (see
+// Bsdf::Lobe), each of which is a tagged union describing one sort of
+// scattering, and dispatches on the lobe kind using a switch.
 //
-// So subclasses of Bsdf should:
-//
-//  (1) Only allocate memory using the Intersect object pointed to by
-//      Bsdf::isec as an arena, i.e., using "new (isec) ...".  Note
-//      that this means STL classes should not be used without a
-//      custom allocator.
-//
-//  (2) Not depend on their destructor being called, as it usually
-//      won't be.  In practice this means they should never declare a
-//      destructor.
+// Most materials add a single lobe.  Materials which modify an
+// underlying material, such as Mirror and Stencil, add a "wrapper"
+// lobe followed by the underlying material's lobes; a wrapper lobe at
+// index I treats the lobes from index I + 1 onwards as its
+// underlying BSDF.
 //
 class Bsdf
 {
@@ -152,20 +150,132 @@ public:
     float pdf;
   };
 
-  Bsdf (const Intersect &_isec) : isec (_isec) { }
-  virtual ~Bsdf () {}
+  // Kind-specific parameters for each kind of lobe.  These must be
+  // plain-old-data types, as they are stored in a union.
+  //
+  struct CookTorranceParams
+  {
+    // RMS microfacet slope.
+    //
+    float m;
+
+    // Probability of sampling the diffuse layer, and 1 / DIFF_WEIGHT
+    // and 1 / (1 - DIFF_WEIGHT).
+    //
+    float diff_weight, inv_diff_weight, inv_gloss_weight;
+
+    // N dot V, and 1 / (4 * (N dot V)).
+    //
+    float nv, inv_4_nv;
+
+    // Index of refraction relative to the surrounding medium, used
+    // for the Fresnel term.
+    //
+    float ior_n, ior_k;
+
+    // Scale factor for the multiple-scattering energy-compensation
+    // term, which is multiplied by (1 - E (N dot L)), where E is the
+    // directional albedo of the glossy layer.
+    //
+    float ms_scale;
+
+    // Bsdf layer flag used for glossy samples, and all layers present.
+    //
+    unsigned gloss_layer, have_layers;
+  };
+  struct PhongParams
+  {
+    float exponent;
+
+    // Probability of sampling the diffuse layer, and 1 / DIFF_WEIGHT
+    // and 1 / (1 - DIFF_WEIGHT).
+    //
+    float diff_weight, inv_diff_weight, inv_spec_weight;
+  };
+  struct GlassParams
+  {
+    // Indices of refraction of the media being left and entered.
+    //
+    float old_ior, new_ior;
+  };
+  struct ThinGlassParams
+  {
+    float ior;
+  };
+  struct MirrorParams
+  {
+    // Index of refraction relative to the surrounding medium, used
+    // for the Fresnel term.
+    //
+    float ior_n, ior_k;
+  };
+  struct StencilParams
+  {
+    // Intensity of the opacity, and its inverse (both are snapped to
+    // 0 or 1 when nearly transparent or opaque).
+    //
+    float opacity_intens, inv_opacity_intens;
+  };
+
+  // A single BSDF lobe.
+  //
+  struct Lobe
+  {
+    enum Kind
+    {
+      LAMBERT,			// COLOR is the diffuse color
+      COOK_TORRANCE,		// COLOR is diffuse, COLOR2 glossy color
+      PHONG,			// COLOR is diffuse, COLOR2 specular color
+      GLASS,
+      THIN_GLASS,		// COLOR is the transmitted color
+      MIRROR,			// wrapper; COLOR is the reflectance
+      STENCIL			// wrapper; COLOR is the opacity
+    };
+
+    Kind kind;
+
+    // Colors used by the lobe; their meaning depends on KIND.
+    //
+    Color color, color2;
+
+    union
+    {
+      CookTorranceParams cook_torrance;
+      PhongParams phong;
+      GlassParams glass;
+      ThinGlassParams thin_glass;
+      MirrorParams mirror;
+      StencilParams stencil;
+    };
+  };
+
+  // Maximum number of lobes in a BSDF.
+  //
+  static const unsigned MAX_LOBES = 4;
+
+  Bsdf (const Intersect &isec) : _isec (&isec), _num_lobes (0) { }
+
+  // Make a copy of BSDF, but belonging to the intersection ISEC.
+  //
+  Bsdf (const Bsdf &bsdf, const Intersect &isec);
 
   // Return a sample of this BSDF, based on the parameter PARAM.
   // FLAGS is the types of samples we'd like.
   //
-  virtual Sample sample (const UV &param, unsigned flags = ALL) const = 0;
+  Sample sample (const UV &param, unsigned flags = ALL) const
+  {
+    return sample_lobes (0, param, flags);
+  }
 
   // Evaluate this BSDF in direction DIR (in the surface-normal
   // coordinate system of the intersection where this BSDF was created),
   // and return its value and pdf.  If FLAGS is specified, then only the
   // given types of surface interaction are considered.
   //
-  virtual Value eval (const Vec &dir, unsigned flags = ALL) const = 0;
+  Value eval (const Vec &dir, unsigned flags = ALL) const
+  {
+    return eval_lobes (0, dir, flags);
+  }
 
   // Return a bitmask of flags from Bsdf::Flags, describing what
   // types of scatting this BSDF supports.  The returned value will
@@ -177,11 +287,48 @@ public:
   // supported by one of the sample-directions
   // (e.g. Bsdf::REFLECTIVE) in return value, and vice-versa.
   //
-  virtual unsigned supports (unsigned limit = ALL) const = 0;
+  unsigned supports (unsigned limit = ALL) const
+  {
+    return lobes_support (0, limit);
+  }
+
+  // Variants of Bsdf::sample, Bsdf::eval, and Bsdf::supports which
+  // only use the lobes starting from FIRST_LOBE.  These are used by
+  // wrapper lobes to access their underlying BSDF.  If there are no
+  // such lobes, the BSDF is treated as black.
+  //
+  Sample sample_lobes (unsigned first_lobe, const UV &param, unsigned flags)
+    const;
+  Value eval_lobes (unsigned first_lobe, const Vec &dir, unsigned flags)
+    const;
+  unsigned lobes_support (unsigned first_lobe, unsigned limit) const;
+
+  // Add a new lobe of kind KIND, and return it so the caller can fill
+  // in its parameters.  If there are already MAX_LOBES lobes, zero is
+  // returned instead.
+  //
+  Lobe *add_lobe (Lobe::Kind kind)
+  {
+    if (_num_lobes == MAX_LOBES)
+      return 0;
+    Lobe *lobe = &lobes[_num_lobes++];
+    lobe->kind = kind;
+    return lobe;
+  }
+
+  unsigned num_lobes () const { return _num_lobes; }
+  const Lobe &lobe (unsigned index) const { return lobes[index]; }
 
   // The intersection where this Bsdf was created.
   //
-  const Intersect &isec;
+  const Intersect &isec () const { return *_isec; }
+
+private:
+
+  const Intersect *_isec;
+
+  unsigned _num_lobes;
+  Lobe lobes[MAX_LOBES];
 };
 
 
@@ -11,6 +11,7 @@
 //
 
 #include "util/snogmath.h"
+#include "util/radical-inverse.h"
 #include "geometry/vec.h"
 #include "render/intersect.h"
 #include "media.h"
@@ -27,55 +28,43 @@ using namespace snogray;
 
 namespace { // keep local to file
 
-// The details of cook-torrance evaluation are in this class.
+// Values of M (RMS slope) less than this are considered "glossy".
 //
-class CookTorranceBsdf : public Bsdf
+// This should be a simple named constant, but C++ (stupidly)
+// disallows non-integral named constants.  Someday when "constexpr"
+// support is widespread, that can be used instead.
+//
+inline float glossy_m () { return 0.5; }
+
+// The details of cook-torrance evaluation are in this class, which is
+// a temporary view of a Cook-Torrance lobe in a Bsdf.
+//
+class CookTorranceLobe
 {
 public:
 
-  // Values of M (RMS slope) less than this are considered "glossy".
-  //
-  // This should be a simple named constant, but C++ (stupidly)
-  // disallows non-integral named constants.  Someday when "constexpr"
-  // support is widespread, that can be used instead.
-  //
-  static float glossy_m () { return 0.5; }
-
-  CookTorranceBsdf (const CookTorrance &ct,
-		    const Intersect &_isec, const TexCoords &tex_coords)
-    : Bsdf (_isec),
-      m (ct.m.eval (tex_coords)), gloss_dist (m), diff_dist (),
-      diff_col (ct.color.eval (tex_coords)),
-      gloss_col (ct.gloss_color.eval (tex_coords)),
-      diff_intens (diff_col.intensity ()),
-      gloss_intens (gloss_col.intensity ()),
-      diff_weight ((diff_intens + gloss_intens) == 0
-		   ? 0
-		   : diff_intens / (diff_intens + gloss_intens)),
-      inv_diff_weight (diff_weight == 0 ? 0 : 1 / diff_weight),
-      inv_gloss_weight (diff_weight == 1 ? 0 : 1 / (1 - diff_weight)),
-      fres (isec.media.medium.ior, ct.ior),
-      nv (isec.cos_n (isec.v)),
-      inv_4_nv ((nv != 0) ? 1 / (4 * nv) : 0),
-      gloss_layer (m < glossy_m() ? GLOSSY : DIFFUSE),
-      have_layers ((diff_weight > 0 ? DIFFUSE : 0)
-		   | (diff_weight < 1 ? gloss_layer : 0))
+  CookTorranceLobe (const Bsdf &bsdf, unsigned lobe)
+    : isec (bsdf.isec ()),
+      diff_col (bsdf.lobe (lobe).color), gloss_col (bsdf.lobe (lobe).color2),
+      params (bsdf.lobe (lobe).cook_torrance),
+      gloss_dist (params.m), diff_dist (),
+      albedos (CookTorrance::albedo_table ())
   { }
 
-  // Return a sample of this BSDF, based on the parameter PARAM.
+  // Return a sample of this lobe, based on the parameter PARAM.
   //
-  virtual Sample sample (const UV &param, unsigned desired = ALL) const
+  Bsdf::Sample sample (const UV &param, unsigned desired) const
   {
     Vec l, h;
-    unsigned flags = REFLECTIVE;
+    unsigned flags = Bsdf::REFLECTIVE;
     float u = param.u, v = param.v;
 
-    if (! (desired & REFLECTIVE))
+    if (! (desired & Bsdf::REFLECTIVE))
       goto fail;
 
     // Remove all flags except those BSDF layers we can support.
     //
-    desired &= have_layers;
+    desired &= params.have_layers;
 
     if (! desired)
       goto fail;
@@ -88,8 +77,8 @@ public:
 
     // DESIRED_DIFF_WEIGHT is the probability we choose the diffuse
     // layer.  If DESIRED contains both layers, then DESIRED_DIFF_WEIGHT
-    // == CookTorranceBsdf::diff_weight; if DESIRED only includes the
-    // diffuse layer, it will be 1, and otherwise it will be 0.
+    // == PARAMS.diff_weight; if DESIRED only includes the diffuse
+    // layer, it will be 1, and otherwise it will be 0.
     //
     // Similarly, INV_DESIRED_DIFF_WEIGHT and INV_DESIRED_GLOSS_WEIGHT are
     // local versions of INV_DIFF_WEIGHT and INV_GLOSS_WEIGHT, and have
@@ -101,16 +90,16 @@ public:
     float desired_diff_weight;
     float inv_desired_diff_weight, inv_desired_gloss_weight;
 
-    if (desired == (DIFFUSE|gloss_layer))
+    if (desired == (Bsdf::DIFFUSE|params.gloss_layer))
       {
 	// Both layers desired, so the DESIRED_ values are the same as
 	// the global ones.
 
-	desired_diff_weight = diff_weight;
-	inv_desired_diff_weight = inv_diff_weight;
-	inv_desired_gloss_weight = inv_gloss_weight;
+	desired_diff_weight = params.diff_weight;
+	inv_desired_diff_weight = params.inv_diff_weight;
+	inv_desired_gloss_weight = params.inv_gloss_weight;
       }
-    else if (desired == DIFFUSE)
+    else if (desired == Bsdf::DIFFUSE)
       {
 	// Only diffuse layer desired.
 
@@ -132,12 +121,12 @@ public:
 	// Adjust U so that the diffuse range (0 - DESIRED_DIFF_WEIGHT)
 	// is mapped to 0 - 1.
 	//
-	if (desired != DIFFUSE)
+	if (desired != Bsdf::DIFFUSE)
 	  u = u * inv_desired_diff_weight;
 
 	l = diff_dist.sample (UV (u, v));
 	h = (isec.v + l).unit ();
-	flags |= DIFFUSE;
+	flags |= Bsdf::DIFFUSE;
       }
     else
       {
@@ -150,43 +139,43 @@ public:
 	if (isec.cos_v (h) < 0)
 	  h = -h;
 	l = isec.v.mirror (h);
-	flags |= gloss_layer;
+	flags |= params.gloss_layer;
       }
 
     if (isec.cos_n (l) > Epsf && isec.cos_geom_n (l) > Epsf)
       {
 	float pdf;
 	Color f = val (l, h, desired, desired_diff_weight, pdf);
-	return Sample (f, pdf, l, flags);
+	return Bsdf::Sample (f, pdf, l, flags);
       }
 
   fail:
-    return Sample ();
+    return Bsdf::Sample ();
   }
 
-  // Evaluate this BSDF in direction DIR, and return its value and pdf.
-  // If FLAGS is specified, then only the given types of surface
-  // interaction are considered.
+  // Evaluate this lobe in direction DIR, and return its value and
+  // pdf.  Only the types of surface interaction in FLAGS are
+  // considered.
   //
-  virtual Value eval (const Vec &dir, unsigned flags) const
+  Bsdf::Value eval (const Vec &dir, unsigned flags) const
   {
     float cos_n = isec.cos_n (dir);
-    if ((flags & REFLECTIVE) && cos_n > 0)
+    if ((flags & Bsdf::REFLECTIVE) && cos_n > 0)
       {
 	// Remove all flags except those BSDF layers we can support.
 	//
-	flags &= have_layers;
+	flags &= params.have_layers;
 
 	// DESIRED_DIFF_WEIGHT is the probability we choose the
 	// diffuse layer.  If FLAGS contains both layers, then
-	// DESIRED_DIFF_WEIGHT == CookTorranceBsdf::diff_weight; if
-	// FLAGS only includes the diffuse layer, it will be 1, and
-	// otherwise it will be 0.
+	// DESIRED_DIFF_WEIGHT == PARAMS.diff_weight; if FLAGS only
+	// includes the diffuse layer, it will be 1, and otherwise it
+	// will be 0.
 	//
 	float desired_diff_weight
-	  = ((flags == (DIFFUSE|gloss_layer))
-	     ? diff_weight
-	     : (flags == DIFFUSE)
+	  = ((flags == (Bsdf::DIFFUSE|params.gloss_layer))
+	     ? params.diff_weight
+	     : (flags == Bsdf::DIFFUSE)
 	     ? 1
 	     : 0);
 
@@ -195,31 +184,10 @@ public:
 	float pdf;
 	Color f = val (dir, h, flags, desired_diff_weight, pdf);
 
-	return Value (f, pdf);
+	return Bsdf::Value (f, pdf);
       }
 
-    return Value ();
-  }
-
-  // Return a bitmask of flags from Bsdf::Flags, describing what
-  // types of scatting this BSDF supports.  The returned value will
-  // include only flags in LIMIT (default, all flags).
-  //
-  // The various fields (Bsdf::ALL_LAYERS, Bsdf::ALL_DIRECTIONS) in
-  // the returned value should be consistent -- a layer flag like
-  // Bsdf::DIFFUSE should only be included if that layer is
-  // supported by one of the sample-directions
-  // (e.g. Bsdf::REFLECTIVE) in the return value, and vice-versa.
-  //
-  virtual unsigned supports (unsigned limit) const
-  {
-    unsigned refl_flags
-      = ((diff_weight > 0 ? DIFFUSE : 0)
-	 | (diff_weight < 1 ? gloss_layer : 0));
-    return
-      ((limit & REFLECTIVE) && (limit & refl_flags))
-      ? ((REFLECTIVE | refl_flags) & limit)
-      : 0;
+    return Bsdf::Value ();
   }
 
 private:
@@ -245,7 +213,10 @@ private:
 
   // Calculate F (fresnel) term
   //
-  float F (float vh) const { return fres.reflectance (vh); }
+  float F (float vh) const
+  {
+    return Fresnel (1.f, Ior (params.ior_n, params.ior_k)).reflectance (vh);
+  }
 
   // Calculate G (microfacet masking/shadowing) term
   //
@@ -255,6 +226,7 @@ private:
   //
   float G (float vh, float nh, float nl) const
   {
+    float nv = params.nv;
     return min (2 * nh * ((nv > nl) ? nl : nv) / vh, 1.f);
   }
 
@@ -262,9 +234,9 @@ private:
   // is the half-vector.  The pdf is returned in PDF.  FLAGS controls
   // which layers are used in the evaluation.  DESIRED_DIFF_WEIGHT is
   // the probability of choosing the diffuse layer (which may be
-  // different than CookTorranceBsdf::diff_weight in the case where
-  // the user specified a restricted set of layers), and is used to
-  // calculate the PDF.
+  // different than PARAMS.diff_weight in the case where the user
+  // specified a restricted set of layers), and is used to calculate
+  // the PDF.
   //
   Color val (const Vec &l, const Vec &h,
 	     unsigned flags, float desired_diff_weight,
@@ -276,7 +248,7 @@ private:
     Color col = 0;
     pdf = 0;
 
-    if (flags & DIFFUSE)
+    if (flags & Bsdf::DIFFUSE)
       {
 	// Diffuse term is a simple lambertian (cosine) distribution, and
 	// its pdf is constant.
@@ -288,7 +260,7 @@ private:
 	col += diff_col * diff;
       }
 
-    if (flags & gloss_layer)
+    if (flags & params.gloss_layer)
       {
 	float nh = isec.cos_n (h);
 
@@ -309,9 +281,18 @@ private:
 	// We sample the glossy-lobe using the D component only, so the pdf
 	// is only based on that.
 	//
-	float gloss = F (vh) * D (nh) * G (vh, nh, nl) * inv_4_nv * inv_nl;
+	float gloss
+	  = F (vh) * D (nh) * G (vh, nh, nl) * params.inv_4_nv * inv_nl;
 	float gloss_pdf = D_pdf (nh, vh);
 
+	// Add the energy-compensation term for light which is lost
+	// to multiple scattering between microfacets (see
+	// CookTorrance::get_bsdf).  We don't sample this term
+	// specially, as it's broad and usually small.
+	//
+	if (params.ms_scale != 0)
+	  gloss += params.ms_scale * (1 - albedos.albedo (nl, params.m));
+
 	pdf += gloss_pdf * (1 - desired_diff_weight);
 	col += gloss_col * gloss;
       }
@@ -319,62 +300,246 @@ private:
     return col;
   }
 
-  // M value used.
+  const Intersect &isec;
+
+  // Color of diffuse/glossy components.
   //
-  float m;
+  const Color &diff_col, &gloss_col;
+
+  const Bsdf::CookTorranceParams &params;
 
   // Sample distributions for glossy and diffuse components.
   //
   const WardDist gloss_dist;
   const CosDist diff_dist;
 
-  // Color of diffuse/glossy components.
+  // Directional albedo of the glossy layer, used for energy
+  // compensation.
   //
-  Color diff_col, gloss_col;
+  const AlbedoTable &albedos;
+};
 
-  // Intensity (sum of all color components) of diffuse and glossy
-  // components.
-  //
-  float diff_intens, gloss_intens;
+} // namespace
 
-  // Weight used for sampling diffuse component (0 = don't sample
-  // diffuse at all, 1 = only sample diffuse).  The glossy component
-  // has a weight of (1 - DIFF_WEIGHT).
-  //
-  float diff_weight;
 
-  // 1 / DIFF_WEIGHT, and 1 / (1 - DIFF_WEIGHT).
-  //
-  float inv_diff_weight, inv_gloss_weight;
+// Add a Cook-Torrance lobe to BSDF for this material instantiated at
+// ISEC.
+//
+bool
+CookTorrance::get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			Bsdf &bsdf)
+  const
+{
+  Bsdf::Lobe *lobe = bsdf.add_lobe (Bsdf::Lobe::COOK_TORRANCE);
+  if (! lobe)
+    return false;
+
+  Bsdf::CookTorranceParams &params = lobe->cook_torrance;
+
+  lobe->color = color.eval (tex_coords);
+  lobe->color2 = gloss_color.eval (tex_coords);
 
-  // Info for calculating the Fresnel term.
+  // Weight used for sampling diffuse component (0 = don't sample
+  // diffuse at all, 1 = only sample diffuse), based on the intensity
+  // of the diffuse and glossy components.  The glossy component has a
+  // weight of (1 - DIFF_WEIGHT).
   //
-  const Fresnel fres;
+  float diff_intens = lobe->color.intensity ();
+  float gloss_intens = lobe->color2.intensity ();
+  float diff_weight
+    = ((diff_intens + gloss_intens) == 0
+       ? 0
+       : diff_intens / (diff_intens + gloss_intens));
+
+  params.m = m.eval (tex_coords);
+  params.diff_weight = diff_weight;
+  params.inv_diff_weight = diff_weight == 0 ? 0 : 1 / diff_weight;
+  params.inv_gloss_weight = diff_weight == 1 ? 0 : 1 / (1 - diff_weight);
 
   // N dot V, which is the cosine of the angle between the eye ray (V),
   // and the surface normal (N), and 1 / (4 * (N dot V)).
   //
-  float nv, inv_4_nv;
+  params.nv = isec.cos_n (isec.v);
+  params.inv_4_nv = (params.nv != 0) ? 1 / (4 * params.nv) : 0;
 
-  // Bsdf layer flags to use for glossy samples.
+  // Index of refraction relative to the surrounding medium, for
+  // calculating the Fresnel term.
+  //
+  float medium_ior = isec.media.medium.ior;
+  params.ior_n = ior.n / medium_ior;
+  params.ior_k = ior.k / medium_ior;
+
+  // The glossy layer only models a single scattering event between
+  // microfacets, so it loses energy that would really be reflected
+  // after scattering multiple times, to an increasing degree as M
+  // increases.  To compensate, we add a term:
+  //
+  //   f_ms = F_ms * (1 - E (N dot V)) * (1 - E (N dot L))
+  //          / (PI * (1 - E_avg))
+  //
+  // where E is the directional albedo and E_avg the average albedo of
+  // the glossy layer with a Fresnel term of 1 (both from a
+  // precomputed table), and:
+  //
+  //   F_ms = F_avg^2 * E_avg / (1 - F_avg * (1 - E_avg))
   //
-  unsigned gloss_layer;
+  // accounts for Fresnel absorption at each scattering event, where
+  // F_avg is the average Fresnel reflectance.  Everything except the
+  // (1 - E (N dot L)) factor is constant for this BSDF, so we
+  // calculate it here.
+  //
+  const AlbedoTable &albedos = albedo_table ();
+  float e_avg = albedos.average_albedo (params.m);
+  if (e_avg < 1)
+    {
+      float f_ms
+	= (fresnel_avg * fresnel_avg * e_avg
+	   / (1 - fresnel_avg * (1 - e_avg)));
+      params.ms_scale
+	= (f_ms * (1 - albedos.albedo (params.nv, params.m))
+	   * INV_PIf / (1 - e_avg));
+    }
+  else
+    params.ms_scale = 0;
+
+  params.gloss_layer
+    = params.m < glossy_m() ? Bsdf::GLOSSY : Bsdf::DIFFUSE;
+  params.have_layers
+    = ((diff_weight > 0 ? Bsdf::DIFFUSE : 0)
+       | (diff_weight < 1 ? params.gloss_layer : 0));
+
+  return true;
+}
+
+
+
+// Albedo table
+
+namespace { // keep local to file
+
+// Size of the Cook-Torrance albedo table, the maximum value of M it
+// covers, and the number of samples used to calculate each entry.
+//
+const unsigned ALBEDO_TABLE_NUM_COS = 32;
+const unsigned ALBEDO_TABLE_NUM_M = 32;
+inline float albedo_table_max_m () { return 1; }
+const unsigned ALBEDO_TABLE_SAMPLES = 1024;
+
+// Return the directional albedo of the Cook-Torrance glossy layer
+// (with a Fresnel term of 1) for a view direction whose cosine with
+// the normal is NV, and RMS slope M.
+//
+float
+cook_torrance_albedo (float nv, float m)
+{
+  WardDist dist (m);
+  Vec v (sqrt (max (1 - nv * nv, 0.f)), 0, nv);
 
-  // The set of Bsdf layer flags for surface types we support; some
-  // combination of DIFFUSE and GLOSSY.
+  // We sample the half-vector H using GLOSS_DIST, just as
+  // CookTorranceLobe::sample does, so the pdf of the resulting light
+  // vector L is D / (4 * (V dot H)).  Dividing the glossy term,
   //
-  unsigned have_layers;
-};
+  //   D * G / (4 * (N dot V) * (N dot L)),
+  //
+  // multiplied by N dot L, by that pdf, leaves G * (V dot H) / (N dot V).
+  //
+  double sum = 0;
+  for (unsigned i = 0; i < ALBEDO_TABLE_SAMPLES; i++)
+    {
+      UV param ((i + 0.5f) / ALBEDO_TABLE_SAMPLES, radical_inverse (i + 1, 2));
+
+      Vec h = dist.sample (param);
+      float vh = dot (v, h);
+      if (vh < 0)
+	{
+	  h = -h;
+	  vh = -vh;
+	}
+
+      Vec l = v.mirror (h);
+      float nl = l.z, nh = h.z;
+
+      if (nl > Epsf && vh > 0)
+	{
+	  float G = min (2 * nh * min (nv, nl) / vh, 1.f);
+	  sum += double (G * vh / nv);
+	}
+    }
+
+  return clamp01 (float (sum / ALBEDO_TABLE_SAMPLES));
+}
+
+// Return a newly calculated albedo table for the Cook-Torrance glossy
+// layer.
+//
+AlbedoTable
+make_albedo_table ()
+{
+  AlbedoTable table (ALBEDO_TABLE_NUM_COS, ALBEDO_TABLE_NUM_M,
+		     albedo_table_max_m ());
+
+  for (unsigned mi = 0; mi < table.num_params; mi++)
+    for (unsigned ci = 0; ci < table.num_cos; ci++)
+      table.set_albedo (ci, mi, cook_torrance_albedo (table.cos_at (ci),
+						       table.param_at (mi)));
+
+  table.calc_average_albedos ();
+
+  return table;
+}
 
 } // namespace
 
 
-// Return a new BSDF object for this material instantiated at ISEC.
+// Return a table of the directional albedo of the Cook-Torrance
+// glossy layer, ignoring the Fresnel term, indexed by the cosine of
+// the view angle and M.  The table is calculated the first time this
+// is called.
+//
+const AlbedoTable &
+CookTorrance::albedo_table ()
+{
+  static const AlbedoTable table = make_albedo_table ();
+  return table;
+}
+
+
+
+// Lobe methods
+
+// Return a sample of the Cook-Torrance lobe at index LOBE in BSDF,
+// based on the parameter PARAM.
+//
+Bsdf::Sample
+CookTorrance::sample_lobe (const Bsdf &bsdf, unsigned lobe,
+			   const UV &param, unsigned flags)
+{
+  return CookTorranceLobe (bsdf, lobe).sample (param, flags);
+}
+
+// Evaluate the Cook-Torrance lobe at index LOBE in BSDF in direction
+// DIR, and return its value and pdf.  Only the types of surface
+// interaction in FLAGS are considered.
+//
+Bsdf::Value
+CookTorrance::eval_lobe (const Bsdf &bsdf, unsigned lobe,
+			 const Vec &dir, unsigned flags)
+{
+  return CookTorranceLobe (bsdf, lobe).eval (dir, flags);
+}
+
+// Return a bitmask of flags from Bsdf::Flags, describing what types
+// of scatting the Cook-Torrance lobe at index LOBE in BSDF supports.
+// The returned value will include only flags in LIMIT.
 //
-Bsdf *
-CookTorrance::get_bsdf (const Intersect &isec, const TexCoords &tex_coords) const
+unsigned
+CookTorrance::lobe_supports (const Bsdf &bsdf, unsigned lobe, unsigned limit)
 {
-  return new (isec) CookTorranceBsdf (*this, isec, tex_coords);
+  unsigned refl_flags = bsdf.lobe (lobe).cook_torrance.have_layers;
+  return
+    ((limit & Bsdf::REFLECTIVE) && (limit & refl_flags))
+    ? ((Bsdf::REFLECTIVE | refl_flags) & limit)
+    : 0;
 }
 
 
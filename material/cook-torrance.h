@@ -15,7 +15,9 @@
 
 #include "texture/tex.h"
 #include "material.h"
+#include "bsdf.h"
 #include "fresnel.h"
+#include "albedo-table.h"
 
 namespace snogray {
 
@@ -26,14 +28,39 @@ public:
 
   CookTorrance (const TexVal<Color> &col, const TexVal<Color> &gloss_col,
 		const TexVal<float> &_m, const Ior &_ior = 1.5)
-    : color (col), gloss_color (gloss_col), m (_m), ior (_ior)
-  { }
-
-  // Return a new BSDF object for this material instantiated at ISEC.
+    : color (col), gloss_color (gloss_col), m (_m), ior (_ior),
+      fresnel_avg (Fresnel (1.f, _ior).average_reflectance ())
+  {
+    // Make sure the albedo table is calculated while the scene is
+    // being set up, rather than during rendering.
+    //
+    albedo_table ();
+  }
+
+  // Add lobes to BSDF for this material instantiated at ISEC, and
+  // return true, or return false if there is no BSDF.
   //
-  virtual Bsdf *get_bsdf (const Intersect &isec, const TexCoords &tex_coords)
+  virtual bool get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			 Bsdf &bsdf)
     const;
 
+  // Bsdf::sample, Bsdf::eval, and Bsdf::supports for the lobe at index
+  // LOBE in BSDF (see Bsdf::sample_lobes).
+  //
+  static Bsdf::Sample sample_lobe (const Bsdf &bsdf, unsigned lobe,
+				   const UV &param, unsigned flags);
+  static Bsdf::Value eval_lobe (const Bsdf &bsdf, unsigned lobe,
+				const Vec &dir, unsigned flags);
+  static unsigned lobe_supports (const Bsdf &bsdf, unsigned lobe,
+				 unsigned limit);
+
+  // Return a table of the directional albedo of the Cook-Torrance
+  // glossy layer, ignoring the Fresnel term, indexed by the cosine of
+  // the view angle and M.  The table is calculated the first time
+  // this is called.
+  //
+  static const AlbedoTable &albedo_table ();
+
   TexVal<Color> color, gloss_color;
 
   // Cook Torrance parameters:
@@ -46,6 +73,16 @@ public:
   // Index of refraction for calculating fresnel reflection term.
   //
   Ior ior;
+
+private:
+
+  // The average Fresnel reflectance over the hemisphere for IOR,
+  // relative to a surrounding medium with an index of refraction of
+  // 1.  This is used for energy compensation, where the surrounding
+  // medium makes little difference, and is expensive to calculate, so
+  // we do it once here.
+  //
+  float fresnel_avg;
 };
 
 
@@ -80,7 +80,18 @@ public:
     //
     cos_refl_angle = abs (clamp (cos_refl_angle, -1.f, 1.f));
 
-    float refl_angle = acos (cos_refl_angle);
+    // At grazing angles, everything is reflected (this also avoids
+    // dividing by zero below).
+    //
+    if (cos_refl_angle == 0)
+      return 1;
+
+    // The sine and tangent of the reflection angle are calculated
+    // directly from its cosine, which is much cheaper than calling the
+    // trigonometric functions.
+    //
+    float sin2_refl_angle = 1 - cos_refl_angle * cos_refl_angle;
+    float sin_refl_angle = sqrt (sin2_refl_angle);
 
     // Reflectance of parallel and perpendicular polarized light.
     //
@@ -102,7 +113,7 @@ public:
 	// trans_angle are the reflection and refraction refl_angles of the
 	// light ray.
 
-	float sin_trans_angle = clamp (sin (refl_angle) / ior.n, -1.f, 1.f);
+	float sin_trans_angle = clamp (sin_refl_angle / ior.n, -1.f, 1.f);
 	float cos_trans_angle = sqrt (1.f - sin_trans_angle * sin_trans_angle);
 
 	float nc1 = ior.n * cos_refl_angle;
@@ -139,10 +150,8 @@ public:
 	//            - (n^2 - k^2 - sin^2 refl_angle)
 	//
 
-	float sin_refl_angle = sin (refl_angle);
-	float n2_m_k2_m_sin2_refl_angle
-	  = n2_m_k2 - sin_refl_angle * sin_refl_angle;
-	float sin_tan_refl_angle = sin_refl_angle * tan (refl_angle);
+	float n2_m_k2_m_sin2_refl_angle = n2_m_k2 - sin2_refl_angle;
+	float sin_tan_refl_angle = sin2_refl_angle / cos_refl_angle;
 
 	float a2_b2_common
 	  = sqrt (n2_m_k2_m_sin2_refl_angle * n2_m_k2_m_sin2_refl_angle
@@ -165,6 +174,28 @@ public:
     return clamp01 ((Rs + Rp) / 2);
   }
 
+  // Return the average reflectance over all directions in a hemisphere,
+  // weighted by the cosine of the angle to the normal (this is the
+  // fraction of diffusely incident light which is reflected).
+  //
+  // This is calculated by numerical integration, so is relatively
+  // expensive, and callers should cache the result where possible.
+  //
+  float average_reflectance () const
+  {
+    // The average reflectance is 2 * integral (0, 1, R(mu) * mu dmu);
+    // we just use the midpoint rule.
+    //
+    const unsigned steps = 64;
+    float sum = 0;
+    for (unsigned i = 0; i < steps; i++)
+      {
+	float mu = (i + 0.5f) / steps;
+	sum += reflectance (mu) * mu;
+      }
+    return clamp01 (2 * sum / steps);
+  }
+
   // Final index of refracetion (the ratio of the indices of refraction on
   // either side of the interface).
   //
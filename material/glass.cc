@@ -24,186 +24,174 @@ using namespace snogray;
 
 namespace { // keep local to file
 
-// Common information used for refraction methods.
+// Return the proportion of light which will be transmitted towards the
+// viewer.  COS_XMIT_ANGLE is the angle between the surface normal and
+// the ray on the other side of the interface.
 //
-class GlassBsdf : public Bsdf
+// This function does not include light concentration due to the changing
+// solid angle of transmitted light rays (use Refraction::magnify for that).
+//
+inline float
+glass_transmittance (const Bsdf::GlassParams &params, float cos_xmit_angle)
 {
-public:
-
-  GlassBsdf (const Medium &medium, const Intersect &isec)
-    : Bsdf (isec), entering (! isec.back),
-      old_ior ((entering ? isec.media.medium : medium).ior),
-      new_ior ((entering
-		? medium
-		: isec.media.enclosing_medium (isec.context.default_medium))
-	       .ior)
-  { }
-
-  // Return a sample of this BSDF, based on the parameter PARAM.
-  //
-  virtual Sample sample (const UV &param, unsigned flags) const
-  {
-    if (flags & SPECULAR)
-      {
-	// Clear all but the direction flags.  This means it will be
-	// either REFLECTIVE, TRANSMISSIVE, or REFLECTIVE|TRANSMISSIVE.
-	//
-	flags &= ALL_DIRECTIONS;
-
-	// Direction from which transmitted light comes.
-	//
-	Vec xmit_dir = (-isec.v).refraction (Vec (0, 0, 1), old_ior, new_ior);
-
-	// The cosine of the angle between the transmitted ray and the
-	// reverse-surface-normal (on the transmission side of the
-	// material).
-	//
-	// Since that angle is 180 minus the angle with the front-surface
-	// normal, we just calculate the cosine of the latter instead, and
-	// then negate it, as cos (180 - theta) = -cos (theta).
-	//
-	// In the case of total internal reflection, XMIT_DIR will be a null
-	// vector, which will cause Intersect::cos_n to return zero.
-	//
-	float cos_xmit_angle = -isec.cos_n (xmit_dir);
-
-	// The cosine of the angle between the reflected ray and the surface
-	// normal.  For reflection this angle is the same as the angle
-	// between the view ray and the normal.
-	//
-	float cos_refl_angle = abs (isec.cos_n (isec.v));
-
-	// Proportion of transmitted light.
-	//
-	float xmit = (cos_xmit_angle == 0) ? 0 : transmittance (cos_xmit_angle);
-
-	// Proportion of reflected light.
-	//
-	float refl = (cos_refl_angle == 0) ? 0 : reflectance (cos_refl_angle);
-
-	if (xmit + refl != 0)
-	  {
-	    // Probability we will choose the transmissive direction.
-	    // If the user forced the choice by only passing one of
-	    // TRANSMISSIVE or REFLECTIVE flags, then the probability will
-	    // be 0 or 1 respectively.
-	    //
-	    float xmit_probability
-	      = (flags == TRANSMISSIVE ? 1
-		 : flags == REFLECTIVE ? 0
-		 : xmit / (xmit + refl));
-
-	    // Choose between the two possible directions based on their
-	    // relative strengths.
-	    //
-	    // We also add the appropriate 1 / cos (theta_i) term just
-	    // before returning (so we only need do one expensive division).
-	    //
-	    if (param.u < xmit_probability)
-	      // Transmitted sample.
-	      {
-		if (cos_xmit_angle != 0)
-		  xmit /= cos_xmit_angle;
-
-		return Sample (xmit, xmit_probability, xmit_dir,
-			       SPECULAR|TRANSMISSIVE);
-	      }
-	    else
-	      // Reflected sample.
-	      {
-		if (cos_refl_angle != 0)
-		  refl /= cos_refl_angle;
-
-		return Sample (refl, (1 - xmit_probability),
-			       isec.v.mirror (Vec (0, 0, 1)),
-			       SPECULAR|REFLECTIVE);
-	      }
-	  }
-      }
-
-    return Sample ();
-  }
-
-  // Evaluate this BSDF in direction DIR, and return its value and pdf.
-  // If FLAGS is specified, then only the given types of surface
-  // interaction are considered.
-  //
-  virtual Value eval (const Vec &, unsigned) const
-  {
-    return Value ();		// we're specular, so all samples fail
-  }
-
-  // Return a bitmask of flags from Bsdf::Flags, describing what
-  // types of scatting this BSDF supports.  The returned value will
-  // include only flags in LIMIT (default, all flags).
-  //
-  // The various fields (Bsdf::ALL_LAYERS, Bsdf::ALL_DIRECTIONS) in
-  // the returned value should be consistent -- a layer flag like
-  // Bsdf::DIFFUSE should only be included if that layer is
-  // supported by one of the sample-directions
-  // (e.g. Bsdf::REFLECTIVE) in the return value, and vice-versa.
-  //
-  virtual unsigned supports (unsigned limit) const
-  {
-    return
-      (limit & SPECULAR)
-      ? (TRANSMISSIVE | REFLECTIVE | SPECULAR) & limit
-      : 0;
-  }
-
-private:
-
-  // Return the proportion of light which will be transmitted towards the
-  // viewer.  COS_XMIT_ANGLE is the angle between the surface normal and
-  // the ray on the other side of the interface.
-  //
-  // This function does not include light concentration due to the changing
-  // solid angle of transmitted light rays (use Refraction::magnify for that).
-  //
-  float transmittance (float cos_xmit_angle) const
-  {
-    // The amount transmitted is one minus the amount of transmitted light
-    // which would be lost due to Fresnel reflection from the interface.
-    //
-    return 1 - Fresnel (new_ior, old_ior).reflectance (cos_xmit_angle);
-  }
-
-  // Return the amount of "magnification" due to the change in solid angle of
-  // a transmitted the light ray.
+  // The amount transmitted is one minus the amount of transmitted light
+  // which would be lost due to Fresnel reflection from the interface.
   //
-  float magnification () const
-  {
-    return (new_ior * new_ior) / (old_ior * old_ior);
-  }
-
-  // The proportion of light which will be reflected towards the viewer
-  // from the same side of the interface, due to fresnel reflection .
-  // COS_REFL_ANGLE is the angle between the surface normal and the ray to
-  // be reflected.
-  //
-  float reflectance (float cos_refl_angle) const
-  {
-    return Fresnel (old_ior, new_ior).reflectance (cos_refl_angle);
-  }
+  return
+    1 - Fresnel (params.new_ior, params.old_ior).reflectance (cos_xmit_angle);
+}
+
+// The proportion of light which will be reflected towards the viewer
+// from the same side of the interface, due to fresnel reflection .
+// COS_REFL_ANGLE is the angle between the surface normal and the ray to
+// be reflected.
+//
+inline float
+glass_reflectance (const Bsdf::GlassParams &params, float cos_refl_angle)
+{
+  return Fresnel (params.old_ior, params.new_ior).reflectance (cos_refl_angle);
+}
+
+} // namespace
+
+
+// Add a glass lobe to BSDF for this material instantiated at ISEC.
+//
+bool
+Glass::get_bsdf (const Intersect &isec, const TexCoords &, Bsdf &bsdf) const
+{
+  Bsdf::Lobe *lobe = bsdf.add_lobe (Bsdf::Lobe::GLASS);
+  if (! lobe)
+    return false;
 
   // Are we entering or exiting the medium enclosed by the glass surface?
   //
-  bool entering;
+  bool entering = ! isec.back;
 
-  // The indices of refraction of OLD_MEDIUM and NEW_MEDIUM.
+  // The indices of refraction of the old and new media.
   //
-  float old_ior, new_ior;
-};
+  lobe->glass.old_ior = (entering ? isec.media.medium : _medium).ior;
+  lobe->glass.new_ior
+    = (entering
+       ? _medium
+       : isec.media.enclosing_medium (isec.context.default_medium)).ior;
 
-} // namespace
+  return true;
+}
+
+
+
+// Lobe methods
 
+// Return a sample of the glass lobe at index LOBE in BSDF, based on
+// the parameter PARAM.
+//
+Bsdf::Sample
+Glass::sample_lobe (const Bsdf &bsdf, unsigned lobe,
+		    const UV &param, unsigned flags)
+{
+  if (flags & Bsdf::SPECULAR)
+    {
+      const Intersect &isec = bsdf.isec ();
+      const Bsdf::GlassParams &params = bsdf.lobe (lobe).glass;
+
+      // Clear all but the direction flags.  This means it will be
+      // either REFLECTIVE, TRANSMISSIVE, or REFLECTIVE|TRANSMISSIVE.
+      //
+      flags &= Bsdf::ALL_DIRECTIONS;
+
+      // Direction from which transmitted light comes.
+      //
+      Vec xmit_dir
+	= (-isec.v).refraction (Vec (0, 0, 1), params.old_ior, params.new_ior);
+
+      // The cosine of the angle between the transmitted ray and the
+      // reverse-surface-normal (on the transmission side of the
+      // material).
+      //
+      // Since that angle is 180 minus the angle with the front-surface
+      // normal, we just calculate the cosine of the latter instead, and
+      // then negate it, as cos (180 - theta) = -cos (theta).
+      //
+      // In the case of total internal reflection, XMIT_DIR will be a null
+      // vector, which will cause Intersect::cos_n to return zero.
+      //
+      float cos_xmit_angle = -isec.cos_n (xmit_dir);
+
+      // The cosine of the angle between the reflected ray and the surface
+      // normal.  For reflection this angle is the same as the angle
+      // between the view ray and the normal.
+      //
+      float cos_refl_angle = abs (isec.cos_n (isec.v));
+
+      // Proportion of transmitted light.
+      //
+      float xmit
+	= ((cos_xmit_angle == 0)
+	   ? 0
+	   : glass_transmittance (params, cos_xmit_angle));
+
+      // Proportion of reflected light.
+      //
+      float refl
+	= ((cos_refl_angle == 0)
+	   ? 0
+	   : glass_reflectance (params, cos_refl_angle));
+
+      if (xmit + refl != 0)
+	{
+	  // Probability we will choose the transmissive direction.
+	  // If the user forced the choice by only passing one of
+	  // TRANSMISSIVE or REFLECTIVE flags, then the probability will
+	  // be 0 or 1 respectively.
+	  //
+	  float xmit_probability
+	    = (flags == Bsdf::TRANSMISSIVE ? 1
+	       : flags == Bsdf::REFLECTIVE ? 0
+	       : xmit / (xmit + refl));
+
+	  // Choose between the two possible directions based on their
+	  // relative strengths.
+	  //
+	  // We also add the appropriate 1 / cos (theta_i) term just
+	  // before returning (so we only need do one expensive division).
+	  //
+	  if (param.u < xmit_probability)
+	    // Transmitted sample.
+	    {
+	      if (cos_xmit_angle != 0)
+		xmit /= cos_xmit_angle;
+
+	      return Bsdf::Sample (xmit, xmit_probability, xmit_dir,
+				   Bsdf::SPECULAR|Bsdf::TRANSMISSIVE);
+	    }
+	  else
+	    // Reflected sample.
+	    {
+	      if (cos_refl_angle != 0)
+		refl /= cos_refl_angle;
+
+	      return Bsdf::Sample (refl, (1 - xmit_probability),
+				   isec.v.mirror (Vec (0, 0, 1)),
+				   Bsdf::SPECULAR|Bsdf::REFLECTIVE);
+	    }
+	}
+    }
+
+  return Bsdf::Sample ();
+}
 
-// Return a new BSDF object for this material instantiated at ISEC.
+// Return a bitmask of flags from Bsdf::Flags, describing what types
+// of scatting the glass lobe at index LOBE in BSDF supports.  The
+// returned value will include only flags in LIMIT.
 //
-Bsdf *
-Glass::get_bsdf (const Intersect &isec, const TexCoords &) const
+unsigned
+Glass::lobe_supports (const Bsdf &, unsigned, unsigned limit)
 {
-  return new (isec) GlassBsdf (_medium, isec);
+  return
+    (limit & Bsdf::SPECULAR)
+    ? (Bsdf::TRANSMISSIVE | Bsdf::REFLECTIVE | Bsdf::SPECULAR) & limit
+    : 0;
 }
 
 
@@ -14,6 +14,7 @@
 #define SNOGRAY_GLASS_H
 
 #include "material.h"
+#include "bsdf.h"
 #include "medium.h"
 
 
@@ -26,11 +27,22 @@ public:
 
   Glass (const Medium &medium) : _medium (medium) { }
 
-  // Return a new BSDF object for this material instantiated at ISEC.
+  // Add lobes to BSDF for this material instantiated at ISEC, and
+  // return true, or return false if there is no BSDF.
   //
-  virtual Bsdf *get_bsdf (const Intersect &isec, const TexCoords &tex_coords)
+  virtual bool get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			 Bsdf &bsdf)
     const;
 
+  // Bsdf::sample and Bsdf::supports for the lobe at index LOBE in
+  // BSDF (see Bsdf::sample_lobes).  As this material is specular,
+  // there's no Bsdf::eval equivalent.
+  //
+  static Bsdf::Sample sample_lobe (const Bsdf &bsdf, unsigned lobe,
+				   const UV &param, unsigned flags);
+  static unsigned lobe_supports (const Bsdf &bsdf, unsigned lobe,
+				 unsigned limit);
+
   // Return the medium of this material (used only for refraction).
   //
   virtual const Medium *medium () const { return &_medium; }
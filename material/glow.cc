@@ -11,6 +11,7 @@
 //
 
 #include "surface/primitive.h"
+#include "surface/mesh.h"
 
 #include "glow.h"
 
@@ -39,14 +40,16 @@ Glow::Le (const Intersect &isec, const TexCoords &tex_coords) const
   return isec.back ? 0 : color.eval (tex_coords);
 }
 
-// Return a new BSDF object for this material instantiated at ISEC.
+// Add lobes to BSDF for this material instantiated at ISEC, and return
+// true, or return false if there is no BSDF.
 //
-Bsdf *
-Glow::get_bsdf (const Intersect &isec, const TexCoords &tex_coords) const
+bool
+Glow::get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+		Bsdf &bsdf)
+  const
 {
   return (underlying_material
-	  ? underlying_material->get_bsdf (isec, tex_coords)
-	  : 0);
+	  && underlying_material->get_bsdf (isec, tex_coords, bsdf));
 }
 
 // Return the medium of this material (used only for refraction).
@@ -70,5 +73,18 @@ Glow::add_light_samplers (const Primitive &primitive,
   primitive.add_light_samplers (color, samplers);
 }
 
+// If this is a light-emitting material, call MESH's
+// Mesh::add_light_samplers method with PART and an appropriate
+// intensity to add a Light::Sampler for the triangles in mesh part
+// PART to SAMPLERS (for non-light-emitting materials, do nothing).
+//
+void
+Glow::add_light_samplers (const Mesh &mesh, unsigned part,
+			  std::vector<const Light::Sampler *> &samplers)
+  const
+{
+  mesh.add_light_samplers (part, color, samplers);
+}
+
 
 // arch-tag: af19d9b6-7b4a-49ec-aee4-529be6aba253
@@ -29,9 +29,11 @@ public:
   Glow (const TexVal<Color> &col,
 	const Ref<const Material> &_underlying_material);
 
-  // Return a new BSDF object for this material instantiated at ISEC.
+  // Add lobes to BSDF for this material instantiated at ISEC, and
+  // return true, or return false if there is no BSDF.
   //
-  virtual Bsdf *get_bsdf (const Intersect &isec, const TexCoords &tex_coords)
+  virtual bool get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			 Bsdf &bsdf)
     const;
 
   // Return the medium of this material (used only for refraction).
@@ -52,6 +54,16 @@ public:
 		 std::vector<const Light::Sampler *> &samplers)
     const;
 
+  // If this is a light-emitting material, call MESH's
+  // Mesh::add_light_samplers method with PART and an appropriate
+  // intensity to add a Light::Sampler for the triangles in mesh part
+  // PART to SAMPLERS (for non-light-emitting materials, do nothing).
+  //
+  virtual void add_light_samplers (
+		 const Mesh &mesh, unsigned part,
+		 std::vector<const Light::Sampler *> &samplers)
+    const;
+
 private:
 
   // Amount of glow.
@@ -21,79 +21,75 @@ using namespace snogray;
 
 
 
-namespace { // keep local to file
-
-// The details of lambertian evaluation are in this class.
+// Add a lambertian lobe to BSDF for this material instantiated at ISEC.
 //
-class LambertBsdf : public Bsdf
+bool
+Lambert::get_bsdf (const Intersect &, const TexCoords &tex_coords,
+		   Bsdf &bsdf)
+  const
 {
-public:
-
-  LambertBsdf (const Lambert &_lambert,
-	       const Intersect &_isec, const TexCoords &tex_coords)
-    : Bsdf (_isec), color (_lambert.color.eval (tex_coords))
-  { }
-
-  // Return a sample of this BSDF, based on the parameter PARAM.
-  //
-  virtual Sample sample (const UV &param, unsigned flags) const
-  {
-    if ((flags & (REFLECTIVE|DIFFUSE)) == (REFLECTIVE|DIFFUSE))
-      {
-	float pdf;
-	Vec dir = dist.sample (param, pdf);
-	if (isec.cos_n (dir) > 0 && isec.cos_geom_n (dir) > 0)
-	  return Sample (color * INV_PIf, pdf, dir, REFLECTIVE|DIFFUSE);
-      }
-    return Sample ();
-  }
+  Bsdf::Lobe *lobe = bsdf.add_lobe (Bsdf::Lobe::LAMBERT);
+  if (! lobe)
+    return false;
 
-  // Evaluate this BSDF in direction DIR, and return its value and pdf.
-  // If FLAGS is specified, then only the given types of surface
-  // interaction are considered.
-  //
-  virtual Value eval (const Vec &dir, unsigned flags) const
-  {
-    float cos_n = isec.cos_n (dir);
-    if ((flags & (DIFFUSE|REFLECTIVE)) == (DIFFUSE|REFLECTIVE) && cos_n > 0)
-      {
-	float pdf = dist.pdf (cos_n);
-	return Value (color * INV_PIf, pdf);
-      }
-    return Value ();
-  }
+  lobe->color = color.eval (tex_coords);
 
-  // Return a bitmask of flags from Bsdf::Flags, describing what
-  // types of scatting this BSDF supports.  The returned value will
-  // include only flags in LIMIT (default, all flags).
-  //
-  // The various fields (Bsdf::ALL_LAYERS, Bsdf::ALL_DIRECTIONS) in
-  // the returned value should be consistent -- a layer flag like
-  // Bsdf::DIFFUSE should only be included if that layer is
-  // supported by one of the sample-directions
-  // (e.g. Bsdf::REFLECTIVE) in the return value, and vice-versa.
-  //
-  virtual unsigned supports (unsigned limit) const
-  {
-    return (limit & REFLECTIVE) ? ((REFLECTIVE | DIFFUSE) & limit) : 0;
-  }
-
-private:
+  return true;
+}
 
-  Color color;
 
-  CosDist dist;
-};
+
+// Lobe methods
 
-} // namespace
+// Return a sample of the lambertian lobe at index LOBE in BSDF,
+// based on the parameter PARAM.
+//
+Bsdf::Sample
+Lambert::sample_lobe (const Bsdf &bsdf, unsigned lobe,
+		      const UV &param, unsigned flags)
+{
+  if ((flags & (Bsdf::REFLECTIVE|Bsdf::DIFFUSE))
+      == (Bsdf::REFLECTIVE|Bsdf::DIFFUSE))
+    {
+      const Intersect &isec = bsdf.isec ();
+      float pdf;
+      Vec dir = CosDist ().sample (param, pdf);
+      if (isec.cos_n (dir) > 0 && isec.cos_geom_n (dir) > 0)
+	return Bsdf::Sample (bsdf.lobe (lobe).color * INV_PIf, pdf, dir,
+			     Bsdf::REFLECTIVE|Bsdf::DIFFUSE);
+    }
+  return Bsdf::Sample ();
+}
 
+// Evaluate the lambertian lobe at index LOBE in BSDF in direction
+// DIR, and return its value and pdf.  Only the types of surface
+// interaction in FLAGS are considered.
+//
+Bsdf::Value
+Lambert::eval_lobe (const Bsdf &bsdf, unsigned lobe,
+		    const Vec &dir, unsigned flags)
+{
+  float cos_n = bsdf.isec ().cos_n (dir);
+  if ((flags & (Bsdf::DIFFUSE|Bsdf::REFLECTIVE))
+      == (Bsdf::DIFFUSE|Bsdf::REFLECTIVE)
+      && cos_n > 0)
+    {
+      float pdf = CosDist ().pdf (cos_n);
+      return Bsdf::Value (bsdf.lobe (lobe).color * INV_PIf, pdf);
+    }
+  return Bsdf::Value ();
+}
 
-// Make a BSDF object for this material instantiated at ISEC.
+// Return a bitmask of flags from Bsdf::Flags, describing what types
+// of scatting the lambertian lobe at index LOBE in BSDF supports.
+// The returned value will include only flags in LIMIT.
 //
-Bsdf *
-Lambert::get_bsdf (const Intersect &isec, const TexCoords &tex_coords) const
+unsigned
+Lambert::lobe_supports (const Bsdf &, unsigned, unsigned limit)
 {
-  return new (isec) LambertBsdf (*this, isec, tex_coords);
+  return ((limit & Bsdf::REFLECTIVE)
+	  ? ((Bsdf::REFLECTIVE | Bsdf::DIFFUSE) & limit)
+	  : 0);
 }
 
 
@@ -24,29 +24,21 @@ MaterialWrapper::MaterialWrapper (const Ref<const Material> &_material)
 }
 
 
-// Return a new Bsdf object for this material instantiated at ISEC,
-// with texture-coordinates TEX_COORDS.
+// Set up BSDF, which is a Bsdf object belonging to ISEC, for this
+// material instantiated at ISEC with texture-coordinates TEX_COORDS,
+// by adding lobes to it (see Bsdf::add_lobe).  Return true if this
+// material has a BSDF, or false if it doesn't.
 //
-// Bsdf objects are allocated extremely often, and they need to
-// follow certain rules:
+// Bsdf objects are created extremely often, so they're stored
+// directly in the Intersect object, and this method should not
+// allocate memory.
 //
-//  (1) They should be allocated using ISEC as an arena, i.e., with
-//      "new (isec) SomeBsdfClass (...)"
-//	  This allocator is very fast, and does no locking.
-//
-//  (2) They should not depend on their destructor being called,
-//      because it won't be.  The memory they occupy (allocated
-//      using ISEC) will be eventually freed in bulk.
-//
-// Consequently, it's unnecessary to do careful tracking of Bsdf
-// objects for memory management purposes, and no attempt is made to
-// do so.
-//
-Bsdf *MaterialWrapper::get_bsdf (const Intersect &isec,
-				 const TexCoords &tex_coords)
+bool
+MaterialWrapper::get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			   Bsdf &bsdf)
   const
 {
-  return material->get_bsdf (isec, tex_coords);
+  return material->get_bsdf (isec, tex_coords, bsdf);
 }
 
 // Return the medium of this material (used only for refraction).
@@ -105,3 +97,17 @@ MaterialWrapper::add_light_samplers (
 {
   material->add_light_samplers (primitive, samplers);
 }
+
+// If this is a light-emitting material, call MESH's
+// Mesh::add_light_samplers method with PART and an appropriate
+// intensity to add a Light::Sampler for the triangles in mesh part
+// PART to SAMPLERS (for non-light-emitting materials, do nothing).
+//
+void
+MaterialWrapper::add_light_samplers (
+		   const Mesh &mesh, unsigned part,
+		   std::vector<const Light::Sampler *> &samplers)
+  const
+{
+  material->add_light_samplers (mesh, part, samplers);
+}
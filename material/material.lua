@@ -21,8 +21,16 @@ local raw = require "snogray.snograw"
 local color = require 'snogray.color'
 
 local texture = require 'snogray.texture'
-local color_tex_val = texture.color_tex_val
-local float_tex_val = texture.float_tex_val
+
+-- Textures used directly by materials are compiled, as that's where
+-- texture trees are complete.
+--
+local function color_tex_val (val)
+   return texture.color_tex_val (texture.compile (val))
+end
+local function float_tex_val (val)
+   return texture.float_tex_val (texture.compile (val))
+end
 
 
 ----------------------------------------------------------------
@@ -72,7 +80,7 @@ local function postproc_material (mat, params)
 	 elseif not texture.is_float_tex (bump) then
 	    error ("Invalid bump map "..tostring(bump))
 	 end
-	 mat.bump_map = bump
+	 mat.bump_map = texture.compile (bump)
       end
 
       -- opacity (alpha transparency)
@@ -31,121 +31,100 @@ Mirror::Mirror (const Ior &_ior,
 { }
 
 
-namespace { // keep local to file
-
-class MirrorBsdf : public Bsdf
+// Add a mirror lobe to BSDF for this material instantiated at ISEC,
+// followed by the lobes of the underlying material, if any.
+//
+bool
+Mirror::get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+		  Bsdf &bsdf)
+  const
 {
-public:
-
-  MirrorBsdf (const Mirror &_mirror,
-	      const Intersect &_isec, const TexCoords &tex_coords)
-    : Bsdf (_isec),
-      underlying_bsdf (_mirror.underlying_material
-		       ? _mirror.underlying_material->get_bsdf (_isec,
-								tex_coords)
-		       : 0),
-      fres (isec.media.medium.ior, _mirror.ior),
-      reflectance (_mirror.reflectance.eval (tex_coords))
-  { }
-
-  // Return a sample of this BSDF, based on the parameter PARAM.
-  //
-  virtual Sample sample (const UV &param, unsigned flags) const
-  {
-    if ((flags & (SPECULAR|REFLECTIVE)) == (SPECULAR|REFLECTIVE))
-      {
-	// The cosine of the angle between the reflected ray and the
-	// surface normal.  For reflection this angle is the same as the
-	// angle between the view ray and the normal.
-	//
-	float cos_refl_angle = isec.cos_n (isec.v);
-
-	if (cos_refl_angle != 0)
-	  {
-	    // Generate specular sample.
-	    //
-	    Color refl
-	      = (reflectance
-		 * fres.reflectance (cos_refl_angle) / cos_refl_angle);
-
-	    if (refl > Eps && isec.cos_geom_n (isec.v) > 0 /* XXX ?? XXX ??  */)
-	      return Sample (refl, 1, isec.v.mirror (Vec (0, 0, 1)), 
-			     SPECULAR|REFLECTIVE);
-	    else if (underlying_bsdf)
-	      {
-		// We have an underlying BSDF, so generate a sample from that.
-		//
-		Sample samp = underlying_bsdf->sample (param, flags);
-
-		// Tweak the result.
-		//
-		samp.val *= remove_specular_reflection (samp.dir);
-
-		return samp;
-	      }
-	  }
-      }
-
-    return Sample ();
-  }
-
-  // Evaluate this BSDF in direction DIR, and return its value and pdf.
-  // If FLAGS is specified, then only the given types of surface
-  // interaction are considered.
-  //
-  virtual Value eval (const Vec &, unsigned) const
-  {
-    return Value ();		// we're specular, so all samples fail
-  }
-
-  // Return a bitmask of flags from Bsdf::Flags, describing what
-  // types of scatting this BSDF supports.  The returned value will
-  // include only flags in LIMIT (default, all flags).
-  //
-  // The various fields (Bsdf::ALL_LAYERS, Bsdf::ALL_DIRECTIONS) in
-  // the returned value should be consistent -- a layer flag like
-  // Bsdf::DIFFUSE should only be included if that layer is
-  // supported by one of the sample-directions
-  // (e.g. Bsdf::REFLECTIVE) in the return value, and vice-versa.
-  //
-  virtual unsigned supports (unsigned limit) const
-  {
-    unsigned flags = 0;
-    if ((limit & REFLECTIVE) && (limit & SPECULAR))
-      flags |= REFLECTIVE | SPECULAR;
-    if (underlying_bsdf)
-      flags |= underlying_bsdf->supports (limit);
-    return flags;
-  }
-
-private:
-
-  // Return an adjust factor to remove any light reflected by perfect
-  // specular reflection.
+  Bsdf::Lobe *lobe = bsdf.add_lobe (Bsdf::Lobe::MIRROR);
+  if (! lobe)
+    return false;
+
+  lobe->color = reflectance.eval (tex_coords);
+
+  // Index of refraction relative to the surrounding medium, for
+  // calculating the Fresnel term.
   //
-  Color remove_specular_reflection (const Vec &dir) const
-  {
-    float fres_refl = fres.reflectance (isec.cos_n (dir));
-    const Color refl = fres_refl * reflectance;
-    return 1 - refl;
-  }
+  float medium_ior = isec.media.medium.ior;
+  lobe->mirror.ior_n = ior.n / medium_ior;
+  lobe->mirror.ior_k = ior.k / medium_ior;
 
-  const Bsdf *underlying_bsdf;
+  if (underlying_material)
+    underlying_material->get_bsdf (isec, tex_coords, bsdf);
 
-  const Fresnel fres;
+  return true;
+}
 
-  Color reflectance;
-};
 
-} // namespace
+
+// Lobe methods
 
+// Return a sample of the mirror lobe at index LOBE in BSDF, based on
+// the parameter PARAM.
+//
+Bsdf::Sample
+Mirror::sample_lobe (const Bsdf &bsdf, unsigned lobe,
+		     const UV &param, unsigned flags)
+{
+  if ((flags & (Bsdf::SPECULAR|Bsdf::REFLECTIVE))
+      == (Bsdf::SPECULAR|Bsdf::REFLECTIVE))
+    {
+      const Intersect &isec = bsdf.isec ();
+      const Bsdf::Lobe &l = bsdf.lobe (lobe);
+      const Fresnel fres (1.f, Ior (l.mirror.ior_n, l.mirror.ior_k));
+
+      // The cosine of the angle between the reflected ray and the
+      // surface normal.  For reflection this angle is the same as the
+      // angle between the view ray and the normal.
+      //
+      float cos_refl_angle = isec.cos_n (isec.v);
+
+      if (cos_refl_angle != 0)
+	{
+	  // Generate specular sample.
+	  //
+	  Color refl
+	    = (l.color * fres.reflectance (cos_refl_angle) / cos_refl_angle);
+
+	  if (refl > Eps && isec.cos_geom_n (isec.v) > 0 /* XXX ?? XXX ??  */)
+	    return Bsdf::Sample (refl, 1, isec.v.mirror (Vec (0, 0, 1)),
+				 Bsdf::SPECULAR|Bsdf::REFLECTIVE);
+	  else if (lobe + 1 < bsdf.num_lobes ())
+	    {
+	      // We have an underlying BSDF, so generate a sample from that.
+	      //
+	      Bsdf::Sample samp = bsdf.sample_lobes (lobe + 1, param, flags);
+
+	      // Tweak the result to remove any light reflected by
+	      // perfect specular reflection.
+	      //
+	      float fres_refl = fres.reflectance (isec.cos_n (samp.dir));
+	      samp.val *= 1 - fres_refl * l.color;
+
+	      return samp;
+	    }
+	}
+    }
+
+  return Bsdf::Sample ();
+}
 
-// Make a BSDF object for this material instantiated at ISEC.
+// Return a bitmask of flags from Bsdf::Flags, describing what types
+// of scatting the mirror lobe at index LOBE in BSDF supports, which
+// includes those supported by the underlying lobes.  The returned
+// value will include only flags in LIMIT.
 //
-Bsdf *
-Mirror::get_bsdf (const Intersect &isec, const TexCoords &tex_coords) const
+unsigned
+Mirror::lobe_supports (const Bsdf &bsdf, unsigned lobe, unsigned limit)
 {
-  return new (isec) MirrorBsdf (*this, isec, tex_coords);
+  unsigned flags = 0;
+  if ((limit & Bsdf::REFLECTIVE) && (limit & Bsdf::SPECULAR))
+    flags |= Bsdf::REFLECTIVE | Bsdf::SPECULAR;
+  flags |= bsdf.lobes_support (lobe + 1, limit);
+  return flags;
 }
 
 
@@ -15,6 +15,7 @@
 
 #include "texture/tex.h"
 #include "material.h"
+#include "bsdf.h"
 #include "fresnel.h"
 
 
@@ -48,11 +49,22 @@ public:
 	  const TexVal<Color> &_reflectance,
 	  const TexVal<Color> &col = Color(0));
 
-  // Return a new BSDF object for this material instantiated at ISEC.
+  // Add lobes to BSDF for this material instantiated at ISEC, and
+  // return true, or return false if there is no BSDF.
   //
-  virtual Bsdf *get_bsdf (const Intersect &isec, const TexCoords &tex_coords)
+  virtual bool get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			 Bsdf &bsdf)
     const;
 
+  // Bsdf::sample and Bsdf::supports for the lobe at index LOBE in
+  // BSDF (see Bsdf::sample_lobes).  As this material is specular,
+  // there's no Bsdf::eval equivalent.
+  //
+  static Bsdf::Sample sample_lobe (const Bsdf &bsdf, unsigned lobe,
+				   const UV &param, unsigned flags);
+  static unsigned lobe_supports (const Bsdf &bsdf, unsigned lobe,
+				 unsigned limit);
+
 
   // Index of refraction for calculating fresnel reflection term.
   //
@@ -25,20 +25,70 @@ using namespace snogray;
 
 namespace { // keep local to file
 
-// The details of phong evaluation are in this class.
+// The details of phong evaluation are in this class, which is a
+// temporary view of a Phong lobe in a Bsdf.
 //
-class PhongBsdf : public Bsdf
+class PhongLobe
 {
 public:
 
-  PhongBsdf (const Phong &_phong, const Intersect &_isec)
-    : Bsdf (_isec), phong (_phong),
-      phong_dist (_phong.exponent), diff_dist (),
-      diff_weight (phong.color.intensity ()),
-      inv_diff_weight (diff_weight == 0 ? 0 : 1 / diff_weight),
-      inv_spec_weight (diff_weight == 1 ? 0 : 1 / (1 - diff_weight))
+  PhongLobe (const Bsdf &bsdf, unsigned lobe)
+    : isec (bsdf.isec ()),
+      diff_col (bsdf.lobe (lobe).color), spec_col (bsdf.lobe (lobe).color2),
+      params (bsdf.lobe (lobe).phong),
+      phong_dist (params.exponent), diff_dist ()
   { }
 
+  // Return a sample of this lobe, based on the parameter PARAM.
+  //
+  Bsdf::Sample sample (const UV &param, unsigned desired_flags) const
+  {
+    Vec l, h;
+    unsigned flags = Bsdf::REFLECTIVE;
+    float u = param.u, v = param.v;
+
+    if (u < params.diff_weight)
+      {
+	float scaled_u = u * params.inv_diff_weight;
+	l = diff_dist.sample (UV (scaled_u, v));
+	h = (isec.v + l).unit ();
+      }
+    else
+      {
+	float scaled_u = (u - params.diff_weight) * params.inv_spec_weight;
+	h = phong_dist.sample (UV (scaled_u, v));
+	if (isec.cos_v (h) < 0)
+	  h = -h;
+	l = isec.v.mirror (h);
+      }
+
+    if (isec.cos_n (l) > Epsf && isec.cos_geom_n (l) > Epsf)
+      {
+	float pdf;
+	Color f = val (l, h, pdf, desired_flags);
+	return Bsdf::Sample (f, pdf, l, flags);
+      }
+
+    return Bsdf::Sample (0, 0, l, flags);
+  }
+
+  // Evaluate this lobe in direction DIR, and return its value and
+  // pdf.  Only the types of surface interaction in FLAGS are
+  // considered.
+  //
+  Bsdf::Value eval (const Vec &dir, unsigned flags) const
+  {
+    float cos_n = isec.cos_n (dir);
+    if ((flags & Bsdf::REFLECTIVE) && cos_n > 0)
+      {
+	const Vec h = (isec.v + dir).unit ();
+	float pdf;
+	Color f = val (dir, h, pdf, flags);
+	return Bsdf::Value (f, pdf);
+      }
+    return Bsdf::Value ();
+  }
+
 private:
 
   // Return the phong reflectance for the sample in direction L, where H
@@ -52,16 +102,16 @@ private:
     Color col = 0;
     pdf = 0;
 
-    if (flags & DIFFUSE)
+    if (flags & Bsdf::DIFFUSE)
       {
 	float diff = INV_PIf;
 	float diff_pdf = diff_dist.pdf (nl);
 
-	pdf += diff_pdf * diff_weight;
-	col += phong.color * diff;
+	pdf += diff_pdf * params.diff_weight;
+	col += diff_col * diff;
       }
 
-    if (flags & GLOSSY)
+    if (flags & Bsdf::GLOSSY)
       {
 	float nh = isec.cos_n (h);
 
@@ -80,110 +130,94 @@ private:
 	float spec = phong_dist.pdf (nh);
 	float spec_pdf = spec / (4 * vh);
 
-	pdf += spec_pdf * (1 - diff_weight);
-	col += phong.specular_color * spec;
+	pdf += spec_pdf * (1 - params.diff_weight);
+	col += spec_col * spec;
       }
 
     return col;
   }
 
-  // Return a sample of this BSDF, based on the parameter PARAM.
-  //
-  virtual Sample sample (const UV &param, unsigned desired_flags = ALL) const
-  {
-    Vec l, h;
-    unsigned flags = REFLECTIVE;
-    float u = param.u, v = param.v;
-
-    if (u < diff_weight)
-      {
-	float scaled_u = u * inv_diff_weight;
-	l = diff_dist.sample (UV (scaled_u, v));
-	h = (isec.v + l).unit ();
-      }
-    else
-      {
-	float scaled_u = (u - diff_weight) * inv_spec_weight;
-	h = phong_dist.sample (UV (scaled_u, v));
-	if (isec.cos_v (h) < 0)
-	  h = -h;
-	l = isec.v.mirror (h);
-      }
-
-
-    if (isec.cos_n (l) > Epsf && isec.cos_geom_n (l) > Epsf)
-      {
-	float pdf;
-	Color f = val (l, h, pdf, desired_flags);
-	return Sample (f, pdf, l, flags);
-      }
-
-    fail:
-      return Sample (0, 0, l, flags);
-  }
-
-  // Evaluate this BSDF in direction DIR, and return its value and pdf.
-  // If FLAGS is specified, then only the given types of surface
-  // interaction are considered.
-  //
-  virtual Value eval (const Vec &dir, unsigned flags) const
-  {
-    float cos_n = isec.cos_n (dir);
-    if ((flags & REFLECTIVE) && cos_n > 0)
-      {
-	const Vec h = (isec.v + dir).unit ();
-	float pdf;
-	Color f = val (dir, h, pdf, flags);
-	return Value (f, pdf);
-      }
-    return Value ();
-  }
+  const Intersect &isec;
 
-  // Return a bitmask of flags from Bsdf::Flags, describing what
-  // types of scatting this BSDF supports.  The returned value will
-  // include only flags in LIMIT (default, all flags).
-  //
-  // The various fields (Bsdf::ALL_LAYERS, Bsdf::ALL_DIRECTIONS) in
-  // the returned value should be consistent -- a layer flag like
-  // Bsdf::DIFFUSE should only be included if that layer is
-  // supported by one of the sample-directions
-  // (e.g. Bsdf::REFLECTIVE) in the return value, and vice-versa.
+  // Color of diffuse and specular components.
   //
-  virtual unsigned supports (unsigned limit) const
-  {
-    return
-      ((limit & REFLECTIVE) && (limit & (DIFFUSE | GLOSSY)))
-      ? ((REFLECTIVE | DIFFUSE | GLOSSY) & limit)
-      : 0;
-  }
+  const Color &diff_col, &spec_col;
 
-  const Phong &phong;
+  const Bsdf::PhongParams &params;
 
   // Sample distributions for specular and diffuse components.
   //
   const PhongDist phong_dist;
   const CosDist diff_dist;
+};
+
+} // namespace
+
+
+// Add a phong lobe to BSDF for this material instantiated at ISEC.
+//
+bool
+Phong::get_bsdf (const Intersect &, const TexCoords &, Bsdf &bsdf) const
+{
+  Bsdf::Lobe *lobe = bsdf.add_lobe (Bsdf::Lobe::PHONG);
+  if (! lobe)
+    return false;
+
+  Bsdf::PhongParams &params = lobe->phong;
+
+  lobe->color = color;
+  lobe->color2 = specular_color;
 
   // Weight used for sampling diffuse component (0 = don't sample
-  // diffuse at all, 1 = only sample diffuse).  The "specular" component
-  // has a weight of (1 - DIFF_WEIGHT).
+  // diffuse at all, 1 = only sample diffuse).  The "specular"
+  // component has a weight of (1 - DIFF_WEIGHT).
   //
-  float diff_weight;
+  float diff_weight = color.intensity ();
 
-  // 1 / DIFF_WEIGHT, and 1 / (1 - DIFF_WEIGHT).
-  //
-  float inv_diff_weight, inv_spec_weight;
-};
+  params.exponent = exponent;
+  params.diff_weight = diff_weight;
+  params.inv_diff_weight = diff_weight == 0 ? 0 : 1 / diff_weight;
+  params.inv_spec_weight = diff_weight == 1 ? 0 : 1 / (1 - diff_weight);
 
-} // namespace
+  return true;
+}
+
+
+
+// Lobe methods
+
+// Return a sample of the phong lobe at index LOBE in BSDF, based on
+// the parameter PARAM.
+//
+Bsdf::Sample
+Phong::sample_lobe (const Bsdf &bsdf, unsigned lobe,
+		    const UV &param, unsigned flags)
+{
+  return PhongLobe (bsdf, lobe).sample (param, flags);
+}
 
+// Evaluate the phong lobe at index LOBE in BSDF in direction DIR, and
+// return its value and pdf.  Only the types of surface interaction in
+// FLAGS are considered.
+//
+Bsdf::Value
+Phong::eval_lobe (const Bsdf &bsdf, unsigned lobe,
+		  const Vec &dir, unsigned flags)
+{
+  return PhongLobe (bsdf, lobe).eval (dir, flags);
+}
 
-// Make a BSDF object for this material instantiated at ISEC.
+// Return a bitmask of flags from Bsdf::Flags, describing what types
+// of scatting the phong lobe at index LOBE in BSDF supports.  The
+// returned value will include only flags in LIMIT.
 //
-Bsdf *
-Phong::get_bsdf (const Intersect &isec, const TexCoords &tex_coords) const
+unsigned
+Phong::lobe_supports (const Bsdf &, unsigned, unsigned limit)
 {
-  return new (isec) PhongBsdf (*this, isec);
+  return
+    ((limit & Bsdf::REFLECTIVE) && (limit & (Bsdf::DIFFUSE | Bsdf::GLOSSY)))
+    ? ((Bsdf::REFLECTIVE | Bsdf::DIFFUSE | Bsdf::GLOSSY) & limit)
+    : 0;
 }
 
 
@@ -21,132 +21,131 @@
 using namespace snogray;
 
 
-namespace { // keep local to file
-
-// Stencil BSDF representing the stencil at a particular intersection.
+// Add lobes to BSDF for this material instantiated at ISEC:  a stencil
+// lobe, followed by the lobes of the underlying material.
 //
-class StencilBsdf : public Bsdf
+bool
+Stencil::get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+		   Bsdf &bsdf)
+  const
 {
-public:
-
-  StencilBsdf (const Color &_opacity, Bsdf *_underlying_bsdf,
-	       const Intersect &isec)
-    : Bsdf (isec),
-      opacity (_opacity),
-      opacity_intens (_opacity.intensity ()),
-      inv_opacity_intens (opacity_intens == 0 ? 0 : 1 / opacity_intens),
-      underlying_bsdf (_underlying_bsdf)
-  {
-    // When nearly opaque or nearly transparent, use full
-    // opacity/transparency instead, which can be substantially more
-    // efficient.  Doing it here allows other code to not worry about
-    // such details.
-    //
-    if (opacity_intens < 0.001f)
-      opacity_intens = inv_opacity_intens = 0;
-    else if (opacity_intens > 0.999f)
-      opacity_intens = inv_opacity_intens = 1;
-  }
-
-  // Return a sample of this BSDF, based on the parameter PARAM.
-  //
-  virtual Sample sample (const UV &param, unsigned flags) const
-  {
-    bool thru_ok
-      = ((opacity_intens < 1)
-	 && ((flags & (TRANSMISSIVE|SPECULAR)) == (TRANSMISSIVE|SPECULAR)));
-    bool undl_ok
-      = ((opacity_intens > 0)
-	 && underlying_bsdf
-	 && underlying_bsdf->supports (flags));
-
-    if (!thru_ok && !undl_ok)
-      return Sample ();
-    else if (! thru_ok)
-      return underlying_bsdf->sample (param, flags);
-    else if (! undl_ok || param.u > opacity_intens)
-      {
-	float cos_n = isec.cos_n (isec.v);
-	if (unlikely (cos_n == 0))
-	  return Sample ();
-	else
-	  return Sample ((1 - opacity) / cos_n,
-			 undl_ok ? 1 - opacity_intens : 1,
-			 -isec.v,
-			 SPECULAR|TRANSMISSIVE|TRANSLUCENT);
-      }
-    else
-      {
-	UV scaled_param (param.u * inv_opacity_intens, param.v);
-	Sample samp = underlying_bsdf->sample (scaled_param, flags);
-	samp.val *= opacity;
-	samp.pdf *= inv_opacity_intens;
-	return samp;
-      }
-  }
-
-  // Evaluate this BSDF in direction DIR, and return its value and pdf.
-  // If FLAGS is specified, then only the given types of surface
-  // interaction are considered.
-  //
-  virtual Value eval (const Vec &dir, unsigned flags) const
-  {
-    if (underlying_bsdf)
-      {
-	Value val = underlying_bsdf->eval (dir, flags);
-	val.val *= opacity;
-	val.pdf *= inv_opacity_intens;
-	return val;
-      }
-    return Value ();
-  }
-
-  // Return a bitmask of flags from Bsdf::Flags, describing what
-  // types of scatting this BSDF supports.  The returned value will
-  // include only flags in LIMIT (default, all flags).
+  Color opac = opacity.eval (tex_coords);
+
+  // This is a common situation, so it's worth optimizing for it.
   //
-  // The various fields (Bsdf::ALL_LAYERS, Bsdf::ALL_DIRECTIONS) in
-  // the returned value should be consistent -- a layer flag like
-  // Bsdf::DIFFUSE should only be included if that layer is
-  // supported by one of the sample-directions
-  // (e.g. Bsdf::REFLECTIVE) in the return value, and vice-versa.
+  if (opac >= 1)
+    return underlying_material->get_bsdf (isec, tex_coords, bsdf);
+
+  Bsdf::Lobe *lobe = bsdf.add_lobe (Bsdf::Lobe::STENCIL);
+  if (! lobe)
+    return false;
+
+  float opacity_intens = opac.intensity ();
+  float inv_opacity_intens = opacity_intens == 0 ? 0 : 1 / opacity_intens;
+
+  // When nearly opaque or nearly transparent, use full
+  // opacity/transparency instead, which can be substantially more
+  // efficient.  Doing it here allows other code to not worry about
+  // such details.
   //
-  virtual unsigned supports (unsigned limit) const
-  {
-    unsigned flags = 0;
-    if (opacity > 0)
-      flags |= underlying_bsdf->supports (limit);
-    if (opacity < 1)
-      flags |= TRANSMISSIVE|SPECULAR;
-    return flags;
-  }
+  if (opacity_intens < 0.001f)
+    opacity_intens = inv_opacity_intens = 0;
+  else if (opacity_intens > 0.999f)
+    opacity_intens = inv_opacity_intens = 1;
+
+  lobe->color = opac;
+  lobe->stencil.opacity_intens = opacity_intens;
+  lobe->stencil.inv_opacity_intens = inv_opacity_intens;
 
-private:
+  underlying_material->get_bsdf (isec, tex_coords, bsdf);
 
-  Color opacity;
-  float opacity_intens, inv_opacity_intens;
-  Bsdf *underlying_bsdf;
-};
+  return true;
+}
 
-} // namespace
 
+
+// Lobe methods
 
-// Return a new BSDF object for this material instantiated at ISEC.
+// Return a sample of the stencil lobe at index LOBE in BSDF, based on
+// the parameter PARAM.
 //
-Bsdf *
-Stencil::get_bsdf (const Intersect &isec, const TexCoords &tex_coords) const
+Bsdf::Sample
+Stencil::sample_lobe (const Bsdf &bsdf, unsigned lobe,
+		      const UV &param, unsigned flags)
 {
-  Color opac = opacity.eval (tex_coords);
-  Bsdf *underlying_bsdf = underlying_material->get_bsdf (isec, tex_coords);
-  
-  // This is a common situation, so it's worth optimizing for it.
-  //
-  if (opac >= 1)
-    return underlying_bsdf;
+  const Bsdf::Lobe &l = bsdf.lobe (lobe);
+  const Color &opacity = l.color;
+  float opacity_intens = l.stencil.opacity_intens;
+
+  bool thru_ok
+    = ((opacity_intens < 1)
+       && ((flags & (Bsdf::TRANSMISSIVE|Bsdf::SPECULAR))
+	   == (Bsdf::TRANSMISSIVE|Bsdf::SPECULAR)));
+  bool undl_ok
+    = ((opacity_intens > 0)
+       && bsdf.lobes_support (lobe + 1, flags));
+
+  if (!thru_ok && !undl_ok)
+    return Bsdf::Sample ();
+  else if (! thru_ok)
+    return bsdf.sample_lobes (lobe + 1, param, flags);
+  else if (! undl_ok || param.u > opacity_intens)
+    {
+      const Intersect &isec = bsdf.isec ();
+      float cos_n = isec.cos_n (isec.v);
+      if (unlikely (cos_n == 0))
+	return Bsdf::Sample ();
+      else
+	return Bsdf::Sample ((1 - opacity) / cos_n,
+			     undl_ok ? 1 - opacity_intens : 1,
+			     -isec.v,
+			     Bsdf::SPECULAR|Bsdf::TRANSMISSIVE
+			     |Bsdf::TRANSLUCENT);
+    }
+  else
+    {
+      float inv_opacity_intens = l.stencil.inv_opacity_intens;
+      UV scaled_param (param.u * inv_opacity_intens, param.v);
+      Bsdf::Sample samp = bsdf.sample_lobes (lobe + 1, scaled_param, flags);
+      samp.val *= opacity;
+      samp.pdf *= inv_opacity_intens;
+      return samp;
+    }
+}
+
+// Evaluate the stencil lobe at index LOBE in BSDF in direction DIR,
+// and return its value and pdf.  Only the types of surface interaction
+// in FLAGS are considered.
+//
+Bsdf::Value
+Stencil::eval_lobe (const Bsdf &bsdf, unsigned lobe,
+		    const Vec &dir, unsigned flags)
+{
+  const Bsdf::Lobe &l = bsdf.lobe (lobe);
+  Bsdf::Value val = bsdf.eval_lobes (lobe + 1, dir, flags);
+  val.val *= l.color;
+  val.pdf *= l.stencil.inv_opacity_intens;
+  return val;
+}
 
-  return new (isec) StencilBsdf (opac, underlying_bsdf, isec);
+// Return a bitmask of flags from Bsdf::Flags, describing what types
+// of scatting the stencil lobe at index LOBE in BSDF supports, which
+// includes those supported by the underlying lobes.  The returned
+// value will include only flags in LIMIT.
+//
+unsigned
+Stencil::lobe_supports (const Bsdf &bsdf, unsigned lobe, unsigned limit)
+{
+  const Color &opacity = bsdf.lobe (lobe).color;
+  unsigned flags = 0;
+  if (opacity > 0)
+    flags |= bsdf.lobes_support (lobe + 1, limit);
+  if (opacity < 1)
+    flags |= Bsdf::TRANSMISSIVE|Bsdf::SPECULAR;
+  return flags;
 }
 
+
 // Return the transmittance of this material at the intersection
 // described by ISEC_INFO in medium MEDIUM.
 //
@@ -15,6 +15,7 @@
 
 #include "texture/tex.h"
 #include "material.h"
+#include "bsdf.h"
 
 
 namespace snogray {
@@ -35,11 +36,23 @@ public:
     bump_map = _underlying_material->bump_map;
   }
 
-  // Return a new BSDF object for this material instantiated at ISEC.
+  // Add lobes to BSDF for this material instantiated at ISEC, and
+  // return true, or return false if there is no BSDF.
   //
-  virtual Bsdf *get_bsdf (const Intersect &isec, const TexCoords &tex_coords)
+  virtual bool get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			 Bsdf &bsdf)
     const;
 
+  // Bsdf::sample, Bsdf::eval, and Bsdf::supports for the lobe at index
+  // LOBE in BSDF (see Bsdf::sample_lobes).
+  //
+  static Bsdf::Sample sample_lobe (const Bsdf &bsdf, unsigned lobe,
+				   const UV &param, unsigned flags);
+  static Bsdf::Value eval_lobe (const Bsdf &bsdf, unsigned lobe,
+				const Vec &dir, unsigned flags);
+  static unsigned lobe_supports (const Bsdf &bsdf, unsigned lobe,
+				 unsigned limit);
+
   // Return the transmittance of this material at the intersection
   // described by ISEC_INFO, with texture-coordinates TEX_COORDS, in
   // medium MEDIUM.
@@ -20,98 +20,83 @@
 using namespace snogray;
 
 
-namespace { // keep local to file
-
-// Common information used for refraction methods.
+// Add a thin-glass lobe to BSDF for this material instantiated at
+// ISEC.
 //
-class ThinGlassBsdf : public Bsdf
+bool
+ThinGlass::get_bsdf (const Intersect &isec, const TexCoords &,
+		     Bsdf &bsdf)
+  const
 {
-public:
+  Bsdf::Lobe *lobe = bsdf.add_lobe (Bsdf::Lobe::THIN_GLASS);
+  if (! lobe)
+    return false;
 
-  ThinGlassBsdf (const ThinGlass &_thin_glass, const Intersect &isec)
-    : Bsdf (isec), thin_glass (_thin_glass)
-  { }
+  lobe->color = color;
 
-  // Return a sample of this BSDF, based on the parameter PARAM.
-  //
-  virtual Sample sample (const UV &param, unsigned flags) const
-  {
-    if (flags & SPECULAR)
-      {
-	// Clear all but the direction flags.  This means it will be
-	// either REFLECTIVE, TRANSMISSIVE, or REFLECTIVE|TRANSMISSIVE.
-	//
-	flags &= ALL_DIRECTIONS;
-
-	// Calculate fresnel surface reflection at the ray angle
-	//
-	float cos_xmit_angle = isec.cos_n (isec.v);
-	float medium_ior = isec.media.medium.ior;
-	float refl
-	  = Fresnel (medium_ior, thin_glass.ior).reflectance (cos_xmit_angle);
-
-	// Render transmitted light (some light is lost due to fresnel
-	// reflection from the back surface).
-	//
-	Color xmit = thin_glass.color * (1 - refl);
-
-	// If we're only allowed to choose a single direction, always
-	// return that, otherwise choose between them based on their
-	// relative strengths.
-	//
-	if (flags == TRANSMISSIVE || param.u < (xmit / (xmit + refl)))
-	  // Transmitted sample.
-	  return Sample (xmit, 1, -isec.v, SPECULAR|TRANSMISSIVE);
-	else
-	  // Reflected sample.
-	  return Sample (refl, 1, isec.v.mirror (Vec (0, 0, 1)),
-			 SPECULAR|REFLECTIVE);
-      }
-
-    return Sample ();
-  }
-
-  // Evaluate this BSDF in direction DIR, and return its value and pdf.
-  // If FLAGS is specified, then only the given types of surface
-  // interaction are considered.
+  // Index of refraction relative to the surrounding medium.
   //
-  virtual Value eval (const Vec &, unsigned) const
-  {
-    return Value ();		// we're specular, so all samples fail
-  }
-
-  // Return a bitmask of flags from Bsdf::Flags, describing what
-  // types of scatting this BSDF supports.  The returned value will
-  // include only flags in LIMIT (default, all flags).
-  //
-  // The various fields (Bsdf::ALL_LAYERS, Bsdf::ALL_DIRECTIONS) in
-  // the returned value should be consistent -- a layer flag like
-  // Bsdf::DIFFUSE should only be included if that layer is
-  // supported by one of the sample-directions
-  // (e.g. Bsdf::REFLECTIVE) in the return value, and vice-versa.
-  //
-  virtual unsigned supports (unsigned limit) const
-  {
-    return
-      (limit & SPECULAR)
-      ? (TRANSMISSIVE | REFLECTIVE | SPECULAR) & limit
-      : 0;
-  }
-
-private:
+  lobe->thin_glass.ior = ior / isec.media.medium.ior;
 
-  const ThinGlass &thin_glass;
-};
-
-} // namespace
+  return true;
+}
 
+// Return a sample of the thin-glass lobe at index LOBE in BSDF, based
+// on the parameter PARAM.
+//
+Bsdf::Sample
+ThinGlass::sample_lobe (const Bsdf &bsdf, unsigned lobe,
+			const UV &param, unsigned flags)
+{
+  if (flags & Bsdf::SPECULAR)
+    {
+      const Intersect &isec = bsdf.isec ();
+      const Bsdf::Lobe &l = bsdf.lobe (lobe);
+
+      // Clear all but the direction flags.  This means it will be
+      // either REFLECTIVE, TRANSMISSIVE, or REFLECTIVE|TRANSMISSIVE.
+      //
+      flags &= Bsdf::ALL_DIRECTIONS;
+
+      // Calculate fresnel surface reflection at the ray angle
+      //
+      float cos_xmit_angle = isec.cos_n (isec.v);
+      float refl
+	= Fresnel (1.f, l.thin_glass.ior).reflectance (cos_xmit_angle);
+
+      // Render transmitted light (some light is lost due to fresnel
+      // reflection from the back surface).
+      //
+      Color xmit = l.color * (1 - refl);
+
+      // If we're only allowed to choose a single direction, always
+      // return that, otherwise choose between them based on their
+      // relative strengths.
+      //
+      if (flags == Bsdf::TRANSMISSIVE || param.u < (xmit / (xmit + refl)))
+	// Transmitted sample.
+	return Bsdf::Sample (xmit, 1, -isec.v,
+			     Bsdf::SPECULAR|Bsdf::TRANSMISSIVE);
+      else
+	// Reflected sample.
+	return Bsdf::Sample (refl, 1, isec.v.mirror (Vec (0, 0, 1)),
+			     Bsdf::SPECULAR|Bsdf::REFLECTIVE);
+    }
+
+  return Bsdf::Sample ();
+}
 
-// Return a new BSDF object for this material instantiated at ISEC.
+// Return a bitmask of flags from Bsdf::Flags, describing what types
+// of scatting the thin-glass lobe at index LOBE in BSDF supports.
+// The returned value will include only flags in LIMIT.
 //
-Bsdf *
-ThinGlass::get_bsdf (const Intersect &isec, const TexCoords &) const
+unsigned
+ThinGlass::lobe_supports (const Bsdf &, unsigned, unsigned limit)
 {
-  return new (isec) ThinGlassBsdf (*this, isec);
+  return
+    (limit & Bsdf::SPECULAR)
+    ? (Bsdf::TRANSMISSIVE | Bsdf::REFLECTIVE | Bsdf::SPECULAR) & limit
+    : 0;
 }
 
 
@@ -40,14 +40,17 @@ XformMaterial::XformMaterial (const Xform &_xform,
       = new XformTex<float> (xform, TexVal<float> (material->bump_map));
 }
 
-// Return a new BSDF object for this material instantiated at ISEC.
+// Add lobes to BSDF for this material instantiated at ISEC, and return
+// true, or return false if there is no BSDF.
 //
-Bsdf *
-XformMaterial::get_bsdf (const Intersect &isec, const TexCoords &tex_coords)
+bool
+XformMaterial::get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			 Bsdf &bsdf)
   const
 {
-  TexCoords xf_tex_coords (xform (tex_coords.pos), xform (tex_coords.uv));
-  return material->get_bsdf (isec, xf_tex_coords);
+  TexCoords xf_tex_coords
+    = tex_coords.with_xformed (xform);
+  return material->get_bsdf (isec, xf_tex_coords, bsdf);
 }
 
 // Return the transmittance of this material at the intersection
@@ -66,7 +69,8 @@ XformMaterial::transmittance (const Surface::Renderable::IsecInfo &isec_info,
 			      const Medium &medium)
   const
 {
-  TexCoords xf_tex_coords (xform (tex_coords.pos), xform (tex_coords.uv));
+  TexCoords xf_tex_coords
+    = tex_coords.with_xformed (xform);
   return material->transmittance (isec_info, xf_tex_coords, medium);
 }
 
@@ -83,14 +87,17 @@ XformMaterialUV::XformMaterialUV (const Xform &_xform,
       = new XformTexUV<float> (xform, TexVal<float> (material->bump_map));
 }
 
-// Return a new BSDF object for this material instantiated at ISEC.
+// Add lobes to BSDF for this material instantiated at ISEC, and return
+// true, or return false if there is no BSDF.
 //
-Bsdf *
-XformMaterialUV::get_bsdf (const Intersect &isec, const TexCoords &tex_coords)
+bool
+XformMaterialUV::get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			   Bsdf &bsdf)
   const
 {
-  TexCoords xf_tex_coords (tex_coords.pos, xform (tex_coords.uv));
-  return material->get_bsdf (isec, xf_tex_coords);
+  TexCoords xf_tex_coords
+    = tex_coords.with_xformed_uv (xform);
+  return material->get_bsdf (isec, xf_tex_coords, bsdf);
 }
 
 // Return the transmittance of this material at the intersection
@@ -109,7 +116,8 @@ XformMaterialUV::transmittance (const Surface::Renderable::IsecInfo &isec_info,
 				const Medium &medium)
   const
 {
-  TexCoords xf_tex_coords (tex_coords.pos, xform (tex_coords.uv));
+  TexCoords xf_tex_coords
+    = tex_coords.with_xformed_uv (xform);
   return material->transmittance (isec_info, xf_tex_coords, medium);
 }
 
@@ -126,14 +134,17 @@ XformMaterialPos::XformMaterialPos (const Xform &_xform,
       = new XformTexPos<float> (xform, TexVal<float> (material->bump_map));
 }
 
-// Return a new BSDF object for this material instantiated at ISEC.
+// Add lobes to BSDF for this material instantiated at ISEC, and return
+// true, or return false if there is no BSDF.
 //
-Bsdf *
-XformMaterialPos::get_bsdf (const Intersect &isec, const TexCoords &tex_coords)
+bool
+XformMaterialPos::get_bsdf (const Intersect &isec, const TexCoords &tex_coords,
+			    Bsdf &bsdf)
   const
 {
-  TexCoords xf_tex_coords (xform (tex_coords.pos), tex_coords.uv);
-  return material->get_bsdf (isec, xf_tex_coords);
+  TexCoords xf_tex_coords (tex_coords);
+  xf_tex_coords.pos = xform (tex_coords.pos);
+  return material->get_bsdf (isec, xf_tex_coords, bsdf);
 }
 
 // Return the transmittance of this material at the intersection
@@ -152,6 +163,7 @@ XformMaterialPos::transmittance (const Surface::Renderable::IsecInfo &isec_info,
 				 const Medium &medium)
   const
 {
-  TexCoords xf_tex_coords (xform (tex_coords.pos), tex_coords.uv);
+  TexCoords xf_tex_coords (tex_coords);
+  xf_tex_coords.pos = xform (tex_coords.pos);
   return material->transmittance (isec_info, xf_tex_coords, medium);
 }
@@ -22,6 +22,7 @@
 
 #include "cli/tty-progress.h"
 #include "util/string-funs.h"
+#include "util/phase-profile.h"
 
 #include "photon-shooter.h"
 
@@ -43,6 +44,8 @@ PhotonShooter::shoot (const GlobalRenderState &global_render_state)
   if (light_samplers.size () == 0)
     return;			// no lights, so no point
 
+  PhaseProfile::Phase phase ("photon shooting");
+
   TtyProgress prog (std::cout, "* " + name + ": shooting photons...");
 
   prog.set_size (target_count ());
@@ -28,10 +28,13 @@ Renderer::Renderer (const GlobalRenderState &_global_state,
   : camera (_camera), width (_width), height (_height),
     context (_global_state),
     camera_samples (context.samples.add_channel<UV> ()),
-    focus_samples (context.samples.add_channel<UV> ()),
-    per_pixel_random_seeds (
-      _global_state.params.get_bool ("per_pixel_random_seeds", false))
+    focus_samples (context.samples.add_channel<UV> ())
 {
+  // Every renderer uses the same seed, so that the random-number
+  // streams chosen below depend only on the pixel and sample, and not
+  // on which renderer (i.e., which thread) renders them.
+  //
+  context.random.seed (_global_state.params.get_uint ("seed", 0));
 }
 
 
@@ -57,17 +60,20 @@ Renderer::render_packet (RenderPacket &packet)
        pi != packet.pixels.end (); ++pi)
     {
       UV pixel = *pi;
+      unsigned px = unsigned (pixel.u), py = unsigned (pixel.v);
 
-      if (per_pixel_random_seeds)
-	{
-	  unsigned seed = unsigned (pixel.u) * 57123 + unsigned (pixel.v);
-	  context.random.seed (seed);
-	}
+      // Use a separate random-number stream for every pixel, and every
+      // sample within it, so the result for a pixel doesn't depend on
+      // which thread renders it, or on what was rendered before it.
+      //
+      context.random.set_stream (px, py, 0);
 
       samples.generate ();
 
       for (unsigned snum = 0; snum < samples.num_samples; snum++)
 	{
+	  context.random.set_stream (px, py, snum + 1);
+
 	  SampleSet::Sample sample (samples, snum);
 
 	  UV camera_samp = sample.get (camera_samples);
@@ -88,6 +94,15 @@ Renderer::render_packet (RenderPacket &packet)
 	  //
 	  Ray camera_ray = camera.eye_ray (film_loc, focus_samp, max_trace);
 
+	  // Give CAMERA_RAY a ray cone roughly covering one pixel, so
+	  // that texture lookups for the surfaces it hits can filter
+	  // accordingly.  The cone is circular, so we use the larger of
+	  // the pixel's width and height.
+	  //
+	  camera_ray.cone_spread
+	    = max (camera.eye_ray_spread (film_loc, UV (1.f / width, 0)),
+		   camera.eye_ray_spread (film_loc, UV (0, 1.f / height)));
+
 	  // .. calculate what light arrives via that ray.
 	  //
 	  Tint tint = surface_integ.Li (camera_ray, media, sample);
@@ -0,0 +1,820 @@
+// bdpt-integ.cc -- Bidirectional path-tracing surface integrator
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "material/bsdf.h"
+#include "material/media.h"
+#include "scene.h"
+#include "global-render-state.h"
+
+#include "bdpt-integ.h"
+
+
+using namespace snogray;
+
+
+
+// Constructors etc
+
+BdptInteg::GlobalState::GlobalState (const GlobalRenderState &rstate,
+				     const ValTable &params)
+  : SurfaceInteg::GlobalState (rstate),
+    min_path_len (params.get_uint ("min_path_len", 3)),
+    max_path_len (params.get_uint ("max_path_len", 5)),
+    scene_radius (rstate.scene.bbox ().radius ())
+{
+  const std::vector<const Light::Sampler *> &lights
+    = rstate.scene.light_samplers;
+
+  std::vector<float> powers;
+  powers.reserve (lights.size ());
+  for (std::vector<const Light::Sampler *>::const_iterator li
+	 = lights.begin ();
+       li != lights.end (); ++li)
+    powers.push_back ((*li)->power ());
+
+  light_dist.set_weights (powers);
+
+  for (unsigned i = 0; i < lights.size (); i++)
+    if (! light_dist.empty () && light_dist.pdf (i) > 0)
+      {
+	if (lights[i]->is_environ_light ())
+	  environ_lights.push_back (i);
+	else if (! lights[i]->is_point_light ())
+	  area_lights.push_back (i);
+      }
+}
+
+// Integrator state for rendering a group of related samples.
+//
+BdptInteg::BdptInteg (RenderContext &context, GlobalState &global_state)
+  : SurfaceInteg (context),
+    global (global_state),
+    light_select_chan (context.samples.add_channel<float> ()),
+    light_pos_chan (context.samples.add_channel<UV> ()),
+    light_dir_chan (context.samples.add_channel<UV> ())
+{
+  for (unsigned i = 0; i < global.min_path_len; i++)
+    {
+      light_bsdf_channels.push_back (context.samples.add_channel<UV> ());
+      camera_bsdf_channels.push_back (context.samples.add_channel<UV> ());
+      direct_select_channels.push_back (context.samples.add_channel<float> ());
+      direct_light_channels.push_back (context.samples.add_channel<UV> ());
+    }
+
+  light_path.reserve (global.max_path_len);
+  camera_path.reserve (global.max_path_len + 2);
+}
+
+// Return a new integrator, allocated in context.
+//
+SurfaceInteg *
+BdptInteg::GlobalState::make_integrator (RenderContext &context)
+{
+  return new BdptInteg (context, *this);
+}
+
+
+// Path probability helpers
+
+namespace { // keep local to file
+
+// Return true if the BSDF at ISEC can be evaluated in arbitrary
+// directions, so that a subpath ending at ISEC can be connected to
+// another subpath.  BSDFs which are purely specular cannot.
+//
+inline bool
+connectible (const Intersect *isec)
+{
+  return (isec && isec->bsdf
+	  && isec->bsdf->supports (Bsdf::ALL_DIRECTIONS
+				   | Bsdf::DIFFUSE | Bsdf::GLOSSY));
+}
+
+// Return PDF, unless it's zero because of specular scattering, in
+// which case return 1.  The infinite PDFs of specular scattering
+// appear in the probability of every strategy that can sample such a
+// path, so they cancel out when comparing strategies.
+//
+// Zero PDFs for the very first vertex of a path (INDEX 0) are real,
+// as they mean the light cannot be sampled that way at all.
+//
+inline float
+remap_pdf (unsigned index, float pdf)
+{
+  return (index == 0 || pdf != 0) ? pdf : 1;
+}
+
+} // namespace
+
+
+// Return the probability, in area terms, of sampling the vertex TO
+// in the solid-angle PDF DIR_PDF from position FROM.  If TO has no
+// intersection (it's the first vertex in a subpath), DIR_PDF is
+// returned unchanged.
+//
+float
+BdptInteg::area_pdf (float dir_pdf, const Pos &from, const Vertex &to)
+{
+  if (! to.isec)
+    return dir_pdf;
+
+  Vec vec = to.pos - from;
+  dist_t dist_sq = vec.length_squared ();
+  if (dist_sq == 0)
+    return 0;
+
+  float cos_to = cos_angle (vec / sqrt (dist_sq), to.isec->geom_normal);
+
+  return dir_pdf * abs (cos_to) / float (dist_sq);
+}
+
+// Return the probability, in area terms, that VERTEX would sample the
+// vertex TO, if it were viewed from direction VIEW_DIR (in world
+// coordinates) instead of the direction its BSDF was created for.
+//
+float
+BdptInteg::reverse_pdf (const Vertex &vertex, const Vec &view_dir,
+			const Vertex &to)
+{
+  const Intersect &isec = *vertex.isec;
+
+  Intersect rev_isec (isec, isec.normal_frame.to (view_dir));
+  if (! rev_isec.bsdf)
+    return 0;
+
+  Vec dir = rev_isec.normal_frame.to ((to.pos - vertex.pos).unit ());
+  float dir_pdf = rev_isec.bsdf->eval (dir).pdf;
+
+  return area_pdf (dir_pdf, vertex.pos, to);
+}
+
+// Return the sum of the light-sampling PDFs, in solid-angle terms from
+// ISEC, of all lights whose surface is hit by a ray from ISEC in
+// direction DIR (in ISEC's normal frame) at distance DIST.  If ENVIRON
+// is true, then DIST is ignored and only environmental lights are
+// considered.
+//
+// This is the probability with which direct lighting would have
+// sampled the point in direction DIR, and includes the probability of
+// choosing each light.
+//
+// As we don't know which light a surface belongs to, every light of
+// the appropriate kind is checked; however this is only needed when a
+// camera subpath actually hits a light.  When the light is known
+// (the start of a light subpath), the other version is used instead.
+//
+float
+BdptInteg::light_pdf (const Intersect &isec, const Vec &dir, dist_t dist,
+		      bool environ)
+  const
+{
+  const std::vector<unsigned> &candidates
+    = environ ? global.environ_lights : global.area_lights;
+
+  float pdf = 0;
+  for (unsigned i = 0; i < candidates.size (); i++)
+    pdf += light_pdf (candidates[i], isec, dir, dist, environ);
+
+  return pdf;
+}
+
+// Return the light-sampling PDF, in solid-angle terms from ISEC, of
+// the light SCENE.light_samplers[LIGHT_NUM] in direction DIR (in
+// ISEC's normal frame), including the probability of choosing it, or
+// zero if its surface isn't at distance DIST.  If ENVIRON is true,
+// then DIST is ignored.
+//
+float
+BdptInteg::light_pdf (unsigned light_num, const Intersect &isec, const Vec &dir,
+		      dist_t dist, bool environ)
+  const
+{
+  const Light::Sampler *light = context.scene.light_samplers[light_num];
+
+  Light::Sampler::Value lval = light->eval (isec, dir);
+
+  dist_t dist_tolerance = dist * 1e-3f + context.params.min_trace;
+
+  if (lval.pdf > 0 && (environ || abs (lval.dist - dist) < dist_tolerance))
+    return lval.pdf * global.light_dist.pdf (light_num);
+  else
+    return 0;
+}
+
+// Return an estimate of the probability, in area terms, that a light
+// subpath starting at the light sample described by LIGHT would next
+// sample VERTEX.  LIGHT_PDF is the light-sampling PDF for LIGHT, as
+// returned by BdptInteg::light_pdf.
+//
+// The light-sampler interface doesn't tell us the directional
+// distribution of light samples, so we assume the usual cases:
+// lambertian emission for area lights (using the PDF for emission
+// normal to the surface), uniform emission for point lights, and for
+// environmental lights, a direction distributed like direct-lighting
+// samples, from a point on a disk covering the scene.  As this is only
+// used to weight strategies, not to scale their results, the estimate
+// affects only noise, not the correctness of the result.
+//
+float
+BdptInteg::emission_pdf (const LightInfo &light, float light_pdf,
+			 const Vertex &vertex)
+  const
+{
+  if (! vertex.isec)
+    return 0;
+
+  if (light.environ)
+    {
+      float cos_v = cos_angle (light.dir, vertex.isec->geom_normal);
+      float disk_area = float (global.scene_radius * global.scene_radius) * PIf;
+      return light_pdf * abs (cos_v) / disk_area;
+    }
+
+  float dir_pdf = light.point ? INV_PIf * 0.25f : INV_PIf;
+
+  return area_pdf (dir_pdf, light.pos, vertex);
+}
+
+
+// Multiple importance sampling
+
+// Fill in PATH_PDF_LIGHT, PATH_PDF_CAMERA, and PATH_SPECULAR for a
+// complete path consisting of the first S vertices of LIGHT_PATH
+// followed by the first T vertices of CAMERA_PATH (in reverse order).
+// The caller should then adjust entries which depend on how the
+// subpaths were connected.
+//
+void
+BdptInteg::init_path_pdfs (unsigned s, unsigned t)
+{
+  unsigned n = s + t;
+
+  path_pdf_light.resize (n);
+  path_pdf_camera.resize (n);
+  path_specular.resize (n);
+
+  for (unsigned i = 0; i < s; i++)
+    if (i < light_path.size ())
+      {
+	const Vertex &vertex = light_path[i];
+	path_pdf_light[i] = vertex.pdf_fwd;
+	path_pdf_camera[i] = vertex.pdf_rev;
+	path_specular[i] = vertex.specular;
+      }
+    else
+      {
+	path_pdf_light[i] = path_pdf_camera[i] = 0;
+	path_specular[i] = false;
+      }
+
+  for (unsigned j = 0; j < t; j++)
+    {
+      const Vertex &vertex = camera_path[j];
+      unsigned i = n - 1 - j;
+      path_pdf_light[i] = vertex.pdf_rev;
+      path_pdf_camera[i] = vertex.pdf_fwd;
+      path_specular[i] = vertex.specular;
+    }
+}
+
+// Return the multiple-importance-sampling weight for the complete path
+// described by PATH_PDF_LIGHT, PATH_PDF_CAMERA and PATH_SPECULAR, as
+// sampled using the strategy with S light vertices.  If DELTA_LIGHT is
+// true, the path starts at a light which cannot be hit by a camera
+// subpath.
+//
+// This is the "power heuristic" (as in mis_sample_weight), extended to
+// all the strategies which could have sampled the same path:  a path
+// with N vertices could have been sampled using from 0 to N-2 light
+// vertices (we never use fewer than two camera vertices), except that
+// subpaths can't be connected at a specularly scattering vertex.
+//
+// The probability of each strategy relative to strategy S is computed
+// incrementally, as moving the connection by one vertex changes only
+// the way that one vertex was sampled.
+//
+float
+BdptInteg::mis_weight (unsigned s, bool delta_light) const
+{
+  unsigned n = path_pdf_light.size ();
+
+  float sum = 1;		// strategy S itself
+
+  // Strategies using more light vertices.
+  //
+  float ratio = 1;
+  for (unsigned str = s + 1; str + 2 <= n; str++)
+    {
+      unsigned i = str - 1;
+
+      float den = remap_pdf (i, path_pdf_camera[i]);
+      if (den == 0)
+	break;
+
+      ratio *= remap_pdf (i, path_pdf_light[i]) / den;
+
+      if (! path_specular[i] && ! path_specular[i + 1])
+	sum += ratio * ratio;
+    }
+
+  // Strategies using fewer light vertices.
+  //
+  ratio = 1;
+  for (unsigned str = s; str > 0; str--)
+    {
+      unsigned i = str - 1;
+
+      float den = remap_pdf (i, path_pdf_light[i]);
+      if (den == 0)
+	break;
+
+      ratio *= remap_pdf (i, path_pdf_camera[i]) / den;
+
+      bool possible
+	= (i == 0 ? !delta_light : (!path_specular[i - 1] && !path_specular[i]));
+      if (possible)
+	sum += ratio * ratio;
+    }
+
+  return 1 / sum;
+}
+
+
+// BdptInteg::gen_light_path
+
+// Generate a light subpath in LIGHT_PATH, using parameters from
+// SAMPLE.  Return the light chosen, or zero if none.
+//
+const Light::Sampler *
+BdptInteg::gen_light_path (const SampleSet::Sample &sample,
+			   const Media &surrounding_media)
+{
+  const Scene &scene = context.scene;
+
+  light_path.clear ();
+
+  if (global.light_dist.empty () || global.max_path_len < 2)
+    return 0;
+
+  // Choose a light.
+  //
+  light_num = global.light_dist.sample (sample.get (light_select_chan));
+  float select_pdf = global.light_dist.pdf (light_num);
+  const Light::Sampler *light = scene.light_samplers[light_num];
+
+  // Sample it.
+  //
+  Light::Sampler::FreeSample samp
+    = light->sample (sample.get (light_pos_chan), sample.get (light_dir_chan));
+
+  if (samp.val == 0 || samp.pdf == 0)
+    return 0;
+
+  light_info = LightInfo (light->is_environ_light (), light->is_point_light (),
+			  samp.pos, samp.dir);
+
+  light_path.push_back (Vertex (0, samp.pos, samp.val, 0, 0));
+
+  // As with photons, the throughput of the first light-subpath segment
+  // is simply the sample value divided by its (combined positional and
+  // directional) PDF.
+  //
+  Color beta = samp.val / (select_pdf * samp.pdf);
+
+  const Media *innermost_media = &surrounding_media;
+
+  Ray ray (samp.pos, samp.dir, context.params.min_trace, scene.horizon);
+
+  // The solid-angle PDF for the next vertex.  For the vertex following
+  // the light, this is unknown, but isn't used.
+  //
+  float dir_pdf = 0;
+
+  // A light subpath vertex is only useful if it can be connected to a
+  // camera subpath vertex without exceeding the maximum path length,
+  // which means light subpaths need at most MAX_PATH_LEN vertices.
+  //
+  while (light_path.size () < global.max_path_len)
+    {
+      const Surface::Renderable::IsecInfo *isec_info
+	= scene.intersect (ray, context);
+
+      if (! isec_info)
+	break;
+
+      const Media &media = *innermost_media;
+
+      // The vertex must not move once created, as its BSDF refers to it,
+      // so allocate it in the context rather than copying it.
+      //
+      const Intersect *isec
+	= new (context) Intersect (isec_info->make_intersect (media, context));
+
+      beta *= context.volume_integ->transmittance (ray, media.medium);
+
+      unsigned index = light_path.size ();
+      Vertex vertex (isec, isec->normal_frame.origin, beta, dir_pdf, 0);
+
+      if (index == 1)
+	{
+	  // This vertex was sampled from the light.  Calculate the
+	  // light vertex's PDF as seen from here, in the same way as
+	  // when a camera subpath hits a light.
+	  //
+	  Vertex &light_vertex = light_path[0];
+
+	  light_vertex.pdf_fwd
+	    = (light_info.point
+	       ? select_pdf
+	       : light_pdf (light_num, *isec, isec->v,
+			    (vertex.pos - light_vertex.pos).length (),
+			    light_info.environ));
+
+	  vertex.pdf_fwd
+	    = emission_pdf (light_info, light_vertex.pdf_fwd, vertex);
+	}
+      else
+	{
+	  const Vertex &prev = light_path[index - 1];
+
+	  vertex.pdf_fwd = area_pdf (dir_pdf, prev.pos, vertex);
+
+	  // Now that we know where the path goes after PREV, we can
+	  // find the probability of reaching the vertex before PREV in
+	  // the reverse direction.
+	  //
+	  Vertex &prev_prev = light_path[index - 2];
+	  prev_prev.pdf_rev
+	    = (prev.specular
+	       ? 0
+	       : reverse_pdf (prev, ray.dir.unit (), prev_prev));
+	}
+
+      light_path.push_back (vertex);
+
+      if (! isec->bsdf || light_path.size () == global.max_path_len)
+	break;
+
+      // Sample the BSDF to continue the path.
+      //
+      unsigned bsdf_num = index - 1;
+      UV bsdf_param
+	= (bsdf_num < global.min_path_len
+	   ? sample.get (light_bsdf_channels[bsdf_num])
+	   : UV (context.random (), context.random ()));
+
+      Bsdf::Sample bsdf_samp = isec->bsdf->sample (bsdf_param);
+
+      if (bsdf_samp.pdf == 0 || bsdf_samp.val == 0)
+	break;
+
+      bool specular = (bsdf_samp.flags & Bsdf::SPECULAR);
+
+      light_path.back ().specular = specular;
+
+      beta
+	*= bsdf_samp.val * abs (isec->cos_n (bsdf_samp.dir)) / bsdf_samp.pdf;
+
+      dir_pdf = specular ? 0 : bsdf_samp.pdf;
+
+      ray = isec->recursive_ray (bsdf_samp.dir);
+
+      if (bsdf_samp.flags & Bsdf::TRANSMISSIVE)
+	Media::update_stack_for_transmission (innermost_media, *isec);
+    }
+
+  return light;
+}
+
+
+// BdptInteg::Li
+
+// Return the light arriving at RAY's origin, from points up until its
+// end.  MEDIA is the media environment through which the ray travels.
+//
+// This method also calls the volume-integrator's Li method, and
+// includes any light it returns for RAY as well.
+//
+// "Li" means "Light incoming".
+//
+Tint
+BdptInteg::Li (const Ray &ray, const Media &orig_media,
+	       const SampleSet::Sample &sample)
+{
+  const Scene &scene = context.scene;
+  unsigned max_path_len = global.max_path_len;
+
+  // Generate the light subpath.  The light subpath starts in the
+  // scene's default medium.
+  //
+  Media light_media (context.default_medium);
+  const Light::Sampler *path_light = gen_light_path (sample, light_media);
+
+  // Now follow the camera subpath, connecting each vertex to the
+  // lights as we go.  CAMERA_PATH[0] is the camera itself.
+  //
+  camera_path.clear ();
+  camera_path.push_back (Vertex (0, ray.origin, 1, 0, 0));
+
+  const Media *innermost_media = &orig_media;
+
+  Ray isec_ray = ray;
+
+  // The throughput of the camera subpath up to the current vertex.
+  //
+  Color beta = 1;
+
+  // Solid-angle PDF with which ISEC_RAY's direction was sampled, or
+  // zero for the camera ray or after specular scattering.
+  //
+  float dir_pdf = 0;
+
+  // We acculate the outgoing illumination in RADIANCE.
+  //
+  Color radiance = 0;
+
+  // The alpha value; this is always 1 except in the case where a camera
+  // ray directly hits the scene background.
+  //
+  float alpha = 1;
+
+  // T is the number of camera-subpath vertices, including the one
+  // we're about to add.
+  //
+  for (unsigned t = 2; ; t++)
+    {
+      const Surface::Renderable::IsecInfo *isec_info
+	= scene.intersect (isec_ray, context);
+
+      // Top of current media stack.
+      //
+      const Media &media = *innermost_media;
+
+      // Include lighting from the volume integrator, and then
+      // attenuation over ISEC_RAY.
+      //
+      radiance
+	+= context.volume_integ->Li (isec_ray, media.medium, sample) * beta;
+      beta *= context.volume_integ->transmittance (isec_ray, media.medium);
+
+      Vec ray_dir = isec_ray.dir.unit ();
+
+      // Add the new vertex.  If ISEC_RAY escaped the scene, this
+      // vertex represents the background, infinitely far away.
+      //
+      const Intersect *isec = 0;
+      if (isec_info)
+	isec = new (context) Intersect (isec_info->make_intersect (media,
+								   context));
+
+      Pos pos
+	= (isec
+	   ? isec->normal_frame.origin
+	   : isec_ray.origin + ray_dir * scene.horizon);
+
+      Vertex vertex (isec, pos, beta, dir_pdf, 0);
+      vertex.pdf_fwd = area_pdf (dir_pdf, camera_path[t - 2].pos, vertex);
+
+      camera_path.push_back (vertex);
+
+      const Vertex &prev = camera_path[t - 2];
+
+      // Now that we know where the path goes after PREV, find the
+      // probability of reaching the vertex before PREV in the reverse
+      // direction (the camera itself is never reached).
+      //
+      if (t > 3)
+	{
+	  Vertex &prev_prev = camera_path[t - 3];
+	  prev_prev.pdf_rev
+	    = prev.specular ? 0 : reverse_pdf (prev, ray_dir, prev_prev);
+	}
+
+      //
+      // Strategy with no light vertices:  the camera subpath hits a
+      // light directly.
+      //
+
+      Color Le = isec ? isec->Le () : scene.background (ray_dir);
+
+      if (Le > 0)
+	{
+	  float weight = 1;
+
+	  if (t > 2)
+	    {
+	      const Intersect &prev_isec = *prev.isec;
+
+	      LightInfo hit_light (!isec, false, pos, -ray_dir);
+
+	      dist_t dist = (pos - prev.pos).length ();
+	      float hit_light_pdf
+		= light_pdf (prev_isec, prev_isec.normal_frame.to (ray_dir),
+			     dist, !isec);
+
+	      init_path_pdfs (0, t);
+	      path_pdf_light[0] = hit_light_pdf;
+	      path_pdf_camera[0] = dir_pdf;
+	      path_specular[0] = false;
+	      path_pdf_light[1] = emission_pdf (hit_light, hit_light_pdf, prev);
+
+	      weight = mis_weight (0, false);
+	    }
+
+	  radiance += Le * beta * weight;
+	}
+
+      if (! isec)
+	{
+	  if (t == 2 && radiance == 0)
+	    alpha = context.global_state.bg_alpha;
+	  break;
+	}
+
+      // If there's no BSDF at all, this path is done.
+      //
+      if (! isec->bsdf)
+	break;
+
+      // The number of scattering vertices in a complete path using
+      // this vertex and S light-subpath vertices is S + T - 2.
+      //
+      const Vertex &z = camera_path[t - 1];
+      bool z_connectible = connectible (isec);
+
+      //
+      // Strategy with one light vertex:  sample a light directly from
+      // this vertex.
+      //
+
+      if (z_connectible && t - 1 <= max_path_len && !global.light_dist.empty ())
+	{
+	  unsigned direct_num = t - 2;
+	  bool well_distributed = direct_num < global.min_path_len;
+
+	  float select_param
+	    = (well_distributed
+	       ? sample.get (direct_select_channels[direct_num])
+	       : context.random ());
+	  UV light_param
+	    = (well_distributed
+	       ? sample.get (direct_light_channels[direct_num])
+	       : UV (context.random (), context.random ()));
+
+	  unsigned light_num = global.light_dist.sample (select_param);
+	  float select_pdf = global.light_dist.pdf (light_num);
+	  const Light::Sampler *light = scene.light_samplers[light_num];
+
+	  Light::Sampler::Sample lsamp = light->sample (*isec, light_param);
+
+	  if (lsamp.pdf > 0 && lsamp.val > 0)
+	    {
+	      Bsdf::Value bval = isec->bsdf->eval (lsamp.dir);
+
+	      Color unweighted
+		= (z.beta * bval.val * lsamp.val
+		   * (abs (isec->cos_n (lsamp.dir)) / (select_pdf * lsamp.pdf)));
+
+	      if (unweighted > 0)
+		{
+		  Ray shadow_ray = isec->recursive_ray (lsamp.dir, lsamp.dist);
+		  Color transmittance = 1;
+		  if (! scene.occludes (shadow_ray, media.medium, transmittance,
+					context))
+		    {
+		      transmittance
+			*= context.volume_integ->transmittance (shadow_ray,
+								media.medium);
+
+		      Vec wdir = isec->normal_frame.from (lsamp.dir);
+		      LightInfo direct_light (light->is_environ_light (),
+					      light->is_point_light (),
+					      z.pos + wdir * lsamp.dist, -wdir);
+
+		      init_path_pdfs (1, t);
+		      path_pdf_light[0] = select_pdf * lsamp.pdf;
+		      path_pdf_camera[0] = bval.pdf;
+		      path_specular[0] = false;
+		      path_pdf_light[1]
+			= emission_pdf (direct_light, path_pdf_light[0], z);
+		      path_specular[1] = false;
+		      if (t > 2)
+			path_pdf_light[2]
+			  = reverse_pdf (z, wdir, camera_path[t - 2]);
+
+		      float weight = mis_weight (1, light->is_point_light ());
+
+		      radiance += unweighted * transmittance * weight;
+		    }
+		}
+	    }
+	}
+
+      //
+      // Strategies with two or more light vertices:  connect this
+      // vertex to each vertex of the light subpath.
+      //
+
+      if (z_connectible && path_light)
+	for (unsigned s = 2;
+	     s <= light_path.size () && s + t - 2 <= max_path_len;
+	     s++)
+	  {
+	    const Vertex &y = light_path[s - 1];
+
+	    if (! connectible (y.isec))
+	      continue;
+
+	    Vec yz_vec = z.pos - y.pos;
+	    dist_t dist = yz_vec.length ();
+	    if (dist == 0)
+	      continue;
+	    Vec yz_dir = yz_vec / dist;
+
+	    Vec y_dir = y.isec->normal_frame.to (yz_dir);
+	    Vec z_dir = isec->normal_frame.to (-yz_dir);
+
+	    Bsdf::Value y_bval = y.isec->bsdf->eval (y_dir);
+	    Bsdf::Value z_bval = isec->bsdf->eval (z_dir);
+
+	    float G
+	      = (abs (y.isec->cos_n (y_dir)) * abs (isec->cos_n (z_dir))
+		 / float (dist * dist));
+
+	    Color unweighted = y.beta * y_bval.val * z_bval.val * z.beta * G;
+
+	    if (! (unweighted > 0))
+	      continue;
+
+	    Ray conn_ray = isec->recursive_ray (z_dir, dist);
+	    Color transmittance = 1;
+	    if (scene.occludes (conn_ray, media.medium, transmittance, context))
+	      continue;
+
+	    transmittance
+	      *= context.volume_integ->transmittance (conn_ray, media.medium);
+
+	    init_path_pdfs (s, t);
+	    path_pdf_camera[s - 1] = area_pdf (z_bval.pdf, z.pos, y);
+	    path_pdf_light[s] = area_pdf (y_bval.pdf, y.pos, z);
+	    path_pdf_camera[s - 2] = reverse_pdf (y, yz_dir, light_path[s - 2]);
+	    if (t > 2)
+	      path_pdf_light[s + 1]
+		= reverse_pdf (z, -yz_dir, camera_path[t - 2]);
+	    path_specular[s - 1] = path_specular[s] = false;
+
+	    float weight = mis_weight (s, light_info.point);
+
+	    radiance += unweighted * transmittance * weight;
+	  }
+
+      // Extending the camera subpath by another vertex is only useful
+      // if that vertex could be part of a path not longer than
+      // MAX_PATH_LEN.
+      //
+      if (t > max_path_len + 1)
+	break;
+
+      // Sample the BSDF to get a new ray for the next path vertex.
+      //
+      unsigned bsdf_num = t - 2;
+      UV bsdf_param
+	= (bsdf_num < global.min_path_len
+	   ? sample.get (camera_bsdf_channels[bsdf_num])
+	   : UV (context.random (), context.random ()));
+
+      Bsdf::Sample bsdf_samp = isec->bsdf->sample (bsdf_param);
+
+      if (bsdf_samp.pdf == 0 || bsdf_samp.val == 0)
+	break;
+
+      bool specular = (bsdf_samp.flags & Bsdf::SPECULAR);
+
+      camera_path.back ().specular = specular;
+
+      beta
+	*= bsdf_samp.val * abs (isec->cos_n (bsdf_samp.dir)) / bsdf_samp.pdf;
+
+      dir_pdf = specular ? 0 : bsdf_samp.pdf;
+
+      isec_ray = isec->recursive_ray (bsdf_samp.dir);
+
+      // If we just followed a refractive (transmissive) sample, we need
+      // to update our stack of Media entries:  entering a refractive
+      // object pushes a new Media, existing one pops the top one.
+      //
+      if (bsdf_samp.flags & Bsdf::TRANSMISSIVE)
+	Media::update_stack_for_transmission (innermost_media, *isec);
+    }
+
+  return Tint (radiance, alpha);
+}
@@ -0,0 +1,297 @@
+// bdpt-integ.h -- Bidirectional path-tracing surface integrator
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_BDPT_INTEG_H
+#define SNOGRAY_BDPT_INTEG_H
+
+#include <vector>
+
+#include "geometry/alias-dist.h"
+#include "light/light-sampler.h"
+
+#include "surface-integ.h"
+
+
+namespace snogray {
+
+
+// A bidirectional path-tracing surface integrator.
+//
+// For each camera ray, a "light subpath" is started at a point chosen
+// on one of the scene's lights, and followed as it scatters through
+// the scene, and a "camera subpath" is followed from the camera in the
+// same way.  Every vertex of the camera subpath is then connected to
+// every vertex of the light subpath (as well as to a separately chosen
+// light sample, and to any light it directly hits), and the resulting
+// complete paths are combined using multiple importance sampling.
+//
+// This finds light arriving through small openings or by way of
+// diffuse reflectors near lights, both of which a unidirectional path
+// tracer will only rarely hit, with far less noise than PathInteg.
+//
+// Connections directly to the camera (light tracing) are not done, as
+// they would contribute to other pixels than the one being rendered;
+// the MIS weights only include the strategies actually used.
+//
+class BdptInteg : public SurfaceInteg
+{
+public:
+
+  // Global state for this integrator, for rendering an entire scene.
+  //
+  class GlobalState : public SurfaceInteg::GlobalState
+  {
+  public:
+
+    GlobalState (const GlobalRenderState &rstate, const ValTable &params);
+
+    // Return a new integrator, allocated in context.
+    //
+    virtual SurfaceInteg *make_integrator (RenderContext &context);
+
+  private:
+
+    friend class BdptInteg;
+
+    // The number of path vertices for which we pre-calculate
+    // well-distributed sampling parameters; vertices after this use
+    // more randomly distributed samples.
+    //
+    unsigned min_path_len;
+
+    // The maximum number of scattering events (bounces) in a complete
+    // path from a light to the camera.
+    //
+    unsigned max_path_len;
+
+    // Distribution used to choose which light to start a light
+    // subpath from, or to sample for direct lighting.  Entry I
+    // corresponds to SCENE.light_samplers[I], and is proportional to
+    // that light's power.
+    //
+    AliasDist light_dist;
+
+    // Indices in SCENE.light_samplers of environmental lights, and of
+    // area lights (lights which are neither environmental nor point
+    // lights), with a non-zero probability in LIGHT_DIST.  These are
+    // the only lights that BdptInteg::light_pdf needs to consider.
+    //
+    std::vector<unsigned> environ_lights, area_lights;
+
+    // Radius of a sphere enclosing the scene, used to find the
+    // density of subpaths starting from environmental lights.
+    //
+    dist_t scene_radius;
+  };
+
+  // Return the light arriving at RAY's origin, from points up until
+  // its end.  MEDIA is the media environment through which the ray
+  // travels.
+  //
+  // This method also calls the volume-integrator's Li method, and
+  // includes any light it returns for RAY as well.
+  //
+  // "Li" means "Light incoming".
+  //
+  virtual Tint Li (const Ray &ray, const Media &media,
+		   const SampleSet::Sample &sample);
+
+private:
+
+  // A single vertex in a light or camera subpath.
+  //
+  struct Vertex
+  {
+    Vertex (const Intersect *_isec, const Pos &_pos, const Color &_beta,
+	    float _dir_pdf, float _pdf_fwd)
+      : isec (_isec), pos (_pos), beta (_beta),
+	dir_pdf (_dir_pdf), pdf_fwd (_pdf_fwd), pdf_rev (0),
+	specular (false)
+    { }
+
+    // The surface intersection at this vertex, or zero for the first
+    // vertex in each subpath (the light sample, or the camera).
+    //
+    const Intersect *isec;
+
+    // Position of this vertex, in world coordinates.
+    //
+    Pos pos;
+
+    // The throughput of the subpath from its start up to this vertex
+    // (not including scattering at this vertex), divided by the
+    // probability of having sampled it.
+    //
+    Color beta;
+
+    // The solid-angle PDF with which this vertex was sampled from the
+    // previous vertex in its subpath.
+    //
+    float dir_pdf;
+
+    // The probabilities, in area terms, of sampling this vertex from
+    // the previous vertex in its subpath (PDF_FWD), and from the next
+    // vertex, if the subpath were sampled in the opposite direction
+    // (PDF_REV).  These are zero if the sampling vertex scattered
+    // specularly.
+    //
+    // The first vertex in a light subpath is a special case; see
+    // BdptInteg::light_pdf.
+    //
+    float pdf_fwd, pdf_rev;
+
+    // True if the subpath was continued from this vertex by specular
+    // scattering.
+    //
+    bool specular;
+  };
+
+  // Information about the light at the start of a complete path.
+  //
+  struct LightInfo
+  {
+    LightInfo (bool _environ, bool _point, const Pos &_pos, const Vec &_dir)
+      : environ (_environ), point (_point), pos (_pos), dir (_dir)
+    { }
+    LightInfo () : environ (false), point (false) { }
+
+    // True if the light is an environmental light, or a point light.
+    //
+    bool environ, point;
+
+    // Position of the light sample, and, for environmental lights, the
+    // direction light travels from it (in world coordinates).
+    //
+    Pos pos;
+    Vec dir;
+  };
+
+  // Integrator state for rendering a group of related samples.
+  //
+  BdptInteg (RenderContext &context, GlobalState &global_state);
+
+  // Generate a light subpath in LIGHT_PATH, using parameters from
+  // SAMPLE.  Return the light chosen, or zero if none.
+  //
+  const Light::Sampler *gen_light_path (const SampleSet::Sample &sample,
+					const Media &surrounding_media);
+
+  // Return the sum of the light-sampling PDFs, in solid-angle terms
+  // from ISEC, of all lights whose surface is hit by a ray from ISEC
+  // in direction DIR (in ISEC's normal frame) at distance DIST.  If
+  // ENVIRON is true, then DIST is ignored and only environmental
+  // lights are considered.
+  //
+  float light_pdf (const Intersect &isec, const Vec &dir, dist_t dist,
+		   bool environ)
+    const;
+
+  // Return the light-sampling PDF, in solid-angle terms from ISEC, of
+  // the light SCENE.light_samplers[LIGHT_NUM] in direction DIR (in
+  // ISEC's normal frame), including the probability of choosing it,
+  // or zero if its surface isn't at distance DIST.  If ENVIRON is
+  // true, then DIST is ignored.  This is used instead of the more
+  // general version when the light is already known.
+  //
+  float light_pdf (unsigned light_num, const Intersect &isec, const Vec &dir,
+		   dist_t dist, bool environ)
+    const;
+
+  // Return an estimate of the probability, in area terms, that a light
+  // subpath starting at the light sample described by LIGHT would
+  // next sample VERTEX.  LIGHT_PDF is the light-sampling PDF for
+  // LIGHT, as returned by BdptInteg::light_pdf.
+  //
+  float emission_pdf (const LightInfo &light, float light_pdf,
+		      const Vertex &vertex)
+    const;
+
+  // Return the probability, in area terms, of sampling the vertex TO
+  // in the solid-angle PDF DIR_PDF from position FROM.  If TO has no
+  // intersection (it's the first vertex in a subpath), DIR_PDF is
+  // returned unchanged.
+  //
+  static float area_pdf (float dir_pdf, const Pos &from, const Vertex &to);
+
+  // Return the probability, in area terms, that VERTEX would sample
+  // the vertex TO, if it were viewed from direction VIEW_DIR (in world
+  // coordinates) instead of the direction its BSDF was created for.
+  //
+  static float reverse_pdf (const Vertex &vertex, const Vec &view_dir,
+			    const Vertex &to);
+
+  // Fill in PATH_PDF_LIGHT, PATH_PDF_CAMERA, and PATH_SPECULAR for a
+  // complete path consisting of the first S vertices of LIGHT_PATH
+  // followed by the first T vertices of CAMERA_PATH (in reverse
+  // order).  The caller should then adjust entries which depend on
+  // how the subpaths were connected.
+  //
+  void init_path_pdfs (unsigned s, unsigned t);
+
+  // Return the multiple-importance-sampling weight for the complete
+  // path described by PATH_PDF_LIGHT, PATH_PDF_CAMERA and
+  // PATH_SPECULAR, as sampled using the strategy with S light
+  // vertices.  If DELTA_LIGHT is true, the path starts at a light
+  // which cannot be hit by a camera subpath.
+  //
+  float mis_weight (unsigned s, bool delta_light) const;
+
+  // Pointer to our global state info.
+  //
+  const GlobalState &global;
+
+  // Sample channels used for the light subpath.
+  //
+  SampleSet::Channel<float> light_select_chan;
+  SampleSet::Channel<UV> light_pos_chan, light_dir_chan;
+
+  // BSDF sample-channels used for the first MIN_PATH_LEN vertices of
+  // the light and camera subpaths.
+  //
+  SampleSet::ChannelVec<UV> light_bsdf_channels, camera_bsdf_channels;
+
+  // Light-selection and light-sampling channels used for direct
+  // lighting at the first MIN_PATH_LEN camera subpath vertices.
+  //
+  SampleSet::ChannelVec<float> direct_select_channels;
+  SampleSet::ChannelVec<UV> direct_light_channels;
+
+  //
+  // The following fields are modified by BdptInteg::Li, but their
+  // state need not be preserved between calls.  As in PathInteg, they
+  // are fields rather than local variables to avoid repeated memory
+  // allocation in BdptInteg::Li, which is called once per eye-ray.
+  //
+
+  // The current light and camera subpaths.
+  //
+  std::vector<Vertex> light_path, camera_path;
+
+  // The light at the start of LIGHT_PATH, and its index in
+  // SCENE.light_samplers.
+  //
+  LightInfo light_info;
+  unsigned light_num;
+
+  // For each vertex of the complete path currently being weighted, in
+  // order starting from the light:  the probability of sampling it
+  // from the light side (PATH_PDF_LIGHT) and from the camera side
+  // (PATH_PDF_CAMERA), and whether it scattered specularly.
+  //
+  std::vector<float> path_pdf_light, path_pdf_camera;
+  std::vector<bool> path_specular;
+};
+
+
+}
+
+#endif // SNOGRAY_BDPT_INTEG_H
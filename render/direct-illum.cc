@@ -10,10 +10,15 @@
 // Written by Miles Bader <miles@gnu.org>
 //
 
+#include <stdexcept>
+
 #include "material/bsdf.h"
 #include "material/media.h"
 #include "light/light.h"
+#include "light/light-power-dist.h"
+#include "light/light-tree.h"
 #include "scene.h"
+#include "global-render-state.h"
 #include "mis-sample-weight.h"
 
 #include "direct-illum.h"
@@ -30,14 +35,37 @@ DirectIllum::GlobalState::GlobalState (unsigned _num_samples)
 {
 }
 
+// Constructor that also sets up light selection according to the
+// "light_select" parameter in PARAMS (or in RSTATE's parameters).
+//
+DirectIllum::GlobalState::GlobalState (const GlobalRenderState &rstate,
+				       const ValTable &params,
+				       unsigned _num_samples)
+  : num_samples (_num_samples)
+{
+  std::string light_select
+    = params.get_string ("light_select",
+			 rstate.params.get_string ("light_select", "all"));
+
+  if (light_select == "tree")
+    light_selector.reset (new LightTree (rstate.scene.light_samplers));
+  else if (light_select == "power")
+    light_selector.reset (new LightPowerDist (rstate.scene.light_samplers));
+  else if (light_select != "all")
+    throw std::runtime_error ("Unknown light-selection method \""
+			      + light_select + "\"");
+}
+
 
 DirectIllum::DirectIllum (RenderContext &context,
 			  const GlobalState &global_state)
   : num_lights_to_sample (
       global_state.num_samples == 0
       ? 0
-      : context.scene.num_light_samplers ()),
-    light_select_chan (context.samples.add_channel<float> ())
+      : (global_state.light_selector
+	 ? 1
+	 : context.scene.num_light_samplers ())),
+    light_selector (global_state.light_selector.get ())
 {
   finish_init (context.samples, global_state);
 }
@@ -50,8 +78,10 @@ DirectIllum::DirectIllum (SampleSet &samples, RenderContext &context,
   : num_lights_to_sample (
       global_state.num_samples == 0
       ? 0
-      : context.scene.num_light_samplers ()),
-    light_select_chan (samples.add_channel<float> ())
+      : (global_state.light_selector
+	 ? 1
+	 : context.scene.num_light_samplers ())),
+    light_selector (global_state.light_selector.get ())
 {
   finish_init (samples, global_state);
 }
@@ -63,6 +93,12 @@ DirectIllum::finish_init (SampleSet &samples, const GlobalState &global_state)
 {
   unsigned num_samples = global_state.num_samples;
 
+  // When using a light selector, each light sample first chooses which
+  // light to sample.
+  //
+  light_select_chan
+    = samples.add_channel<float> (light_selector ? num_samples : 1);
+
   for (unsigned i = 0; i < num_lights_to_sample; i++)
     {
       light_samp_channels.push_back (samples.add_channel<UV> (num_samples));
@@ -99,9 +135,9 @@ DirectIllum::sample_all_lights (const Intersect &isec,
       const SampleSet::Channel<float> &bsdf_layer_chan = bsdf_layer_channels[i];
       unsigned num_samples = light_chan.size;
 
-      std::vector<UV>::const_iterator li = sample.begin (light_chan);
-      std::vector<UV>::const_iterator bi = sample.begin (bsdf_chan);
-      std::vector<float>::const_iterator bli = sample.begin (bsdf_layer_chan);
+      SampleSet::Iterator<UV> li = sample.begin (light_chan);
+      SampleSet::Iterator<UV> bi = sample.begin (bsdf_chan);
+      SampleSet::Iterator<float> bli = sample.begin (bsdf_layer_chan);
 
       Color light_radiance = 0;
       for (unsigned j = 0; j < num_samples; j++)
@@ -114,6 +150,59 @@ DirectIllum::sample_all_lights (const Intersect &isec,
   return radiance;
 }
 
+
+// DirectIllum::sample_selected_lights
+
+// Given the intersection ISEC, resulting from a cast ray, choose a
+// single light for each light sample using our light selector, and return
+// an estimate of the contribution of all lights in that ray's
+// direction.  FLAGS specifies what part of the BSDF will be used.
+//
+Color
+DirectIllum::sample_selected_lights (const Intersect &isec,
+				     const SampleSet::Sample &sample,
+				     unsigned flags)
+  const
+{
+  RenderContext &context = isec.context;
+
+  context.stats.illum_calls++;
+
+  if (num_lights_to_sample == 0)
+    return 0;
+
+  const SampleSet::Channel<UV> &light_chan = light_samp_channels[0];
+  const SampleSet::Channel<UV> &bsdf_chan = bsdf_samp_channels[0];
+  const SampleSet::Channel<float> &bsdf_layer_chan = bsdf_layer_channels[0];
+  unsigned num_samples = light_chan.size;
+
+  SampleSet::Iterator<float> si = sample.begin (light_select_chan);
+  SampleSet::Iterator<UV> li = sample.begin (light_chan);
+  SampleSet::Iterator<UV> bi = sample.begin (bsdf_chan);
+  SampleSet::Iterator<float> bli = sample.begin (bsdf_layer_chan);
+
+  const Frame &norm_frame = isec.normal_frame;
+
+  Color radiance = 0;
+  for (unsigned j = 0; j < num_samples; j++)
+    {
+      float select_pdf;
+      const Light::Sampler *light_sampler
+	= light_selector->sample (norm_frame.origin, norm_frame.z, *si++,
+			      select_pdf);
+
+      if (light_sampler && select_pdf > 0)
+	radiance += sample_light (isec, light_sampler, *li, *bi, *bli,
+				  flags, select_pdf);
+
+      ++li;
+      ++bi;
+      ++bli;
+    }
+
+  return radiance / float (num_samples);
+}
+
 
 // DirectIllum::sample_light
 
@@ -122,12 +211,16 @@ DirectIllum::sample_all_lights (const Intersect &isec,
 // BSDF_LAYER_PARAM to sample both the light and the BSDF.  FLAGS
 // specifies what part of the BSDF will be used.
 //
+// LIGHT_SELECT_PDF is the probability with which LIGHT_SAMPLER was
+// chosen, if it was chosen randomly from the scene's lights; the result
+// is an estimate of the contribution of all those lights.
+//
 Color
 DirectIllum::sample_light (const Intersect &isec,
 			   const Light::Sampler *light_sampler,
 			   const UV &light_param,
 			   const UV &bsdf_param, float bsdf_layer_param,
-			   unsigned flags)
+			   unsigned flags, float light_select_pdf)
   const
 {
   RenderContext &context = isec.context;
@@ -173,7 +266,8 @@ DirectIllum::sample_light (const Intersect &isec,
 	      //
 	      if (! light_sampler->is_point_light ())
 		lsamp_radiance
-		  *= mis_sample_weight (lsamp.pdf, 1, bval.pdf, 1);
+		  *= mis_sample_weight (lsamp.pdf * light_select_pdf, 1,
+					bval.pdf, 1);
 
 	      // Filter the light through the BSDF function.
 	      //
@@ -233,7 +327,8 @@ DirectIllum::sample_light (const Intersect &isec,
 		  // on the relative pro
 		  //
 		  bsamp_radiance
-		    *= mis_sample_weight (bsamp.pdf, 1, lval.pdf, 1);
+		    *= mis_sample_weight (bsamp.pdf, 1,
+					  lval.pdf * light_select_pdf, 1);
 
 		  // Filter the light through the BSDF function.
 		  //
@@ -251,5 +346,5 @@ DirectIllum::sample_light (const Intersect &isec,
 	}
     }
 
-  return radiance;
+  return radiance / light_select_pdf;
 }
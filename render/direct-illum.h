@@ -13,8 +13,10 @@
 #ifndef SNOGRAY_DIRECT_ILLUM_H
 #define SNOGRAY_DIRECT_ILLUM_H
 
+#include "util/unique-ptr.h"
 #include "color/color.h"
 #include "material/bsdf.h"
+#include "light/light-selector.h"
 #include "sample-set.h"
 
 
@@ -24,6 +26,7 @@ namespace snogray {
 class Intersect;
 class ValTable;
 class Light;
+class GlobalRenderState;
 
 
 class DirectIllum
@@ -40,7 +43,18 @@ public:
     //
     GlobalState (unsigned num_samples);
 
+    // Constructor that also sets up light selection according to the
+    // "light_select" parameter in PARAMS (or in RSTATE's parameters).
+    //
+    GlobalState (const GlobalRenderState &rstate, const ValTable &params,
+		 unsigned num_samples);
+
     unsigned num_samples;
+
+    // If non-zero, used to choose a single light for each light
+    // sample, instead of sampling every light in the scene.
+    //
+    UniquePtr<LightSelector> light_selector;
   };
 
   DirectIllum (RenderContext &context, const GlobalState &global_state);
@@ -59,12 +73,10 @@ public:
 		       unsigned flags = (Bsdf::ALL & ~Bsdf::SPECULAR))
     const
   {
-    // XXX  For now, just do all lights.  In the future we should add a way
-    // to limit the number of light samples in the case where there are
-    // many lights (e.g., divide the desired number of light samples among
-    // lights in the scene).
-    //
-    return sample_all_lights (isec, sample, flags);
+    if (light_selector)
+      return sample_selected_lights (isec, sample, flags);
+    else
+      return sample_all_lights (isec, sample, flags);
   }
 
   // Given the intersection ISEC, resulting from a cast ray, sample
@@ -77,15 +89,31 @@ public:
 			   unsigned flags = (Bsdf::ALL & ~Bsdf::SPECULAR))
     const;
 
+  // Given the intersection ISEC, resulting from a cast ray, choose a
+  // single light for each light sample using our light selector, and
+  // return an estimate of the contribution of all lights in that ray's
+  // direction.  FLAGS specifies what part of the BSDF will be used.
+  //
+  Color sample_selected_lights (const Intersect &isec,
+				const SampleSet::Sample &sample,
+				unsigned flags = (Bsdf::ALL & ~Bsdf::SPECULAR))
+    const;
+
   // Use multiple-importance-sampling to estimate the radiance of
   // LIGHT_SAMPLER towards ISEC, LIGHT_PARAM, BSDF_PARAM, and
   // BSDF_LAYER_PARAM to sample both the light and the BSDF.  FLAGS
   // specifies what part of the BSDF will be used.
+  //
+  // LIGHT_SELECT_PDF is the probability with which LIGHT_SAMPLER was
+  // chosen, if it was chosen randomly from the scene's lights; the
+  // result is an estimate of the contribution of all those lights.
+  //
   Color sample_light (const Intersect &isec,
 		      const Light::Sampler *light_sampler,
 		      const UV &light_param,
 		      const UV &bsdf_param, float bsdf_layer_param,
-		      unsigned flags = (Bsdf::ALL & ~Bsdf::SPECULAR))
+		      unsigned flags = (Bsdf::ALL & ~Bsdf::SPECULAR),
+		      float light_select_pdf = 1)
     const;
 
 private:
@@ -108,7 +136,13 @@ private:
   //
   unsigned num_lights_to_sample;
 
-  // XXX not used; for selecting a light if we're not sampling all lights.
+  // If non-zero, used to choose a single light for each light sample,
+  // instead of sampling every light.  This points into the GlobalState
+  // object, so that DirectIllum objects remain copyable.
+  //
+  const LightSelector *light_selector;
+
+  // Sample channel for selecting a light using LIGHT_SELECTOR.
   //
   SampleSet::Channel<float> light_select_chan;
 };
@@ -14,8 +14,12 @@
 #include "space/octree.h"
 #include "space/triv-space.h"
 #include "grid.h"
+#include "halton.h"
+#include "sobol.h"
+#include "zero-two.h"
 #include "direct-integ.h"
 #include "path-integ.h"
+#include "bdpt-integ.h"
 #include "photon-integ.h"
 #include "filter-volume-integ.h"
 
@@ -55,9 +59,20 @@ GlobalRenderState::GlobalRenderState (const Surface &scene_contents,
 //
 
 SampleGen *
-GlobalRenderState::make_sample_gen (const ValTable &)
+GlobalRenderState::make_sample_gen (const ValTable &params)
 {
-  return new Grid;
+  std::string sampler = params.get_string ("sampler", "grid");
+
+  if (sampler == "grid")
+    return new Grid;
+  else if (sampler == "sobol")
+    return new Sobol;
+  else if (sampler == "halton")
+    return new Halton;
+  else if (sampler == "zero-two" || sampler == "02")
+    return new ZeroTwo;
+  else
+    throw std::runtime_error ("Unknown sampler \"" + sampler + "\"");
 }
 
 SpaceBuilderFactory *
@@ -84,6 +99,8 @@ GlobalRenderState::make_surface_integ_global_state (const ValTable &params)
     return new DirectInteg::GlobalState (*this, sint_params);
   else if (sint == "path")
     return new PathInteg::GlobalState (*this, sint_params);
+  else if (sint == "bdpt")
+    return new BdptInteg::GlobalState (*this, sint_params);
   else if (sint == "photon")
     return new PhotonInteg::GlobalState (*this, sint_params);
   else
@@ -12,7 +12,8 @@
 
 #include "util/snogmath.h"
 #include "util/snogassert.h"
-#include "util/random.h"
+#include "util/hash-bits.h"
+#include "util/radical-inverse.h"
 
 #include "grid.h"
 
@@ -20,10 +21,8 @@
 using namespace snogray;
 
 
-void
-Grid::gen_uv_samples (Random &random,
-		      const std::vector<UV>::iterator &table, unsigned num)
-  const
+UV
+Grid::uv_sample (unsigned index, unsigned num, unsigned seed) const
 {
   ASSERT (num != 0);
 
@@ -32,8 +31,8 @@ Grid::gen_uv_samples (Random &random,
   // is greater than or equal to NUM.
   //
   double sqrt_num = sqrt (double (num));
-  double up = ceil (sqrt_num);
-  double down = floor (sqrt_num + 0.5);
+  float up = ceil (sqrt_num);
+  float down = floor (sqrt_num + 0.5);
 
   unsigned u_steps = unsigned (up);
   unsigned v_steps = unsigned (down);
@@ -45,25 +44,16 @@ Grid::gen_uv_samples (Random &random,
   //
   ASSERT (u_steps * v_steps == num);
 
-  float u_step = 1 / up;
-  float v_step = 1 / down;
-
-  float v_offs = 0;
-
-  std::vector<UV>::iterator samp = table;
-  for (unsigned i = 0; i < v_steps; i++)
-    {
-      float u_offs = 0;
+  // The jitter for each sample is a hash of its index and SEED.
+  //
+  unsigned u_jitter = mix_bits (index ^ seed);
+  unsigned v_jitter = mix_bits (u_jitter);
 
-      for (unsigned j = 0; j < u_steps; j++)
-	{
-	  *samp++ = UV (clamp01 (u_offs + random () * u_step),
-			clamp01 (v_offs + random () * v_step));
-	  u_offs += u_step;
-	}
+  unsigned u_cell = index % u_steps;
+  unsigned v_cell = index / u_steps;
 
-      v_offs += v_step;
-    }
+  return UV (clamp01 ((u_cell + fixed_point_to_float (u_jitter)) / up),
+	     clamp01 ((v_cell + fixed_point_to_float (v_jitter)) / down));
 }
 
 unsigned
@@ -79,17 +69,11 @@ Grid::adjust_uv_sample_count (unsigned num) const
   return unsigned (up * down);
 }
 
-void
-Grid::gen_float_samples (Random &random,
-			 const std::vector<float>::iterator &table,
-			 unsigned num)
-  const
+float
+Grid::float_sample (unsigned index, unsigned num, unsigned seed) const
 {
-  float n_step = 1 / float (num);
-  float offs = 0;
-
-  for (unsigned i = 0; i < num; i++)
-    table[i] = clamp01 (offs + random () * n_step);
+  float jitter = fixed_point_to_float (mix_bits (index ^ seed));
+  return clamp01 ((index + jitter) / float (num));
 }
 
 
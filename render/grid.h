@@ -23,16 +23,12 @@ class Grid : public SampleGen
 {
 protected:
 
-  // The actual sample generating methods.  Using RANDOM as a source of
-  // randomness, add NUM samples to TABLE through TABLE+NUM.
+  // The actual sample generating methods.  Return sample INDEX of a
+  // set of NUM samples, randomized using SEED.
   //
-  virtual void gen_float_samples (Random &random,
-				  const std::vector<float>::iterator &table,
-				  unsigned num)
+  virtual float float_sample (unsigned index, unsigned num, unsigned seed)
     const;
-  virtual void gen_uv_samples (Random &random,
-			       const std::vector<UV>::iterator &table,
-			       unsigned num)
+  virtual UV uv_sample (unsigned index, unsigned num, unsigned seed)
     const;
 
   virtual unsigned adjust_uv_sample_count (unsigned num) const;
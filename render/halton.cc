@@ -0,0 +1,51 @@
+// halton.cc -- Sample generator using a randomly rotated Halton sequence
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "util/hash-bits.h"
+#include "util/radical-inverse.h"
+
+#include "halton.h"
+
+
+using namespace snogray;
+
+
+namespace { // keep local to file
+
+// Return VAL + OFFS, modulo 1, where both VAL and OFFS are in the range
+// [0, 1).
+//
+inline float
+rotate (double val, double offs)
+{
+  val += offs;
+  if (val >= 1)
+    val -= 1;
+  return float (val);
+}
+
+} // namespace
+
+
+UV
+Halton::uv_sample (unsigned index, unsigned, unsigned seed) const
+{
+  return UV (rotate (radical_inverse (index, 2), fixed_point_to_float (seed)),
+	     rotate (radical_inverse (index, 3),
+		     fixed_point_to_float (mix_bits (seed))));
+}
+
+float
+Halton::float_sample (unsigned index, unsigned, unsigned seed) const
+{
+  return rotate (radical_inverse (index, 2), fixed_point_to_float (seed));
+}
@@ -0,0 +1,46 @@
+// halton.h -- Sample generator using a randomly rotated Halton sequence
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_HALTON_H
+#define SNOGRAY_HALTON_H
+
+#include "sample-gen.h"
+
+
+namespace snogray {
+
+
+// A sample generator using the Halton sequence (bases 2 and 3),
+// randomized by a Cranley-Patterson rotation.
+//
+// Each set of samples generated uses a new random rotation (a random
+// offset added to every sample, modulo 1), so samples for different
+// pixels are independent.  Unlike the base-2 sequences, the Halton
+// sequence is well-distributed for any sample count.
+//
+class Halton : public SampleGen
+{
+protected:
+
+  // The actual sample generating methods.  Return sample INDEX of a
+  // set of NUM samples, randomized using SEED.
+  //
+  virtual float float_sample (unsigned index, unsigned num, unsigned seed)
+    const;
+  virtual UV uv_sample (unsigned index, unsigned num, unsigned seed)
+    const;
+};
+
+
+}
+
+#endif // SNOGRAY_HALTON_H
@@ -16,6 +16,7 @@
 #include "material/media.h"
 #include "scene.h"
 #include "render-context.h"
+#include "texture/tex-eval-cache.h"
 
 #include "intersect.h"
 
@@ -34,23 +35,33 @@ bump_map (Frame &normal_frame, const Ref<const Tex<float> > &tex,
   //
   dist_t ds = 0.001f, dt = 0.001f;
       
-  // Non-perturbed bump-map value.
-  //
-  dist_t origin_depth = tex->eval (tex_coords);
-
-  // Evaluate bump-map in s direction.
+  // Texture coordinates perturbed in the s direction.
   //
   Pos ds_pos = tex_coords.pos + normal_frame.x * ds;
   UV ds_uv = tex_coords.uv + dTds * ds;
-  TexCoords ds_tex_coords (ds_pos, ds_uv);
-  dist_t ds_delta = dist_t (tex->eval (ds_tex_coords)) - origin_depth;
+  TexCoords ds_tex_coords (ds_pos, ds_uv, tex_coords.dTdx, tex_coords.dTdy,
+			   tex_coords.dPdx, tex_coords.dPdy,
+			   tex_coords.eval_cache);
 
-  // Evaluate bump-map in t direction.
+  // Texture coordinates perturbed in the t direction.
   //
   Pos dt_pos = tex_coords.pos + normal_frame.y * dt;
   UV dt_uv = tex_coords.uv + dTdt * dt;
-  TexCoords dt_tex_coords (dt_pos, dt_uv);
-  dist_t dt_delta = dist_t (tex->eval (dt_tex_coords)) - origin_depth;
+  TexCoords dt_tex_coords (dt_pos, dt_uv, tex_coords.dTdx, tex_coords.dTdy,
+			   tex_coords.dPdx, tex_coords.dPdy,
+			   tex_coords.eval_cache);
+
+  // Evaluate the bump-map at the original and both perturbed
+  // coordinates at once, which lets noise textures and compiled
+  // textures share work between them.
+  //
+  TexCoords bump_coords[3] = { tex_coords, ds_tex_coords, dt_tex_coords };
+  float depths[3];
+  tex->eval_batch (bump_coords, 3, depths);
+
+  dist_t origin_depth = depths[0];
+  dist_t ds_delta = dist_t (depths[1]) - origin_depth;
+  dist_t dt_delta = dist_t (depths[2]) - origin_depth;
 
   if (ds_delta != 0 || dt_delta != 0)
     {
@@ -86,7 +97,20 @@ bump_map (Frame &normal_frame, const Ref<const Tex<float> > &tex,
 void
 Intersect::finish_init (const Ray &ray, const UV &dTds, const UV &dTdt)
 {
-  TexCoords tex_coords (normal_frame.origin, tex_coords_uv);
+  // If RAY has a ray cone, find our texture footprint; this must be
+  // done before bump-mapping changes the normal frame.  Otherwise,
+  // textures just use point lookups.
+  //
+  if (ray.cone_width != 0 || ray.cone_spread != 0)
+    calc_tex_footprint (ray, dTds, dTdt);
+  else
+    {
+      tex_coords_dTdx = tex_coords_dTdy = UV (0, 0);
+      tex_coords_dPdx = tex_coords_dPdy = Vec (0, 0, 0);
+      ray_cone_width = ray_cone_spread = 0;
+    }
+
+  TexCoords tex_coords = this->tex_coords ();
 
   if (material.bump_map)
     bump_map (normal_frame, material.bump_map, tex_coords, dTds, dTdt);
@@ -102,13 +126,10 @@ Intersect::finish_init (const Ray &ray, const UV &dTds, const UV &dTdt)
   //
   v = normal_frame.to (wv);
 
-  // Eye vector in the geometric frame.
-  //
-  Vec gv = geom_frame.to (wv);
-
-  // back-face flag.
+  // back-face flag; this is set if the eye vector is on the
+  // opposite side of the surface from the geometric normal.
   //
-  back = (gv.z < 0);
+  back = (dot (wv, geom_normal) < 0);
 
   // Make sure V (in the normal frame of reference) always has a
   // positive Z component.
@@ -120,22 +141,82 @@ Intersect::finish_init (const Ray &ray, const UV &dTds, const UV &dTdt)
     }
 
   // Now that NORMAL_FRAME is completely set up, calculate the geometric
-  // normal in that frame, GEOM_N.  Unlike GEOM_FRAME, GEOM_N is flipped so
-  // that it is always in the same hemisphere as the lighting normal (i.e.,
-  // GEOM_N.z is always positive).
+  // normal in that frame, GEOM_N.  Unlike GEOM_NORMAL, GEOM_N is flipped
+  // so that it is always in the same hemisphere as the lighting normal
+  // (i.e., GEOM_N.z is always positive).
   //
-  geom_n = normal_frame.to (geom_frame.z);
+  geom_n = normal_frame.to (geom_normal);
   geom_n.z = abs (geom_n.z);	// flip GEOM_N if necessary
 
-  // Set up the "bsdf" field by calling Intersect::get_bsdf.  This is done
+  // Set up the "bsdf" field by calling Material::get_bsdf.  This is done
   // separately from the constructor initialization, because we pass the
   // intersect object as argument to Material::get_bsdf, and we want it to
   // be in a consistent state.
   //
-  bsdf = material.get_bsdf (*this, tex_coords);
+  bsdf = (material.get_bsdf (*this, tex_coords, bsdf_storage)
+	  ? &bsdf_storage
+	  : 0);
 }
 
 
+// Calculate the footprint of this intersection, as seen by RAY's ray
+// cone, and store it in TEX_COORDS_DTDX, TEX_COORDS_DTDY,
+// TEX_COORDS_DPDX, TEX_COORDS_DPDY, and RAY_CONE_WIDTH.  DTDS and DTDT
+// are the derivatives of the texture coordinates with respect to
+// NORMAL_FRAME.x and NORMAL_FRAME.y.
+//
+void
+Intersect::calc_tex_footprint (const Ray &ray, const UV &dTds, const UV &dTdt)
+{
+  // Width of the ray cone at the intersection.  RAY may not be in
+  // world coordinates, but as the cone is in terms of the ray
+  // parameter, scaling by the length of RAY.dir makes WIDTH be in the
+  // same units as NORMAL_FRAME.
+  //
+  dist_t width
+    = (ray.cone_width + ray.t1 * ray.cone_spread) * ray.dir.length ();
+
+  ray_cone_width = float (width);
+  ray_cone_spread = ray.cone_spread;
+
+  // The footprint on the surface is an ellipse, stretched along the
+  // projection of the ray direction onto the surface by the inverse
+  // of the cosine between the ray and the normal.
+  //
+  Vec nv = normal_frame.to (-ray.dir.unit ());
+  dist_t cos_nv = max (abs (nv.z), dist_t (0.05));
+  dist_t proj_len = sqrt (nv.x * nv.x + nv.y * nv.y);
+  dist_t major_x = 1, major_y = 0;
+  if (proj_len > dist_t (1e-6))
+    {
+      major_x = nv.x / proj_len;
+      major_y = nv.y / proj_len;
+    }
+
+  dist_t major_len = width / cos_nv;
+  tex_coords_dTdx = dTds * (major_x * major_len) + dTdt * (major_y * major_len);
+  tex_coords_dTdy = dTds * (-major_y * width) + dTdt * (major_x * width);
+  tex_coords_dPdx = normal_frame.from (Vec (major_x, major_y, 0) * major_len);
+  tex_coords_dPdy = normal_frame.from (Vec (-major_y, major_x, 0) * width);
+}
+
+// Give RAY, which leaves this intersection, a ray cone continuing the
+// cone of the ray which hit it.  The new cone starts with the width of
+// the old one at this intersection, and keeps its spread, which is
+// exact for reflection from a flat mirror, and a reasonable estimate
+// otherwise.
+//
+void
+Intersect::set_ray_cone (Ray &ray) const
+{
+  if (ray_cone_width != 0 || ray_cone_spread != 0)
+    {
+      ray.cone_width = ray_cone_width / float (ray.dir.length ());
+      ray.cone_spread = ray_cone_spread;
+    }
+}
+
+
 // Constructors
 
 Intersect::Intersect (const Ray &ray, const Media &_media,
@@ -143,11 +224,13 @@ Intersect::Intersect (const Ray &ray, const Media &_media,
 		      const Material &_material,
 		      const Frame &_normal_frame,
 		      const UV &_tex_coords_uv, const UV &dTds, const UV &dTdt)
-  : normal_frame (_normal_frame), geom_frame (_normal_frame),
+  : normal_frame (_normal_frame), geom_normal (_normal_frame.z),
     // v and back are initialized by Intersect::finish_init
     material (_material),
     media (_media), context (_context),
-    tex_coords_uv (_tex_coords_uv)
+    tex_coords_uv (_tex_coords_uv),
+    tex_eval_cache (_context.mempool),
+    bsdf_storage (*this)
 {
   finish_init (ray, dTds, dTdt);
 }
@@ -157,26 +240,71 @@ Intersect::Intersect (const Ray &ray, const Media &_media,
 		      const Material &_material,
 		      const Frame &_normal_frame, const Frame &_geom_frame,
 		      const UV &_tex_coords_uv, const UV &dTds, const UV &dTdt)
-  : normal_frame (_normal_frame), geom_frame (_geom_frame),
+  : normal_frame (_normal_frame), geom_normal (_geom_frame.z),
     // v, geom_n, and back are initialized by Intersect::finish_init
     material (_material),
     media (_media), context (_context),
-    tex_coords_uv (_tex_coords_uv)
+    tex_coords_uv (_tex_coords_uv),
+    tex_eval_cache (_context.mempool),
+    bsdf_storage (*this)
 {
   finish_init (ray, dTds, dTdt);
 }
 
-// Copy-constructor.
+// Copy-constructor.  The copy gets its own copy of ISEC's BSDF.
 //
 Intersect::Intersect (const Intersect &isec)
-  : normal_frame (isec.normal_frame), geom_frame (isec.geom_frame),
+  : normal_frame (isec.normal_frame), geom_normal (isec.geom_normal),
     v (isec.v), geom_n (isec.geom_n), back (isec.back),
-    material (isec.material), bsdf (isec.bsdf),
+    material (isec.material), bsdf (isec.bsdf ? &bsdf_storage : 0),
     media (isec.media), context (isec.context),
-    tex_coords_uv (isec.tex_coords_uv)
+    tex_coords_uv (isec.tex_coords_uv),
+    tex_coords_dTdx (isec.tex_coords_dTdx),
+    tex_coords_dTdy (isec.tex_coords_dTdy),
+    tex_coords_dPdx (isec.tex_coords_dPdx),
+    tex_coords_dPdy (isec.tex_coords_dPdy),
+    ray_cone_width (isec.ray_cone_width),
+    ray_cone_spread (isec.ray_cone_spread),
+    tex_eval_cache (isec.tex_eval_cache),
+    bsdf_storage (isec.bsdf_storage, *this)
 {
 }
 
+// Make a copy of ISEC, but as seen from the direction VIEW_DIR (in
+// ISEC's normal frame) instead of ISEC.v, with a new BSDF to match.
+// VIEW_DIR must be normalized.
+//
+Intersect::Intersect (const Intersect &isec, const Vec &view_dir)
+  : normal_frame (isec.normal_frame), geom_normal (isec.geom_normal),
+    v (view_dir), geom_n (isec.geom_n), back (isec.back),
+    material (isec.material),
+    media (isec.media), context (isec.context),
+    tex_coords_uv (isec.tex_coords_uv),
+    tex_coords_dTdx (isec.tex_coords_dTdx),
+    tex_coords_dTdy (isec.tex_coords_dTdy),
+    tex_coords_dPdx (isec.tex_coords_dPdx),
+    tex_coords_dPdy (isec.tex_coords_dPdy),
+    ray_cone_width (isec.ray_cone_width),
+    ray_cone_spread (isec.ray_cone_spread),
+    tex_eval_cache (isec.tex_eval_cache),
+    bsdf_storage (*this)
+{
+  // As in Intersect::finish_init, keep V in the same hemisphere as the
+  // normal.  GEOM_N needs no adjustment, as flipping the normal frame
+  // only negates the z-component, and GEOM_N.z is always positive.
+  //
+  if (v.z < 0)
+    {
+      v.z = -v.z;
+      normal_frame.z = -normal_frame.z;
+      back = !back;
+    }
+
+  bsdf = (material.get_bsdf (*this, tex_coords (), bsdf_storage)
+	  ? &bsdf_storage
+	  : 0);
+}
+
 
 // Misc methods
 
@@ -185,7 +313,7 @@ Intersect::Intersect (const Intersect &isec)
 Color
 Intersect::Le () const
 {
-  return material.Le (*this, TexCoords (normal_frame.origin, tex_coords_uv));
+  return material.Le (*this, tex_coords ());
 }
 
 // Return a ray from this intersection in direction DIR in the
@@ -197,8 +325,9 @@ Intersect::recursive_ray (const Vec &dir) const
 {
   dist_t min_dist = context.params.min_trace;
   dist_t max_dist = context.scene.horizon;
-  return Ray (normal_frame.origin, normal_frame.from (dir),
-	      min_dist, max_dist);
+  Ray ray (normal_frame.origin, normal_frame.from (dir), min_dist, max_dist);
+  set_ray_cone (ray);
+  return ray;
 }
 
 // Return a ray from this intersection in direction DIR in the
@@ -213,8 +342,10 @@ Intersect::recursive_ray (const Vec &dir, dist_t max_dist) const
   dist_t min_dist = context.params.min_trace;
   if (max_dist == 0)
     max_dist = context.scene.horizon;
-  return Ray (normal_frame.origin, normal_frame.from (dir),
-	      min_dist, max_dist - min_dist);
+  Ray ray (normal_frame.origin, normal_frame.from (dir),
+	   min_dist, max_dist - min_dist);
+  set_ray_cone (ray);
+  return ray;
 }
 
 
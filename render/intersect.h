@@ -21,6 +21,7 @@
 #include "color/color.h"
 #include "render/render-context.h"
 #include "texture/tex-coords.h"
+#include "texture/tex-eval-cache.h"
 
 
 namespace snogray {
@@ -54,6 +55,15 @@ public:
   //
   Intersect (const Intersect &isec);
 
+  // Make a copy of ISEC, but as seen from the direction VIEW_DIR (in
+  // ISEC's normal frame) instead of ISEC.v, with a new BSDF to match.
+  // VIEW_DIR must be normalized.
+  //
+  // This is used by bidirectional integrators, which need to know how
+  // likely a path would be if sampled in the opposite direction.
+  //
+  Intersect (const Intersect &isec, const Vec &view_dir);
+
   // Return directly-emitted radiance from this intersection.
   //
   Color Le () const;
@@ -131,14 +141,14 @@ public:
   //
   Frame normal_frame;
 
-  // A frame of reference roughly similar to NORMAL_FRAME, but
-  // corresponding to the true surface geometry, with no normal
-  // perturbations (by bump-mapping etc) applied.
+  // The geometric surface normal in world space, corresponding to the
+  // true surface geometry, with no normal perturbations (by
+  // bump-mapping etc) applied.
   //
-  // Unlike NORMAL_FRAME, GEOM_FRAME is not "flipped" to place the
+  // Unlike NORMAL_FRAME, GEOM_NORMAL is not "flipped" to place the
   // normal is in the same hemisphere as the eye-vector.
   //
-  Frame geom_frame;
+  Vec geom_normal;
 
   // The eye vector, a unit vector pointing towards the viewer, in the
   // normal frame.
@@ -149,7 +159,7 @@ public:
   // geometry, with no normal perturbations applied), in the normal
   // frame.
   //
-  // Unlike GEOM_FRAME, GEOM_N is flipped so that it is always in the
+  // Unlike GEOM_NORMAL, GEOM_N is flipped so that it is always in the
   // same hemisphere as the lighting normal (i.e., GEOM_N.z is always
   // positive).
   //
@@ -164,7 +174,8 @@ public:
   //
   const Material &material;
 
-  // BSDF used at this intersection.
+  // BSDF used at this intersection, or zero if there is none.  This
+  // points to storage inside this Intersect object.
   //
   const Bsdf *bsdf;
 
@@ -183,11 +194,59 @@ private:
   //
   void finish_init (const Ray &ray, const UV &dTds, const UV &dTdt);
 
+  // Calculate the footprint of this intersection, as seen by RAY's
+  // ray cone, and store it in TEX_COORDS_DTDX, TEX_COORDS_DTDY,
+  // TEX_COORDS_DPDX, TEX_COORDS_DPDY, and RAY_CONE_WIDTH.  DTDS and
+  // DTDT are the derivatives of the texture coordinates with respect
+  // to NORMAL_FRAME.x and NORMAL_FRAME.y.
+  //
+  void calc_tex_footprint (const Ray &ray, const UV &dTds, const UV &dTdt);
+
+  // Give RAY, which leaves this intersection, a ray cone continuing
+  // the cone of the ray which hit it.
+  //
+  void set_ray_cone (Ray &ray) const;
+
+  // Return the texture-coordinates for this intersection.
+  //
+  TexCoords tex_coords () const
+  {
+    return TexCoords (normal_frame.origin, tex_coords_uv,
+		      tex_coords_dTdx, tex_coords_dTdy,
+		      tex_coords_dPdx, tex_coords_dPdy, &tex_eval_cache);
+  }
+
   // Surface UV texture coordinates for this intersection.  This field
   // is private because these are the "raw" texture-coordinates, which
   // are not correct in all contexts.
   //
   UV tex_coords_uv;
+
+  // The footprint of this intersection in UV and positional terms
+  // (see TexCoords::dTdx, etc).  These are only non-zero if the ray
+  // which hit this intersection had a ray cone.
+  //
+  UV tex_coords_dTdx, tex_coords_dTdy;
+  Vec tex_coords_dPdx, tex_coords_dPdy;
+
+  // The width (in the units of NORMAL_FRAME) and spread angle of the
+  // ray cone which hit this intersection, used to give rays leaving
+  // it a cone too.  Both are zero if there was no ray cone.
+  //
+  float ray_cone_width, ray_cone_spread;
+
+  // Cache of texture values evaluated at this intersection.  Its
+  // entries are only allocated (from CONTEXT's mempool) if an
+  // expensive texture is evaluated, and are shared by copies of this
+  // intersection made after that.  It is mutable as adding values
+  // doesn't change the intersection.
+  //
+  mutable TexEvalCache tex_eval_cache;
+
+  // Storage for the BSDF pointed to by Intersect::bsdf, filled in by
+  // Material::get_bsdf.
+  //
+  Bsdf bsdf_storage;
 };
 
 
@@ -64,6 +64,7 @@ PathInteg::GlobalState::GlobalState (const GlobalRenderState &rstate,
     min_path_len (params.get_uint ("min_path_len", 3)),
     max_path_len (params.get_uint ("max_path_len", 25)),
     direct_illum (
+      rstate, params,
       params.get_uint ("direct_samples,dir_samples,dir_samps",
 		       rstate.params.get_uint ("direct_samples", 1))),
     photon_eval (
@@ -44,6 +44,7 @@ PhotonInteg::GlobalState::GlobalState (const GlobalRenderState &rstate,
       params.get_float ("photon_radius", 0.1),
       params.get_float ("marker_radius", 0)),
     direct_illum (
+      rstate, params,
       params.get_uint ("direct_samples,dir_samples,dir_samps",
 		       rstate.params.get_uint ("direct_samples", 16))),
     use_direct_illum (params.get_bool ("direct_illum,dir_illum", true)),
@@ -431,7 +432,7 @@ PhotonInteg::Lo_fgather (const Intersect &isec, const Media &media,
 
   // Iterator yielding parameters for photon-direction based sampling.
   //
-  std::vector<UV>::const_iterator pi = sample.begin (fgather_photon_chan);
+  SampleSet::Iterator<UV> pi = sample.begin (fgather_photon_chan);
 
   unsigned bsdf_flags = isec.bsdf->supports ();
 
@@ -546,7 +547,7 @@ PhotonInteg::Lo_fgather (const Intersect &isec, const Media &media,
 
   // Iterator yielding parameters for BSDF sampling.
   //
-  std::vector<UV>::const_iterator bi = sample.begin (fgather_bsdf_chan);
+  SampleSet::Iterator<UV> bi = sample.begin (fgather_bsdf_chan);
 
   // Shoot NUM_BSDF_SAMPLES sample rays, sampling the BSDF for the directions.
   //
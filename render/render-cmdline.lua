@@ -30,7 +30,14 @@ function render_cmdline.option_parser (params)
         doc = [[Use surface-integrator INTEG (default "direct"):\+
 	        \|"direct"  -- direct-lighting
 	        \|"path"    -- path-tracing
+	        \|"bdpt"    -- bidirectional path-tracing
 	        \|"photon"  -- photon-mapping]] },
+      { "--sampler=SAMPLER", { params, "sampler" },
+        doc = [[Use SAMPLER to generate samples (default "grid"):\+
+	        \|"grid"     -- jittered grid
+	        \|"sobol"    -- Owen-scrambled Sobol sequence
+	        \|"halton"   -- randomly rotated Halton sequence
+	        \|"zero-two" -- XOR-scrambled (0,2)-sequence]] },
       { "-A/--background-alpha=ALPHA", { params, "background_alpha", 'float' },
         doc = [[Use ALPHA as the opacity of the background]] },
       { "-R/--render-options=OPTIONS",
@@ -76,6 +76,11 @@ public:
 
   // Random number generator.  This is a callable object.
   //
+  // Each context's generator starts with a different seed, so that
+  // threads which never choose a stream (see Random::set_stream) don't
+  // all generate the same numbers.  A Renderer re-seeds its context's
+  // generator with the common "seed" render parameter instead.
+  //
   Random random;
 
   // Global state shared by all render-contexts.
@@ -13,19 +13,21 @@
 #ifndef SNOGRAY_SAMPLE_GEN_H
 #define SNOGRAY_SAMPLE_GEN_H
 
-#include <vector>
-
 #include "geometry/uv.h"
 
 
 namespace snogray {
 
-class Random;
-
 
 // A sample generator, which can generate a specified number of samples to
 // cover a certain number of dimensions "evenly".
 //
+// Samples are generated individually, on demand:  sample INDEX of a set
+// of NUM samples is a deterministic function of INDEX, NUM, and a
+// 32-bit random SEED, which selects a particular randomization of the
+// set (for instance, a jitter pattern or a scramble).  The whole set of
+// samples for a given NUM and SEED covers the sample space evenly.
+//
 // This class is defined in generically using a templates, but only certain
 // types of samples are supported:  float, UV
 //
@@ -33,14 +35,11 @@ class SampleGen
 {
 public:
 
-  // Using RANDOM as a source of randomness, add NUM samples to TABLE
-  // through TABLE+NUM.
+  // Return sample INDEX of a set of NUM samples (INDEX must be less
+  // than NUM), randomized using SEED.
   //
   template<typename T>
-  void gen_samples (Random &random,
-		    const typename std::vector<T>::iterator &table,
-		    unsigned num)
-    const;
+  T sample (unsigned index, unsigned num, unsigned seed) const;
 
   // Return the number of samples we'd like to generate instead of NUM.
   //
@@ -50,16 +49,11 @@ public:
 protected:
 
   // The actual sample generating methods, defined by subclasses.
-  // Using RANDOM as a source of randomness, add NUM samples to TABLE
-  // through TABLE+NUM.
+  // Return sample INDEX of a set of NUM samples, randomized using SEED.
   //
-  virtual void gen_float_samples (Random &random,
-				  const std::vector<float>::iterator &table,
-				  unsigned num)
+  virtual float float_sample (unsigned index, unsigned num, unsigned seed)
     const = 0;
-  virtual void gen_uv_samples (Random &random,
-			       const std::vector<UV>::iterator &table,
-			       unsigned num)
+  virtual UV uv_sample (unsigned index, unsigned num, unsigned seed)
     const = 0;
 
   // Sample-count adjusting methods defined by subclasses.  By default,
@@ -77,27 +71,21 @@ protected:
 
 
 //
-// Specializations of SampleGen::gen_samples for supported sample types.
+// Specializations of SampleGen::sample for supported sample types.
 //
 
 template<>
-inline void
-SampleGen::gen_samples<float> (Random &random,
-			       const std::vector<float>::iterator &table,
-			       unsigned num)
-  const
+inline float
+SampleGen::sample<float> (unsigned index, unsigned num, unsigned seed) const
 {
-  gen_float_samples (random, table, num);
+  return float_sample (index, num, seed);
 }
 
 template<>
-inline void
-SampleGen::gen_samples<UV> (Random &random,
-			    const std::vector<UV>::iterator &table,
-			    unsigned num)
-  const
+inline UV
+SampleGen::sample<UV> (unsigned index, unsigned num, unsigned seed) const
 {
-  gen_uv_samples (random, table, num);
+  return uv_sample (index, num, seed);
 }
 
 
@@ -17,66 +17,23 @@
 using namespace snogray;
 
 
-// Removes all samples from this sample-set, invalidating any previously
-// created channels.  To subsequently generate more samples, new channels
-// must be added.
+// Removes all channels from this sample-set, invalidating any
+// previously created channels.  To subsequently generate more
+// samples, new channels must be added.
 //
 void
 SampleSet::clear ()
 {
-  float_samples.clear ();
-  uv_samples.clear ();
-
-  float_channels.clear ();
-  uv_channels.clear ();
+  num_channels = 0;
 }
 
 // Compute a completely new set of sample values in all channels.
 //
+// This just chooses a new random seed; the actual sample values are
+// calculated on demand.
+//
 void
 SampleSet::generate ()
 {
-  for (std::vector<Channel<float> >::iterator i = float_channels.begin();
-       i != float_channels.end (); ++i)
-    if (i->num_total_samples != 0)
-      {
-	std::vector<float>::iterator base = sample<float> (i->base_offset);
-	gen.gen_samples<float> (random, base, i->num_total_samples);
-	random_shuffle (base, base + i->num_total_samples, random);
-      }
-
-  for (std::vector<Channel<UV> >::iterator i = uv_channels.begin();
-       i != uv_channels.end (); ++i)
-    if (i->num_total_samples != 0)
-      {
-	std::vector<UV>::iterator base = sample<UV> (i->base_offset);
-	gen.gen_samples<UV> (random, base, i->num_total_samples);
-	random_shuffle (base, base + i->num_total_samples, random);
-      }
+  seed = random.gen_bits ();
 }
-
-
-// Add enough entries to the end of our sample table for samples of
-// type T to hold NUM_SAMPLES samples, and return the offset of the
-// first entry so allocated.
-//
-// These specializations are out-of-line to try and avoid bloat a little bit.
-
-template<>
-unsigned
-SampleSet::add_sample_space<float> (unsigned num_samples)
-{
-  unsigned base_offset = float_samples.size ();
-  float_samples.resize (base_offset + num_samples);
-  return base_offset;
-}
-
-template<>
-unsigned
-SampleSet::add_sample_space<UV> (unsigned num_samples)
-{
-  unsigned base_offset = uv_samples.size ();
-  uv_samples.resize (base_offset + num_samples);
-  return base_offset;
-}
-
@@ -15,13 +15,16 @@
 
 #include <vector>
 
+#include "util/hash-bits.h"
 #include "sample-gen.h"
 
 
 namespace snogray {
 
+class Random;
+
+
 
-
 // ----------------------------------------------------------------
 // SampleSet
 
@@ -29,7 +32,14 @@ namespace snogray {
 // A set of samples.  There are zero or more channels, each holding the
 // same number of samples.  Each channel has samples generated by the same
 // generator, but the channels are explicitly de-correlated from each other
-// by randomly shuffling the samples in each channel after generation.
+// by randomly permuting the order of the samples in each channel.
+//
+// Samples are not stored; each sample is calculated when it's asked
+// for, from its channel, its index, and a random seed chosen by
+// SampleSet::generate.  So generating a new set of samples (which
+// happens for every pixel) is very cheap, and samples in channels
+// which aren't used (e.g., for path vertices beyond the end of a path)
+// cost nothing.
 //
 class SampleSet
 {
@@ -50,6 +60,12 @@ public:
   {
   };
 
+  // An iterator over the sub-samples of a top-level sample in a
+  // single channel.
+  //
+  template<typename T>
+  class Iterator;
+
   // A reference to a single top-level sample in a sample-set.
   //
   // This is just a convenient package to hold the set and a
@@ -62,7 +78,8 @@ public:
   // RANDOM as a source of randomness.
   //
   SampleSet (unsigned _num_samples, const SampleGen &_gen, Random &_random)
-    : num_samples (_num_samples), gen (_gen), random (_random)
+    : num_samples (_num_samples), num_channels (0), seed (0),
+      gen (_gen), random (_random)
   {}
 
 
@@ -79,16 +96,14 @@ public:
   // sample SAMPLE_NUM from the sample channel CHANNEL.
   //
   template<typename T>
-  typename std::vector<T>::const_iterator
-  begin (const Channel<T> &channel, unsigned sample_num) const;
+  Iterator<T> begin (const Channel<T> &channel, unsigned sample_num) const;
 
   // Return an iterator pointing just past the end of the last
   // sub-sample for top-level sample SAMPLE_NUM from the sample channel
   // CHANNEL.
   //
   template<typename T>
-  typename std::vector<T>::const_iterator
-  end (const Channel<T> &channel, unsigned sample_num) const;
+  Iterator<T> end (const Channel<T> &channel, unsigned sample_num) const;
 
   // Allocate a new sample-channel in this set, containing
   // NUM_SUB_SAMPLES samples per top-level sample (which defaults to 1).
@@ -105,14 +120,17 @@ public:
   template<typename T>
   ChannelVec<T> add_channel_vec (unsigned size, unsigned num_sub_samples);
 
-  // Removes all samples from this sample-set, invalidating any previously
-  // created channels.  To subsequently generate more samples, new channels
-  // must be added.
+  // Removes all channels from this sample-set, invalidating any
+  // previously created channels.  To subsequently generate more
+  // samples, new channels must be added.
   //
   void clear ();
 
   // Compute a completely new set of sample values in all channels.
   //
+  // This just chooses a new random seed; the actual sample values are
+  // calculated on demand.
+  //
   void generate ();
 
   // Number of top-level samples.
@@ -122,31 +140,15 @@ public:
 
 private:
 
-  // Returns an iterator pointing into sample space for samples of type
-  // T at offset OFFSET.
-  //
-  template<typename T>
-  const typename std::vector<T>::iterator sample (unsigned offset);
-  template<typename T>
-  const typename std::vector<T>::const_iterator sample (unsigned offset) const;
-  
-  // Add enough entries to the end of our sample table for samples of
-  // type T to hold NUM samples, and return the offset of the
-  // first entry so allocated.
-  //
-  template<typename T>
-  unsigned add_sample_space (unsigned num);
-  
-  // Add CHANNEL to the appropriate vector of channels, and return it.
+  // Number of channels allocated so far.  This is used to give each
+  // channel a unique number.
   //
-  template<typename T>
-  Channel<T> _add_channel (const Channel<T> &chan);
-
-  std::vector<float> float_samples;
-  std::vector<UV> uv_samples;
+  unsigned num_channels;
 
-  std::vector<Channel<float> > float_channels;
-  std::vector<Channel<UV> > uv_channels;
+  // Random seed chosen by the last call to SampleSet::generate.  All
+  // sample values are derived from this.
+  //
+  unsigned seed;
 
 
 public:
@@ -161,7 +163,7 @@ public:
 };
 
 
-
+
 // ----------------------------------------------------------------
 // SampleSet::Channel
 
@@ -183,10 +185,20 @@ public:
   // Copy constructor
   //
   Channel (const Channel &from)
-    : size (from.size), base_offset (from.base_offset),
+    : size (from.size), number (from.number),
       num_total_samples (from.num_total_samples)
   {}
 
+  // Assignment operator
+  //
+  Channel &operator= (const Channel &from)
+  {
+    size = from.size;
+    number = from.number;
+    num_total_samples = from.num_total_samples;
+    return *this;
+  }
+
   // Number of sub-samples this channel contains.  There are this many
   // sub-samples per top-level sample.
   //
@@ -197,18 +209,18 @@ private:
 
   friend class SampleSet;
 
-  // Normal constructor.  This is private, as BASE_OFFSET is an
+  // Normal constructor.  This is private, as NUMBER is an
   // implementation detail.
   //
-  Channel (unsigned _base_offset, unsigned _size, unsigned _num_total_samples)
-    : size (_size), base_offset (_base_offset),
+  Channel (unsigned _number, unsigned _size, unsigned _num_total_samples)
+    : size (_size), number (_number),
       num_total_samples (_num_total_samples)
   {}
 
-  // Offset of our first sample in the appropriate sample vector of
-  // our SampleSet.
+  // The number of this channel in our SampleSet, which is used to
+  // choose a random seed for it which differs from all other channels.
   //
-  unsigned base_offset;
+  unsigned number;
 
   // Number of total samples generated for this channel.  This should be
   // at least SIZE * NUM_TOP_LEVEL_SAMPLES.  In the case that it's
@@ -220,7 +232,57 @@ private:
 };
 
 
-
+
+// ----------------------------------------------------------------
+// SampleSet::Iterator
+
+
+// An iterator over the sub-samples of a top-level sample in a single
+// channel.  Each sample value is calculated when the iterator is
+// dereferenced.
+//
+template<typename T>
+class SampleSet::Iterator
+{
+public:
+
+  Iterator (const SampleSet &_set, const Channel<T> &_channel,
+	    unsigned _sample_num, unsigned _sub_sample_num)
+    : set (&_set), channel (_channel), sample_num (_sample_num),
+      sub_sample_num (_sub_sample_num)
+  { }
+
+  T operator* () const
+  {
+    return set->get (channel, sample_num, sub_sample_num);
+  }
+
+  Iterator &operator++ () { ++sub_sample_num; return *this; }
+  Iterator operator++ (int)
+  {
+    Iterator old = *this;
+    ++sub_sample_num;
+    return old;
+  }
+
+  bool operator== (const Iterator &it) const
+  {
+    return sub_sample_num == it.sub_sample_num;
+  }
+  bool operator!= (const Iterator &it) const
+  {
+    return sub_sample_num != it.sub_sample_num;
+  }
+
+private:
+
+  const SampleSet *set;
+  Channel<T> channel;
+  unsigned sample_num, sub_sample_num;
+};
+
+
+
 // ----------------------------------------------------------------
 // SampleSet::Sample
 
@@ -252,8 +314,7 @@ public:
   // sample-channel CHANNEL.
   //
   template<typename T>
-  typename std::vector<T>::const_iterator
-  begin (const Channel<T> &channel) const
+  Iterator<T> begin (const Channel<T> &channel) const
   {
     return set.begin<T> (channel, sample_num);
   }
@@ -263,8 +324,7 @@ public:
   // CHANNEL.
   //
   template<typename T>
-  typename std::vector<T>::const_iterator
-  end (const Channel<T> &channel) const
+  Iterator<T> end (const Channel<T> &channel) const
   {
     return set.end<T> (channel, sample_num);
   }
@@ -279,7 +339,7 @@ public:
 };
 
 
-
+
 // ----------------------------------------------------------------
 // SampleSet inline method definitions
 
@@ -294,18 +354,30 @@ SampleSet::get (const Channel<T> &channel,
 		unsigned sample_num, unsigned sub_sample_num)
   const
 {
-  return sample<T> (channel.base_offset)
-    [sample_num * channel.size + sub_sample_num];
+  unsigned num = channel.num_total_samples;
+  unsigned index = sample_num * channel.size + sub_sample_num;
+
+  // Each channel gets its own seed, derived from the set's seed, which
+  // is used both to permute the order of its samples (which
+  // de-correlates them from other channels) and to randomize the
+  // sample values.
+  //
+  unsigned chan_seed = mix_bits (seed + channel.number * 0x9e3779b9);
+
+  if (num > 1)
+    index = permute_index (index, num, chan_seed);
+
+  return gen.sample<T> (index, num, mix_bits (chan_seed));
 }
 
 // Return an iterator pointing to the first sub-sample for top-level
 // sample SAMPLE_NUM from the sample channel CHANNEL.
 //
 template<typename T>
-typename std::vector<T>::const_iterator
+SampleSet::Iterator<T>
 SampleSet::begin (const Channel<T> &channel, unsigned sample_num) const
 {
-  return sample<T> (channel.base_offset) + (sample_num * channel.size);
+  return Iterator<T> (*this, channel, sample_num, 0);
 }
 
 // Return an iterator pointing just past the end of the last
@@ -313,10 +385,10 @@ SampleSet::begin (const Channel<T> &channel, unsigned sample_num) const
 // CHANNEL.
 //
 template<typename T>
-typename std::vector<T>::const_iterator
+SampleSet::Iterator<T>
 SampleSet::end (const Channel<T> &channel, unsigned sample_num) const
 {
-  return begin (channel, sample_num) + channel.size;
+  return Iterator<T> (*this, channel, sample_num, channel.size);
 }
 
 // Allocate a new sample-channel in this set, containing
@@ -344,12 +416,7 @@ SampleSet::add_channel (unsigned num_sub_samples)
   //
   num_sub_samples = num_total_samples / num_samples;
 
-  // Add enough room to our sample array for all the samples.
-  //
-  unsigned base_sample_offset = add_sample_space<T> (num_total_samples);
-
-  return _add_channel<T> (Channel<T> (base_sample_offset, num_sub_samples,
-				      num_total_samples));
+  return Channel<T> (num_channels++, num_sub_samples, num_total_samples);
 }
 
 // Allocate and return a vector of channels in this set, each
@@ -367,76 +434,6 @@ SampleSet::add_channel_vec (unsigned size, unsigned num_sub_samples)
 }
 
 
-
-// ----------------------------------------------------------------
-// Template specializations
-
-
-//
-// Declarations for specialized SampleSet::add_sample_space methods.
-//
-
-template<>
-unsigned
-SampleSet::add_sample_space<float> (unsigned num_samples);
-
-template<>
-unsigned
-SampleSet::add_sample_space<UV> (unsigned num_samples);
-
-//
-// Specializations of SampleGen::sample for supported sample types.
-//
-
-template<>
-inline const std::vector<float>::iterator
-SampleSet::sample<float> (unsigned offset)
-{
-  return float_samples.begin() + offset;
-}
-
-template<>
-inline const std::vector<UV>::iterator
-SampleSet::sample<UV> (unsigned offset)
-{
-  return uv_samples.begin() + offset;
-}
-
-template<>
-inline const std::vector<float>::const_iterator
-SampleSet::sample<float> (unsigned offset) const
-{
-  return float_samples.begin() + offset;
-}
-
-template<>
-inline const std::vector<UV>::const_iterator
-SampleSet::sample<UV> (unsigned offset) const
-{
-  return uv_samples.begin() + offset;
-}
-
-//
-// Specializations of SampleGen::_add_channel for supported sample types.
-//
-  
-template<>
-inline SampleSet::Channel<float>
-SampleSet::_add_channel (const Channel<float> &chan)
-{
-  float_channels.push_back (chan);
-  return chan;
-}
-  
-template<>
-inline SampleSet::Channel<UV>
-SampleSet::_add_channel (const Channel<UV> &chan)
-{
-  uv_channels.push_back (chan);
-  return chan;
-}
-
-
 }
 
 #endif // SNOGRAY_SAMPLE_SET_H
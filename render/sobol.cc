@@ -0,0 +1,63 @@
+// sobol.cc -- Sample generator using an Owen-scrambled Sobol sequence
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "util/hash-bits.h"
+#include "util/radical-inverse.h"
+
+#include "sobol.h"
+
+
+using namespace snogray;
+
+
+namespace { // keep local to file
+
+// Return the fixed-point fraction FRAC (see util/radical-inverse.h)
+// with an Owen scramble applied, where SEED selects the scramble.
+//
+// A true Owen scramble flips each digit of FRAC based on a random
+// function of all the more significant digits.  This uses the
+// hash-based approximation of Laine and Karras, with the improved
+// constants suggested by Burley: the hash below only propagates
+// changes from lower bits to higher bits, so applying it to the
+// bit-reversed fraction has the required effect.
+//
+inline unsigned
+owen_scramble (unsigned frac, unsigned seed)
+{
+  unsigned x = reverse_bits (frac);
+
+  x += seed;
+  x ^= x * 0x6c50b47c;
+  x ^= x * 0xb82f1e52;
+  x ^= x * 0xc7afe638;
+  x ^= x * 0x8d22f6e6;
+
+  return reverse_bits (x);
+}
+
+} // namespace
+
+
+UV
+Sobol::uv_sample (unsigned index, unsigned, unsigned seed) const
+{
+  unsigned u = owen_scramble (van_der_corput (index), seed);
+  unsigned v = owen_scramble (sobol2 (index), mix_bits (seed));
+  return UV (fixed_point_to_float (u), fixed_point_to_float (v));
+}
+
+float
+Sobol::float_sample (unsigned index, unsigned, unsigned seed) const
+{
+  return fixed_point_to_float (owen_scramble (van_der_corput (index), seed));
+}
@@ -0,0 +1,48 @@
+// sobol.h -- Sample generator using an Owen-scrambled Sobol sequence
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_SOBOL_H
+#define SNOGRAY_SOBOL_H
+
+#include "sample-gen.h"
+
+
+namespace snogray {
+
+
+// A sample generator using the first two dimensions of the Sobol
+// sequence, with Owen ("nested uniform") scrambling.
+//
+// Each set of samples generated uses a new random scramble, so samples
+// for different pixels are independent, while the samples within a set
+// keep the stratification properties of the Sobol sequence:  any prefix
+// whose length is a power of two is perfectly stratified in every
+// elementary interval.  Owen scrambling also gives better convergence
+// than simpler scrambling methods for smooth integrands.
+//
+class Sobol : public SampleGen
+{
+protected:
+
+  // The actual sample generating methods.  Return sample INDEX of a
+  // set of NUM samples, randomized using SEED.
+  //
+  virtual float float_sample (unsigned index, unsigned num, unsigned seed)
+    const;
+  virtual UV uv_sample (unsigned index, unsigned num, unsigned seed)
+    const;
+};
+
+
+}
+
+#endif // SNOGRAY_SOBOL_H
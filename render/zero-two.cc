@@ -0,0 +1,33 @@
+// zero-two.cc -- Sample generator using a (0,2)-sequence
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "util/hash-bits.h"
+#include "util/radical-inverse.h"
+
+#include "zero-two.h"
+
+
+using namespace snogray;
+
+
+UV
+ZeroTwo::uv_sample (unsigned index, unsigned, unsigned seed) const
+{
+  return UV (fixed_point_to_float (van_der_corput (index, seed)),
+	     fixed_point_to_float (sobol2 (index, mix_bits (seed))));
+}
+
+float
+ZeroTwo::float_sample (unsigned index, unsigned, unsigned seed) const
+{
+  return fixed_point_to_float (van_der_corput (index, seed));
+}
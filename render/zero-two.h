@@ -0,0 +1,46 @@
+// zero-two.h -- Sample generator using a (0,2)-sequence
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_ZERO_TWO_H
+#define SNOGRAY_ZERO_TWO_H
+
+#include "sample-gen.h"
+
+
+namespace snogray {
+
+
+// A sample generator using a base-2 (0,2)-sequence (the van der Corput
+// sequence paired with the second dimension of the Sobol sequence),
+// randomized by XORing each sample with a random digit scramble.
+//
+// This is the cheapest of the low-discrepancy sample generators; it has
+// the same stratification properties as Sobol, but the random XOR
+// scramble is a coarser randomization than Owen scrambling.
+//
+class ZeroTwo : public SampleGen
+{
+protected:
+
+  // The actual sample generating methods.  Return sample INDEX of a
+  // set of NUM samples, randomized using SEED.
+  //
+  virtual float float_sample (unsigned index, unsigned num, unsigned seed)
+    const;
+  virtual UV uv_sample (unsigned index, unsigned num, unsigned seed)
+    const;
+};
+
+
+}
+
+#endif // SNOGRAY_ZERO_TWO_H
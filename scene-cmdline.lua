@@ -21,6 +21,7 @@ local coord = require 'snogray.coord'
 local light = require 'snogray.light'
 local transform = require 'snogray.transform'
 local color = require 'snogray.color'
+local texture = require 'snogray.texture'
 
 
 -- Command-line parser
@@ -45,6 +46,33 @@ function scene_cmdline.option_parser (scene_params)
 	        OPT1=VAL1[,...]; current options include:\+
 		\|"format"    -- scene file type
 		\|"background"-- scene background]] },
+      { "--texture-cache=SIZE",
+	function (arg)
+	   scene_params.texture_cache = clp.unsigned_argument (arg)
+	   texture.set_image_cache (scene_params.texture_cache,
+				    scene_params.texture_tile_dir)
+	end,
+	doc = [[Load image textures on demand as tiles, using
+	        at most SIZE megabytes of memory for them]] },
+      { "--texture-tile-dir=DIR",
+	function (arg)
+	   scene_params.texture_tile_dir = arg
+	   texture.set_image_cache (scene_params.texture_cache or 0,
+				    scene_params.texture_tile_dir)
+	end,
+	doc = [[Keep image textures converted to tiles in DIR,
+	        for reuse by later runs]] },
+      { "--texture-load=MODE",
+	function (arg)
+	   texture.set_image_load_mode (arg)
+	end,
+	doc = [[Load image textures according to MODE:\+
+	        \|"parallel"  -- in the background (default)
+		\|"lazy"      -- only when first used
+		\|"immediate" -- as soon as they're defined]] },
+      { "--no-texture-compile",
+	function () texture.set_compile_enabled (false) end,
+	doc = [[Don't compile procedural textures]] },
    }
 end
 
@@ -0,0 +1,22 @@
+// snogmesh.cc -- Mesh-format conversion utility
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "lua/invoke-lua-driver.h"
+
+// All the real work is done by the Lua driver, as that gives us
+// access to every mesh format snogray can load.
+//
+int main (int, const char **argv)
+{
+  snogray::invoke_lua_driver ("snogmesh.lua", argv);
+  return 0;
+}
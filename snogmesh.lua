@@ -0,0 +1,69 @@
+-- snogmesh.lua -- Top-level driver for snogmesh
+--
+--  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+--
+-- This source code is free software; you can redistribute it and/or
+-- modify it under the terms of the GNU General Public License as
+-- published by the Free Software Foundation; either version 3, or (at
+-- your option) any later version.  See the file COPYING for more details.
+--
+-- Written by Miles Bader <miles@gnu.org>
+--
+
+-- snogmesh converts a mesh file in any format snogray can load into
+-- snogray's native binary mesh format (".snogmesh"), which can be
+-- loaded much more quickly.
+
+local cmdline = ...
+
+
+----------------------------------------------------------------
+-- Imports
+
+local clp = require 'snogray.cmdlineparser'
+
+local load = require 'snogray.load'
+local environ = require 'snogray.environ'
+local surface = require 'snogray.surface'
+local material = require 'snogray.material'
+
+local raw = require 'snogray.snograw'
+
+
+----------------------------------------------------------------
+-- Parse command-line options
+--
+
+local load_params = {}
+
+local parser = clp.standard_parser {
+   desc = "Convert a mesh file to snogray's native binary mesh format",
+   usage = "INPUT_MESH_FILE OUTPUT_SNOGMESH_FILE",
+   prog_name = cmdline[0],
+   package = "snogray",
+   version = environ.version,
+
+   { "-f/--format=FORMAT", function (fmt) load_params.format = fmt end,
+     doc = [[Read the input mesh file as format FORMAT
+             (default is to use the file extension)]] },
+}
+
+local args = parser (cmdline)
+
+if #args ~= 2 then
+   parser:usage_error ()
+end
+
+local in_file, out_file = args[1], args[2]
+
+
+----------------------------------------------------------------
+-- Convert the mesh
+--
+
+-- Materials aren't stored in .snogmesh files, so just use a dummy.
+--
+local mesh = surface.mesh ()
+load.mesh_geometry (in_file, mesh, material.lambert (0.5), load_params)
+
+raw.save_snogmesh_file (out_file, mesh)
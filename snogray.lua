@@ -36,6 +36,7 @@ local sys = require 'snogray.sys'
 local camera = require 'snogray.camera'
 local environ = require 'snogray.environ'
 local surface = require 'snogray.surface'
+local texture = require 'snogray.texture'
 
 local img_out_cmdline = require 'snogray.image-sampled-output-cmdline'
 local render_cmdline = require 'snogray.render-cmdline'
@@ -53,6 +54,8 @@ local limit_cmdline = require 'snogray.limit-cmdline'
 local quiet = false
 local progress = true
 local recover = false
+local profile_startup = false
+local profile_output_file = nil
 local num_threads = sys.num_cores ()
 local render_params = {}
 local scene_params = {}
@@ -154,6 +157,13 @@ local parser = clp.standard_parser {
      doc = [[Output progress indicator despite --quiet]] },
    { "-P/--no-progress", function () progress = false end,
      doc = [[Do not output progress indicator]] },
+   { "--profile-startup", function () profile_startup = true end,
+     doc = [[Print the time and memory used by each phase of
+	     scene loading and setup]] },
+   { "--profile-output=FILE",
+     function (arg) profile_startup = true; profile_output_file = arg end,
+     doc = [[Like --profile-startup, but also write the profile to
+	     FILE in a tab-separated machine-readable format]] },
    { "--build-info", print_build_info_and_exit,
      doc = [[Print information about how snogray was built]] }
 }
@@ -194,9 +204,16 @@ end
 -- Load the scene
 --
 
+if profile_startup then
+   sys.enable_phase_profile ()
+end
+
 local beg_time = os.time ()
 local scene_beg_ru = sys.rusage () -- begin marker for scene loading
 
+sys.begin_phase "startup"
+sys.begin_phase "scene load"
+
 local scene = surface.group ()
 local camera = camera.new ()  	-- note, shadows variable, but oh well
 
@@ -384,6 +401,7 @@ if not output_file then
 end
 
 local scene_end_ru = sys.rusage () -- end marker for scene setup
+sys.end_phase () -- "scene load"
 
 
 ----------------------------------------------------------------
@@ -532,9 +550,64 @@ end
 --
 
 local setup_beg_ru = sys.rusage ()
+
+sys.begin_phase "render setup"
 local grstate = render_cmdline.make_global_render_state (scene, render_params)
+sys.end_phase ()
+
+-- Image textures may still be loading in the background; wait for
+-- them, so that any errors are reported before rendering starts.
+--
+sys.begin_phase "image texture wait"
+texture.finish_image_loads ()
+sys.end_phase ()
+
 local setup_end_ru = sys.rusage ()
 
+sys.end_phase () -- "startup"
+
+
+----------------------------------------------------------------
+-- Startup profile
+--
+
+if profile_startup then
+   local phases = sys.phase_profile ()
+
+   -- Print a table of phases; nested phases (which are recorded after
+   -- the phases containing them) are simply listed in order, and
+   -- their times are also included in the containing phase.
+   --
+   print "Startup profile:"
+   print("  "..string.right_pad ("phase", 24)
+	 ..lpad ("count", 7)..lpad ("wall", 10)..lpad ("user", 10)
+	 ..lpad ("sys", 10)..lpad ("max rss MB", 12))
+   for i, ph in ipairs (phases) do
+      print("  "..string.right_pad (ph.name, 24)
+	    ..lpad (commify (ph.count), 7)
+	    ..lpad (round_and_commify (ph.wall_time, 3), 10)
+	    ..lpad (round_and_commify (ph.user_cpu_time, 3), 10)
+	    ..lpad (round_and_commify (ph.sys_cpu_time, 3), 10)
+	    ..lpad (round_and_commify (ph.max_rss / 1024, 1), 12))
+   end
+
+   if profile_output_file then
+      local out, err = io.open (profile_output_file, "w")
+      if not out then
+	 error (err, 0)
+      end
+      out:write ("phase\tcount\twall_time\tuser_cpu_time\tsys_cpu_time"
+		 .."\tmax_rss_kb\n")
+      for i, ph in ipairs (phases) do
+	 out:write (string.format ("%s\t%d\t%.6f\t%.6f\t%.6f\t%d\n",
+				   ph.name, ph.count, ph.wall_time,
+				   ph.user_cpu_time, ph.sys_cpu_time,
+				   ph.max_rss))
+      end
+      out:close ()
+   end
+end
+
 
 ----------------------------------------------------------------
 -- Rendering
@@ -653,6 +726,53 @@ if not quiet then
       end
    end
 
+   -- Print image-texture loading statistics, including the load
+   -- times of the slowest textures.
+   --
+   local function print_texture_load_stats ()
+      local tstats = texture.image_load_stats ()
+      if #tstats == 0 then
+	 return
+      end
+
+      local num_loaded, num_failed, tot_time = 0, 0, 0
+      for i, ts in ipairs (tstats) do
+	 if ts.state == 'loaded' then
+	    num_loaded = num_loaded + 1
+	 elseif ts.state == 'failed' then
+	    num_failed = num_failed + 1
+	 end
+	 tot_time = tot_time + ts.time
+      end
+
+      print ""
+      print "Texture loading:"
+      print("     image textures:  "..lpad (commify (#tstats), 16))
+      print("     loaded:          "..lpad (commify (num_loaded), 16)
+	    .." ("..lpad (percent (num_loaded, #tstats), 2).."%)")
+      if num_failed ~= 0 then
+	 print("     failed:          "..lpad (commify (num_failed), 16))
+      end
+      print("     total load time: "
+	    ..lpad (round_and_commify (tot_time, 2), 16).." sec")
+
+      table.sort (tstats, function (ts1, ts2) return ts1.time > ts2.time end)
+
+      local max_listed = 10
+      for i = 1, math.min (#tstats, max_listed) do
+	 local ts = tstats[i]
+	 if ts.state ~= 'unloaded' then
+	    local base = string.match (ts.filename, "[^/]*$")
+	    print("       "..lpad (round_and_commify (ts.time, 2), 10)
+		  .." sec  "..base
+		  ..(ts.state == 'failed' and " (failed)" or ""))
+	 end
+      end
+      if #tstats > max_listed then
+	 print("       ("..commify (#tstats - max_listed).." more)")
+      end
+   end
+
    -- Print the amount of CPU time used between BEG_RU and END_RU,
    -- prefix with LABEL.
    --
@@ -675,6 +795,7 @@ if not quiet then
    end
 
    print_render_stats (render_stats)
+   print_texture_load_stats ()
 
    --
    -- Print times; a field width of 14 is enough for over a year of
@@ -13,22 +13,7 @@
 #ifndef SNOGRAY_ISEC_CACHE_H
 #define SNOGRAY_ISEC_CACHE_H
 
-#include "config.h"
-
-#include "surface/surface.h"
-
-
-// We use intptr_t below.  If the system defines, it we must include
-// the proper include file, otherwise, it should be defined in
-// "config.h".  Note that we use the C versions of the header files.
-//
-#if HAVE_INTPTR_T
-# if HAVE_STDINT_H
-#  include <stdint.h>
-# elif HAVE_INTTYPES_H
-#  include <inttypes.h>
-# endif
-#endif // HAVE_INTPTR_T
+#include "renderable-ref.h"
 
 
 namespace snogray {
@@ -51,7 +36,7 @@ public:
 
   // Return true if there's an up-to-date entry for SURF in the cache.
   //
-  bool contains (const Surface::Renderable *surf) const
+  bool contains (const RenderableRef &surf) const
   {
     const Mbox &mbox = lookup (surf);
     return mbox.gen == gen && mbox.surf == surf;
@@ -60,7 +45,7 @@ public:
   // Add an up-to-date entry for SURF.  Return true if a collision occurred
   // (the new entry removed an old one).
   //
-  bool add (const Surface::Renderable *surf)
+  bool add (const RenderableRef &surf)
   {
     Mbox &mbox = lookup (surf);
     bool collision = (mbox.gen == gen);
@@ -84,26 +69,23 @@ private:
   struct Mbox
   {
     gen_t gen;
-    const Surface::Renderable *surf;
+    RenderableRef surf;
   };
 
-  hash_t hash (const Surface::Renderable *surf) const
+  hash_t hash (const RenderableRef &surf) const
   {
-    // Just use the pointer as a hash value, throwing away some of the
-    // lower bits as they're usually zero.
-    //
-    // We first cast to intptr_t to avoid compiler warnings about a
-    // lossy cast (as hash_t may be smaller than a pointer), and then
-    // to hash_t to throw away any upper bits we don't care about.
+    // Renderables in the same set usually have consecutive indices,
+    // so just use the index, mixing in the set so that renderables
+    // with the same index in different sets don't collide.
     //
-    return (hash_t)((intptr_t)surf >> 3);
+    return surf.index + surf.set * 0x9E3779B1u;
   }
 
-  Mbox &lookup (const Surface::Renderable *surf)
+  Mbox &lookup (const RenderableRef &surf)
   {
     return mboxes[hash (surf) % TABLE_SIZE];
   }
-  const Mbox &lookup (const Surface::Renderable *surf) const
+  const Mbox &lookup (const RenderableRef &surf) const
   {
     return mboxes[hash (surf) % TABLE_SIZE];
   }
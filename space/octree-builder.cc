@@ -33,30 +33,22 @@ public:
   Builder ()
     // surface_ptr_list_nodes is initialized with dummy entry
     : num_real_surfaces (0),
-      surface_ptr_list_nodes (1, SurfacePtrListNode (0,0))
+      surface_ptr_list_nodes (1, SurfacePtrListNode (RenderableRef (), 0))
   { }
 
-  // Add SURFACE to the space being built.
-  //
-  virtual void add (const Surface::Renderable *surface)
-  {
-    num_real_surfaces++;
-    add (surface, surface->bbox ());
-  }
-
   // Make the final space.  Note that this can only be done once.
   //
   virtual const Space *make_space ();
 
   // Copy all of our nodes into TO_NODES, and their associated surface
-  // pointers into zero-terminated spans in TO_SURFACE_PTRS, using an
+  // references into null-terminated spans in TO_SURFACE_PTRS, using an
   // "optimized order", where nodes nearer the top of the node-tree
   // are closer to the front of TO_NODES (and the corresponding
   // surface lists are closer to beginning of TO_SURFACE_PTRS).
   //
   void copy_optimized_nodes (
 	 std::vector<Node> &to_nodes,
-	 std::vector<const Surface::Renderable *> &to_surface_ptrs)
+	 std::vector<RenderableRef> &to_surface_ptrs)
     const;
 
   // One corner of the octree.
@@ -71,9 +63,20 @@ public:
   //
   unsigned long num_real_surfaces;
 
+protected:
+
+  // Add the renderable referred to by REF, which has a bounding box
+  // of BBOX, to the space being built.
+  //
+  virtual void add_renderable (const RenderableRef &ref, const BBox &bbox)
+  {
+    num_real_surfaces++;
+    add (ref, bbox);
+  }
+
 private:
 
-  // An entry in a linked list of Surface::Renderable pointers.  These are
+  // An entry in a linked list of renderable references.  These are
   // referred to by integer indices (to make it possible to store them
   // in a growing vector).  Note that index 0 always means "end of
   // list."
@@ -83,24 +86,24 @@ private:
   //
   struct SurfacePtrListNode
   {
-    SurfacePtrListNode (const Surface::Renderable *_surface,
+    SurfacePtrListNode (const RenderableRef &_surface,
 			unsigned _next_node_index)
       : surface (_surface), next_node_index (_next_node_index)
     { }
-    const Surface::Renderable *surface;
+    RenderableRef surface;
     unsigned next_node_index;
   };
 
   // Add SURFACE to the octree.  SURFACE_BBOX should be SURFACE's
   // bounding-box.
   //
-  void add (const Surface::Renderable *surface, const BBox &surface_bbox);
+  void add (const RenderableRef &surface, const BBox &surface_bbox);
 
   // Add SURFACE, with bounding box SURFACE_BBOX, to the node at
   // NODE_INDEX or some subnode; SURFACE is assumed to fit.  X, Y, Z,
   // and SIZE indicate the volume this node encompasses.
   //
-  void add (const Surface::Renderable *surface, const BBox &surface_bbox,
+  void add (const RenderableRef &surface, const BBox &surface_bbox,
 	    unsigned node_index,
 	    coord_t x, coord_t y, coord_t z, dist_t size);
 
@@ -109,7 +112,7 @@ private:
   // SURFACE is assumed to fit.  X, Y, Z, and SIZE indicate the volume
   // this node encompasses.
   //
-  void add_to_child (const Surface::Renderable *surface,
+  void add_to_child (const RenderableRef &surface,
 		     const BBox &surface_bbox,
 		     unsigned node_index, unsigned child_num,
 		     coord_t x, coord_t y, coord_t z, dist_t size);
@@ -118,14 +121,14 @@ private:
   // SURFACE; add surrounding levels of nodes until one can hold
   // SURFACE, and make that the new root node.
   //
-  void grow_to_include (const Surface::Renderable *surface,
+  void grow_to_include (const RenderableRef &surface,
 			const BBox &surface_bbox);
 
   // Push SURFACE onto the a list of surface-pointers whose head is
   // indicated by the index in HEAD_INDEX.  HEAD_INDEX is updated to
   // include the new pointer.
   //
-  void push_surface_ptr (const Surface::Renderable *surface,
+  void push_surface_ptr (const RenderableRef &surface,
 			 unsigned &head_index)
   {
     unsigned new_head = surface_ptr_list_nodes.size ();
@@ -137,19 +140,19 @@ private:
   // HEAD_INDEX in Octree::Builder::surface_ptr_list_nodes, to the end
   // of SURFACE_PTRs, returning the index in SURFACE_PTRS of the first
   // entry (the the last entry will be at the end of SURFACE_PTRS).
-  // An additional final zero entry is also added to terminate the
+  // An additional final null entry is also added to terminate the
   // list.
   //
   unsigned unroll_surface_ptr_list (
 	     unsigned head_index,
-	     std::vector<const Surface::Renderable *> &surface_ptrs)
+	     std::vector<RenderableRef> &surface_ptrs)
     const
   {
     unsigned rval = surface_ptrs.size ();
     for (unsigned index = head_index;
 	 index; index = surface_ptr_list_nodes[index].next_node_index)
       surface_ptrs.push_back (surface_ptr_list_nodes[index].surface);
-    surface_ptrs.push_back (0); // list terminator
+    surface_ptrs.push_back (RenderableRef ()); // list terminator
     return rval;
   }
 
@@ -171,7 +174,7 @@ private:
 // bounding-box.
 //
 void
-Octree::Builder::add (const Surface::Renderable *surface, const BBox &surface_bbox)
+Octree::Builder::add (const RenderableRef &surface, const BBox &surface_bbox)
 {
   if (! nodes.empty ())
     // We've already got some nodes.
@@ -224,7 +227,7 @@ Octree::Builder::add (const Surface::Renderable *surface, const BBox &surface_bb
 // make that the new root node.
 //
 void
-Octree::Builder::grow_to_include (const Surface::Renderable *surface,
+Octree::Builder::grow_to_include (const RenderableRef &surface,
 				  const BBox &surface_bbox)
 {
   // Make a new root node.  The root node must always be the first
@@ -334,7 +337,7 @@ Octree::Builder::grow_to_include (const Surface::Renderable *surface,
 // sparsely populated octree levels.
 //
 void
-Octree::Builder::add (const Surface::Renderable *surface, const BBox &surface_bbox,
+Octree::Builder::add (const RenderableRef &surface, const BBox &surface_bbox,
 		      unsigned node_index,
 		      coord_t x, coord_t y, coord_t z, dist_t size)
 {
@@ -503,7 +506,7 @@ Octree::Builder::add (const Surface::Renderable *surface, const BBox &surface_bb
 // this node encompasses.
 //
 void
-Octree::Builder::add_to_child (const Surface::Renderable *surface, const BBox &surface_bbox,
+Octree::Builder::add_to_child (const RenderableRef &surface, const BBox &surface_bbox,
 			       unsigned node_index, unsigned child_num,
 			       coord_t x, coord_t y, coord_t z, dist_t size)
 {
@@ -529,7 +532,7 @@ Octree::Builder::add_to_child (const Surface::Renderable *surface, const BBox &s
 // Octree::Builder::copy_optimized_nodes
 
 // Copy all of our nodes into TO_NODES, and their associated surface
-// pointers into zero-terminated spans in TO_SURFACE_PTRS, using an
+// references into null-terminated spans in TO_SURFACE_PTRS, using an
 // "optimized order", where nodes nearer the top of the node-tree are
 // closer to the front of TO_NODES (and the corresponding surface
 // lists are closer to beginning of TO_SURFACE_PTRS).
@@ -537,7 +540,7 @@ Octree::Builder::add_to_child (const Surface::Renderable *surface, const BBox &s
 void
 Octree::Builder::copy_optimized_nodes (
 		   std::vector<Node> &to_nodes,
-		   std::vector<const Surface::Renderable *> &to_surface_ptrs)
+		   std::vector<RenderableRef> &to_surface_ptrs)
   const
 {
   //
@@ -573,9 +576,9 @@ Octree::Builder::copy_optimized_nodes (
   to_nodes.reserve (nodes.size ());
   to_surface_ptrs.reserve (num_surface_ptr_entries);
 
-  // Add the reserved zero-entry to octree.surface_ptrs
+  // Add the reserved null entry to octree.surface_ptrs
   //
-  to_surface_ptrs.push_back (0);
+  to_surface_ptrs.push_back (RenderableRef ());
 
 
   //
@@ -34,6 +34,7 @@ struct Octree::SearchState : Space::SearchState
 			 | (ray.dir.y >= 0 ? Node::Y_LO : Node::Y_HI)
 			 | (ray.dir.z >= 0 ? Node::Z_LO : Node::Z_HI)),
       nodes (_octree.nodes), surface_ptrs (_octree.surface_ptrs),
+      renderable_sets (_octree.renderable_sets),
       negative_isec_cache (_negative_isec_cache),
       neg_cache_hits (0), neg_cache_collisions (0)
   { }
@@ -77,7 +78,11 @@ struct Octree::SearchState : Space::SearchState
   // Node and surface-pointer vectors from Octree.
   //
   const std::vector<Node> &nodes;
-  const std::vector<const Surface::Renderable *> &surface_ptrs;
+  const std::vector<RenderableRef> &surface_ptrs;
+
+  // Renderable sets referred to by entries in SURFACE_PTRS.
+  //
+  const std::vector<const Surface::RenderableSet *> &renderable_sets;
 
   // Cache of negative surface intersection test results, so we can
   // avoid testing the same object twice.
@@ -194,15 +199,15 @@ Octree::SearchState::for_each_possible_intersector (
   //
   if (node.surface_ptrs_head_index)
     for (unsigned surf_ptr_index = node.surface_ptrs_head_index;
-	 surface_ptrs[surf_ptr_index]; surf_ptr_index++)
+	 surface_ptrs[surf_ptr_index].valid (); surf_ptr_index++)
       {
-	const Surface::Renderable *surf = surface_ptrs[surf_ptr_index];
+	const RenderableRef &surf = surface_ptrs[surf_ptr_index];
 
 	if (! negative_isec_cache.contains (surf))
 	  {
 	    surf_isec_tests++;
 
-	    if (callback (surf))
+	    if (callback (renderable_sets[surf.set], surf.index))
 	      surf_isec_hits++;
 	    else
 	      {
@@ -349,7 +354,8 @@ Octree::upd_stats (const Node &node, Stats &stats) const
 
   // Num surfaces
   //
-  for (unsigned spi = node.surface_ptrs_head_index; surface_ptrs[spi]; spi++)
+  for (unsigned spi = node.surface_ptrs_head_index;
+       surface_ptrs[spi].valid (); spi++)
     stats.num_surfaces++;
 
   // Update `max_depth' field.
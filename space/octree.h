@@ -100,11 +100,11 @@ private:
   //
   std::vector<Node> nodes;
 
-  // Pointers to surfaces referred to in this octree.
-  // Surface-pointers occur in runs inside this vector with a NULL
-  // pointer following the last entry in a list.
+  // References to surfaces referred to in this octree.
+  // Surface-references occur in runs inside this vector with a null
+  // reference following the last entry in a list.
   //
-  std::vector<const Surface::Renderable *> surface_ptrs;
+  std::vector<RenderableRef> surface_ptrs;
 
   // One corner of the octree.
   //
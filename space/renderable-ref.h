@@ -0,0 +1,47 @@
+// renderable-ref.h -- Compact reference to a renderable in a Space
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_RENDERABLE_REF_H
+#define SNOGRAY_RENDERABLE_REF_H
+
+
+namespace snogray {
+
+
+// A reference to a single renderable stored in a Space:  the index of
+// a Surface::RenderableSet in the space's list of renderable sets,
+// and the index of the renderable within that set.
+//
+// Set index zero is never used for a real set, so a default-constructed
+// RenderableRef is a "null" reference, used to terminate lists.
+//
+struct RenderableRef
+{
+  RenderableRef () : set (0), index (0) { }
+  RenderableRef (unsigned _set, unsigned _index) : set (_set), index (_index) { }
+
+  // Return true if this is a non-null reference.
+  //
+  bool valid () const { return set != 0; }
+
+  bool operator== (const RenderableRef &ref) const
+  {
+    return set == ref.set && index == ref.index;
+  }
+
+  unsigned set, index;
+};
+
+
+}
+
+#endif // SNOGRAY_RENDERABLE_REF_H
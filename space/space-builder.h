@@ -17,8 +17,11 @@
 
 #include "util/unique-ptr.h"
 #include "util/deletion-list.h"
+#include "util/phase-profile.h"
 #include "surface/surface.h"
 
+#include "renderable-ref.h"
+
 
 namespace snogray {
 
@@ -27,10 +30,16 @@ class Space;
 
 // A class used for building a Space object.
 //
+// Renderables are stored in the final space as compact RenderableRef
+// values, referring to a Surface::RenderableSet object and an index
+// within it.  Individually added Surface::Renderable objects are kept
+// in a special set owned by the space.
+//
 class SpaceBuilder
 {
 public:
 
+  SpaceBuilder ();
   virtual ~SpaceBuilder() { }
 
   // Add RENDERABLE to the space being built.
@@ -40,7 +49,14 @@ public:
   // Space object is; to do that, separately call
   // SpaceBuilder::delete_after_rendering on RENDERABLE.
   //
-  virtual void add (const Surface::Renderable *renderable) = 0;
+  void add (const Surface::Renderable *renderable);
+
+  // Add renderable INDEX from SET to the space being built.
+  //
+  // SET should be valid as long as the final Space object is, and
+  // will _not_ be deallocated when the Space object is.
+  //
+  void add (const Surface::RenderableSet *set, unsigned index);
 
   // Arrange for PTR to be deleted properly after rendering is
   // complete.  This is intended for use by allocated instances of
@@ -61,15 +77,47 @@ public:
   //
   virtual const Space *make_space () = 0;
 
+protected:
+
+  // Add the renderable referred to by REF, which has a bounding box
+  // of BBOX, to the space being built.
+  //
+  virtual void add_renderable (const RenderableRef &ref, const BBox &bbox) = 0;
+
 private:
 
   friend class Space;
 
+  // A Surface::RenderableSet holding individual Surface::Renderable
+  // objects.
+  //
+  class RenderableList;
+
+  // Return the index of SET in RENDERABLE_SETS, adding it if necessary.
+  //
+  unsigned renderable_set_index (const Surface::RenderableSet *set);
+
   // A list of things to be deleted after rendering.  This is intended
   // for use by allocated instances of Surface::Renderable, but can be
   // used for other things too.
   //
   DeletionList deletion_list;
+
+  // All renderable sets referred to by renderables in this space.
+  // Entry zero is unused (see RenderableRef), and entry one is
+  // always RENDERABLE_LIST.
+  //
+  std::vector<const Surface::RenderableSet *> renderable_sets;
+
+  // Set holding renderables added individually.
+  //
+  RenderableList *renderable_list;
+
+  // The most recently used set and its index in RENDERABLE_SETS, as a
+  // set's renderables are usually all added together.
+  //
+  const Surface::RenderableSet *last_set;
+  unsigned last_set_index;
 };
 
 
@@ -85,6 +133,8 @@ public:
   //
   const Space *make_space (const Surface &surface) const
   {
+    PhaseProfile::Phase phase ("scene space build");
+
     UniquePtr<SpaceBuilder> space_builder (make_space_builder ());
 
     surface.add_to_space (*space_builder);
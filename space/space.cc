@@ -10,6 +10,8 @@
 // Written by Miles Bader <miles@gnu.org>
 //
 
+#include <algorithm>
+
 #include "surface/surface.h"
 #include "light/light.h"
 
@@ -26,6 +28,118 @@ using namespace snogray;
 Space::Space (SpaceBuilder &builder)
 {
   deletion_list.swap (builder.deletion_list);
+  renderable_sets.swap (builder.renderable_sets);
+}
+
+
+
+// SpaceBuilder::RenderableList
+
+// A Surface::RenderableSet holding individual Surface::Renderable
+// objects, used for renderables added with
+// SpaceBuilder::add(const Surface::Renderable *).
+//
+class SpaceBuilder::RenderableList : public Surface::RenderableSet
+{
+public:
+
+  unsigned add (const Surface::Renderable *renderable)
+  {
+    renderables.push_back (renderable);
+    return renderables.size () - 1;
+  }
+
+  virtual const Surface::Renderable::IsecInfo *intersect (
+						 unsigned index, Ray &ray,
+						 RenderContext &context)
+    const
+  {
+    return renderables[index]->intersect (ray, context);
+  }
+
+  virtual bool intersects (unsigned index, const Ray &ray,
+			   RenderContext &context)
+    const
+  {
+    return renderables[index]->intersects (ray, context);
+  }
+
+  virtual bool occludes (unsigned index, const Ray &ray,
+			 const Medium &medium, Color &total_transmittance,
+			 RenderContext &context)
+    const
+  {
+    return renderables[index]->occludes (ray, medium, total_transmittance,
+					 context);
+  }
+
+  virtual BBox bbox (unsigned index) const
+  {
+    return renderables[index]->bbox ();
+  }
+
+private:
+
+  std::vector<const Surface::Renderable *> renderables;
+};
+
+
+
+// SpaceBuilder
+
+SpaceBuilder::SpaceBuilder ()
+  : renderable_sets (2, static_cast<const Surface::RenderableSet *> (0)),
+    renderable_list (new RenderableList), last_set (0), last_set_index (0)
+{
+  renderable_sets[1] = renderable_list;
+  deletion_list.add (renderable_list);
+}
+
+// Add RENDERABLE to the space being built.
+//
+// RENDERABLE will be stored into the final Space object, and should
+// be valid as long as it is, but will _not_ be deallocated when the
+// Space object is; to do that, separately call
+// SpaceBuilder::delete_after_rendering on RENDERABLE.
+//
+void
+SpaceBuilder::add (const Surface::Renderable *renderable)
+{
+  unsigned index = renderable_list->add (renderable);
+  add_renderable (RenderableRef (1, index), renderable->bbox ());
+}
+
+// Add renderable INDEX from SET to the space being built.
+//
+// SET should be valid as long as the final Space object is, and
+// will _not_ be deallocated when the Space object is.
+//
+void
+SpaceBuilder::add (const Surface::RenderableSet *set, unsigned index)
+{
+  add_renderable (RenderableRef (renderable_set_index (set), index),
+		  set->bbox (index));
+}
+
+// Return the index of SET in RENDERABLE_SETS, adding it if necessary.
+//
+unsigned
+SpaceBuilder::renderable_set_index (const Surface::RenderableSet *set)
+{
+  if (set != last_set)
+    {
+      std::vector<const Surface::RenderableSet *>::iterator i
+	= std::find (renderable_sets.begin () + 2, renderable_sets.end (),
+		     set);
+
+      last_set_index = i - renderable_sets.begin ();
+      last_set = set;
+
+      if (i == renderable_sets.end ())
+	renderable_sets.push_back (set);
+    }
+
+  return last_set_index;
 }
 
 
@@ -39,10 +153,10 @@ struct Space::ClosestIntersectCallback : Space::IntersectCallback
     : ray (_ray), closest (0), context (_context)
   { }
 
-  virtual bool operator() (const Surface::Renderable *surf)
+  virtual bool operator() (const Surface::RenderableSet *set, unsigned index)
   {
     const Surface::Renderable::IsecInfo *isec_info
-      = surf->intersect (ray, context);
+      = set->intersect (index, ray, context);
     if (isec_info)
       {
 	closest = isec_info;
@@ -93,9 +207,9 @@ struct Space::IntersectsCallback : Space::IntersectCallback
     : ray (_ray), intersects (false), context (_context)
   { }
 
-  virtual bool operator() (const Surface::Renderable *surf)
+  virtual bool operator() (const Surface::RenderableSet *set, unsigned index)
   {
-    intersects = surf->intersects (ray, context);
+    intersects = set->intersects (index, ray, context);
 
     if (intersects)
       // We can immediately return it; stop looking any further.
@@ -141,9 +255,10 @@ struct Space::OccludesCallback : Space::IntersectCallback
       medium (_medium), context (_context), occludes (false)
   { }
 
-  virtual bool operator() (const Surface::Renderable *surf)
+  virtual bool operator() (const Surface::RenderableSet *set, unsigned index)
   {
-    occludes = surf->occludes (ray, medium, total_transmittance, context);
+    occludes
+      = set->occludes (index, ray, medium, total_transmittance, context);
     if (occludes)
       stop_iteration ();
     return occludes;
@@ -13,11 +13,15 @@
 #ifndef SNOGRAY_SPACE_H
 #define SNOGRAY_SPACE_H
 
+#include <vector>
+
 #include "util/deletion-list.h"
 #include "geometry/ray.h"
 #include "surface/surface-renderable.h"
 #include "render/render-context.h"
 
+#include "renderable-ref.h"
+
 
 namespace snogray {
 
@@ -82,6 +86,11 @@ protected:
 					      RenderStats::IsecStats &isec_stats)
     const = 0;
 
+  // All renderable sets referred to by renderables in this space,
+  // indexed by RenderableRef::set.
+  //
+  std::vector<const Surface::RenderableSet *> renderable_sets;
+
 
 private:
 
@@ -111,11 +120,13 @@ struct Space::IntersectCallback
 
   virtual ~IntersectCallback () { }
 
-  // Test SURF to see if it really intersects, and return true if so.
-  // Returning true does not necessarily stop the search; to do that,
-  // call the IntersectCallback::stop_intersection method.
+  // Test renderable INDEX in SET to see if it really intersects, and
+  // return true if so.  Returning true does not necessarily stop the
+  // search; to do that, call the IntersectCallback::stop_intersection
+  // method.
   //
-  virtual bool operator() (const Surface::Renderable *surf) = 0;
+  virtual bool operator() (const Surface::RenderableSet *set, unsigned index)
+    = 0;
 
   void stop_iteration () { stop = true; }
 
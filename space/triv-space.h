@@ -51,10 +51,9 @@ public:
 					      RenderStats::IsecStats &)
     const
   {
-    for (std::vector<const Surface::Renderable *>::const_iterator i
-	   = surfaces.begin();
+    for (std::vector<RenderableRef>::const_iterator i = surfaces.begin();
 	 i != surfaces.end(); ++i)
-      callback (*i);
+      callback (renderable_sets[i->set], i->index);
   }
 
 private:  
@@ -64,7 +63,7 @@ private:
   //
   TrivSpace (Builder &builder);
 
-  std::vector<const Surface::Renderable *> surfaces;
+  std::vector<RenderableRef> surfaces;
 };
 
 
@@ -79,25 +78,27 @@ public:
 
   Builder () { }
 
-  // Add SURFACE to the space being built.
+  // Make the final space.  Note that this can only be done once.
   //
-  virtual void add (const Surface::Renderable *surface)
+  virtual const Space *make_space ()
   {
-    surfaces.push_back (surface);
+    return new TrivSpace (*this);
   }
 
-  // Make the final space.  Note that this can only be done once.
+protected:
+
+  // Add the renderable referred to by REF to the space being built.
   //
-  virtual const Space *make_space ()
+  virtual void add_renderable (const RenderableRef &ref, const BBox &)
   {
-    return new TrivSpace (*this);
+    surfaces.push_back (ref);
   }
 
 private:
 
   friend class TrivSpace;
 
-  std::vector<const Surface::Renderable *> surfaces;
+  std::vector<RenderableRef> surfaces;
 };
 
 
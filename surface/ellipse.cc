@@ -206,6 +206,10 @@ public:
 					     const Vec &dir)
     const;
 
+  // Return the area of (one side of) the surface being sampled.
+  //
+  virtual float area () const { return 1 / pdf; }
+
 private:
 
   const Ellipse &ellipse;
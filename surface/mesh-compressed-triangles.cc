@@ -0,0 +1,95 @@
+// mesh-compressed-triangles.cc -- Compact storage for mesh triangle indices
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <algorithm>
+
+#include "mesh-compressed-triangles.h"
+
+
+using namespace snogray;
+
+
+const unsigned MeshCompressedTriangles::CLUSTER_SIZE;
+
+
+MeshCompressedTriangles::MeshCompressedTriangles (
+			   const vert_index_t *tri_vert_indices,
+			   unsigned _num_tris)
+  : num_tris (_num_tris),
+    clusters ((_num_tris + CLUSTER_SIZE - 1) / CLUSTER_SIZE)
+{
+  for (unsigned c = 0; c < clusters.size (); c++)
+    {
+      const vert_index_t *begin = tri_vert_indices + c * CLUSTER_SIZE * 3;
+      const vert_index_t *end
+	= tri_vert_indices + std::min ((c + 1) * CLUSTER_SIZE, num_tris) * 3;
+
+      vert_index_t min = *std::min_element (begin, end);
+      vert_index_t max = *std::max_element (begin, end);
+
+      Cluster &cl = clusters[c];
+      cl.base = min;
+
+      if (max - min <= 255)
+	{
+	  cl.width = 1;
+	  cl.start = indices8.size ();
+	  for (const vert_index_t *vi = begin; vi != end; ++vi)
+	    indices8.push_back (*vi - min);
+	}
+      else if (max - min <= 65535)
+	{
+	  cl.width = 2;
+	  cl.start = indices16.size ();
+	  for (const vert_index_t *vi = begin; vi != end; ++vi)
+	    indices16.push_back (*vi - min);
+	}
+      else
+	{
+	  cl.width = 4;
+	  cl.start = indices32.size ();
+	  indices32.insert (indices32.end (), begin, end);
+	}
+    }
+
+  // Free any excess capacity left over from growing the index arrays.
+  //
+  std::vector<unsigned char> (indices8).swap (indices8);
+  std::vector<unsigned short> (indices16).swap (indices16);
+  std::vector<vert_index_t> (indices32).swap (indices32);
+}
+
+// Append the vertex indices of all triangles to TRI_VERT_INDICES,
+// three entries per triangle.
+//
+void
+MeshCompressedTriangles::get_all (std::vector<vert_index_t> &tri_vert_indices)
+  const
+{
+  unsigned offs = tri_vert_indices.size ();
+  tri_vert_indices.resize (offs + num_tris * 3);
+
+  for (unsigned t = 0; t < num_tris; t++)
+    get (t, &tri_vert_indices[offs + t * 3]);
+}
+
+// Return the number of bytes of memory used.
+//
+size_t
+MeshCompressedTriangles::memory_size () const
+{
+  return (sizeof *this
+	  + clusters.capacity () * sizeof (Cluster)
+	  + indices8.capacity () * sizeof (unsigned char)
+	  + indices16.capacity () * sizeof (unsigned short)
+	  + indices32.capacity () * sizeof (vert_index_t));
+}
@@ -0,0 +1,120 @@
+// mesh-compressed-triangles.h -- Compact storage for mesh triangle indices
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_MESH_COMPRESSED_TRIANGLES_H
+#define SNOGRAY_MESH_COMPRESSED_TRIANGLES_H
+
+#include <vector>
+
+
+namespace snogray {
+
+
+// Compact storage for the vertex indices of the triangles in a mesh
+// part, used by Mesh::compress_vertices.
+//
+// Triangles are divided into clusters of CLUSTER_SIZE consecutive
+// triangles, and the vertex indices in each cluster are stored
+// relative to the smallest index in the cluster, using 8 bits per
+// index if they all fit, otherwise 16 bits, or, failing that, the
+// full 32 bits.  As triangles that are close in a mesh tend to use
+// vertices that are close in the vertex array, most clusters usually
+// use 8-bit indices, so a triangle typically takes 3 bytes instead of
+// 12 bytes uncompressed.
+//
+// Unlike MeshCompressedVertices, this is lossless.
+//
+class MeshCompressedTriangles
+{
+public:
+
+  typedef unsigned vert_index_t;
+
+  // Number of triangles in each cluster.
+  //
+  static const unsigned CLUSTER_SIZE = 64;
+
+  // Make a compressed copy of the NUM_TRIS triangles in
+  // TRI_VERT_INDICES, which should contain three entries for each
+  // triangle.
+  //
+  MeshCompressedTriangles (const vert_index_t *tri_vert_indices,
+			   unsigned num_tris);
+
+  unsigned size () const { return num_tris; }
+
+  // Return the vertex indices of triangle TRI in VI.
+  //
+  void get (unsigned tri, vert_index_t vi[3]) const
+  {
+    const Cluster &cl = clusters[tri / CLUSTER_SIZE];
+    unsigned offs = cl.start + (tri % CLUSTER_SIZE) * 3;
+
+    switch (cl.width)
+      {
+      case 1:
+	vi[0] = cl.base + indices8[offs];
+	vi[1] = cl.base + indices8[offs + 1];
+	vi[2] = cl.base + indices8[offs + 2];
+	break;
+      case 2:
+	vi[0] = cl.base + indices16[offs];
+	vi[1] = cl.base + indices16[offs + 1];
+	vi[2] = cl.base + indices16[offs + 2];
+	break;
+      default:
+	vi[0] = indices32[offs];
+	vi[1] = indices32[offs + 1];
+	vi[2] = indices32[offs + 2];
+	break;
+      }
+  }
+
+  // Append the vertex indices of all triangles to TRI_VERT_INDICES,
+  // three entries per triangle.
+  //
+  void get_all (std::vector<vert_index_t> &tri_vert_indices) const;
+
+  // Return the number of bytes of memory used.
+  //
+  size_t memory_size () const;
+
+private:
+
+  // A cluster of triangles.  WIDTH is the number of bytes used for
+  // each vertex index in the cluster, and START is the offset of the
+  // cluster's first index in the array for that width.  Indices in
+  // 8-bit and 16-bit clusters are relative to BASE.
+  //
+  struct Cluster
+  {
+    vert_index_t base;
+    unsigned start;
+    unsigned char width;
+  };
+
+  unsigned num_tris;
+
+  std::vector<Cluster> clusters;
+
+  // Vertex indices, three per triangle, for clusters using 8-bit,
+  // 16-bit, and 32-bit indices respectively.
+  //
+  std::vector<unsigned char> indices8;
+  std::vector<unsigned short> indices16;
+  std::vector<vert_index_t> indices32;
+};
+
+
+}
+
+#endif // SNOGRAY_MESH_COMPRESSED_TRIANGLES_H
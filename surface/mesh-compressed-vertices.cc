@@ -0,0 +1,193 @@
+// mesh-compressed-vertices.cc -- Compact quantized storage for mesh vertices
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include "util/parallel-for.h"
+
+#include "mesh-compressed-vertices.h"
+
+
+using namespace snogray;
+
+
+const unsigned MeshCompressedVertices::CLUSTER_SIZE;
+
+
+namespace { // keep local to file
+
+// Return VAL quantized to a 16-bit value relative to MIN and SCALE.
+//
+inline unsigned short
+quantize (float val, float min, float scale)
+{
+  if (scale == 0)
+    return 0;
+
+  float q = floor ((val - min) / scale + 0.5f);
+  return q < 0 ? 0 : q > 65535 ? 65535 : (unsigned short)q;
+}
+
+// Return VAL, which should be in the range -1 to 1, as a 16-bit
+// fixed-point value, rounded down if ROUND_UP is false, or up if it's
+// true.
+//
+inline short
+snorm16 (float val, bool round_up)
+{
+  float q = round_up ? ceil (val * 32767) : floor (val * 32767);
+  return q < -32767 ? -32767 : q > 32767 ? 32767 : (short)q;
+}
+
+} // namespace
+
+
+MeshCompressedVertices::MeshCompressedVertices (const SPos *_positions,
+						const SVec *_normals,
+						const UV *_uvs,
+						unsigned _num_verts)
+  : num_verts (_num_verts),
+    clusters ((_num_verts + CLUSTER_SIZE - 1) / CLUSTER_SIZE),
+    positions (_num_verts * 3)
+{
+  if (_normals)
+    normals.resize (num_verts * 2);
+  if (_uvs)
+    uvs.resize (num_verts * 2);
+
+  ClusterCompressor compressor (*this, _positions, _normals, _uvs);
+  parallel_for (0, clusters.size (), compressor, 64);
+}
+
+// Compress the vertices in clusters [BEGIN_CLUSTER, END_CLUSTER)
+// from POSITIONS, NORMALS and UVS (the latter two may be zero).
+//
+void
+MeshCompressedVertices::compress_clusters (const SPos *_positions,
+					   const SVec *_normals,
+					   const UV *_uvs,
+					   unsigned begin_cluster,
+					   unsigned end_cluster)
+{
+  for (unsigned c = begin_cluster; c < end_cluster; c++)
+    {
+      unsigned begin = c * CLUSTER_SIZE;
+      unsigned end = std::min (begin + CLUSTER_SIZE, num_verts);
+
+      SPos min = _positions[begin], max = min;
+      for (unsigned v = begin + 1; v < end; v++)
+	{
+	  const SPos &pos = _positions[v];
+	  min = SPos (std::min (min.x, pos.x), std::min (min.y, pos.y),
+		      std::min (min.z, pos.z));
+	  max = SPos (std::max (max.x, pos.x), std::max (max.y, pos.y),
+		      std::max (max.z, pos.z));
+	}
+
+      Cluster &cl = clusters[c];
+      cl.min = min;
+      cl.scale = (max - min) / 65535;
+
+      for (unsigned v = begin; v < end; v++)
+	{
+	  const SPos &pos = _positions[v];
+	  positions[v * 3] = quantize (pos.x, cl.min.x, cl.scale.x);
+	  positions[v * 3 + 1] = quantize (pos.y, cl.min.y, cl.scale.y);
+	  positions[v * 3 + 2] = quantize (pos.z, cl.min.z, cl.scale.z);
+	}
+
+      if (_normals)
+	for (unsigned v = begin; v < end; v++)
+	  encode_normal (_normals[v], normals[v * 2], normals[v * 2 + 1]);
+
+      if (_uvs)
+	{
+	  UV uv_min = _uvs[begin], uv_max = uv_min;
+	  for (unsigned v = begin + 1; v < end; v++)
+	    {
+	      const UV &uv = _uvs[v];
+	      uv_min = UV (std::min (uv_min.u, uv.u),
+			   std::min (uv_min.v, uv.v));
+	      uv_max = UV (std::max (uv_max.u, uv.u),
+			   std::max (uv_max.v, uv.v));
+	    }
+
+	  cl.uv_min = uv_min;
+	  cl.uv_scale = UV ((uv_max.u - uv_min.u) / 65535,
+			    (uv_max.v - uv_min.v) / 65535);
+
+	  for (unsigned v = begin; v < end; v++)
+	    {
+	      const UV &uv = _uvs[v];
+	      uvs[v * 2] = quantize (uv.u, cl.uv_min.u, cl.uv_scale.u);
+	      uvs[v * 2 + 1] = quantize (uv.v, cl.uv_min.v, cl.uv_scale.v);
+	    }
+	}
+    }
+}
+
+// Return the number of bytes of memory used.
+//
+size_t
+MeshCompressedVertices::memory_size () const
+{
+  return (sizeof *this
+	  + clusters.capacity () * sizeof (Cluster)
+	  + positions.capacity () * sizeof (unsigned short)
+	  + normals.capacity () * sizeof (short)
+	  + uvs.capacity () * sizeof (unsigned short));
+}
+
+
+// Normal encoding
+
+// Encode the unit vector NORM using octahedral encoding, returning the
+// result in E0 and E1.
+//
+// NORM is projected onto the octahedron |x| + |y| + |z| = 1, the lower
+// half of which is folded up over the diagonals, and the x and y
+// coordinates of the result are stored as 16-bit fixed-point values.
+// Of the four nearest fixed-point values, the one which decodes to
+// the vector closest to NORM is used.
+//
+void
+MeshCompressedVertices::encode_normal (const SVec &norm, short &e0, short &e1)
+{
+  float len = fabs (norm.x) + fabs (norm.y) + fabs (norm.z);
+  if (len == 0)
+    {
+      e0 = e1 = 0;
+      return;
+    }
+
+  float x = norm.x / len, y = norm.y / len;
+  if (norm.z < 0)
+    {
+      float fx = (1 - fabs (y)) * (x < 0 ? -1 : 1);
+      float fy = (1 - fabs (x)) * (y < 0 ? -1 : 1);
+      x = fx;
+      y = fy;
+    }
+
+  SVec unit_norm = norm.unit ();
+  float best_cos = -2;
+
+  for (unsigned i = 0; i < 4; i++)
+    {
+      short q0 = snorm16 (x, i & 1), q1 = snorm16 (y, i & 2);
+      float cos = dot (decode_normal (q0, q1), unit_norm);
+      if (cos > best_cos)
+	{
+	  best_cos = cos;
+	  e0 = q0;
+	  e1 = q1;
+	}
+    }
+}
@@ -0,0 +1,186 @@
+// mesh-compressed-vertices.h -- Compact quantized storage for mesh vertices
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_MESH_COMPRESSED_VERTICES_H
+#define SNOGRAY_MESH_COMPRESSED_VERTICES_H
+
+#include <vector>
+
+#include "geometry/pos.h"
+#include "geometry/vec.h"
+#include "geometry/uv.h"
+
+
+namespace snogray {
+
+
+// Lossily compressed storage for mesh vertex positions, and optionally
+// normals and UV values, used by Mesh::compress_vertices.
+//
+// Vertices are divided into clusters of CLUSTER_SIZE consecutive
+// vertices, and positions are stored as 16-bit fixed-point values
+// relative to the bounding box of their cluster.  As mesh vertices
+// that are close in the vertex array tend to be close in space, this
+// usually gives an error much smaller than a fixed-point encoding
+// relative to the whole mesh.  UV values are stored the same way,
+// relative to the UV bounds of their cluster.  Normals are stored as
+// two 16-bit values using an "octahedral" encoding.
+//
+// A vertex position, normal and UV value thus take 14 bytes, instead
+// of 32 bytes uncompressed.
+//
+// Decoding is cheap, and is done every time a value is fetched.
+//
+class MeshCompressedVertices
+{
+public:
+
+  // Number of vertices in each cluster.
+  //
+  static const unsigned CLUSTER_SIZE = 256;
+
+  // Make a compressed copy of the NUM_VERTS vertices in POSITIONS,
+  // and of the normals in NORMALS and UV values in UVS, if they are
+  // non-zero.
+  //
+  MeshCompressedVertices (const SPos *positions, const SVec *normals,
+			  const UV *uvs, unsigned num_verts);
+
+  unsigned size () const { return num_verts; }
+
+  bool has_normals () const { return ! normals.empty (); }
+  bool has_uvs () const { return ! uvs.empty (); }
+
+  // Return the position of vertex VERT.
+  //
+  SPos position (unsigned vert) const
+  {
+    const Cluster &cl = clusters[vert / CLUSTER_SIZE];
+    const unsigned short *q = &positions[vert * 3];
+    return SPos (cl.min.x + q[0] * cl.scale.x,
+		 cl.min.y + q[1] * cl.scale.y,
+		 cl.min.z + q[2] * cl.scale.z);
+  }
+
+  // Return the normal of vertex VERT.
+  //
+  SVec normal (unsigned vert) const
+  {
+    return decode_normal (normals[vert * 2], normals[vert * 2 + 1]);
+  }
+
+  // Return the UV value of vertex VERT.
+  //
+  UV uv (unsigned vert) const
+  {
+    const Cluster &cl = clusters[vert / CLUSTER_SIZE];
+    const unsigned short *q = &uvs[vert * 2];
+    return UV (cl.uv_min.u + q[0] * cl.uv_scale.u,
+	       cl.uv_min.v + q[1] * cl.uv_scale.v);
+  }
+
+  // Return the number of bytes of memory used.
+  //
+  size_t memory_size () const;
+
+  // Conversion between unit vectors and octahedral encoding.  A zero
+  // vector is encoded as if it were (0, 0, 1).
+  //
+  static void encode_normal (const SVec &norm, short &e0, short &e1);
+  static SVec decode_normal (short e0, short e1);
+
+private:
+
+  // Per-cluster quantization parameters.  A quantized coordinate Q
+  // represents the value MIN + Q * SCALE, and a quantized UV
+  // coordinate Q the value UV_MIN + Q * UV_SCALE.
+  //
+  struct Cluster
+  {
+    SPos min;
+    SVec scale;
+
+    UV uv_min, uv_scale;
+  };
+
+  // Compress the vertices in clusters [BEGIN_CLUSTER, END_CLUSTER)
+  // from POSITIONS, NORMALS and UVS (the latter two may be zero).
+  //
+  void compress_clusters (const SPos *positions, const SVec *normals,
+			  const UV *uvs,
+			  unsigned begin_cluster, unsigned end_cluster);
+
+  // Functor used to call compress_clusters from parallel_for.
+  //
+  struct ClusterCompressor
+  {
+    ClusterCompressor (MeshCompressedVertices &_cverts,
+		       const SPos *_positions, const SVec *_normals,
+		       const UV *_uvs)
+      : cverts (_cverts), positions (_positions), normals (_normals),
+	uvs (_uvs)
+    { }
+
+    void operator() (unsigned begin, unsigned end) const
+    {
+      cverts.compress_clusters (positions, normals, uvs, begin, end);
+    }
+
+    MeshCompressedVertices &cverts;
+    const SPos *positions;
+    const SVec *normals;
+    const UV *uvs;
+  };
+
+  unsigned num_verts;
+
+  std::vector<Cluster> clusters;
+
+  // Three quantized coordinates per vertex.
+  //
+  std::vector<unsigned short> positions;
+
+  // Two octahedral coordinates per vertex, or empty.
+  //
+  std::vector<short> normals;
+
+  // Two quantized UV coordinates per vertex, or empty.
+  //
+  std::vector<unsigned short> uvs;
+};
+
+
+// Return the unit vector encoded as E0, E1 using octahedral encoding.
+//
+inline SVec
+MeshCompressedVertices::decode_normal (short e0, short e1)
+{
+  float x = e0 * (1.f / 32767), y = e1 * (1.f / 32767);
+  float z = 1 - fabs (x) - fabs (y);
+
+  // Points in the lower hemisphere are folded over the diagonals.
+  //
+  if (z < 0)
+    {
+      float fx = (1 - fabs (y)) * (x < 0 ? -1 : 1);
+      float fy = (1 - fabs (x)) * (y < 0 ? -1 : 1);
+      x = fx;
+      y = fy;
+    }
+
+  return SVec (x, y, z).unit ();
+}
+
+
+}
+
+#endif // SNOGRAY_MESH_COMPRESSED_VERTICES_H
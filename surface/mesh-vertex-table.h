@@ -0,0 +1,164 @@
+// mesh-vertex-table.h -- Hash tables for sharing mesh vertices
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_MESH_VERTEX_TABLE_H
+#define SNOGRAY_MESH_VERTEX_TABLE_H
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "util/hash-bits.h"
+#include "geometry/pos.h"
+#include "geometry/vec.h"
+
+
+namespace snogray {
+
+
+// Return a hash of the bits of the floating-point number NUM, mixed
+// with HASH.  Positive and negative zero hash the same, as they compare
+// equal.
+//
+template<typename T>
+inline unsigned long long
+hash_float_bits (T num, unsigned long long hash)
+{
+  if (num == 0)
+    num = 0;
+
+  unsigned long long bits = 0;
+  std::memcpy (&bits, &num, sizeof num);
+
+  return mix_bits64 (hash ^ bits);
+}
+
+// Return a hash of the coordinates of TUPLE, mixed with HASH.
+//
+template<typename T>
+inline unsigned long long
+hash_tuple_bits (const Tuple3<T> &tuple, unsigned long long hash = 0)
+{
+  hash = hash_float_bits (tuple.x, hash + 0x9e3779b97f4a7c15ULL);
+  hash = hash_float_bits (tuple.y, hash);
+  return hash_float_bits (tuple.z, hash);
+}
+
+inline unsigned long long
+mesh_vertex_key_hash (const Pos &pos)
+{
+  return hash_tuple_bits (pos);
+}
+inline unsigned long long
+mesh_vertex_key_hash (const std::pair<Pos, Vec> &pos_norm)
+{
+  return hash_tuple_bits (pos_norm.second, hash_tuple_bits (pos_norm.first));
+}
+
+
+// A table mapping vertex keys of type Key (e.g., a position, or a
+// position and normal) to mesh vertex indices, used to share vertices
+// in a mesh (see Mesh::add_vertex).
+//
+// This is an open-addressed hash table, which unlike a std::map does
+// no allocation per entry, and has constant-time lookups.
+//
+template<typename Key>
+class MeshVertexTable
+{
+public:
+
+  MeshVertexTable () : mask (0) { }
+
+  // If there's an entry for KEY, return true and store its vertex
+  // index in VERT; otherwise return false.
+  //
+  bool find (const Key &key, unsigned &vert) const
+  {
+    if (entries.empty ())
+      return false;
+
+    for (unsigned slot = mesh_vertex_key_hash (key) & mask; ;
+	 slot = (slot + 1) & mask)
+      {
+	unsigned entry = slots[slot];
+	if (entry == 0)
+	  return false;
+	if (entries[entry - 1].first == key)
+	  {
+	    vert = entries[entry - 1].second;
+	    return true;
+	  }
+      }
+  }
+
+  // Add an entry mapping KEY to the vertex index VERT.  KEY should not
+  // already have an entry.
+  //
+  void insert (const Key &key, unsigned vert)
+  {
+    entries.push_back (std::make_pair (key, vert));
+
+    // Keep the table at most half full.
+    //
+    if (entries.size () * 2 > slots.size ())
+      rehash ();
+    else
+      add_slot (entries.size () - 1);
+  }
+
+private:
+
+  // Make the slot table large enough for the current entries, and
+  // re-insert all of them.
+  //
+  void rehash ()
+  {
+    unsigned size = 64;
+    while (size < entries.size () * 2)
+      size *= 2;
+
+    slots.assign (size, 0);
+    mask = size - 1;
+
+    for (unsigned i = 0; i < entries.size (); i++)
+      add_slot (i);
+  }
+
+  // Add a slot pointing to entry ENTRY.
+  //
+  void add_slot (unsigned entry)
+  {
+    unsigned slot = mesh_vertex_key_hash (entries[entry].first) & mask;
+    while (slots[slot] != 0)
+      slot = (slot + 1) & mask;
+    slots[slot] = entry + 1;
+  }
+
+  // All entries, in the order they were added.
+  //
+  std::vector<std::pair<Key, unsigned> > entries;
+
+  // Hash slots, each either zero (empty), or one plus an index into
+  // ENTRIES.  The size is always a power of two.
+  //
+  std::vector<unsigned> slots;
+
+  // The size of SLOTS minus one.
+  //
+  unsigned mask;
+};
+
+
+}
+
+#endif // SNOGRAY_MESH_VERTEX_TABLE_H
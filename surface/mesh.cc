@@ -10,15 +10,21 @@
 // Written by Miles Bader <miles@gnu.org>
 //
 
+#include <algorithm>
 #include <iostream>
 
 #include "util/globals.h"
 #include "util/excepts.h"
 #include "util/string-funs.h"
+#include "util/num-cores.h"
+#include "util/parallel-for.h"
+#include "util/phase-profile.h"
 
 #include "geometry/tripar-isec.h"
 #include "space/space-builder.h"
+#include "light/mesh-light-sampler.h"
 
+#include "mesh-compressed-triangles.h"
 #include "mesh.h"
 
 
@@ -33,6 +39,8 @@ using namespace snogray;
 Mesh::vert_index_t
 Mesh::add_vertex (const Pos &pos)
 {
+  uncompress_vertices ();
+
   vert_index_t vert_index = vertices.size ();
   vertices.push_back (MPos (pos));
   _bbox += pos;		   // make sure POS is included in the bounding-box
@@ -45,16 +53,13 @@ Mesh::add_vertex (const Pos &pos)
 Mesh::vert_index_t
 Mesh::add_vertex (const Pos &pos, VertexGroup &vgroup)
 {
-  VertexGroup::iterator prev_entry = vgroup.find (pos);
-
-  if (prev_entry != vgroup.end ())
-    return prev_entry->second;
-  else
+  vert_index_t vert_index;
+  if (! vgroup.find (pos, vert_index))
     {
-      vert_index_t vert_index = add_vertex (pos);
-      vgroup.insert (prev_entry, VertexGroup::value_type (pos, vert_index));
-      return vert_index;
+      vert_index = add_vertex (pos);
+      vgroup.insert (pos, vert_index);
     }
+  return vert_index;
 }
 
 
@@ -66,6 +71,8 @@ Mesh::add_vertex (const Pos &pos, VertexGroup &vgroup)
 Mesh::vert_index_t
 Mesh::add_vertex (const Pos &pos, const Vec &normal)
 {
+  uncompress_vertices ();
+
   vert_index_t vert_index = vertices.size ();
 
   // Make sure the vertex_normals vector contains entries for all previous
@@ -94,18 +101,15 @@ Mesh::add_vertex (const Pos &pos, const Vec &normal)
 Mesh::vert_index_t
 Mesh::add_vertex (const Pos &pos, const Vec &normal, VertexNormalGroup &vgroup)
 {
-  VertexNormalGroup::key_type key (pos, normal);
-  VertexNormalGroup::iterator prev_entry = vgroup.find (key);
+  std::pair<Pos, Vec> key (pos, normal);
 
-  if (prev_entry != vgroup.end ())
-    return prev_entry->second;
-  else
+  vert_index_t vert_index;
+  if (! vgroup.find (key, vert_index))
     {
-      vert_index_t vert_index = add_vertex (pos, normal);
-      vgroup.insert (prev_entry,
-		     VertexNormalGroup::value_type (key, vert_index));
-      return vert_index;
+      vert_index = add_vertex (pos, normal);
+      vgroup.insert (key, vert_index);
     }
+  return vert_index;
 }
 
 
@@ -120,6 +124,8 @@ Mesh::add_vertex (const Pos &pos, const Vec &normal, VertexNormalGroup &vgroup)
 Mesh::vert_index_t
 Mesh::add_normal (vert_index_t vert_index, const Vec &normal)
 {
+  uncompress_vertices ();
+
   // Make sure the vertex_normals vector contains entries for all previous
   // vertices (the effect of this is that if a mesh contains vertices with
   // explicit normals, all triangles will have interpolated normals, even
@@ -140,27 +146,86 @@ Mesh::add_normal (vert_index_t vert_index, const Vec &normal)
 
 // Mesh::Part
 
-struct Mesh::Part
+// A mesh part is exported to the space as a Surface::RenderableSet,
+// whose members are its triangles, so triangles need no per-triangle
+// renderable object; a triangle is just three vertex indices.
+//
+struct Mesh::Part : public Surface::RenderableSet
 {
   Part (const Mesh &_mesh, const Ref<const Material> &mat)
     : mesh (_mesh), material (mat)
   { }
 
 
-  // Add new triangles to this mesh part using vertices from
+  // Add NUM_TRIS new triangles to this mesh part using vertices from
   // TRI_VERT_INDICES.  TRI_VERT_INDICES should contain three entries
   // for each new triangle; the indices in TRI_VERT_INDICES are
   // relative to BASE_VERT (which should be a value returned from an
   // earlier call to Mesh::add_vertices).
   //
-  void add_triangles (const std::vector<vert_index_t> &tri_vert_indices,
+  void add_triangles (const vert_index_t *tri_vert_indices, unsigned num_tris,
 		      vert_index_t base_vert = 0);
 
+  // Add NUM_TRIS new triangles to this mesh part using the absolute
+  // vertex indices in TRI_VERT_INDICES.  If this part has no triangles
+  // yet, TRI_VERT_INDICES is used directly, without copying it (see
+  // Mesh::add_triangles).
+  //
+  void add_triangles (const vert_index_t *tri_vert_indices, unsigned num_tris,
+		      const Ref<const RefCounted> &owner);
+
   // Add Surface::Renderable objects associated with this mesh part to
   // the space being built by SPACE_BUILDER.
   //
   void add_to_space (SpaceBuilder &space_builder) const;
 
+  // Return the number of triangles in this part.
+  //
+  unsigned num_triangles () const
+  {
+    return compressed_tris ? compressed_tris->size () : tri_verts.size () / 3;
+  }
+
+  // Return the vertex indices of triangle INDEX in VI.
+  //
+  void triangle_verts (unsigned index, vert_index_t vi[3]) const
+  {
+    if (compressed_tris)
+      compressed_tris->get (index, vi);
+    else
+      {
+	const vert_index_t *tvi = &tri_verts[index * 3];
+	vi[0] = tvi[0];
+	vi[1] = tvi[1];
+	vi[2] = tvi[2];
+      }
+  }
+
+  // Replace TRI_VERTS with a compact representation (see the
+  // MeshCompressedTriangles class for details).
+  //
+  void compress_triangles ();
+
+  // If this part's triangles are compressed, convert them back to the
+  // normal uncompressed representation in TRI_VERTS.
+  //
+  void uncompress_triangles ();
+
+  // Surface::RenderableSet methods; INDEX is a triangle index.
+  //
+  virtual const Surface::Renderable::IsecInfo *intersect (
+						 unsigned index, Ray &ray,
+						 RenderContext &context)
+    const;
+  virtual bool intersects (unsigned index, const Ray &ray,
+			   RenderContext &context)
+    const;
+  virtual bool occludes (unsigned index, const Ray &ray,
+			 const Medium &medium, Color &total_transmittance,
+			 RenderContext &context)
+    const;
+  virtual BBox bbox (unsigned index) const;
+
 
   // A single triangle in the mesh.
   //
@@ -174,9 +239,16 @@ struct Mesh::Part
   //
   Ref<const Material> material;
 
-  // A vector of Mesh::Part::Triangle surfaces that use this part.
+  // Vertex indices of the triangles in this part, three per triangle.
+  // These may refer to an external array, e.g., in a memory-mapped
+  // file.
   //
-  std::vector<Triangle> triangles;
+  MappedVector<vert_index_t> tri_verts;
+
+  // If non-zero, this part's triangles are compressed, and are stored
+  // here instead of in TRI_VERTS, which is empty.
+  //
+  UniquePtr<MeshCompressedTriangles> compressed_tris;
 };
 
 
@@ -184,29 +256,19 @@ struct Mesh::Part
 // Mesh::Part::Triangle
 
 
-// A single triangle in a Mesh.  These are the exported renderable
-// object from meshes.
+// A single triangle in a Mesh.  This is a small temporary object,
+// made from the vertex indices stored in a mesh part when needed.
 //
-class Mesh::Part::Triangle : public Surface::Renderable
+class Mesh::Part::Triangle
 {
 public:
 
-  Triangle (const Mesh::Part &_part) : part (_part) { }
-
-  Triangle (const Part &_part,
-	    vert_index_t v0i, vert_index_t v1i, vert_index_t v2i)
+  // Make a triangle object for triangle INDEX in _PART.
+  //
+  Triangle (const Part &_part, unsigned index)
     : part (_part)
   {
-    vi[0] = v0i;
-    vi[1] = v1i;
-    vi[2] = v2i;
-  }
-
-  void operator= (const Triangle &triang)
-  {
-    vi[0] = triang.vi[0];
-    vi[1] = triang.vi[1];
-    vi[2] = triang.vi[2];
+    part.triangle_verts (index, vi);
   }
 
   // If this surface intersects RAY, change RAY's maximum bound
@@ -215,12 +277,13 @@ public:
   // (which should be allocated using placement-new with CONTEXT);
   // otherwise return zero.
   //
-  virtual const IsecInfo *intersect (Ray &ray, RenderContext &context) const;
+  const Surface::Renderable::IsecInfo *intersect (Ray &ray,
+						  RenderContext &context)
+    const;
 
   // Return true if this surface intersects RAY.
   //
-  virtual bool intersects (const Ray &ray, RenderContext &context)
-    const;
+  bool intersects (const Ray &ray, RenderContext &context) const;
 
   // Return true if this surface completely occludes RAY.  If it does
   // not completely occlude RAY, then return false, and multiply
@@ -232,31 +295,31 @@ public:
   // probably considered opaque because it changes light direction as
   // well as transmitting it).
   //
-  virtual bool occludes (const Ray &ray, const Medium &medium,
-			 Color &total_transmittance,
-			 RenderContext &context)
+  bool occludes (const Ray &ray, const Medium &medium,
+		 Color &total_transmittance,
+		 RenderContext &context)
     const;
 
   // Return a bounding box for this surface.
   //
-  virtual BBox bbox () const;
+  BBox bbox () const;
 
   // Vertex NUM of this triangle
   //
-  Pos v (unsigned num) const { return Pos (part.mesh.vertices[vi[num]]); }
+  Pos v (unsigned num) const { return part.mesh.vertex (vi[num]); }
 
   // Normal of vertex NUM (assuming this part contains vertex normals!)
   //
   Vec vnorm (unsigned num) const
   {
-    return Vec (part.mesh.vertex_normals[vi[num]]);
+    return part.mesh.vertex_normal (vi[num]);
   }
 
   // UV value of vertex NUM (assuming this part contains vertex UV values!)
   //
   UV vuv (unsigned num) const
   {
-    return part.mesh.vertex_uvs[vi[num]];
+    return part.mesh.vertex_uv (vi[num]);
   }
 
   // These both return the "raw" normal of this triangle, not doing
@@ -297,7 +360,7 @@ private:
     // mapping is used.
     //
     UV T1, T2;
-    if (part.mesh.vertex_uvs.empty ())
+    if (! part.mesh.has_vertex_uvs ())
       {
 	// The assignment of UV values to triangle vertices in the
 	// absence of UV-mapping information is fairly arbitrary.
@@ -344,8 +407,15 @@ private:
 Mesh::vert_index_t
 Mesh::add_vertices (const std::vector<MPos> &new_verts)
 {
+  uncompress_vertices ();
+
   vert_index_t base_vert = vertices.size ();
-  vertices.insert (vertices.end(), new_verts.begin(), new_verts.end());
+  vertices.append (new_verts.begin(), new_verts.end());
+
+  for (std::vector<MPos>::const_iterator vi = new_verts.begin ();
+       vi != new_verts.end (); ++vi)
+    _bbox += *vi;
+
   return base_vert;
 }
 
@@ -360,6 +430,8 @@ Mesh::add_vertices (const std::vector<MPos> &new_verts)
 Mesh::vert_index_t
 Mesh::add_vertices (const std::vector<scoord_t> &new_verts)
 {
+  uncompress_vertices ();
+
   vert_index_t base_vert = vertices.size ();
   unsigned num_new_verts = new_verts.size () / 3;
 
@@ -381,6 +453,57 @@ Mesh::add_vertices (const std::vector<scoord_t> &new_verts)
   return base_vert;
 }
 
+// Add NUM_VERTS vertices with positions from the array VERTS, and
+// corresponding normals and UV values from NORMALS and UVS (either of
+// which may be zero, if not available).  VERTS_BBOX should be a
+// bounding box for all of VERTS.  The index in the mesh of the first
+// new vertex is returned.
+//
+// If this mesh doesn't have any vertices yet, the arrays are used
+// directly, without copying them (they are only copied if later
+// modified); in that case, they must remain valid as long as OWNER,
+// which should typically be the memory-mapped file containing them,
+// is alive, and the mesh keeps a reference to OWNER.
+//
+Mesh::vert_index_t
+Mesh::add_vertices (const MPos *verts, const MVec *normals, const UV *uvs,
+		    unsigned num_verts, const BBox &verts_bbox,
+		    const Ref<const RefCounted> &owner)
+{
+  uncompress_vertices ();
+
+  vert_index_t base_vert = vertices.size ();
+
+  // As with Mesh::add_normals and Mesh::add_uvs, we don't know what to
+  // do if some existing vertices have normals or UVs and others don't.
+  //
+  if (normals && vertex_normals.size () != base_vert)
+    throw std::runtime_error ("Inconsistent normals in Mesh::add_vertices");
+  if (uvs && vertex_uvs.size () != base_vert)
+    throw std::runtime_error ("Inconsistent UVs in Mesh::add_vertices");
+
+  if (base_vert == 0)
+    {
+      vertices.map (verts, num_verts, owner);
+      if (normals)
+	vertex_normals.map (normals, num_verts, owner);
+      if (uvs)
+	vertex_uvs.map (uvs, num_verts, owner);
+    }
+  else
+    {
+      vertices.append (verts, verts + num_verts);
+      if (normals)
+	vertex_normals.append (normals, normals + num_verts);
+      if (uvs)
+	vertex_uvs.append (uvs, uvs + num_verts);
+    }
+
+  _bbox += verts_bbox;
+
+  return base_vert;
+}
+
 // Add all the normal vectors in NEW_NORMALS as vertex normals in this
 // mesh, corresponding to all the vertices starting from BASE_VERT
 // (which should be a value returned from an earlier call to
@@ -389,6 +512,8 @@ Mesh::add_vertices (const std::vector<scoord_t> &new_verts)
 void
 Mesh::add_normals (const std::vector<MVec> &new_normals, vert_index_t base_vert)
 {
+  uncompress_vertices ();
+
   // Not sure what to do if normals after BASE_VERT already exist, of
   // if vertices before BASE_VERT don't have normals yet, so just barf
   // in those cases.
@@ -399,8 +524,7 @@ Mesh::add_normals (const std::vector<MVec> &new_normals, vert_index_t base_vert)
     throw std::runtime_error (
 		 "Size of NEW_NORMALS incorrect in Mesh::add_normals");
 
-  vertex_normals.insert (vertex_normals.end(),
-			 new_normals.begin(), new_normals.end());
+  vertex_normals.append (new_normals.begin(), new_normals.end());
 }
 
 // Add all the normal vectors described by NEW_NORMALS as vertex
@@ -415,6 +539,8 @@ void
 Mesh::add_normals (const std::vector<sdist_t> &new_normals,
 		   vert_index_t base_vert)
 {
+  uncompress_vertices ();
+
   unsigned num_new_normals = new_normals.size () / 3;
 
   // Not sure what to do if normals after BASE_VERT already exist, of
@@ -450,6 +576,8 @@ Mesh::add_normals (const std::vector<sdist_t> &new_normals,
 void
 Mesh::add_uvs (const std::vector<UV> &new_uvs, vert_index_t base_vert)
 {
+  uncompress_vertices ();
+
   // Not sure what to do if uvs after BASE_VERT already exist, if
   // if vertices before BASE_VERT don't have uvs yet, so just barf
   // in those cases.
@@ -459,7 +587,7 @@ Mesh::add_uvs (const std::vector<UV> &new_uvs, vert_index_t base_vert)
   if (base_vert + new_uvs.size() != vertices.size ())
     throw std::runtime_error ("Size of NEW_UVS incorrect in Mesh::add_uvs");
 
-  vertex_uvs.insert (vertex_uvs.end(), new_uvs.begin(), new_uvs.end());
+  vertex_uvs.append (new_uvs.begin(), new_uvs.end());
 }
 
 // Add all the UV values described by NEW_UVS as vertex UV values in
@@ -472,6 +600,8 @@ Mesh::add_uvs (const std::vector<UV> &new_uvs, vert_index_t base_vert)
 void
 Mesh::add_uvs (const std::vector<float> &new_uvs, vert_index_t base_vert)
 {
+  uncompress_vertices ();
+
   unsigned num_new_uvs = new_uvs.size () / 2;
 
   // Not sure what to do if uvs after BASE_VERT already exist, of
@@ -502,30 +632,78 @@ Mesh::add_uvs (const std::vector<float> &new_uvs, vert_index_t base_vert)
 // Mesh::Part::add_triangles
 
 
-// Add new triangles to this mesh part using vertices from
+// Add NUM_TRIS new triangles to this mesh part using vertices from
 // TRI_VERT_INDICES.  TRI_VERT_INDICES should contain three entries
 // for each new triangle; the indices in TRI_VERT_INDICES are
 // relative to BASE_VERT (which should be a value returned from an
 // earlier call to Mesh::add_vertices).
 //
 void
-Mesh::Part::add_triangles (const std::vector<vert_index_t> &tri_vert_indices,
-			   vert_index_t base_vert)
+Mesh::Part::add_triangles (const vert_index_t *tri_vert_indices,
+			   unsigned num_tris, vert_index_t base_vert)
 {
-  unsigned num_tris = tri_vert_indices.size () / 3;
+  if (num_tris == 0)
+    return;
+
+  uncompress_triangles ();
+
+  unsigned old_size = tri_verts.size ();
+  tri_verts.resize (old_size + num_tris * 3);
+
+  vert_index_t *tvi = &tri_verts[old_size];
+  for (unsigned i = 0; i < num_tris * 3; i++)
+    tvi[i] = base_vert + tri_vert_indices[i];
+}
+
+// Add NUM_TRIS new triangles to this mesh part using the absolute
+// vertex indices in TRI_VERT_INDICES.  If this part has no triangles
+// yet, TRI_VERT_INDICES is used directly, without copying it (see
+// Mesh::add_triangles).
+//
+void
+Mesh::Part::add_triangles (const vert_index_t *tri_vert_indices,
+			   unsigned num_tris,
+			   const Ref<const RefCounted> &owner)
+{
+  uncompress_triangles ();
 
-  triangles.reserve (triangles.size() + num_tris);
+  if (tri_verts.empty ())
+    tri_verts.map (tri_vert_indices, num_tris * 3, owner);
+  else
+    tri_verts.append (tri_vert_indices, tri_vert_indices + num_tris * 3);
+}
+
+// Replace TRI_VERTS with a compact representation (see the
+// MeshCompressedTriangles class for details).
+//
+void
+Mesh::Part::compress_triangles ()
+{
+  if (compressed_tris)
+    return;
+
+  compressed_tris.reset (
+    new MeshCompressedTriangles (tri_verts.begin (), num_triangles ()));
+
+  tri_verts.clear ();
+}
+
+// If this part's triangles are compressed, convert them back to the
+// normal uncompressed representation in TRI_VERTS.
+//
+void
+Mesh::Part::uncompress_triangles ()
+{
+  if (! compressed_tris)
+    return;
 
-  unsigned tvi_num = 0;
+  unsigned num_tris = compressed_tris->size ();
+
+  tri_verts.resize (num_tris * 3);
   for (unsigned t = 0; t < num_tris; t++)
-    {
-      triangles.push_back (
-		  Triangle (*this,
-			    base_vert + tri_vert_indices[tvi_num + 0],
-			    base_vert + tri_vert_indices[tvi_num + 1],
-			    base_vert + tri_vert_indices[tvi_num + 2]));
-      tvi_num += 3;
-    }
+    compressed_tris->get (t, &tri_verts[t * 3]);
+
+  compressed_tris.reset ();
 }
 
 
@@ -553,7 +731,10 @@ private:
   //
   Frame make_frame (const Pos &orgin, const Vec &norm) const;
 
-  const Triangle &triangle;
+  // A copy of the triangle, as triangle objects are temporary.
+  //
+  const Triangle triangle;
+
   dist_t u, v;
 };
 
@@ -621,7 +802,7 @@ Mesh::Part::Triangle::IsecInfo::make_intersect (const Media &media, RenderContex
   // otherwise just copy the geometric frame.
   //
   Frame normal_frame;
-  if (! triangle.part.mesh.vertex_normals.empty ())
+  if (triangle.part.mesh.has_vertex_normals ())
     {
       Vec norm = triangle.vnorm(0) * (1 - u - v);
       norm += triangle.vnorm(1) * u;
@@ -832,20 +1013,68 @@ Mesh::Part::Triangle::bbox () const
 void
 Mesh::Part::add_to_space (SpaceBuilder &space_builder) const
 {
-  for (unsigned i = 0; i < triangles.size(); i++)
-    {
-      const Triangle &tri = triangles[i];
+  unsigned num_tris = num_triangles ();
 
+  for (unsigned i = 0; i < num_tris; i++)
+    {
       // Degenerate triangles (those with a zero-length normal) can
       // cause a crash during rendering, so only add non-degenerate
       // triangles.
       //
-      if (tri.raw_normal_unscaled().length_squared() > 0)
-	space_builder.add (&tri);
+      if (Triangle (*this, i).raw_normal_unscaled().length_squared() > 0)
+	space_builder.add (this, i);
     }
 }
 
 
+
+// Mesh::Part Surface::RenderableSet methods
+
+// If triangle INDEX intersects RAY, change RAY's maximum bound
+// (Ray::t1) to reflect the point of intersection, and return a
+// Surface::Renderable::IsecInfo object describing the intersection
+// (which should be allocated using placement-new with CONTEXT);
+// otherwise return zero.
+//
+const Surface::Renderable::IsecInfo *
+Mesh::Part::intersect (unsigned index, Ray &ray, RenderContext &context) const
+{
+  return Triangle (*this, index).intersect (ray, context);
+}
+
+// Return true if triangle INDEX intersects RAY.
+//
+bool
+Mesh::Part::intersects (unsigned index, const Ray &ray,
+			RenderContext &context)
+  const
+{
+  return Triangle (*this, index).intersects (ray, context);
+}
+
+// Return true if triangle INDEX completely occludes RAY.  If it does
+// not completely occlude RAY, then return false, and multiply
+// TOTAL_TRANSMITTANCE by the transmittance of the triangle in medium
+// MEDIUM.
+//
+bool
+Mesh::Part::occludes (unsigned index, const Ray &ray, const Medium &medium,
+		      Color &total_transmittance, RenderContext &context)
+  const
+{
+  return Triangle (*this, index).occludes (ray, medium, total_transmittance,
+					   context);
+}
+
+// Return a bounding box for triangle INDEX.
+//
+BBox
+Mesh::Part::bbox (unsigned index) const
+{
+  return Triangle (*this, index).bbox ();
+}
+
+
 
 // Mesh part-related methods
 
@@ -879,7 +1108,68 @@ Mesh::add_triangles (part_index_t part,
   if (part > parts.size ())
     throw std::runtime_error ("Invalid mesh part index");
 
-  parts[part]->add_triangles (tri_vert_indices, base_vert);
+  unsigned num_tris = tri_vert_indices.size () / 3;
+  if (num_tris != 0)
+    parts[part]->add_triangles (&tri_vert_indices[0], num_tris, base_vert);
+}
+
+// Add NUM_TRIS new triangles to mesh part PART, using vertices from
+// the array TRI_VERT_INDICES, which should contain three entries for
+// each triangle; otherwise the same as the std::vector version.
+//
+void
+Mesh::add_triangles (part_index_t part,
+		     const vert_index_t *tri_vert_indices, unsigned num_tris,
+		     vert_index_t base_vert)
+  const
+{
+  if (part > parts.size ())
+    throw std::runtime_error ("Invalid mesh part index");
+
+  parts[part]->add_triangles (tri_vert_indices, num_tris, base_vert);
+}
+
+// Add NUM_TRIS new triangles to mesh part PART, using vertices from
+// the array TRI_VERT_INDICES, which should contain three entries for
+// each triangle.
+//
+// If PART has no triangles yet, and BASE_VERT is zero, the array is
+// used directly, without copying it (it is only copied if later
+// modified); in that case, it must remain valid as long as OWNER is
+// alive, and the mesh keeps a reference to OWNER.
+//
+void
+Mesh::add_triangles (part_index_t part,
+		     const vert_index_t *tri_vert_indices, unsigned num_tris,
+		     vert_index_t base_vert,
+		     const Ref<const RefCounted> &owner)
+  const
+{
+  if (part > parts.size ())
+    throw std::runtime_error ("Invalid mesh part index");
+
+  if (base_vert == 0)
+    parts[part]->add_triangles (tri_vert_indices, num_tris, owner);
+  else
+    parts[part]->add_triangles (tri_vert_indices, num_tris, base_vert);
+}
+
+// Append the vertex indices of all triangles in mesh part PART to
+// TRI_VERT_INDICES, three entries per triangle.
+//
+void
+Mesh::get_triangles (part_index_t part,
+		     std::vector<vert_index_t> &tri_vert_indices)
+  const
+{
+  const Part &mesh_part = *parts[part];
+
+  if (mesh_part.compressed_tris)
+    mesh_part.compressed_tris->get_all (tri_vert_indices);
+  else
+    tri_vert_indices.insert (tri_vert_indices.end (),
+			     mesh_part.tri_verts.begin (),
+			     mesh_part.tri_verts.end ());
 }
 
 
@@ -897,180 +1187,603 @@ Mesh::material (part_index_t part) const
 
 
 
+// Vertex normal computation
 
 namespace { // keep local to file
 
-// Object for calculating vertex normals.
+// A random-access view of all the triangles in a mesh, in all parts,
+// numbered consecutively in part order.  Each triangle is represented
+// by a pointer to its three vertex indices.
 //
-class VertNormGroups
+class MeshTriangles
 {
 public:
 
-  VertNormGroups (Mesh &_mesh, float max_angle,
-		  Mesh::vert_index_t _base_vert = 0)
-    : mesh (_mesh), min_cos (cos (max_angle)), base_vert (_base_vert)
+  MeshTriangles () : part_base (1, 0) { }
+
+  // Add the triangles in TRI_VERTS.  As they may be modified through
+  // this object, any external array TRI_VERTS refers to is copied.
+  //
+  void add_part (MappedVector<Mesh::vert_index_t> &tri_verts)
+  {
+    part_tris.push_back (tri_verts.empty () ? 0 : &tri_verts[0]);
+    part_base.push_back (part_base.back () + tri_verts.size () / 3);
+  }
+
+  unsigned size () const { return part_base.back (); }
+
+  Mesh::vert_index_t *operator[] (unsigned index) const
+  {
+    unsigned part
+      = (std::upper_bound (part_base.begin (), part_base.end (), index)
+	 - part_base.begin () - 1);
+    return part_tris[part] + (index - part_base[part]) * 3;
+  }
+
+private:
+
+  // The vertex indices of the first triangle in each part, or zero
+  // for empty parts.
+  //
+  std::vector<Mesh::vert_index_t *> part_tris;
+
+  // The number of triangles in all parts before each part, with an
+  // extra final entry holding the total number of triangles.
+  //
+  std::vector<unsigned> part_base;
+};
+
+// Functor for parallel_for which computes the unit geometric normal of
+// a range of triangles, or a zero vector for degenerate triangles.
+//
+struct FaceNormalCalc
+{
+  FaceNormalCalc (const Mesh &_mesh, const MeshTriangles &_tris,
+		  Mesh::MVec *_normals)
+    : mesh (_mesh), tris (_tris), normals (_normals)
   { }
 
-  // A single vertex "group"
-  struct Group
+  void operator() (unsigned begin, unsigned end) const
   {
-    Group () : num_faces (0), next (0) { }
+    for (unsigned t = begin; t < end; t++)
+      {
+	const Mesh::vert_index_t *vi = tris[t];
+	Pos v0 = mesh.vertex (vi[0]);
+	Vec e1 = mesh.vertex (vi[1]) - v0, e2 = mesh.vertex (vi[2]) - v0;
+	Vec norm = mesh.left_handed ? cross (e2, e1) : cross (e1, e2);
+	dist_t len = norm.length ();
+	normals[t] = (len == 0) ? Mesh::MVec (0, 0, 0) : Mesh::MVec (norm / len);
+      }
+  }
 
-    // The number of faces in this group.
-    //
-    unsigned num_faces;
+  const Mesh &mesh;
+  const MeshTriangles &tris;
+  Mesh::MVec *normals;
+};
 
-    // The sum of the normals of the faces in this group.
-    //
-    Mesh::MVec normal_sum;
+// Information shared by the functors used to compute vertex normals.
+//
+// Each triangle vertex ("corner") is identified by TRIANGLE * 3 + NUM,
+// and the corners which use each vertex are recorded, in triangle
+// order, in a compact array.
+//
+struct VertNormInfo
+{
+  VertNormInfo (const MeshTriangles &_tris, Mesh::vert_index_t _base_vert)
+    : tris (_tris), base_vert (_base_vert)
+  { }
 
-    // The average of the normals of the faces in this group.
-    //
-    Mesh::MVec normal;
+  // All triangles in the mesh.
+  //
+  const MeshTriangles &tris;
 
-    // The vertex index of the next normal group.
-    //
-    Mesh::vert_index_t next;
-  };
+  // The first vertex we're calculating normals for.
+  //
+  Mesh::vert_index_t base_vert;
 
-  Group &operator[] (Mesh::vert_index_t index)
-  { return groups[index - base_vert]; }
+  // Geometric normal of each triangle, zero if degenerate.
+  //
+  std::vector<Mesh::MVec> face_normals;
 
-  // Add a face with normal FACE_NORMAL to the normal group for VERTEX, or to
-  // some other normal group derived from it, or to a new normal group, such
-  // that the angle between FACE_NORMAL and the normal group's normal is not
-  // greater than the maximum angle specified for this VertNormGroups object.
-  // Returns the index of the vertex to which FACE_NORMAL was added.
+  // The corners using vertex BASE_VERT + I are
+  // VERT_CORNERS[CORNERS_START[I] ... CORNERS_START[I + 1] - 1].
   //
-  Mesh::vert_index_t add_face (const Mesh::MVec &face_normal,
-			       Mesh::vert_index_t vertex);
+  std::vector<unsigned> corners_start;
+  std::vector<unsigned> vert_corners;
 
-private:
+  // For each entry in VERT_CORNERS, the normal group it belongs to.
+  //
+  std::vector<unsigned> corner_group;
 
-  // Mesh we're calculating normals for.
+  // The number of normal groups for vertex BASE_VERT + I.
   //
-  Mesh &mesh;
+  std::vector<unsigned> num_groups;
+
+  // The index of the first new vertex split from vertex BASE_VERT + I
+  // (used for normal groups 1 and above).
+  //
+  std::vector<Mesh::vert_index_t> split_base;
+};
+
+// Functor for parallel_for which divides the faces around each vertex
+// in a range into normal groups, such that the angle between a face's
+// normal and its group's average normal is never greater than the
+// maximum angle.  Each face is added to the first group it fits into,
+// in triangle order, or a new group if none is suitable.
+//
+struct VertNormGrouper
+{
+  VertNormGrouper (VertNormInfo &_info, float max_angle)
+    : info (_info), min_cos (cos (max_angle))
+  { }
+
+  void operator() (unsigned begin, unsigned end) const
+  {
+    std::vector<Mesh::MVec> group_sums, group_normals;
+
+    for (unsigned i = begin; i < end; i++)
+      {
+	group_sums.clear ();
+	group_normals.clear ();
+
+	for (unsigned c = info.corners_start[i];
+	     c < info.corners_start[i + 1]; c++)
+	  {
+	    const Mesh::MVec &face_normal
+	      = info.face_normals[info.vert_corners[c] / 3];
+
+	    // Degenerate faces have no useful normal, so just leave
+	    // them in the first group without contributing to it.
+	    //
+	    unsigned g = 0;
+
+	    if (! face_normal.null ())
+	      {
+		while (g < group_normals.size ()
+		       && cos_angle (face_normal, group_normals[g]) < min_cos)
+		  g++;
+
+		if (g == group_normals.size ())
+		  {
+		    group_sums.push_back (Mesh::MVec (0, 0, 0));
+		    group_normals.push_back (Mesh::MVec (0, 0, 0));
+		  }
+
+		group_sums[g] += face_normal;
+		group_normals[g] = group_sums[g].unit ();
+	      }
+
+	    info.corner_group[c] = g;
+	  }
+
+	info.num_groups[i] = group_normals.empty () ? 1 : group_normals.size ();
+      }
+  }
+
+  VertNormInfo &info;
 
   // The minimum cosine, and thus maximum angle, allowed between normals in
   // the same group.
   //
   float min_cos;
+};
 
-  // The first vertex we're calculating for.
-  //
-  Mesh::vert_index_t base_vert;
+// Functor for parallel_for which, for each vertex in a range, stores
+// the normal of each of its normal groups, initializes vertices split
+// off for groups after the first, and updates the triangles in those
+// groups to use the split vertices.
+//
+struct VertNormSetter
+{
+  VertNormSetter (VertNormInfo &_info, Mesh::MPos *_verts,
+		  Mesh::MVec *_normals, UV *_uvs)
+    : info (_info), verts (_verts), normals (_normals), uvs (_uvs)
+  { }
 
-  // Normal groups allocated so far.  The first entry is for vertex
-  // BASE_VERT, and all others follow in vertex order.
-  //
-  std::vector<Group> groups;
+  void operator() (unsigned begin, unsigned end) const
+  {
+    std::vector<Mesh::MVec> group_sums;
+
+    for (unsigned i = begin; i < end; i++)
+      {
+	Mesh::vert_index_t vert = info.base_vert + i;
+	unsigned num_groups = info.num_groups[i];
+
+	group_sums.assign (num_groups, Mesh::MVec (0, 0, 0));
+
+	for (unsigned c = info.corners_start[i];
+	     c < info.corners_start[i + 1]; c++)
+	  {
+	    unsigned corner = info.vert_corners[c];
+	    unsigned g = info.corner_group[c];
+
+	    group_sums[g] += info.face_normals[corner / 3];
+
+	    if (g != 0)
+	      info.tris[corner / 3][corner % 3] = info.split_base[i] + g - 1;
+	  }
+
+	for (unsigned g = 0; g < num_groups; g++)
+	  {
+	    Mesh::vert_index_t gvert
+	      = (g == 0) ? vert : info.split_base[i] + g - 1;
+
+	    normals[gvert]
+	      = (group_sums[g].null ()
+		 ? Mesh::MVec (0, 0, 0)
+		 : group_sums[g].unit ());
+
+	    if (g != 0)
+	      {
+		verts[gvert] = verts[vert];
+		if (uvs)
+		  uvs[gvert] = uvs[vert];
+	      }
+	  }
+      }
+  }
+
+  VertNormInfo &info;
+
+  Mesh::MPos *verts;
+  Mesh::MVec *normals;
+  UV *uvs;
 };
 
 } // namespace
 
 
-// Add a face with normal FACE_NORMAL to the normal group for VERTEX, or to
-// some other normal group derived from it, or to a new normal group, such
-// that the angle between FACE_NORMAL and the normal group's normal is not
-// greater than the maximum angle specified for this VertNormGroups object.
-// Returns the index of the vertex to which FACE_NORMAL was added.
+// Compute a normal vector for each vertex that doesn't already have one,
+// by averaging the normals of the triangles that use the vertex.
+// MAX_ANGLE is the maximum angle allowed between two triangles that share
+// a vertex (and thus a vertex normal); in order to maintain this
+// constraint, compute_vertex_normals may split vertices, so the number of
+// vertices may increase (to prevent this, specify a sufficiently large
+// MAX_ANGLE, e.g. 2 * PI).
 //
-Mesh::vert_index_t
-VertNormGroups::add_face (const Mesh::MVec &face_normal,
-			  Mesh::vert_index_t vertex)
+// The per-triangle and per-vertex work is done in parallel; vertices
+// split off from a vertex are added to the end of the vertex array, in
+// the order of the vertices they were split from.
+//
+void
+Mesh::compute_vertex_normals (float max_angle)
 {
-  if (vertex - base_vert >= groups.size ())
-    groups.resize (vertex - base_vert + 1);
+  PhaseProfile::Phase phase ("mesh vertex normals");
 
-  // Vertex group for VERTEX.
-  //
-  Group &group = groups[vertex - base_vert];
+  uncompress_vertices ();
+
+  unsigned num_verts = vertices.size ();
+  unsigned num_parts = parts.size ();
+  unsigned num_old_norms = vertex_normals.size();
+
+  if (num_old_norms >= num_verts)
+    return;
+
+  unsigned num_new_norms = num_verts - num_old_norms;
+
+  MeshTriangles tris;
+  for (part_index_t part = 0; part < num_parts; part++)
+    {
+      parts[part]->uncompress_triangles ();
+      tris.add_part (parts[part]->tri_verts);
+    }
+
+  unsigned num_tris = tris.size ();
+
+  VertNormInfo info (tris, num_old_norms);
 
-  // First see if FACE_NORMAL is acceptable to merge with GROUP, either
-  // because it's the first normal added to it, or because the angle
-  // between FACE_NORMAL and the group's normal is sufficiently small.
+  // Compute face normals.
   //
-  float cos_fg;
-  if (group.num_faces == 0
-      || (cos_fg = cos_angle (face_normal, group.normal) >= min_cos))
-    //
-    // It fits, add FACE_NORMAL to GROUP, and return VERTEX.
+  info.face_normals.resize (num_tris);
+  if (num_tris != 0)
     {
-      group.num_faces++;
-      group.normal_sum += face_normal;
-      group.normal = group.normal_sum.unit ();
-      return vertex;
+      FaceNormalCalc face_normal_calc (*this, tris, &info.face_normals[0]);
+      parallel_for (0, num_tris, face_normal_calc, 10000);
     }
-  else if (cos_fg < 0)
+
+  // Make a list of the corners using each vertex, using a counting
+  // sort so that each vertex's corners remain in triangle order.
+  //
+  info.corners_start.assign (num_new_norms + 1, 0);
+  for (unsigned t = 0; t < num_tris; t++)
     {
-      throw std::runtime_error (
-		   "Face orientation mismatch while smoothing mesh");
+      const vert_index_t *vi = tris[t];
+      for (unsigned num = 0; num < 3; num++)
+	if (vi[num] >= num_old_norms)
+	  info.corners_start[vi[num] - num_old_norms + 1]++;
     }
-  else
+  for (unsigned i = 0; i < num_new_norms; i++)
+    info.corners_start[i + 1] += info.corners_start[i];
+
+  info.vert_corners.resize (info.corners_start[num_new_norms]);
+  std::vector<unsigned> corners_fill (info.corners_start.begin (),
+				      info.corners_start.end () - 1);
+  for (unsigned t = 0; t < num_tris; t++)
     {
-      // If no other vertices/groups have been split from this one yet,
-      // make a new vertex by copying this one.
-      //
-      if (! group.next)
-	group.next = mesh.add_vertex (mesh.vertex (vertex));
+      const vert_index_t *vi = tris[t];
+      for (unsigned num = 0; num < 3; num++)
+	if (vi[num] >= num_old_norms)
+	  info.vert_corners[corners_fill[vi[num] - num_old_norms]++]
+	    = t * 3 + num;
+    }
 
-      // Continue our lookup with the next group.
-      //
-      return add_face (face_normal, group.next);
+  // Divide the faces around each vertex into normal groups.
+  //
+  info.corner_group.resize (info.vert_corners.size ());
+  info.num_groups.resize (num_new_norms);
+  VertNormGrouper grouper (info, max_angle);
+  parallel_for (0, num_new_norms, grouper, 1000);
+
+  // Allocate new vertices for normal groups after the first.
+  //
+  info.split_base.resize (num_new_norms);
+  vert_index_t next_vert = num_verts;
+  for (unsigned i = 0; i < num_new_norms; i++)
+    {
+      info.split_base[i] = next_vert;
+      next_vert += info.num_groups[i] - 1;
     }
+
+  bool has_uvs = vertex_uvs.size () == num_verts;
+
+  vertices.resize (next_vert);
+  vertex_normals.resize (next_vert);
+  if (has_uvs)
+    vertex_uvs.resize (next_vert);
+
+  // Finally compute the vertex normals, and update triangles.
+  //
+  VertNormSetter setter (info, &vertices[0], &vertex_normals[0],
+			 has_uvs ? &vertex_uvs[0] : 0);
+  parallel_for (0, num_new_norms, setter, 1000);
 }
 
 
 
+// Vertex welding
 
-// Compute a normal vector for each vertex that doesn't already have one,
-// by averaging the normals of the triangles that use the vertex.
-// MAX_ANGLE is the maximum angle allowed between two triangles that share
-// a vertex (and thus a vertex normal); in order to maintain this
-// constraint, compute_vertex_normals may split vertices, so the number of
-// vertices may increase (to prevent this, specify a sufficiently large
-// MAX_ANGLE, e.g. 2 * PI).
+namespace { // keep local to file
+
+// Vertex data used by the vertex welding functors.  NORMALS and UVS
+// are zero if the mesh doesn't have them.
+//
+struct WeldVerts
+{
+  WeldVerts (const Mesh::MPos *_verts, const Mesh::MVec *_normals,
+	     const UV *_uvs)
+    : verts (_verts), normals (_normals), uvs (_uvs)
+  { }
+
+  unsigned long long hash (unsigned i) const
+  {
+    unsigned long long h = hash_tuple_bits (verts[i]);
+    if (normals)
+      h = hash_tuple_bits (normals[i], h);
+    if (uvs)
+      h = hash_float_bits (uvs[i].v, hash_float_bits (uvs[i].u, h));
+    return h;
+  }
+
+  bool equal (unsigned i, unsigned j) const
+  {
+    return (verts[i] == verts[j]
+	    && (!normals || normals[i] == normals[j])
+	    && (!uvs || (uvs[i].u == uvs[j].u && uvs[i].v == uvs[j].v)));
+  }
+
+  const Mesh::MPos *verts;
+  const Mesh::MVec *normals;
+  const UV *uvs;
+};
+
+// Functor for parallel_for which computes the hash of a range of
+// vertices.
+//
+struct WeldHasher
+{
+  WeldHasher (const WeldVerts &_verts, unsigned long long *_hashes)
+    : verts (_verts), hashes (_hashes)
+  { }
+
+  void operator() (unsigned begin, unsigned end) const
+  {
+    for (unsigned i = begin; i < end; i++)
+      hashes[i] = verts.hash (i);
+  }
+
+  const WeldVerts &verts;
+  unsigned long long *hashes;
+};
+
+// Functor for parallel_for which, for each vertex in a range of hash
+// partitions, finds the first vertex equal to it (which may be the
+// vertex itself).  Vertices are assigned to partitions by hash value,
+// so partitions can be handled independently, each using its own hash
+// table.
+//
+struct WeldMatcher
+{
+  WeldMatcher (const WeldVerts &_verts, const unsigned long long *_hashes,
+	       unsigned _num_verts, unsigned _num_partitions,
+	       unsigned *_first_equal)
+    : verts (_verts), hashes (_hashes), num_verts (_num_verts),
+      num_partitions (_num_partitions), first_equal (_first_equal)
+  { }
+
+  unsigned partition (unsigned long long hash) const
+  {
+    return (hash >> 32) % num_partitions;
+  }
+
+  void operator() (unsigned begin, unsigned end) const
+  {
+    std::vector<unsigned> slots;
+
+    for (unsigned p = begin; p < end; p++)
+      {
+	unsigned num_members = 0;
+	for (unsigned i = 0; i < num_verts; i++)
+	  if (partition (hashes[i]) == p)
+	    num_members++;
+
+	// Keep the table at most half full.
+	//
+	unsigned num_slots = 16;
+	while (num_slots < num_members * 2)
+	  num_slots *= 2;
+	unsigned mask = num_slots - 1;
+
+	// Each slot holds a vertex index plus one, or zero if empty.
+	//
+	slots.assign (num_slots, 0);
+
+	for (unsigned i = 0; i < num_verts; i++)
+	  {
+	    unsigned long long hash = hashes[i];
+	    if (partition (hash) != p)
+	      continue;
+
+	    unsigned slot = hash & mask;
+	    while (slots[slot])
+	      {
+		unsigned j = slots[slot] - 1;
+		if (hashes[j] == hash && verts.equal (i, j))
+		  break;
+		slot = (slot + 1) & mask;
+	      }
+
+	    if (slots[slot])
+	      first_equal[i] = slots[slot] - 1;
+	    else
+	      {
+		slots[slot] = i + 1;
+		first_equal[i] = i;
+	      }
+	  }
+      }
+  }
+
+  const WeldVerts &verts;
+  const unsigned long long *hashes;
+  unsigned num_verts, num_partitions;
+  unsigned *first_equal;
+};
+
+// Functor for parallel_for which updates the vertex indices of a range
+// of triangles after vertices have been welded.
+//
+struct WeldRemapper
+{
+  WeldRemapper (const MeshTriangles &_tris, Mesh::vert_index_t _base_vert,
+		const Mesh::vert_index_t *_new_index)
+    : tris (_tris), base_vert (_base_vert), new_index (_new_index)
+  { }
+
+  void operator() (unsigned begin, unsigned end) const
+  {
+    for (unsigned t = begin; t < end; t++)
+      {
+	Mesh::vert_index_t *vi = tris[t];
+	for (unsigned num = 0; num < 3; num++)
+	  if (vi[num] >= base_vert)
+	    vi[num] = base_vert + new_index[vi[num] - base_vert];
+      }
+  }
+
+  const MeshTriangles &tris;
+  Mesh::vert_index_t base_vert;
+  const Mesh::vert_index_t *new_index;
+};
+
+} // namespace
+
+
+// Merge all vertices starting from BASE_VERT which have exactly the
+// same position, normal (if the mesh has vertex normals), and UV
+// value (if the mesh has vertex UVs), into a single vertex, updating
+// triangles to refer to the merged vertex.  Vertices before
+// BASE_VERT are left alone.
 //
 void
-Mesh::compute_vertex_normals (float max_angle)
+Mesh::weld_vertices (vert_index_t base_vert)
 {
+  PhaseProfile::Phase phase ("mesh vertex welding");
+
+  uncompress_vertices ();
+
   unsigned num_verts = vertices.size ();
-  unsigned num_parts = parts.size ();
-  unsigned num_old_norms = vertex_normals.size();
+  if (base_vert >= num_verts)
+    return;
 
-  if (num_old_norms < num_verts)
-    {
-      VertNormGroups norm_groups (*this, max_angle, num_old_norms);
+  unsigned num = num_verts - base_vert;
 
-      for (part_index_t part = 0; part < num_parts; part++)
-	{
-	  std::vector<Part::Triangle> &triangles = parts[part]->triangles;
-	  unsigned num_triangles = triangles.size ();
-
-	  for (unsigned t = 0; t < num_triangles; t++)
-	    {
-	      Part::Triangle &triang = triangles[t];
-	      const MVec norm (triang.raw_normal ());
-
-	      // Find a vertex normal group for this triangle's normal.
-	      // We just update each vertex index to refer to the vertex to
-	      // which the normal was added.
-	      //
-	      for (unsigned num = 0; num < 3; num++)
-		if (triang.vi[num] >= num_old_norms)
-		  triang.vi[num] = norm_groups.add_face (norm, triang.vi[num]);
-	    }
-	}
+  bool has_normals = vertex_normals.size () == num_verts;
+  bool has_uvs = vertex_uvs.size () == num_verts;
 
-      // The number of vertices may have increased due to vertex splitting.
-      //
-      num_verts = vertices.size ();
+  if ((!has_normals && vertex_normals.size () > base_vert)
+      || (!has_uvs && vertex_uvs.size () > base_vert))
+    throw std::runtime_error ("Mesh::weld_vertices: inconsistent vertex data");
 
-      vertex_normals.resize (num_verts);
+  WeldVerts verts (vertices.begin () + base_vert,
+		   has_normals ? vertex_normals.begin () + base_vert : 0,
+		   has_uvs ? vertex_uvs.begin () + base_vert : 0);
+
+  // Hash all vertices.
+  //
+  std::vector<unsigned long long> hashes (num);
+  WeldHasher hasher (verts, &hashes[0]);
+  parallel_for (0, num, hasher, 10000);
+
+  // Find the first equal vertex for each vertex.
+  //
+  std::vector<unsigned> first_equal (num);
+  unsigned num_partitions = num_cores ();
+  WeldMatcher matcher (verts, &hashes[0], num, num_partitions,
+		       &first_equal[0]);
+  parallel_for (0, num_partitions, matcher);
+
+  // Give each distinct vertex a new index, in order.
+  //
+  std::vector<vert_index_t> new_index (num);
+  unsigned num_distinct = 0;
+  for (unsigned i = 0; i < num; i++)
+    new_index[i]
+      = (first_equal[i] == i) ? num_distinct++ : new_index[first_equal[i]];
+
+  if (num_distinct == num)
+    return;
+
+  // Compact the vertex arrays.  As a vertex's new index is never
+  // greater than its old index, this can be done in place.
+  //
+  for (unsigned i = 0; i < num; i++)
+    if (first_equal[i] == i && new_index[i] != i)
+      {
+	vertices[base_vert + new_index[i]] = vertices[base_vert + i];
+	if (has_normals)
+	  vertex_normals[base_vert + new_index[i]]
+	    = vertex_normals[base_vert + i];
+	if (has_uvs)
+	  vertex_uvs[base_vert + new_index[i]] = vertex_uvs[base_vert + i];
+      }
+
+  vertices.resize (base_vert + num_distinct);
+  if (has_normals)
+    vertex_normals.resize (base_vert + num_distinct);
+  if (has_uvs)
+    vertex_uvs.resize (base_vert + num_distinct);
 
-      for (vert_index_t v = num_old_norms; v < num_verts; v++)
-	vertex_normals[v] = norm_groups[v].normal;
+  // Update triangles to use the new vertex indices.
+  //
+  MeshTriangles tris;
+  for (part_index_t part = 0; part < parts.size (); part++)
+    {
+      parts[part]->uncompress_triangles ();
+      tris.add_part (parts[part]->tri_verts);
     }
+
+  WeldRemapper remapper (tris, base_vert, &new_index[0]);
+  parallel_for (0, tris.size (), remapper, 10000);
 }
 
 
@@ -1096,9 +1809,10 @@ Mesh::add_to_space (SpaceBuilder &space_builder) const
   // actually needed.
   //
 
-  if (!quiet && vertices.size () > 50000)
+  if (!quiet && num_vertices () > 50000)
     std::cout << "* adding large mesh: "
-	      << commify (vertices.size ()) << " vertices"
+	      << commify (num_vertices ()) << " vertices"
+	      << (compressed_verts ? " (compressed)" : "")
 	      << ", " << commify (num_triangles ()) << " triangles"
 	      << std::endl;
 
@@ -1108,6 +1822,69 @@ Mesh::add_to_space (SpaceBuilder &space_builder) const
 }
 
 
+// Add light-samplers for this surface in SCENE to SAMPLERS.  Any
+// samplers added become owned by the owner of SAMPLERS, and will be
+// destroyed when it is.
+//
+void
+Mesh::add_light_samplers (const Scene &,
+			  std::vector<const Light::Sampler *> &samplers)
+  const
+{
+  // Each part's material decides whether it emits light, and if so,
+  // calls back to our other add_light_samplers method.
+  //
+  for (part_index_t p = 0; p < parts.size (); p++)
+    parts[p]->material->add_light_samplers (*this, p, samplers);
+}
+
+// Add a light-sampler for the triangles in mesh part PART, with
+// intensity INTENSITY, to SAMPLERS.  This is called by light-emitting
+// materials.
+//
+void
+Mesh::add_light_samplers (part_index_t part,
+			  const TexVal<Color> &intensity,
+			  std::vector<const Light::Sampler *> &samplers)
+  const
+{
+  const Part &mesh_part = *parts[part];
+  unsigned num_tris = mesh_part.num_triangles ();
+
+  std::vector<MeshLightSampler::Triangle> light_tris;
+  light_tris.reserve (num_tris);
+
+  for (unsigned t = 0; t < num_tris; t++)
+    {
+      Part::Triangle tri (mesh_part, t);
+
+      Vec norm = tri.raw_normal_unscaled ();
+      if (norm.length_squared () == 0)
+	continue;
+      norm = norm.unit ();
+
+      // Make the emitting side agree with the vertex normals, as
+      // Triangle::IsecInfo::make_intersect does for the geometric
+      // normal.
+      //
+      if (has_vertex_normals ()
+	  && dot (tri.vnorm (0) + tri.vnorm (1) + tri.vnorm (2), norm) < 0)
+	norm = -norm;
+
+      UV T0, dTdu, dTdv;
+      tri.get_texture_params (T0, dTdu, dTdv);
+
+      light_tris.push_back (
+		   MeshLightSampler::Triangle (tri.v(0), tri.v(1), tri.v(2),
+					       norm,
+					       T0, T0 + dTdu, T0 + dTdv));
+    }
+
+  if (! light_tris.empty ())
+    samplers.push_back (new MeshLightSampler (light_tris, intensity));
+}
+
+
 // Return the number of triangles in all mesh parts.
 //
 unsigned
@@ -1117,7 +1894,7 @@ Mesh::num_triangles () const
 
   for (std::vector<Part *>::const_iterator pi = parts.begin ();
        pi != parts.end (); ++pi)
-    num_tris += (*pi)->triangles.size ();
+    num_tris += (*pi)->num_triangles ();
 
   return num_tris;
 }
@@ -1144,7 +1921,7 @@ Mesh::accum_stats (Stats &stats, StatsCache &) const
 void
 Mesh::recalc_bbox ()
 {
-  unsigned num_verts = vertices.size ();
+  unsigned num_verts = num_vertices ();
 
   if (num_verts > 0)
     {
@@ -1158,11 +1935,86 @@ Mesh::recalc_bbox ()
 }
 
 
+// Replace this mesh's vertex positions, normals, and UV values with
+// a compact, lossily compressed, representation (see the
+// MeshCompressedVertices class for details), and the vertex indices
+// of its triangles with a compact lossless representation (see the
+// MeshCompressedTriangles class).
+//
+void
+Mesh::compress_vertices ()
+{
+  for (std::vector<Part *>::const_iterator pi = parts.begin ();
+       pi != parts.end (); ++pi)
+    (*pi)->compress_triangles ();
+
+  if (compressed_verts)
+    return;
+
+  unsigned num_verts = vertices.size ();
+
+  // Vertices after the last one with a normal or UV value (which
+  // should only happen if the mesh is still being built) can't be
+  // represented, so just don't bother in that case.
+  //
+  if ((! vertex_normals.empty () && vertex_normals.size () != num_verts)
+      || (! vertex_uvs.empty () && vertex_uvs.size () != num_verts))
+    return;
+
+  compressed_verts.reset (
+    new MeshCompressedVertices (
+	  vertices.begin (),
+	  vertex_normals.empty () ? 0 : vertex_normals.begin (),
+	  vertex_uvs.empty () ? 0 : vertex_uvs.begin (),
+	  num_verts));
+
+  vertices.clear ();
+  vertex_normals.clear ();
+  vertex_uvs.clear ();
+
+  // Make sure the bounding box includes the decoded vertex positions,
+  // which may be very slightly different from the originals.
+  //
+  recalc_bbox ();
+}
+
+// Convert compressed vertices back to the normal uncompressed
+// representation.
+//
+void
+Mesh::expand_compressed_vertices ()
+{
+  unsigned num_verts = compressed_verts->size ();
+
+  vertices.resize (num_verts);
+  for (vert_index_t v = 0; v < num_verts; v++)
+    vertices[v] = compressed_verts->position (v);
+
+  if (compressed_verts->has_normals ())
+    {
+      vertex_normals.resize (num_verts);
+      for (vert_index_t v = 0; v < num_verts; v++)
+	vertex_normals[v] = compressed_verts->normal (v);
+    }
+
+  if (compressed_verts->has_uvs ())
+    {
+      vertex_uvs.resize (num_verts);
+      for (vert_index_t v = 0; v < num_verts; v++)
+	vertex_uvs[v] = compressed_verts->uv (v);
+    }
+
+  compressed_verts.reset ();
+}
+
+
 // Transform the geometry of this surface by XFORM.
 //
 void
 Mesh::transform (const Xform &xform)
 {
+  uncompress_vertices ();
+
   const SXform xf = SXform (xform);
 
   for (vert_index_t v = 0; v < vertices.size (); v++)
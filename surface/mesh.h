@@ -14,13 +14,17 @@
 #define SNOGRAY_MESH_H
 
 #include <vector>
-#include <map>
+#include <utility>
 
+#include "util/mapped-vector.h"
+#include "util/unique-ptr.h"
 #include "geometry/pos.h"
 #include "geometry/xform.h"
 #include "material/material.h"
 
 #include "surface.h"
+#include "mesh-vertex-table.h"
+#include "mesh-compressed-vertices.h"
 
 
 namespace snogray {
@@ -46,8 +50,8 @@ public:
 
   // A vertex group can be used to group vertices together.
   //
-  typedef std::map<Pos, vert_index_t> VertexGroup;
-  typedef std::map<std::pair<Pos, Vec>, vert_index_t> VertexNormalGroup;
+  typedef MeshVertexTable<Pos> VertexGroup;
+  typedef MeshVertexTable<std::pair<Pos, Vec> > VertexNormalGroup;
 
 
   // Basic constructor.  Actual contents must be defined later.
@@ -127,11 +131,45 @@ public:
   //
   void add_uvs (const std::vector<float> &new_uvs, vert_index_t base_vert);
 
+  // Add NUM_VERTS vertices with positions from the array VERTS, and
+  // corresponding normals and UV values from NORMALS and UVS (either of
+  // which may be zero, if not available).  VERTS_BBOX should be a
+  // bounding box for all of VERTS.  The index in the mesh of the first
+  // new vertex is returned.
+  //
+  // If this mesh doesn't have any vertices yet, the arrays are used
+  // directly, without copying them (they are only copied if later
+  // modified); in that case, they must remain valid as long as OWNER,
+  // which should typically be the memory-mapped file containing them,
+  // is alive, and the mesh keeps a reference to OWNER.
+  //
+  vert_index_t add_vertices (const MPos *verts, const MVec *normals,
+			     const UV *uvs, unsigned num_verts,
+			     const BBox &verts_bbox,
+			     const Ref<const RefCounted> &owner);
+
   // Add Surface::Renderable objects associated with this surface to
   // the space being built by SPACE_BUILDER.
   //
   virtual void add_to_space (SpaceBuilder &space_builder) const;
 
+  // Add light-samplers for this surface in SCENE to SAMPLERS.  Any
+  // samplers added become owned by the owner of SAMPLERS, and will be
+  // destroyed when it is.
+  //
+  virtual void add_light_samplers (
+		 const Scene &scene,
+		 std::vector<const Light::Sampler *> &samplers)
+    const;
+
+  // Add a light-sampler for the triangles in mesh part PART, with
+  // intensity INTENSITY, to SAMPLERS.  This is called by light-emitting
+  // materials.
+  //
+  void add_light_samplers (part_index_t part,
+			   const TexVal<Color> &intensity,
+			   std::vector<const Light::Sampler *> &samplers)
+    const;
 
   // Compute a normal vector for each vertex that doesn't already have one,
   // by averaging the normals of the triangles that use the vertex.
@@ -143,13 +181,76 @@ public:
   //
   void compute_vertex_normals (float max_angle = 45 * PIf / 180);
 
+  // Merge all vertices starting from BASE_VERT which have exactly the
+  // same position, normal (if the mesh has vertex normals), and UV
+  // value (if the mesh has vertex UVs), into a single vertex, updating
+  // triangles to refer to the merged vertex.  Vertices before
+  // BASE_VERT are left alone.
+  //
+  // The result is the same as adding the vertices using a vertex group
+  // (see Mesh::add_vertex), but is much faster for large meshes, as
+  // the work is done in parallel.
+  //
+  void weld_vertices (vert_index_t base_vert = 0);
+
 
-  Pos vertex (vert_index_t index) const { return Pos (vertices[index]); }
+  // Replace this mesh's vertex positions, normals, and UV values with
+  // a compact, lossily compressed, representation (see the
+  // MeshCompressedVertices class for details), which uses less than
+  // half as much memory.  The vertex indices of triangles are also
+  // stored compactly, usually using a quarter as much memory, but
+  // without loss (see the MeshCompressedTriangles class).  Values are
+  // decoded whenever they're used.
+  //
+  // This should be done after the mesh is complete, as any operation
+  // which modifies the vertices or triangles first converts them back
+  // to the normal uncompressed representation.
+  //
+  void compress_vertices ();
+
+  // Return true if this mesh's vertices are compressed.
+  //
+  bool vertices_compressed () const { return !!compressed_verts; }
+
+
+  Pos vertex (vert_index_t index) const
+  {
+    return Pos (compressed_verts
+		? compressed_verts->position (index)
+		: vertices[index]);
+  }
   Vec vertex_normal (vert_index_t index) const
-  { return Vec (vertex_normals[index]); }
+  {
+    return Vec (compressed_verts
+		? compressed_verts->normal (index)
+		: vertex_normals[index]);
+  }
+  UV vertex_uv (vert_index_t index) const
+  {
+    return compressed_verts ? compressed_verts->uv (index) : vertex_uvs[index];
+  }
+
+  // Return true if this mesh has vertex normals or UV values,
+  // respectively.
+  //
+  bool has_vertex_normals () const
+  {
+    return (compressed_verts
+	    ? compressed_verts->has_normals ()
+	    : ! vertex_normals.empty ());
+  }
+  bool has_vertex_uvs () const
+  {
+    return (compressed_verts
+	    ? compressed_verts->has_uvs ()
+	    : ! vertex_uvs.empty ());
+  }
 
 
-  unsigned num_vertices () const { return vertices.size (); }
+  unsigned num_vertices () const
+  {
+    return compressed_verts ? compressed_verts->size () : vertices.size ();
+  }
 
   // Return the number of triangles in all mesh parts.
   //
@@ -161,6 +262,7 @@ public:
   //
   void reserve_vertices (unsigned num_verts)
   {
+    uncompress_vertices ();
     vertices.reserve (num_vertices() + num_verts);
   }
 
@@ -169,6 +271,7 @@ public:
   //
   void reserve_normals ()
   {
+    uncompress_vertices ();
     vertex_normals.reserve (num_vertices ());
   }
 
@@ -177,6 +280,7 @@ public:
   //
   void reserve_uvs ()
   {
+    uncompress_vertices ();
     vertex_uvs.reserve (num_vertices ());
   }
 
@@ -199,6 +303,38 @@ public:
 		      vert_index_t base_vert = 0)
     const;
 
+  // Add NUM_TRIS new triangles to mesh part PART, using vertices from
+  // the array TRI_VERT_INDICES, which should contain three entries for
+  // each triangle; otherwise the same as the std::vector version.
+  //
+  void add_triangles (part_index_t part,
+		      const vert_index_t *tri_vert_indices, unsigned num_tris,
+		      vert_index_t base_vert = 0)
+    const;
+
+  // Add NUM_TRIS new triangles to mesh part PART, using vertices from
+  // the array TRI_VERT_INDICES, which should contain three entries for
+  // each triangle.
+  //
+  // If PART has no triangles yet, and BASE_VERT is zero, the array is
+  // used directly, without copying it (it is only copied if later
+  // modified); in that case, it must remain valid as long as OWNER,
+  // which should typically be the memory-mapped file containing it, is
+  // alive, and the mesh keeps a reference to OWNER.
+  //
+  void add_triangles (part_index_t part,
+		      const vert_index_t *tri_vert_indices, unsigned num_tris,
+		      vert_index_t base_vert,
+		      const Ref<const RefCounted> &owner)
+    const;
+
+  // Append the vertex indices of all triangles in mesh part PART to
+  // TRI_VERT_INDICES, three entries per triangle.
+  //
+  void get_triangles (part_index_t part,
+		      std::vector<vert_index_t> &tri_vert_indices)
+    const;
+
   // Return the number of mesh parts.
   //
   unsigned num_parts () const { return parts.size (); }
@@ -237,16 +373,33 @@ private:
   //
   void recalc_bbox ();
 
+  // If this mesh's vertices are compressed, convert them back to the
+  // normal uncompressed representation (with any compression error
+  // intact).
+  //
+  void uncompress_vertices ()
+  {
+    if (compressed_verts)
+      expand_compressed_vertices ();
+  }
+  void expand_compressed_vertices ();
+
   // A list of vertices used in this part.
   //
-  std::vector<MPos> vertices;
+  MappedVector<MPos> vertices;
 
   // Vectors of various per-vertext properties.  In general, these vectors
   // may be empty (meaning the given property is not known), otherwise they
   // are assumed to contain information for every vertex.
   //
-  std::vector<MVec> vertex_normals;
-  std::vector<UV> vertex_uvs;
+  MappedVector<MVec> vertex_normals;
+  MappedVector<UV> vertex_uvs;
+
+  // If non-zero, this mesh's vertices are compressed, and are stored
+  // here instead of in the above vectors, which are empty (see
+  // Mesh::compress_vertices).
+  //
+  UniquePtr<MeshCompressedVertices> compressed_verts;
 
   // Parts of this mesh, one per material.
   //
@@ -13,6 +13,7 @@
 #include <memory>
 
 #include "util/snogassert.h"
+#include "util/phase-profile.h"
 #include "space/space.h"
 #include "space/space-builder.h"
 
@@ -40,6 +41,8 @@ Model::make_space () const
     {
       ASSERT (space_builder);
 
+      PhaseProfile::Phase phase ("model space build");
+
       _surface->add_to_space (*space_builder);
 
       space.reset (space_builder->make_space ());
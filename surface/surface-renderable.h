@@ -77,6 +77,61 @@ public:
 };
 
 
+
+// ----------------------------------------------------------------
+// Surface::RenderableSet
+
+
+// A RenderableSet is a set of renderables which are not represented
+// by individual Surface::Renderable objects, but are instead referred
+// to by index.  This is used for surfaces with very large numbers of
+// simple components, such as the triangles in a mesh, where a
+// separate object for each component would use too much memory.
+//
+// The methods are the same as those in Surface::Renderable, except
+// that each takes an additional INDEX argument saying which member of
+// the set is meant.
+//
+// This is an abstract class.
+//
+class Surface::RenderableSet
+{
+public:
+
+  virtual ~RenderableSet () {}
+
+  // If renderable INDEX intersects RAY, change RAY's maximum bound
+  // (Ray::t1) to reflect the point of intersection, and return a
+  // Surface::Renderable::IsecInfo object describing the intersection
+  // (which should be allocated using placement-new with CONTEXT);
+  // otherwise return zero.
+  //
+  virtual const Renderable::IsecInfo *intersect (unsigned index, Ray &ray,
+						 RenderContext &context)
+    const = 0;
+
+  // Return true if renderable INDEX intersects RAY.
+  //
+  virtual bool intersects (unsigned index, const Ray &ray,
+			   RenderContext &context)
+    const = 0;
+
+  // Return true if renderable INDEX completely occludes RAY.  If it
+  // does not completely occlude RAY, then return false, and multiply
+  // TOTAL_TRANSMITTANCE by the transmittance of the renderable in
+  // medium MEDIUM.
+  //
+  virtual bool occludes (unsigned index, const Ray &ray, const Medium &medium,
+			 Color &total_transmittance,
+			 RenderContext &context)
+    const = 0;
+
+  // Return a bounding box for renderable INDEX.
+  //
+  virtual BBox bbox (unsigned index) const = 0;
+};
+
+
 
 // ----------------------------------------------------------------
 // Surface::Renderable::IsecInfo
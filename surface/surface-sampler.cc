@@ -79,3 +79,34 @@ Surface::Sampler::sample_from_viewpoint (const Pos &viewpoint, const UV &param)
 {
   return AngularSample (sample (param), viewpoint);
 }
+
+// Return the area of (one side of) the surface being sampled.
+//
+// This method is optional; the default implementation estimates the
+// area using the PDFs of a set of samples returned by the
+// Surface::Sampler::sample method.
+//
+float
+Surface::Sampler::area () const
+{
+  // As the expected value of 1 / PDF over samples drawn from any
+  // distribution covering the surface is just the surface area, we
+  // average 1 / PDF over a grid of sample parameters.
+  //
+  static const unsigned GRID_SIZE = 8;
+
+  double inv_pdf_sum = 0;
+  unsigned num = 0;
+
+  for (unsigned i = 0; i < GRID_SIZE; i++)
+    for (unsigned j = 0; j < GRID_SIZE; j++)
+      {
+	UV param ((i + 0.5f) / GRID_SIZE, (j + 0.5f) / GRID_SIZE);
+	AreaSample samp = sample (param);
+	if (samp.pdf > 0)
+	  inv_pdf_sum += 1 / double (samp.pdf);
+	num++;
+      }
+
+  return float (inv_pdf_sum / num);
+}
@@ -112,6 +112,14 @@ public:
 					     const Vec &dir)
     const = 0;
 
+  // Return the area of (one side of) the surface being sampled.
+  //
+  // This method is optional; the default implementation estimates the
+  // area using the PDFs of a set of samples returned by the
+  // Surface::Sampler::sample method.
+  //
+  virtual float area () const;
+
 protected:
 
   // This is a helper function that can be used to return a sample
@@ -37,6 +37,7 @@ class Surface
 public:
 
   class Renderable;	  // Interface for surface rendering
+  class RenderableSet;	  // Indexed set of renderables
   class Sampler;	  // Surface-sampling interface
   struct Stats;		  // Surface statistics
 
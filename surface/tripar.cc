@@ -200,6 +200,14 @@ public:
 					     const Vec &dir)
     const;
 
+  // Return the area of (one side of) the surface being sampled.
+  //
+  virtual float area () const
+  {
+    float par_area = cross (tripar.e2, tripar.e1).length ();
+    return tripar.parallelogram ? par_area : par_area * 0.5f;
+  }
+
 private:
 
   const Tripar &tripar;
@@ -13,7 +13,7 @@
 #ifndef SNOGRAY_ARITH_TEX_H
 #define SNOGRAY_ARITH_TEX_H
 
-#include "tex.h"
+#include "tex-eval-cache.h"
 
 
 namespace snogray {
@@ -22,7 +22,7 @@ namespace snogray {
 // A texture which is the result of doing an arithmetic operation
 //
 template<typename T>
-class ArithTex : public Tex<T>
+class ArithTex : public CachedTex<T>
 {
 public:
 
@@ -37,12 +37,17 @@ public:
   };
 
   ArithTex (Op _op, const TexVal<T> &_arg1, const TexVal<T> &_arg2)
-    : op (_op), arg1 (_arg1), arg2 (_arg2)
+    : CachedTex<T> (_arg1.expensive () || _arg2.expensive ()),
+      op (_op), arg1 (_arg1), arg2 (_arg2)
   { }
 
   // Evaluate this texture at TEX_COORDS.
   //
-  virtual T eval (const TexCoords &tex_coords) const;
+  virtual T eval_uncached (const TexCoords &tex_coords) const;
+
+  // Return the result of applying the operation OP to VAL1 and VAL2.
+  //
+  static T apply (Op op, const T &val1, const T &val2);
 
   // The operation.
   //
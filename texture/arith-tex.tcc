@@ -23,15 +23,12 @@
 namespace snogray {
 
 
-// Evaluate this texture at TEX_COORDS.
+// Return the result of applying the operation OP to VAL1 and VAL2.
 //
 template<typename T>
-T
-ArithTex<T>::eval (const TexCoords &tex_coords) const
+inline T
+ArithTex<T>::apply (Op op, const T &val1, const T &val2)
 {
-  T val1 = arg1.eval (tex_coords);
-  T val2 = arg2.eval (tex_coords);
-
   switch (op)
     {
     case ADD:
@@ -73,6 +70,15 @@ ArithTex<T>::eval (const TexCoords &tex_coords) const
     };
 }
 
+// Evaluate this texture at TEX_COORDS.
+//
+template<typename T>
+T
+ArithTex<T>::eval_uncached (const TexCoords &tex_coords) const
+{
+  return apply (op, arg1.eval (tex_coords), arg2.eval (tex_coords));
+}
+
 
 // If possible, suppress instantiation of classes which we will define
 // out-of-line.
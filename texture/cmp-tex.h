@@ -13,7 +13,7 @@
 #ifndef SNOGRAY_CMP_TEX_H
 #define SNOGRAY_CMP_TEX_H
 
-#include "tex.h"
+#include "tex-eval-cache.h"
 
 
 namespace snogray {
@@ -23,7 +23,7 @@ namespace snogray {
 // values depending on the result.
 //
 template<typename T>
-class CmpTex : public Tex<T>
+class CmpTex : public CachedTex<T>
 {
 public:
 
@@ -32,12 +32,14 @@ public:
   CmpTex (Op _op,
 	  const TexVal<float> &_cval1, const TexVal<float> &_cval2,
 	  const TexVal<T> &_rval1, const TexVal<T> &_rval2)
-    : op (_op), cval1 (_cval1), cval2 (_cval2), rval1 (_rval1), rval2 (_rval2)
+    : CachedTex<T> (_cval1.expensive () || _cval2.expensive ()
+		    || _rval1.expensive () || _rval2.expensive ()),
+      op (_op), cval1 (_cval1), cval2 (_cval2), rval1 (_rval1), rval2 (_rval2)
   { }
 
   // Evaluate this texture at COORDS.
   //
-  virtual T eval (const TexCoords &coords) const;
+  virtual T eval_uncached (const TexCoords &coords) const;
 
   // The operation.
   //
@@ -25,7 +25,7 @@ namespace snogray {
 //
 template<typename T>
 T
-CmpTex<T>::eval (const TexCoords &coords) const
+CmpTex<T>::eval_uncached (const TexCoords &coords) const
 {
   T c1 = cval1.eval (coords);
   T c2 = cval2.eval (coords);
@@ -14,6 +14,7 @@
 #define SNOGRAY_COORD_TEX_H
 
 #include "tex.h"
+#include "tex-program.h"
 
 
 namespace snogray {
@@ -44,6 +45,8 @@ public:
 
 private:
 
+  friend class TexProgram::Compiler;
+
   Kind kind;
 };
 
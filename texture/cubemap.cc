@@ -209,7 +209,12 @@ Cubemap::load (std::istream &stream, const std::string &filename_pfx)
 
       try
 	{ 
-	  face.tex.reset (new MatrixTex<Color> (tex_filename));
+	  // Cubemap lookups never have a footprint, so don't bother
+	  // with filtering.
+	  //
+	  ValTable tex_params;
+	  tex_params.set ("filter", std::string ("bilinear"));
+	  face.tex.reset (new MatrixTex<Color> (tex_filename, tex_params));
 	}
       catch (std::runtime_error &err)
 	{
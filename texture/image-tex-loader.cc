@@ -0,0 +1,314 @@
+// image-tex-loader.cc -- Deferred and parallel loading of image textures
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <stdexcept>
+#include <algorithm>
+
+#include "util/timeval.h"
+#include "util/num-cores.h"
+
+#include "image-tex-loader.h"
+
+
+using namespace snogray;
+
+
+ImageTexLoader::ImageTexLoader ()
+  : _mode (LOAD_PARALLEL), max_threads (num_cores ()), active_workers (0)
+{ }
+
+ImageTexLoader::~ImageTexLoader ()
+{
+  {
+    LockGuard guard (mutex);
+
+    for (std::deque<Job *>::iterator ji = queue.begin ();
+	 ji != queue.end (); ++ji)
+      (*ji)->state = Job::UNLOADED;
+
+    queue.clear ();
+  }
+
+  join_workers ();
+}
+
+// Return the global image-texture loader.
+//
+ImageTexLoader &
+ImageTexLoader::global ()
+{
+  // This is never destroyed, as textures may still refer to it during
+  // program exit.
+  //
+  static ImageTexLoader *global_loader = new ImageTexLoader;
+  return *global_loader;
+}
+
+// Set the loading mode to MODE.  NUM_THREADS is the maximum number of
+// worker threads used in LOAD_PARALLEL mode; if 0, the number of
+// cores is used.
+//
+void
+ImageTexLoader::set_mode (Mode mode, unsigned num_threads)
+{
+  LockGuard guard (mutex);
+  _mode = mode;
+  max_threads = num_threads ? num_threads : num_cores ();
+}
+
+
+// Job management
+
+// Register JOB with the loader.  In LOAD_IMMEDIATE mode, JOB is
+// loaded immediately (and an exception thrown if that fails); in
+// LOAD_PARALLEL mode, it is queued for loading by a worker thread;
+// in LOAD_LAZY mode, nothing is done until ImageTexLoader::load is
+// called.
+//
+void
+ImageTexLoader::add (Job &job)
+{
+  UniqueLock lock (mutex);
+
+  job.entry = entries.size ();
+  entries.push_back (Entry (job.filename));
+
+  if (_mode == LOAD_IMMEDIATE)
+    {
+      run_job (job, lock);
+      if (job.state == Job::FAILED)
+	throw std::runtime_error (job.error);
+    }
+  else if (_mode == LOAD_PARALLEL)
+    {
+      job.state = Job::QUEUED;
+      queue.push_back (&job);
+      start_workers ();
+    }
+}
+
+// Make sure that JOB has been loaded, loading it in the calling
+// thread if necessary, or waiting for it if some other thread is
+// already loading it.  If loading failed, an exception is thrown.
+//
+void
+ImageTexLoader::load (Job &job)
+{
+  UniqueLock lock (mutex);
+
+  for (;;)
+    switch (job.state)
+      {
+      case Job::QUEUED:
+	queue.erase (std::find (queue.begin (), queue.end (), &job));
+	// fall through
+
+      case Job::UNLOADED:
+	run_job (job, lock);
+	break;
+
+      case Job::LOADING:
+	job_done.wait (lock);
+	break;
+
+      case Job::LOADED:
+	return;
+
+      case Job::FAILED:
+	throw std::runtime_error (job.error);
+      }
+}
+
+// Unregister JOB, which is about to be destroyed.  If it is being
+// loaded by another thread, wait for that to finish first.
+//
+void
+ImageTexLoader::remove (Job &job)
+{
+  UniqueLock lock (mutex);
+
+  while (job.state == Job::LOADING)
+    job_done.wait (lock);
+
+  if (job.state == Job::QUEUED)
+    queue.erase (std::find (queue.begin (), queue.end (), &job));
+}
+
+// Load JOB in the calling thread, and record the result.  LOCK must be
+// a lock on MUTEX, which is released during the actual loading.
+//
+void
+ImageTexLoader::run_job (Job &job, UniqueLock &lock)
+{
+  job.state = Job::LOADING;
+
+  lock.unlock ();
+
+  Timeval beg_time (Timeval::TIME_OF_DAY);
+
+  std::string error;
+  try
+    {
+      job.load ();
+    }
+  catch (std::exception &err)
+    {
+      error = err.what ();
+      if (error.empty ())
+	error = job.filename + ": Cannot load texture";
+    }
+
+  Timeval end_time (Timeval::TIME_OF_DAY);
+
+  lock.lock ();
+
+  Entry &entry = entries[job.entry];
+  entry.load_time = end_time - beg_time;
+
+  if (error.empty ())
+    {
+      job.state = Job::LOADED;
+      entry.loaded = true;
+    }
+  else
+    {
+      job.state = Job::FAILED;
+      job.error = error;
+      entry.error = error;
+    }
+
+  job.publish (error.empty ());
+
+  job_done.notify_all ();
+}
+
+
+// Worker threads
+
+// Worker thread main loop; loads queued jobs until the queue is
+// empty, and then exits.
+//
+void
+ImageTexLoader::worker ()
+{
+  UniqueLock lock (mutex);
+
+  while (! queue.empty ())
+    {
+      Job *job = queue.front ();
+      queue.pop_front ();
+
+      run_job (*job, lock);
+
+      if (job->state == Job::FAILED && worker_error.empty ())
+	worker_error = job->error;
+    }
+
+  active_workers--;
+  job_done.notify_all ();
+}
+
+// If there are more queued jobs than active workers, start more
+// worker threads, up to MAX_THREADS.  MUTEX must be locked.
+//
+void
+ImageTexLoader::start_workers ()
+{
+#if USE_THREADS
+  while (active_workers < max_threads && active_workers < queue.size ())
+    {
+      active_workers++;
+      workers.push_back (new Thread (&ImageTexLoader::worker, this));
+    }
+#endif
+}
+
+// Join all worker threads, which must be finishing.
+//
+void
+ImageTexLoader::join_workers ()
+{
+#if USE_THREADS
+  std::vector<Thread *> finished;
+
+  {
+    LockGuard guard (mutex);
+    finished.swap (workers);
+  }
+
+  for (std::vector<Thread *>::iterator ti = finished.begin ();
+       ti != finished.end (); ++ti)
+    {
+      (*ti)->join ();
+      delete *ti;
+    }
+#endif
+}
+
+// Wait until all queued jobs have been loaded.  If any load failed,
+// an exception describing the first failure is thrown.
+//
+void
+ImageTexLoader::wait ()
+{
+  std::string error;
+
+  {
+    UniqueLock lock (mutex);
+
+    // Help out with any jobs still in the queue (if threads aren't
+    // supported, this is where all the loading happens).
+    //
+    while (! queue.empty ())
+      {
+	Job *job = queue.front ();
+	queue.pop_front ();
+
+	run_job (*job, lock);
+
+	if (job->state == Job::FAILED && worker_error.empty ())
+	  worker_error = job->error;
+      }
+
+    while (active_workers > 0)
+      job_done.wait (lock);
+
+    error = worker_error;
+    worker_error.clear ();
+  }
+
+  join_workers ();
+
+  if (! error.empty ())
+    throw std::runtime_error (error);
+}
+
+
+// Load statistics
+
+// Return the number of textures registered with the loader.
+//
+unsigned
+ImageTexLoader::num_entries () const
+{
+  LockGuard guard (mutex);
+  return entries.size ();
+}
+
+// Return a copy of entry I, describing texture number I.
+//
+ImageTexLoader::Entry
+ImageTexLoader::entry (unsigned i) const
+{
+  LockGuard guard (mutex);
+  return entries[i];
+}
@@ -0,0 +1,228 @@
+// image-tex-loader.h -- Deferred and parallel loading of image textures
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_IMAGE_TEX_LOADER_H
+#define SNOGRAY_IMAGE_TEX_LOADER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#include "config.h"
+
+#include "util/mutex.h"
+#include "util/cond-var.h"
+#if USE_THREADS
+# include "util/thread.h"
+#endif
+
+
+namespace snogray {
+
+
+// A manager for loading image textures, which are often the most
+// time-consuming part of scene loading.
+//
+// Depending on the loader's mode, each image texture is loaded either:
+//
+//   LOAD_IMMEDIATE  immediately, when the texture is defined
+//   LOAD_PARALLEL   in the background, by a pool of worker threads
+//   LOAD_LAZY       only when the texture is first evaluated
+//
+// In the latter two cases, a texture which is evaluated before it has
+// been loaded is loaded (or waited for) by the thread evaluating it.
+//
+// The loader also keeps a record of how long each texture took to
+// load, for reporting.
+//
+class ImageTexLoader
+{
+public:
+
+  enum Mode { LOAD_IMMEDIATE, LOAD_PARALLEL, LOAD_LAZY };
+
+  // A texture waiting to be loaded.
+  //
+  class Job
+  {
+  public:
+
+    Job (const std::string &_filename)
+      : filename (_filename), state (UNLOADED), entry (0)
+    { }
+    virtual ~Job () { }
+
+    // Actually load the texture.  This is called at most once, by
+    // ImageTexLoader, and possibly in another thread.
+    //
+    virtual void load () = 0;
+
+    // Called by ImageTexLoader after Job::load has returned, with
+    // SUCCEEDED true, or thrown an exception, with SUCCEEDED false.
+    // The loader's lock is held during the call, so this is a safe
+    // place to make the result of loading visible to other threads.
+    //
+    virtual void publish (bool /* succeeded */) { }
+
+    // File the texture is loaded from.
+    //
+    const std::string filename;
+
+  private:
+
+    friend class ImageTexLoader;
+
+    enum State { UNLOADED, QUEUED, LOADING, LOADED, FAILED };
+
+    State state;
+
+    // If STATE is FAILED, the error message.
+    //
+    std::string error;
+
+    // Index of this job's entry in ImageTexLoader::entries.
+    //
+    unsigned entry;
+  };
+
+  // Load-time information about a single texture.
+  //
+  struct Entry
+  {
+    Entry (const std::string &_filename)
+      : filename (_filename), loaded (false), load_time (0)
+    { }
+
+    std::string filename;
+
+    // True if the texture has been loaded.
+    //
+    bool loaded;
+
+    // If loading the texture failed, the error message.
+    //
+    std::string error;
+
+    // Time spent loading the texture, in seconds.
+    //
+    double load_time;
+  };
+
+  ImageTexLoader ();
+  ~ImageTexLoader ();
+
+  // Return the global image-texture loader.
+  //
+  static ImageTexLoader &global ();
+
+  // Set the loading mode to MODE.  NUM_THREADS is the maximum number of
+  // worker threads used in LOAD_PARALLEL mode; if 0, the number of
+  // cores is used.
+  //
+  void set_mode (Mode mode, unsigned num_threads = 0);
+
+  // Return the current loading mode.
+  //
+  Mode mode () const { return _mode; }
+
+  // Register JOB with the loader.  In LOAD_IMMEDIATE mode, JOB is
+  // loaded immediately (and an exception thrown if that fails); in
+  // LOAD_PARALLEL mode, it is queued for loading by a worker thread;
+  // in LOAD_LAZY mode, nothing is done until ImageTexLoader::load is
+  // called.
+  //
+  void add (Job &job);
+
+  // Make sure that JOB has been loaded, loading it in the calling
+  // thread if necessary, or waiting for it if some other thread is
+  // already loading it.  If loading failed, an exception is thrown.
+  //
+  void load (Job &job);
+
+  // Unregister JOB, which is about to be destroyed.  If it is being
+  // loaded by another thread, wait for that to finish first.
+  //
+  void remove (Job &job);
+
+  // Wait until all queued jobs have been loaded.  If any load failed,
+  // an exception describing the first failure is thrown.
+  //
+  void wait ();
+
+  // Return the number of textures registered with the loader, and a
+  // copy of entry I, describing texture number I.
+  //
+  unsigned num_entries () const;
+  Entry entry (unsigned i) const;
+
+private:
+
+  // Load JOB in the calling thread, and record the result.  LOCK must be
+  // a lock on MUTEX, which is released during the actual loading.
+  //
+  void run_job (Job &job, UniqueLock &lock);
+
+  // Worker thread main loop; loads queued jobs until the queue is
+  // empty, and then exits.
+  //
+  void worker ();
+
+  // If there are more queued jobs than active workers, start more
+  // worker threads, up to MAX_THREADS.  MUTEX must be locked.
+  //
+  void start_workers ();
+
+  // Join all worker threads, which must be finishing.
+  //
+  void join_workers ();
+
+  Mode _mode;
+
+  // Maximum number of worker threads.
+  //
+  unsigned max_threads;
+
+  // Jobs waiting to be loaded by worker threads.
+  //
+  std::deque<Job *> queue;
+
+  // Load-time information about all textures ever registered.
+  //
+  std::vector<Entry> entries;
+
+  // Number of worker threads currently running.
+  //
+  unsigned active_workers;
+
+#if USE_THREADS
+  // All worker threads started since the last call to
+  // ImageTexLoader::join_workers.
+  //
+  std::vector<Thread *> workers;
+#endif
+
+  // The first error reported by a worker thread since the last call to
+  // ImageTexLoader::wait, or an empty string if there was none.
+  //
+  std::string worker_error;
+
+  // Lock protecting all our state (and the state of jobs), and a
+  // condition variable signaled whenever a job finishes loading.
+  //
+  mutable Mutex mutex;
+  CondVar job_done;
+};
+
+
+}
+
+#endif // SNOGRAY_IMAGE_TEX_LOADER_H
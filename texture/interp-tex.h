@@ -16,6 +16,7 @@
 #include "util/interp.h"
 
 #include "tex.h"
+#include "tex-program.h"
 
 
 namespace snogray {
@@ -43,6 +44,8 @@ public:
 
 private:
 
+  friend class TexProgram::Compiler;
+
   const TexVal<float> control;
   const TexVal<T> val1, val2;
 };
@@ -70,6 +73,8 @@ public:
 
 private:
 
+  friend class TexProgram::Compiler;
+
   const TexVal<float> control;
   const TexVal<T> val1, val2;
 };
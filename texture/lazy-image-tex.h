@@ -0,0 +1,131 @@
+// lazy-image-tex.h -- Image texture loaded by ImageTexLoader
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_LAZY_IMAGE_TEX_H
+#define SNOGRAY_LAZY_IMAGE_TEX_H
+
+#include "util/compiler.h"
+#include "util/atomic-ptr.h"
+#include "util/val-table.h"
+#include "matrix-tex.h"
+#include "image-tex-loader.h"
+
+
+namespace snogray {
+
+
+// An image texture whose image is loaded by the global ImageTexLoader,
+// possibly in another thread, or not until the texture is first
+// evaluated.  Once loaded, evaluation is just passed on to a MatrixTex.
+//
+// The image file's header is read when the texture is created, so
+// missing or unreadable files are still reported during scene loading.
+// If loading the image data later fails, an error is recorded by the
+// loader, and the texture evaluates to zero.
+//
+template<typename T>
+class LazyImageTex : public Tex<T>, public ImageTexLoader::Job
+{
+public:
+
+  LazyImageTex (const std::string &filename,
+		const ValTable &_params = ValTable::NONE)
+    : Job (filename), params (_params),
+      element_type (tuple_element_type (filename, _params))
+  {
+    ImageTexLoader::global ().add (*this);
+  }
+
+  ~LazyImageTex () { ImageTexLoader::global ().remove (*this); }
+
+  // Evaluate this texture at TEX_COORDS.
+  //
+  virtual T eval (const TexCoords &tex_coords) const
+  {
+    const Tex<T> *tex = loaded_tex.load_acquire ();
+    if (unlikely (! tex))
+      tex = wait_for_load ();
+    return tex->eval (tex_coords);
+  }
+
+  // Load the image.  This is called by ImageTexLoader, possibly in
+  // another thread.
+  //
+  virtual void load ()
+  {
+    matrix_tex = make_matrix_tex<T> (filename, params, element_type);
+  }
+
+  // Make the result of loading visible to Tex::eval, using the loaded
+  // texture if loading SUCCEEDED, and otherwise a texture which is
+  // always zero.  This is called by ImageTexLoader with its lock held.
+  //
+  virtual void publish (bool succeeded)
+  {
+    if (succeeded)
+      loaded_tex.store_release (&*matrix_tex);
+    else
+      loaded_tex.store_release (&zero_tex);
+  }
+
+private:
+
+  // A texture that always evaluates to zero, used if loading fails.
+  //
+  class ZeroTex : public Tex<T>
+  {
+  public:
+    virtual T eval (const TexCoords &) const { return T (0); }
+  };
+
+  // Make sure our image has been loaded, and return the texture to use.
+  //
+  const Tex<T> *wait_for_load () const
+  {
+    try
+      {
+	ImageTexLoader::global ().load (const_cast<LazyImageTex &> (*this));
+      }
+    catch (std::runtime_error &)
+      {
+	// The loader has already recorded the error, and published
+	// ZERO_TEX as our texture.
+      }
+
+    return loaded_tex.load_acquire ();
+  }
+
+  // Parameters for loading the image.
+  //
+  const ValTable params;
+
+  // Type of matrix element used to store the image.
+  //
+  const TupleElementType element_type;
+
+  // The loaded texture, once loading is complete.
+  //
+  Ref<Tex<T> > matrix_tex;
+
+  // The texture to use for evaluation, or zero if not yet loaded.  This
+  // is read without locking, so is only set, by
+  // LazyImageTex::publish, once everything it points to is ready.
+  //
+  AtomicPtr<const Tex<T> > loaded_tex;
+
+  ZeroTex zero_tex;
+};
+
+
+}
+
+#endif // SNOGRAY_LAZY_IMAGE_TEX_H
@@ -16,6 +16,37 @@
 using namespace snogray;
 
 
+// Table of Gaussian filter weights used for EWA filtering in MatrixTex.
+// Entry I is the weight for a texel whose squared (normalized) distance
+// from the filter center is I / MATRIX_TEX_EWA_WEIGHTS_SIZE.
+//
+float snogray::matrix_tex_ewa_weights[MATRIX_TEX_EWA_WEIGHTS_SIZE];
+
+namespace { // keep local to file
+
+// Initializer for MATRIX_TEX_EWA_WEIGHTS.
+//
+struct EwaWeightsInit
+{
+  EwaWeightsInit ()
+  {
+    // The Gaussian is offset so that it falls to zero at the edge of
+    // the filter.
+    //
+    const float alpha = 2;
+    for (unsigned i = 0; i < MATRIX_TEX_EWA_WEIGHTS_SIZE; i++)
+      {
+	float r2 = float (i) / float (MATRIX_TEX_EWA_WEIGHTS_SIZE - 1);
+	matrix_tex_ewa_weights[i] = exp (-alpha * r2) - exp (-alpha);
+      }
+  }
+};
+
+EwaWeightsInit ewa_weights_init;
+
+} // namespace
+
+
 // If the compiler supports "extern template" syntax, we can define some
 // commonly used instantiations out-of-line here, which saves a lot of
 // space.
@@ -26,6 +57,12 @@ using namespace snogray;
 #if HAVE_EXTERN_TEMPLATE
 template class snogray::MatrixTex<Color>;
 template class snogray::MatrixTex<float>;
+template class snogray::MatrixTex<Color, SrgbByte>;
+template class snogray::MatrixTex<float, SrgbByte>;
+#if HAVE_LIBEXR
+template class snogray::MatrixTex<Color, float>;
+template class snogray::MatrixTex<float, float>;
+#endif
 #endif
 
 
@@ -14,32 +14,77 @@
 #define SNOGRAY_MATRIX_TEX_H
 
 #include <string>
+#include <vector>
 
 #include "util/snogmath.h"
 #include "tex.h"
 #include "image/tuple-matrix.h"
+#include "image/tiled-matrix.h"
 #include "matrix-linterp.h"
 
 
 namespace snogray {
 
 
+// Number of entries in MATRIX_TEX_EWA_WEIGHTS.
+//
+#define MATRIX_TEX_EWA_WEIGHTS_SIZE 128
+
+// Table of Gaussian filter weights used for EWA filtering in MatrixTex.
+// Entry I is the weight for a texel whose squared (normalized) distance
+// from the filter center is I / MATRIX_TEX_EWA_WEIGHTS_SIZE.
+//
+extern float matrix_tex_ewa_weights[MATRIX_TEX_EWA_WEIGHTS_SIZE];
+
+
 // A 2d texture based on a matrix tuple (probably loaded from an image).
 //
+// If the texture coordinates passed to MatrixTex::eval include a
+// footprint (TexCoords::dTdx and TexCoords::dTdy), the lookup is
+// filtered using a mip-map pyramid of the texture, to avoid aliasing
+// when the texture is viewed at a distance.  The "filter" parameter
+// chooses the filtering method:
+//
+//   "ewa"       elliptically weighted averaging, which handles
+//               anisotropic footprints well (the default)
+//   "trilinear" interpolation between bilinear lookups in two
+//               mip-map levels; faster, but blurrier
+//   "bilinear"  no filtering; only a single bilinear lookup in the
+//               full-size texture is done
+//
+// The "max_anisotropy" parameter limits the ratio between the long and
+// short axes of EWA footprints (default 8), as very long footprints are
+// expensive to filter.
+//
+// The template parameter DT is the type used to store matrix elements;
+// make_matrix_tex chooses a suitable one for each image file.
+//
+// Textures loaded from an image file may use tiled storage (see
+// TiledMatrixData::use_tiles), in which case the image data is not kept
+// in memory, but read on demand through the global tile-cache.  The
+// MATRIX field and iterators are only valid for textures that don't
+// use tiled storage.
+//
 template<typename T, typename DT = default_tuple_element_type>
 class MatrixTex : public Tex<T>
 {
 public:
 
+  // This constructor loads the texture from the image file FILENAME,
+  // and may use tiled storage.  PARAMS may also contain texture
+  // filtering parameters.
+  //
   MatrixTex (const std::string &filename,
 	     const ValTable &params = ValTable::NONE);
 
   // This constructor stores a (ref-counted) reference to CONTENTS.
+  // Lookups using this constructor are not filtered.
   //
   MatrixTex (const Ref<TupleMatrix<T, DT> > &contents);
 
   // This constructor _copies_ the specified region of BASE (and so
-  // doesn't reference BASE).
+  // doesn't reference BASE).  Lookups using this constructor are not
+  // filtered.
   //
   MatrixTex (const TupleMatrix<T, DT> &base,
 	     unsigned offs_x, unsigned offs_y, unsigned w, unsigned h);
@@ -106,16 +151,136 @@ public:
 
   const_iterator end () const {return const_iterator(*this, 0, matrix->height);}
 
-  // Matrix holding data for this texture.
+  // Matrix holding data for this texture.  This is null if the
+  // texture uses tiled storage.
   //
   Ref<TupleMatrix<T, DT> > matrix;
 
 private:
 
+  // Texture filtering methods.
+  //
+  enum Filter { FILTER_BILINEAR, FILTER_TRILINEAR, FILTER_EWA };
+
+  // Set up filtering according to PARAMS.
+  //
+  void init_filter (const ValTable &params);
+
+  // Return the number of mip-map levels, and the width and height of
+  // mip-map level LEVEL.
+  //
+  unsigned num_levels () const
+  {
+    return tiled ? tiled->num_levels () : mip_levels.size () + 1;
+  }
+  unsigned level_width (unsigned level) const
+  {
+    return (tiled ? tiled->level_width (level)
+	    : level == 0 ? matrix->width : mip_levels[level - 1]->width);
+  }
+  unsigned level_height (unsigned level) const
+  {
+    return (tiled ? tiled->level_height (level)
+	    : level == 0 ? matrix->height : mip_levels[level - 1]->height);
+  }
+
+  // Return the value of the matrix element at X, Y in mip-map level
+  // LEVEL, where X and Y must be within bounds.
+  //
+  // PIN, here and in the following methods, is only used with tiled
+  // storage, to keep the most recently used tile pinned so that
+  // neighboring elements can be fetched without consulting the
+  // tile-cache (see TiledMatrixData::get_tuple).
+  //
+  T element (unsigned level, unsigned x, unsigned y, TileCache::Pin &pin)
+    const
+  {
+    if (tiled)
+      return (*tiled) (x, y, level, pin);
+    else if (level == 0)
+      return (*matrix) (x, y);
+    else
+      return (*mip_levels[level - 1]) (x, y);
+  }
+
+  // Return the texel at integer texel coordinates X, Y in mip-map level
+  // LEVEL.  X and Y wrap around, and Y increases upwards, like the V
+  // texture coordinate.
+  //
+  T texel (unsigned level, int x, int y, TileCache::Pin &pin) const;
+
+  // Return a bilinearly interpolated lookup at UV in mip-map level LEVEL.
+  //
+  T bilinear (unsigned level, const UV &uv, TileCache::Pin &pin) const;
+
+  // Return a lookup at UV, interpolated between the two mip-map levels
+  // closest in resolution to a footprint WIDTH wide (in UV units).
+  //
+  T trilinear (const UV &uv, float width, TileCache::Pin &pin) const;
+
+  // Return a lookup at UV filtered over the elliptical footprint with
+  // axes AXIS0 and AXIS1 (in UV units), using elliptically weighted
+  // averaging.
+  //
+  T ewa (const UV &uv, UV axis0, UV axis1, TileCache::Pin &pin) const;
+
+  // Return a lookup at UV in mip-map level LEVEL, filtered over the
+  // elliptical footprint with axes AXIS0 and AXIS1.
+  //
+  T ewa_level (unsigned level, const UV &uv,
+	       const UV &axis0, const UV &axis1, TileCache::Pin &pin)
+    const;
+
+  // Return the mip-map level (possibly fractional) whose texels are
+  // about WIDTH wide (in UV units), clamped to the valid range.
+  //
+  float level_for_width (float width) const;
+
+  // Build MIP_LEVELS from MATRIX.
+  //
+  void make_mip_levels ();
+
+  // If non-null, tiled storage holding data for this texture, used
+  // instead of MATRIX.
+  //
+  Ref<TiledMatrix<T, DT> > tiled;
+
   const MatrixLinterp interp;
+
+  // Filtering method used for lookups with a footprint.
+  //
+  Filter filter;
+
+  // Maximum ratio between the axes of an EWA filter footprint.
+  //
+  float max_anisotropy;
+
+  // When not using tiled storage, and filtering is enabled, mip-map
+  // levels 1 and up (level 0 is MATRIX); each is half the size of the
+  // previous level, down to 1 x 1.
+  //
+  std::vector<Ref<TupleMatrix<T, DT> > > mip_levels;
 };
 
 
+// Return a new MatrixTex loaded from the image file FILENAME, whose
+// storage element type is chosen according to the image format and
+// PARAMS (see tuple_element_type).  All lookups are specialized for
+// the chosen type at compile time.
+//
+template<typename T>
+Ref<Tex<T> > make_matrix_tex (const std::string &filename,
+			      const ValTable &params = ValTable::NONE);
+
+// Return a new MatrixTex loaded from the image file FILENAME, using
+// PARAMS, which stores its data using ELEMENT_TYPE.
+//
+template<typename T>
+Ref<Tex<T> > make_matrix_tex (const std::string &filename,
+			      const ValTable &params,
+			      TupleElementType element_type);
+
+
 } // namespace snogray
 
 
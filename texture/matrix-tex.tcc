@@ -15,6 +15,9 @@
 
 #include "config.h"
 
+#include <stdexcept>
+#include <algorithm>
+
 #if HAVE_EXTERN_TEMPLATE
 # include "color/color.h"
 #endif
@@ -27,13 +30,19 @@ namespace snogray {
 
 template<typename T, typename DT>
 MatrixTex<T,DT>::MatrixTex (const std::string &filename, const ValTable &params)
-  : matrix (new TupleMatrix<T,DT> (filename, params)),
-    interp (matrix->width, matrix->height)
-{ }
+  : matrix (TiledMatrix<T,DT>::use_tiles (params)
+	    ? 0 : new TupleMatrix<T,DT> (filename, params)),
+    tiled (matrix ? 0 : new TiledMatrix<T,DT> (filename, params)),
+    interp (matrix ? matrix->width : tiled->width,
+	    matrix ? matrix->height : tiled->height)
+{
+  init_filter (params);
+}
 
 template<typename T, typename DT>
 MatrixTex<T,DT>::MatrixTex (const Ref<TupleMatrix<T, DT> > &contents)
-  : matrix (contents), interp (matrix->width, matrix->height)
+  : matrix (contents), interp (matrix->width, matrix->height),
+    filter (FILTER_BILINEAR), max_anisotropy (8)
 { }
 
 template<typename T, typename DT>
@@ -41,15 +50,94 @@ MatrixTex<T,DT>::MatrixTex (const TupleMatrix<T,DT> &base,
 			    unsigned offs_x, unsigned offs_y,
 			    unsigned w, unsigned h)
   : matrix (new TupleMatrix<T,DT> (base, offs_x, offs_y, w, h)),
-    interp (matrix->width, matrix->height)
+    interp (matrix->width, matrix->height),
+    filter (FILTER_BILINEAR), max_anisotropy (8)
 { }
 
+// Set up filtering according to PARAMS.
+//
+template<typename T, typename DT>
+void
+MatrixTex<T,DT>::init_filter (const ValTable &params)
+{
+  std::string filter_name = params.get_string ("filter", "ewa");
+
+  if (filter_name == "ewa")
+    filter = FILTER_EWA;
+  else if (filter_name == "trilinear")
+    filter = FILTER_TRILINEAR;
+  else if (filter_name == "bilinear")
+    filter = FILTER_BILINEAR;
+  else
+    throw std::runtime_error ("Unknown texture filter \"" + filter_name + "\"");
+
+  max_anisotropy = params.get_float ("max_anisotropy", 8);
+
+  // Tiled storage already includes mip-map levels.
+  //
+  if (filter != FILTER_BILINEAR && !tiled)
+    make_mip_levels ();
+}
+
+// Build MIP_LEVELS from MATRIX.
+//
+template<typename T, typename DT>
+void
+MatrixTex<T,DT>::make_mip_levels ()
+{
+  // This uses the same box-filter as TiledMatrixData, so that tiled and
+  // non-tiled textures look the same.
+  //
+  const TupleMatrix<T, DT> *prev = &*matrix;
+
+  while (prev->width > 1 || prev->height > 1)
+    {
+      unsigned w = (prev->width + 1) / 2, h = (prev->height + 1) / 2;
+      Ref<TupleMatrix<T, DT> > level = new TupleMatrix<T, DT> (w, h);
+
+      for (unsigned y = 0; y < h; y++)
+	for (unsigned x = 0; x < w; x++)
+	  {
+	    unsigned x0 = x * 2, x1 = min (x0 + 1, prev->width - 1);
+	    unsigned y0 = y * 2, y1 = min (y0 + 1, prev->height - 1);
+	    (*level) (x, y)
+	      = (T ((*prev) (x0, y0)) + T ((*prev) (x1, y0))
+		 + T ((*prev) (x0, y1)) + T ((*prev) (x1, y1))) * 0.25f;
+	  }
+
+      mip_levels.push_back (level);
+      prev = &*level;
+    }
+}
+
+
+
+// ----------------------------------------------------------------
+// Texture lookup
+
+
 // Evaluate this texture at TEX_COORDS.
 //
 template<typename T, typename DT>
 T
 MatrixTex<T,DT>::eval (const TexCoords &tex_coords) const
 {
+  // Tile pin used for all lookups in tiled storage.
+  //
+  TileCache::Pin pin;
+
+  if (filter != FILTER_BILINEAR && tex_coords.has_footprint ())
+    {
+      if (filter == FILTER_EWA)
+	return ewa (tex_coords.uv, tex_coords.dTdx, tex_coords.dTdy, pin);
+      else
+	{
+	  float dx = max (abs (tex_coords.dTdx.u), abs (tex_coords.dTdx.v));
+	  float dy = max (abs (tex_coords.dTdy.u), abs (tex_coords.dTdy.v));
+	  return trilinear (tex_coords.uv, max (dx, dy), pin);
+	}
+    }
+
   unsigned xi_lo, yi_lo, xi_hi, yi_hi;
   float x_lo_fr, y_lo_fr, x_hi_fr, y_hi_fr;
   interp.calc_params (tex_coords.uv, xi_lo, yi_lo, xi_hi, yi_hi,
@@ -59,6 +147,13 @@ MatrixTex<T,DT>::eval (const TexCoords &tex_coords) const
   // No attempt is made to optimize the case where an pixel is hit
   // directly, as that's probably fairly rare.
   //
+  if (tiled)
+    return
+      x_lo_fr * y_lo_fr * (*tiled) (xi_lo, yi_lo, 0, pin)
+      + x_lo_fr * y_hi_fr * (*tiled) (xi_lo, yi_hi, 0, pin)
+      + x_hi_fr * y_lo_fr * (*tiled) (xi_hi, yi_lo, 0, pin)
+      + x_hi_fr * y_hi_fr * (*tiled) (xi_hi, yi_hi, 0, pin);
+
   return
     x_lo_fr * y_lo_fr * (*matrix) (xi_lo, yi_lo)
     + x_lo_fr * y_hi_fr * (*matrix) (xi_lo, yi_hi)
@@ -66,6 +161,237 @@ MatrixTex<T,DT>::eval (const TexCoords &tex_coords) const
     + x_hi_fr * y_hi_fr * (*matrix) (xi_hi, yi_hi);
 }
 
+// Return the texel at integer texel coordinates X, Y in mip-map level
+// LEVEL.  X and Y wrap around, and Y increases upwards, like the V
+// texture coordinate.
+//
+template<typename T, typename DT>
+T
+MatrixTex<T,DT>::texel (unsigned level, int x, int y, TileCache::Pin &pin)
+  const
+{
+  int w = level_width (level), h = level_height (level);
+
+  x %= w;
+  if (x < 0)
+    x += w;
+  y %= h;
+  if (y < 0)
+    y += h;
+
+  return element (level, x, h - y - 1, pin);
+}
+
+// Return a bilinearly interpolated lookup at UV in mip-map level LEVEL.
+//
+template<typename T, typename DT>
+T
+MatrixTex<T,DT>::bilinear (unsigned level, const UV &uv, TileCache::Pin &pin)
+  const
+{
+  MatrixLinterp level_interp (level_width (level), level_height (level));
+
+  unsigned xi_lo, yi_lo, xi_hi, yi_hi;
+  float x_lo_fr, y_lo_fr, x_hi_fr, y_hi_fr;
+  level_interp.calc_params (uv, xi_lo, yi_lo, xi_hi, yi_hi,
+			    x_lo_fr, y_lo_fr, x_hi_fr, y_hi_fr);
+
+  return
+    x_lo_fr * y_lo_fr * element (level, xi_lo, yi_lo, pin)
+    + x_lo_fr * y_hi_fr * element (level, xi_lo, yi_hi, pin)
+    + x_hi_fr * y_lo_fr * element (level, xi_hi, yi_lo, pin)
+    + x_hi_fr * y_hi_fr * element (level, xi_hi, yi_hi, pin);
+}
+
+// Return the mip-map level (possibly fractional) whose texels are
+// about WIDTH wide (in UV units), clamped to the valid range.
+//
+template<typename T, typename DT>
+float
+MatrixTex<T,DT>::level_for_width (float width) const
+{
+  // Each level halves the resolution, so the level whose texels are
+  // WIDTH wide is log2 of WIDTH in level-0 texels.
+  //
+  float texels = width * max (level_width (0), level_height (0));
+  float level = texels > 1 ? float (log (texels) / log (2.f)) : 0.f;
+  return min (level, float (num_levels () - 1));
+}
+
+// Return a lookup at UV, interpolated between the two mip-map levels
+// closest in resolution to a footprint WIDTH wide (in UV units).
+//
+template<typename T, typename DT>
+T
+MatrixTex<T,DT>::trilinear (const UV &uv, float width, TileCache::Pin &pin)
+  const
+{
+  float level = level_for_width (width);
+  unsigned level_lo = unsigned (level);
+  float hi_fr = level - float (level_lo);
+
+  if (hi_fr == 0 || level_lo + 1 >= num_levels ())
+    return bilinear (level_lo, uv, pin);
+
+  return ((1 - hi_fr) * bilinear (level_lo, uv, pin)
+	  + hi_fr * bilinear (level_lo + 1, uv, pin));
+}
+
+// Return a lookup at UV filtered over the elliptical footprint with
+// axes AXIS0 and AXIS1 (in UV units), using elliptically weighted
+// averaging.
+//
+template<typename T, typename DT>
+T
+MatrixTex<T,DT>::ewa (const UV &uv, UV axis0, UV axis1, TileCache::Pin &pin)
+  const
+{
+  // Make AXIS0 the major (longer) axis.
+  //
+  float len0 = sqrt (axis0.u * axis0.u + axis0.v * axis0.v);
+  float len1 = sqrt (axis1.u * axis1.u + axis1.v * axis1.v);
+  if (len0 < len1)
+    {
+      std::swap (axis0, axis1);
+      std::swap (len0, len1);
+    }
+
+  // If the footprint is too eccentric, widen the minor axis; this
+  // blurs the result somewhat, but limits the number of texels used.
+  //
+  if (len1 * max_anisotropy < len0 && len1 > 0)
+    {
+      float scale = len0 / (len1 * max_anisotropy);
+      axis1 = axis1 * scale;
+      len1 *= scale;
+    }
+
+  if (len1 == 0)
+    return bilinear (0, uv, pin);
+
+  // Choose mip-map levels based on the minor axis, so that the
+  // filter covers a reasonable number of texels, and interpolate
+  // between the two nearest.
+  //
+  float level = level_for_width (len1);
+  unsigned level_lo = unsigned (level);
+  float hi_fr = level - float (level_lo);
+
+  if (hi_fr == 0 || level_lo + 1 >= num_levels ())
+    return ewa_level (level_lo, uv, axis0, axis1, pin);
+
+  return ((1 - hi_fr) * ewa_level (level_lo, uv, axis0, axis1, pin)
+	  + hi_fr * ewa_level (level_lo + 1, uv, axis0, axis1, pin));
+}
+
+// Return a lookup at UV in mip-map level LEVEL, filtered over the
+// elliptical footprint with axes AXIS0 and AXIS1.
+//
+template<typename T, typename DT>
+T
+MatrixTex<T,DT>::ewa_level (unsigned level, const UV &uv,
+			    const UV &axis0, const UV &axis1,
+			    TileCache::Pin &pin)
+  const
+{
+  float w = level_width (level), h = level_height (level);
+
+  // Convert everything to texel coordinates at this level.
+  //
+  float s = (uv.u - floor (uv.u)) * w - 0.5f;
+  float t = (uv.v - floor (uv.v)) * h - 0.5f;
+  float ds0 = axis0.u * w, dt0 = axis0.v * h;
+  float ds1 = axis1.u * w, dt1 = axis1.v * h;
+
+  // Coefficients of the implicit ellipse equation
+  // A*s^2 + B*s*t + C*t^2 = 1, enlarged by one texel so that it never
+  // falls between texels.
+  //
+  float A = dt0 * dt0 + dt1 * dt1 + 1;
+  float B = -2 * (ds0 * dt0 + ds1 * dt1);
+  float C = ds0 * ds0 + ds1 * ds1 + 1;
+  float inv_F = 1 / (A * C - B * B * 0.25f);
+  A *= inv_F;
+  B *= inv_F;
+  C *= inv_F;
+
+  // Bounding box of the ellipse.
+  //
+  float det = -B * B + 4 * A * C;
+  float inv_det = 1 / det;
+  float s_extent = 2 * inv_det * sqrt (det * C);
+  float t_extent = 2 * inv_det * sqrt (det * A);
+  int s0 = int (ceil (s - s_extent)), s1 = int (floor (s + s_extent));
+  int t0 = int (ceil (t - t_extent)), t1 = int (floor (t + t_extent));
+
+  // Sum the texels inside the ellipse, weighted by a Gaussian based on
+  // their distance from the center.
+  //
+  T sum = 0;
+  float sum_weights = 0;
+  for (int it = t0; it <= t1; it++)
+    {
+      float tt = it - t;
+      for (int is = s0; is <= s1; is++)
+	{
+	  float ss = is - s;
+	  float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+	  if (r2 < 1)
+	    {
+	      unsigned index = min (unsigned (r2 * MATRIX_TEX_EWA_WEIGHTS_SIZE),
+				    unsigned (MATRIX_TEX_EWA_WEIGHTS_SIZE - 1));
+	      float weight = matrix_tex_ewa_weights[index];
+	      sum += texel (level, is, it, pin) * weight;
+	      sum_weights += weight;
+	    }
+	}
+    }
+
+  if (sum_weights == 0)
+    return bilinear (level, uv, pin);
+
+  return sum / sum_weights;
+}
+
+
+
+// ----------------------------------------------------------------
+// make_matrix_tex
+
+
+// Return a new MatrixTex loaded from the image file FILENAME, whose
+// storage element type is chosen according to the image format and
+// PARAMS (see tuple_element_type).
+//
+template<typename T>
+Ref<Tex<T> >
+make_matrix_tex (const std::string &filename, const ValTable &params)
+{
+  return make_matrix_tex<T> (filename, params,
+			     tuple_element_type (filename, params));
+}
+
+// Return a new MatrixTex loaded from the image file FILENAME, using
+// PARAMS, which stores its data using ELEMENT_TYPE.
+//
+template<typename T>
+Ref<Tex<T> >
+make_matrix_tex (const std::string &filename, const ValTable &params,
+		 TupleElementType element_type)
+{
+  switch (element_type)
+    {
+    case TUPLE_ELEMENT_SRGB8:
+      return new MatrixTex<T, SrgbByte> (filename, params);
+#if HAVE_LIBEXR
+    case TUPLE_ELEMENT_HALF:
+      return new MatrixTex<T, half> (filename, params);
+#endif
+    default:
+      return new MatrixTex<T, float> (filename, params);
+    }
+}
+
 
 // If possible, suppress instantiation of classes which we will define
 // out-of-line.
@@ -76,6 +402,12 @@ MatrixTex<T,DT>::eval (const TexCoords &tex_coords) const
 #if HAVE_EXTERN_TEMPLATE
 EXTERN_TEMPLATE_EXTENSION extern template class MatrixTex<Color>;
 EXTERN_TEMPLATE_EXTENSION extern template class MatrixTex<float>;
+EXTERN_TEMPLATE_EXTENSION extern template class MatrixTex<Color, SrgbByte>;
+EXTERN_TEMPLATE_EXTENSION extern template class MatrixTex<float, SrgbByte>;
+#if HAVE_LIBEXR
+EXTERN_TEMPLATE_EXTENSION extern template class MatrixTex<Color, float>;
+EXTERN_TEMPLATE_EXTENSION extern template class MatrixTex<float, float>;
+#endif
 #endif
 
 
@@ -22,6 +22,36 @@
 namespace snogray {
 
 
+// Return a copy of COORDS with UV coordinates found by applying the
+// mapping MAP to COORDS.pos.  The UV footprint is found by mapping the
+// ends of the positional footprint too.  If WRAP_U is true, the U
+// coordinate of MAP wraps around at 1, and U differences in the
+// footprint are taken modulo 1.
+//
+inline TexCoords
+pos_mapped_tex_coords (const TexCoords &coords, UV (*map) (const Pos &pos),
+		       bool wrap_u)
+{
+  TexCoords mapped (coords);
+
+  mapped.uv = map (coords.pos);
+
+  if (coords.has_footprint ())
+    {
+      mapped.dTdx = map (coords.pos + coords.dPdx) - mapped.uv;
+      mapped.dTdy = map (coords.pos + coords.dPdy) - mapped.uv;
+
+      if (wrap_u)
+	{
+	  mapped.dTdx.u -= floor (mapped.dTdx.u + 0.5f);
+	  mapped.dTdy.u -= floor (mapped.dTdy.u + 0.5f);
+	}
+    }
+
+  return mapped;
+}
+
+
 // Texture for mapping from 3d x-y plane to 2d texture coordinates.
 //
 template<typename T>
@@ -29,14 +59,18 @@ class PlaneMapTex : public Tex<T>
 {
 public:
 
-  PlaneMapTex (const Ref<Tex<T> > &_tex) : tex (_tex) { }
+  PlaneMapTex (const Ref<const Tex<T> > &_tex) : tex (_tex) { }
 
   virtual T eval (const TexCoords &coords) const
   {
-    return tex->eval (TexCoords (coords.pos, UV (coords.pos.x, coords.pos.y)));
+    return tex->eval (pos_mapped_tex_coords (coords, map, false));
   }
 
-  const Ref<Tex<T> > tex;
+  // Return the texture coordinates corresponding to POS.
+  //
+  static UV map (const Pos &pos) { return UV (pos.x, pos.y); }
+
+  const Ref<const Tex<T> > tex;
 };
 
 
@@ -47,16 +81,21 @@ class CylinderMapTex : public Tex<T>
 {
 public:
 
-  CylinderMapTex (const Ref<Tex<T> > &_tex) : tex (_tex) { }
+  CylinderMapTex (const Ref<const Tex<T> > &_tex) : tex (_tex) { }
 
   virtual T eval (const TexCoords &coords) const
   {
-    const Pos &pos = coords.pos;
-    UV uv (atan2 (pos.x, pos.y) * INV_PI * 0.5f + 0.5f, pos.z);
-    return tex->eval (TexCoords (pos, uv));
+    return tex->eval (pos_mapped_tex_coords (coords, map, true));
   }
 
-  const Ref<Tex<T> > tex;
+  // Return the texture coordinates corresponding to POS.
+  //
+  static UV map (const Pos &pos)
+  {
+    return UV (atan2 (pos.x, pos.y) * INV_PIf * 0.5f + 0.5f, pos.z);
+  }
+
+  const Ref<const Tex<T> > tex;
 };
 
 
@@ -68,15 +107,18 @@ class LatLongMapTex : public Tex<T>
 {
 public:
 
-  LatLongMapTex (const Ref<Tex<T> > &_tex) : tex (_tex) { }
+  LatLongMapTex (const Ref<const Tex<T> > &_tex) : tex (_tex) { }
 
   virtual T eval (const TexCoords &coords) const
   {
-    const Pos &pos = coords.pos;
-    return tex->eval (TexCoords (pos, z_axis_latlong (Vec (pos))));
+    return tex->eval (pos_mapped_tex_coords (coords, map, true));
   }
 
-  const Ref<Tex<T> > tex;
+  // Return the texture coordinates corresponding to POS.
+  //
+  static UV map (const Pos &pos) { return z_axis_latlong (Vec (pos)); }
+
+  const Ref<const Tex<T> > tex;
 };
 
 
@@ -15,23 +15,49 @@
 
 #include "perlin.h"
 
-#include "tex.h"
+#include "tex-eval-cache.h"
 
 
 namespace snogray {
 
 
-class PerlinTex : public Tex<float>
+class PerlinTex : public CachedTex<float>
 {
 public:
 
-  virtual float eval (const TexCoords &coords) const
+  PerlinTex () : CachedTex<float> (true) { }
+
+  virtual float eval_uncached (const TexCoords &coords) const
   {
     return perlin.noise (coords.pos);
   }
 
+  virtual void eval_batch_uncached (const TexCoords *coords, unsigned num,
+				    float *vals)
+    const
+  {
+    while (num > 0)
+      {
+	unsigned chunk = num < BATCH_SIZE ? num : BATCH_SIZE;
+
+	Pos pos[BATCH_SIZE];
+	for (unsigned j = 0; j < chunk; j++)
+	  pos[j] = coords[j].pos;
+
+	perlin.noise (pos, chunk, vals);
+
+	coords += chunk;
+	vals += chunk;
+	num -= chunk;
+      }
+  }
+
 private:
 
+  // Number of points passed to Perlin::noise at once in eval_batch_uncached.
+  //
+  static const unsigned BATCH_SIZE = 8;
+
   Perlin perlin;
 };
 
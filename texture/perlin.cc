@@ -12,10 +12,26 @@
 
 #include <algorithm>
 
+#include "config.h"
+
 #include "util/interp.h"
 
 #include "perlin.h"
 
+// Use SSE2 instructions for batch evaluation if possible.  This is only
+// done with single-precision coordinates, so that batch results are
+// the same as those calculated one at a time.
+//
+// If AVX2 is available, it is also used for gradient-table lookups.
+//
+#if defined (__SSE2__) && !USE_DOUBLE_COORDS
+# define USE_SSE2_NOISE 1
+# include <emmintrin.h>
+# ifdef __AVX2__
+#  include <immintrin.h>
+# endif
+#endif
+
 
 using namespace snogray;
 
@@ -37,14 +53,17 @@ Perlin::noise (const Pos &pos) const
   Vec frac = pos - base;
   int xi = int (base.x), yi = int (base.y), zi = int (base.z);
 
-  float v000 = dot (g (xi+0, yi+0, zi+0), Vec (0,0,0) - frac);
-  float v001 = dot (g (xi+0, yi+0, zi+1), Vec (0,0,1) - frac);
-  float v010 = dot (g (xi+0, yi+1, zi+0), Vec (0,1,0) - frac);
-  float v011 = dot (g (xi+0, yi+1, zi+1), Vec (0,1,1) - frac);
-  float v100 = dot (g (xi+1, yi+0, zi+0), Vec (1,0,0) - frac);
-  float v101 = dot (g (xi+1, yi+0, zi+1), Vec (1,0,1) - frac);
-  float v110 = dot (g (xi+1, yi+1, zi+0), Vec (1,1,0) - frac);
-  float v111 = dot (g (xi+1, yi+1, zi+1), Vec (1,1,1) - frac);
+  unsigned grads[8];
+  corner_grads (xi, yi, zi, grads);
+
+  float v000 = dot (G[grads[0]], Vec (0,0,0) - frac);
+  float v001 = dot (G[grads[1]], Vec (0,0,1) - frac);
+  float v010 = dot (G[grads[2]], Vec (0,1,0) - frac);
+  float v011 = dot (G[grads[3]], Vec (0,1,1) - frac);
+  float v100 = dot (G[grads[4]], Vec (1,0,0) - frac);
+  float v101 = dot (G[grads[5]], Vec (1,0,1) - frac);
+  float v110 = dot (G[grads[6]], Vec (1,1,0) - frac);
+  float v111 = dot (G[grads[7]], Vec (1,1,1) - frac);
 
   float v00 = sinterp (frac.z, v000, v001);
   float v01 = sinterp (frac.z, v010, v011);
@@ -57,6 +76,206 @@ Perlin::noise (const Pos &pos) const
   return sinterp (frac.x, v0, v1);
 }
 
+// Set VALS[I] to Perlin noise at position POS[I], for I from 0 to
+// NUM-1.  This is faster than calling Perlin::noise for each
+// position separately, as several positions are processed at once
+// using SIMD instructions (where available).
+//
+void
+Perlin::noise (const Pos *pos, unsigned num, float *vals) const
+{
+#if USE_SSE2_NOISE
+
+  unsigned i = 0;
+  for (; i + 4 <= num; i += 4)
+    noise4 (pos + i, vals + i);
+
+  // Handle any remaining positions by padding them out to a group of
+  // four, so that all results come from the same code.
+  //
+  if (i < num)
+    {
+      Pos pad_pos[4];
+      float pad_vals[4];
+      for (unsigned j = 0; j < 4; j++)
+	pad_pos[j] = pos[i + j < num ? i + j : num - 1];
+
+      noise4 (pad_pos, pad_vals);
+
+      for (unsigned j = 0; i + j < num; j++)
+	vals[i + j] = pad_vals[j];
+    }
+
+#else // !USE_SSE2_NOISE
+
+  for (unsigned i = 0; i < num; i++)
+    vals[i] = noise (pos[i]);
+
+#endif // USE_SSE2_NOISE
+}
+
+
+
+#if USE_SSE2_NOISE
+
+// SSE2 batch evaluation
+
+namespace { // keep local to file
+
+// A copy of Perlin::G_global, with each gradient padded to four floats,
+// so that it can be loaded directly into an SSE register.
+//
+float G_sse[16][4];
+
+// Return the floor of each element of X, as integers.  SSE2 has no
+// floor instruction, so we truncate, and then adjust elements where
+// that rounded up.
+//
+inline __m128i
+sse_floor (__m128 x)
+{
+  __m128i xi = _mm_cvttps_epi32 (x);
+  __m128 rounded_up = _mm_cmpgt_ps (_mm_cvtepi32_ps (xi), x);
+  return _mm_add_epi32 (xi, _mm_castps_si128 (rounded_up)); // -1 if true
+}
+
+// Return the "s curve" interpolation between V1 and V2 according to
+// FRAC, in exactly the same way as snogray::sinterp.
+//
+inline __m128
+sse_sinterp (__m128 frac, __m128 v1, __m128 v2)
+{
+  __m128 d3 = _mm_mul_ps (_mm_mul_ps (frac, frac), frac);
+  __m128 d4 = _mm_mul_ps (d3, frac);
+  __m128 d5 = _mm_mul_ps (d4, frac);
+  __m128 s = _mm_add_ps (_mm_sub_ps (_mm_mul_ps (_mm_set1_ps (6), d5),
+				     _mm_mul_ps (_mm_set1_ps (15), d4)),
+			 _mm_mul_ps (_mm_set1_ps (10), d3));
+  return _mm_add_ps (v1, _mm_mul_ps (s, _mm_sub_ps (v2, v1)));
+}
+
+#ifdef __AVX2__
+
+// Return the elements of the 256-entry permutation table P indexed by
+// each element of I (modulo 256).
+//
+inline __m128i
+avx2_perm (const int *P, __m128i i)
+{
+  return _mm_i32gather_epi32 (P, _mm_and_si128 (i, _mm_set1_epi32 (255)), 4);
+}
+
+#endif // __AVX2__
+
+} // namespace
+
+
+// Set VALS[0] through VALS[3] to Perlin noise at positions POS[0]
+// through POS[3], using SSE2 instructions.
+//
+void
+Perlin::noise4 (const Pos *pos, float *vals) const
+{
+  __m128 x = _mm_setr_ps (pos[0].x, pos[1].x, pos[2].x, pos[3].x);
+  __m128 y = _mm_setr_ps (pos[0].y, pos[1].y, pos[2].y, pos[3].y);
+  __m128 z = _mm_setr_ps (pos[0].z, pos[1].z, pos[2].z, pos[3].z);
+
+  __m128i xi = sse_floor (x), yi = sse_floor (y), zi = sse_floor (z);
+
+  __m128 frac_x = _mm_sub_ps (x, _mm_cvtepi32_ps (xi));
+  __m128 frac_y = _mm_sub_ps (y, _mm_cvtepi32_ps (yi));
+  __m128 frac_z = _mm_sub_ps (z, _mm_cvtepi32_ps (zi));
+
+  // Indices of the gradients at each corner of each lane's cube, in
+  // the same order as Perlin::corner_grads.
+  //
+  unsigned grads[8][4];
+
+#ifdef __AVX2__
+
+  // Use AVX2 gather instructions to look up the gradients for all
+  // lanes at once.
+  //
+  const __m128i ione = _mm_set1_epi32 (1);
+  const __m128i xs[2] = { xi, _mm_add_epi32 (xi, ione) };
+  const __m128i ys[2] = { yi, _mm_add_epi32 (yi, ione) };
+  const __m128i zs[2] = { zi, _mm_add_epi32 (zi, ione) };
+  const __m128i g_mask = _mm_set1_epi32 (G_LEN - 1);
+
+  for (int a = 0; a < 2; a++)
+    {
+      __m128i pa = avx2_perm (P, xs[a]);
+      for (int b = 0; b < 2; b++)
+	{
+	  __m128i pab = avx2_perm (P, _mm_add_epi32 (pa, ys[b]));
+	  for (int c = 0; c < 2; c++)
+	    {
+	      __m128i g = avx2_perm (P, _mm_add_epi32 (pab, zs[c]));
+	      __m128i *dst
+		= reinterpret_cast<__m128i *> (grads[a * 4 + b * 2 + c]);
+	      _mm_storeu_si128 (dst, _mm_and_si128 (g, g_mask));
+	    }
+	}
+    }
+
+#else // !__AVX2__
+
+  // Without gather instructions, gradient lookups must be done
+  // separately for each lane.
+  //
+  int xs[4], ys[4], zs[4];
+  _mm_storeu_si128 (reinterpret_cast<__m128i *> (xs), xi);
+  _mm_storeu_si128 (reinterpret_cast<__m128i *> (ys), yi);
+  _mm_storeu_si128 (reinterpret_cast<__m128i *> (zs), zi);
+
+  for (unsigned l = 0; l < 4; l++)
+    {
+      unsigned lane_grads[8];
+      corner_grads (xs[l], ys[l], zs[l], lane_grads);
+      for (unsigned c = 0; c < 8; c++)
+	grads[c][l] = lane_grads[c];
+    }
+
+#endif // __AVX2__
+
+  // Offsets from POS to the lower and upper cube faces in each
+  // dimension.
+  //
+  __m128 zero = _mm_setzero_ps (), one = _mm_set1_ps (1);
+  __m128 dx[2] = { _mm_sub_ps (zero, frac_x), _mm_sub_ps (one, frac_x) };
+  __m128 dy[2] = { _mm_sub_ps (zero, frac_y), _mm_sub_ps (one, frac_y) };
+  __m128 dz[2] = { _mm_sub_ps (zero, frac_z), _mm_sub_ps (one, frac_z) };
+
+  // Dot-products of the gradient at each corner with the offset from
+  // POS to that corner.
+  //
+  __m128 v[8];
+  for (unsigned c = 0; c < 8; c++)
+    {
+      __m128 gx = _mm_loadu_ps (G_sse[grads[c][0]]);
+      __m128 gy = _mm_loadu_ps (G_sse[grads[c][1]]);
+      __m128 gz = _mm_loadu_ps (G_sse[grads[c][2]]);
+      __m128 gw = _mm_loadu_ps (G_sse[grads[c][3]]);
+      _MM_TRANSPOSE4_PS (gx, gy, gz, gw);
+
+      v[c] = _mm_add_ps (_mm_add_ps (_mm_mul_ps (gx, dx[c >> 2]),
+				     _mm_mul_ps (gy, dy[(c >> 1) & 1])),
+			 _mm_mul_ps (gz, dz[c & 1]));
+    }
+
+  __m128 v00 = sse_sinterp (frac_z, v[0], v[1]);
+  __m128 v01 = sse_sinterp (frac_z, v[2], v[3]);
+  __m128 v10 = sse_sinterp (frac_z, v[4], v[5]);
+  __m128 v11 = sse_sinterp (frac_z, v[6], v[7]);
+
+  __m128 v0 = sse_sinterp (frac_y, v00, v01);
+  __m128 v1 = sse_sinterp (frac_y, v10, v11);
+
+  _mm_storeu_ps (vals, sse_sinterp (frac_x, v0, v1));
+}
+
+#endif // USE_SSE2_NOISE
+
 
 // Global table initialization
 
@@ -91,4 +310,14 @@ Perlin::init_globals ()
   G_global[13] = Vec (-1,1,0);
   G_global[14] = Vec (0,-1,1);
   G_global[15] = Vec (0,-1,-1);
+
+#if USE_SSE2_NOISE
+  for (unsigned i = 0; i < G_LEN; i++)
+    {
+      G_sse[i][0] = G_global[i].x;
+      G_sse[i][1] = G_global[i].y;
+      G_sse[i][2] = G_global[i].z;
+      G_sse[i][3] = 0;
+    }
+#endif
 }
@@ -34,6 +34,13 @@ public:
   //
   float noise (const Pos &pos) const;
 
+  // Set VALS[I] to Perlin noise at position POS[I], for I from 0 to
+  // NUM-1.  This is faster than calling Perlin::noise for each
+  // position separately, as several positions are processed at once
+  // using SIMD instructions (where available).
+  //
+  void noise (const Pos *pos, unsigned num, float *vals) const;
+
 private:
 
   static const unsigned P_LEN = 256;
@@ -42,11 +49,34 @@ private:
   static int P_global[P_LEN];
   static Vec G_global[G_LEN];
 
-  Vec g (int i, int j, int k) const
+  // Set GRADS[C] to the index in G of the gradient at each corner C
+  // of the integer lattice cube whose lowest corner is I,J,K; the bits
+  // of C (4 = x, 2 = y, 1 = z) give the offset of the corner.
+  //
+  // Table indices wrap around modulo P_LEN, including for negative
+  // lattice coordinates, so the noise pattern simply repeats every
+  // P_LEN units along each axis.  (Taking a signed remainder would
+  // give negative indices there, which are outside the table.)
+  //
+  void corner_grads (int i, int j, int k, unsigned grads[8]) const
   {
-    return G[P[(P[(P[i % P_LEN] + j) % P_LEN] + k) % P_LEN] % G_LEN];
+    for (int a = 0; a < 2; a++)
+      {
+	int pa = P[unsigned (i + a) % P_LEN];
+	for (int b = 0; b < 2; b++)
+	  {
+	    int pab = P[unsigned (pa + j + b) % P_LEN];
+	    for (int c = 0; c < 2; c++)
+	      grads[a * 4 + b * 2 + c] = P[unsigned (pab + k + c) % P_LEN] % G_LEN;
+	  }
+      }
   }
 
+  // Set VALS[0] through VALS[3] to Perlin noise at positions POS[0]
+  // through POS[3], using SSE2 instructions.
+  //
+  void noise4 (const Pos *pos, float *vals) const;
+
   static void init_globals ();
 
   static bool globals_initialized;
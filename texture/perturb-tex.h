@@ -13,31 +13,38 @@
 #ifndef SNOGRAY_PERTURB_TEX_H
 #define SNOGRAY_PERTURB_TEX_H
 
-#include "tex.h"
+#include "tex-eval-cache.h"
+#include "tex-program.h"
 
 
 namespace snogray {
 
 
 template<typename T>
-class PerturbPosTex : public Tex<T>
+class PerturbPosTex : public CachedTex<T>
 {
 public:
 
   PerturbPosTex (const TexVal<T> &_source,
 		 const TexVal<float> &_x, const TexVal<float> &_y,
 		 const TexVal<float> &_z)
-    : source (_source), x (_x), y (_y), z (_z)
+    : CachedTex<T> (_source.expensive () || _x.expensive ()
+		    || _y.expensive () || _z.expensive ()),
+      source (_source), x (_x), y (_y), z (_z)
   { }
 
-  virtual T eval (const TexCoords &coords) const
+  virtual T eval_uncached (const TexCoords &coords) const
   {
     Vec offs (x.eval (coords), y.eval (coords), z.eval (coords));
-    return source.eval (TexCoords (coords.pos + offs, coords.uv));
+    TexCoords perturbed (coords);
+    perturbed.pos = coords.pos + offs;
+    return source.eval (perturbed);
   }
 
 private:
 
+  friend class TexProgram::Compiler;
+
   TexVal<T> source;
 
   TexVal<float> x, y, z;
@@ -45,23 +52,29 @@ private:
 
 
 template<typename T>
-class PerturbUvTex : public Tex<T>
+class PerturbUvTex : public CachedTex<T>
 {
 public:
 
   PerturbUvTex (const TexVal<T> &_source,
 		const TexVal<float> &_u, const TexVal<float> &_v)
-    : source (_source), u (_u), v (_v)
+    : CachedTex<T> (_source.expensive () || _u.expensive ()
+		    || _v.expensive ()),
+      source (_source), u (_u), v (_v)
   { }
 
-  virtual T eval (const TexCoords &coords) const
+  virtual T eval_uncached (const TexCoords &coords) const
   {
     UV offs (u.eval (coords), v.eval (coords));
-    return source.eval (TexCoords (coords.pos, coords.uv + offs));
+    TexCoords perturbed (coords);
+    perturbed.uv = coords.uv + offs;
+    return source.eval (perturbed);
   }
 
 private:
 
+  friend class TexProgram::Compiler;
+
   TexVal<T> source;
 
   TexVal<float> u, v;
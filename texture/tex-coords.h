@@ -15,22 +15,88 @@
 
 #include "geometry/uv.h"
 #include "geometry/pos.h"
+#include "geometry/vec.h"
 
 
 namespace snogray {
 
 
+class TexEvalCache;
+
+
 class TexCoords
 {
 public:
 
   TexCoords (const Pos &_pos, const UV &_uv)
-    : pos (_pos), uv (_uv)
+    : pos (_pos), uv (_uv), dTdx (0, 0), dTdy (0, 0),
+      dPdx (0, 0, 0), dPdy (0, 0, 0), eval_cache (0)
+  { }
+  TexCoords (const Pos &_pos, const UV &_uv,
+	     const UV &_dTdx, const UV &_dTdy,
+	     const Vec &_dPdx, const Vec &_dPdy,
+	     TexEvalCache *_eval_cache = 0)
+    : pos (_pos), uv (_uv), dTdx (_dTdx), dTdy (_dTdy),
+      dPdx (_dPdx), dPdy (_dPdy), eval_cache (_eval_cache)
   { }
   TexCoords () {}  // allow to be uninitialized
 
+  // Return a copy of this object with UV mapped through XFORM.  The UV
+  // footprint is mapped too, so that filtered lookups still cover the
+  // same area.
+  //
+  template<typename XF>
+  TexCoords with_xformed_uv (const XF &xform) const
+  {
+    UV xuv = xform (uv);
+    return TexCoords (pos, xuv, xform (uv + dTdx) - xuv,
+		      xform (uv + dTdy) - xuv, dPdx, dPdy, eval_cache);
+  }
+
+  // Return a copy of this object with both the position and UV mapped
+  // through XFORM, along with their footprints.
+  //
+  template<typename XF>
+  TexCoords with_xformed (const XF &xform) const
+  {
+    TexCoords xf_coords = with_xformed_uv (xform);
+    xf_coords.pos = xform (pos);
+    xf_coords.dPdx = xform (dPdx);
+    xf_coords.dPdy = xform (dPdy);
+    return xf_coords;
+  }
+
+  // Return true if this object has a non-zero UV footprint.
+  //
+  bool has_footprint () const
+  {
+    return dTdx.u != 0 || dTdx.v != 0 || dTdy.u != 0 || dTdy.v != 0;
+  }
+
   Pos pos;
   UV uv;
+
+  // The UV "footprint" of the area these coordinates represent (for
+  // instance, the part of a surface covered by one image pixel), as
+  // the two axes of an ellipse centered on UV.  Textures which can
+  // filter their values, such as MatrixTex, use this to avoid
+  // aliasing.  If both are zero, textures should just do a point
+  // lookup.
+  //
+  UV dTdx, dTdy;
+
+  // The same footprint in terms of position:  POS + DPDX corresponds
+  // to UV + DTDX, and POS + DPDY to UV + DTDY.  Textures which map
+  // positions to UV coordinates use this to find the UV footprint.
+  //
+  Vec dPdx, dPdy;
+
+  // If non-zero, a cache of texture values for the shading point
+  // these coordinates belong to; textures which are expensive to
+  // evaluate may use it to avoid evaluating more than once at the same
+  // coordinates.
+  //
+  TexEvalCache *eval_cache;
 };
 
 
@@ -0,0 +1,298 @@
+// tex-eval-cache.h -- Per-shading-point cache of texture values
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_TEX_EVAL_CACHE_H
+#define SNOGRAY_TEX_EVAL_CACHE_H
+
+#include <cstring>
+
+#include "util/mempool.h"
+#include "color/color.h"
+#include "tex.h"
+
+
+namespace snogray {
+
+
+// A small cache of texture values, used to avoid evaluating the same
+// texture at the same coordinates more than once.
+//
+// Materials often use the same procedural texture (or parts of one) in
+// several places -- for instance, for both the diffuse color and the
+// bump-map -- so the same texture sub-tree may be evaluated many times
+// for a single shading point.  Each Intersect has a TexEvalCache, and
+// passes it to textures as TexCoords::eval_cache; textures derived
+// from CachedTex consult it before doing any real work.
+//
+// The cache entries are only allocated (from a mempool) when a value
+// is first added, so shading points which never evaluate an expensive
+// texture pay almost nothing for the cache.  Copies of a TexEvalCache
+// share any entries already allocated.
+//
+// The cache is direct-mapped, keyed by the texture and the texture
+// coordinates, so conflicting entries simply replace each other.  The
+// positional footprint (TexCoords::dPdx and dPdy) isn't part of the
+// key, as at a single shading point it only changes along with the
+// position.
+//
+class TexEvalCache
+{
+public:
+
+  // Number of entries in the cache.
+  //
+  static const unsigned SIZE = 32;
+
+  // Make an empty cache, whose entries will be allocated from MEMPOOL.
+  //
+  TexEvalCache (Mempool &_mempool) : mempool (_mempool), table (0) { }
+
+  // If the value of TEX at COORDS is in the cache, set VAL to it and
+  // return true, otherwise return false.
+  //
+  template<typename T>
+  bool lookup (const Tex<T> *tex, const TexCoords &coords, T &val) const
+  {
+    if (! table)
+      return false;
+
+    unsigned i = index (tex, coords);
+    const Entry &entry = table->entries[i];
+    if (table->tags[i] == tex && entry.matches (coords))
+      {
+	entry.get (val);
+	return true;
+      }
+    return false;
+  }
+
+  // Add VAL to the cache as the value of TEX at COORDS.
+  //
+  template<typename T>
+  void add (const Tex<T> *tex, const TexCoords &coords, const T &val)
+  {
+    if (! table)
+      table = new (mempool) Table;
+
+    unsigned i = index (tex, coords);
+    Entry &entry = table->entries[i];
+    table->tags[i] = tex;
+    entry.pos = coords.pos;
+    entry.uv = coords.uv;
+    entry.dTdx = coords.dTdx;
+    entry.dTdy = coords.dTdy;
+    entry.set (val);
+  }
+
+private:
+
+  struct Entry
+  {
+    bool matches (const TexCoords &coords) const
+    {
+      return (pos == coords.pos && same (uv, coords.uv)
+	      && same (dTdx, coords.dTdx) && same (dTdy, coords.dTdy));
+    }
+
+    static bool same (const UV &uv1, const UV &uv2)
+    {
+      return uv1.u == uv2.u && uv1.v == uv2.v;
+    }
+
+    void get (Color &val) const { val = color_val; }
+    void get (float &val) const { val = float_val; }
+    void set (const Color &val) { color_val = val; }
+    void set (float val) { float_val = val; }
+
+    // Coordinates at which TEX was evaluated.
+    //
+    Pos pos;
+    UV uv, dTdx, dTdy;
+
+    // The value; which field is used depends on TEX's type.
+    //
+    Color color_val;
+    float float_val;
+  };
+
+  // The cache entries.  TAGS[I] is the texture whose value is in
+  // ENTRIES[I], or zero if that entry is unused; only the tags need
+  // to be initialized.
+  //
+  struct Table
+  {
+    Table ()
+    {
+      for (unsigned i = 0; i < SIZE; i++)
+	tags[i] = 0;
+    }
+
+    const void *tags[SIZE];
+    Entry entries[SIZE];
+  };
+
+  // Return the bit-pattern of the float F, for hashing.
+  //
+  static unsigned float_bits (float f)
+  {
+    unsigned bits;
+    std::memcpy (&bits, &f, sizeof bits);
+    return bits;
+  }
+
+  // Return the index of the entry used for TEX at COORDS.
+  //
+  static unsigned index (const void *tex, const TexCoords &coords)
+  {
+    size_t hash = reinterpret_cast<size_t> (tex) / sizeof (void *);
+    hash = hash * 31 + float_bits (coords.uv.u);
+    hash = hash * 31 + float_bits (coords.uv.v);
+    hash = hash * 31 + float_bits (float (coords.pos.x));
+    hash = hash * 31 + float_bits (float (coords.pos.y));
+    hash = hash * 31 + float_bits (float (coords.pos.z));
+    hash ^= hash >> 16;
+    return hash % SIZE;
+  }
+
+  // Mempool from which TABLE is allocated.
+  //
+  Mempool &mempool;
+
+  // The cache entries, or zero if nothing has been added yet.
+  //
+  Table *table;
+};
+
+
+// A texture whose values are cached in TexCoords::eval_cache, if it
+// is expensive to evaluate.  Subclasses define eval_uncached instead
+// of eval.
+//
+// Noise textures are always considered expensive, and textures which
+// combine the values of other textures (e.g. ArithTex) are expensive
+// if any of their inputs are; textures which just combine constants
+// and cheap textures aren't worth caching.
+//
+template<typename T>
+class CachedTex : public Tex<T>
+{
+public:
+
+  CachedTex (bool _is_expensive) : is_expensive (_is_expensive) { }
+
+  // Evaluate this texture at COORDS.
+  //
+  virtual T eval (const TexCoords &coords) const
+  {
+    TexEvalCache *cache = coords.eval_cache;
+    if (! cache || ! is_expensive)
+      return eval_uncached (coords);
+
+    T val;
+    if (! cache->lookup (this, coords, val))
+      {
+	val = eval_uncached (coords);
+	cache->add (this, coords, val);
+      }
+    return val;
+  }
+
+  // Evaluate this texture at NUM sets of texture coordinates, COORDS[0]
+  // through COORDS[NUM-1], storing the results in VALS.  Values found
+  // in the cache are used directly, and the rest are evaluated
+  // together with eval_batch_uncached.
+  //
+  virtual void eval_batch (const TexCoords *coords, unsigned num, T *vals)
+    const
+  {
+    if (! is_expensive || num == 0 || ! coords[0].eval_cache)
+      {
+	eval_batch_uncached (coords, num, vals);
+	return;
+      }
+
+    while (num > 0)
+      {
+	unsigned chunk = num < MAX_BATCH ? num : MAX_BATCH;
+
+	// Look up each set of coordinates in the cache, and gather up
+	// the ones which miss.
+	//
+	TexCoords misses[MAX_BATCH];
+	unsigned miss_idx[MAX_BATCH];
+	unsigned num_misses = 0;
+	for (unsigned i = 0; i < chunk; i++)
+	  {
+	    TexEvalCache *cache = coords[i].eval_cache;
+	    if (! cache || ! cache->lookup (this, coords[i], vals[i]))
+	      {
+		misses[num_misses] = coords[i];
+		miss_idx[num_misses++] = i;
+	      }
+	  }
+
+	if (num_misses > 0)
+	  {
+	    T miss_vals[MAX_BATCH];
+	    eval_batch_uncached (misses, num_misses, miss_vals);
+
+	    for (unsigned m = 0; m < num_misses; m++)
+	      {
+		unsigned i = miss_idx[m];
+		vals[i] = miss_vals[m];
+		if (coords[i].eval_cache)
+		  coords[i].eval_cache->add (this, coords[i], vals[i]);
+	      }
+	  }
+
+	coords += chunk;
+	vals += chunk;
+	num -= chunk;
+      }
+  }
+
+  // Evaluate this texture at COORDS, without using any cache.
+  //
+  virtual T eval_uncached (const TexCoords &coords) const = 0;
+
+  // Evaluate this texture at NUM sets of texture coordinates, COORDS[0]
+  // through COORDS[NUM-1], storing the results in VALS, without using
+  // any cache.  The default just calls eval_uncached for each.
+  //
+  virtual void eval_batch_uncached (const TexCoords *coords, unsigned num,
+				    T *vals)
+    const
+  {
+    for (unsigned i = 0; i < num; i++)
+      vals[i] = eval_uncached (coords[i]);
+  }
+
+  // Return true if this texture is expensive to evaluate.
+  //
+  virtual bool expensive () const { return is_expensive; }
+
+protected:
+
+  // Maximum number of cache misses gathered together by eval_batch.
+  //
+  static const unsigned MAX_BATCH = 8;
+
+  // True if this texture is expensive enough to evaluate that its
+  // values should be cached.
+  //
+  bool is_expensive;
+};
+
+
+}
+
+#endif // SNOGRAY_TEX_EVAL_CACHE_H
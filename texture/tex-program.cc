@@ -0,0 +1,751 @@
+// tex-program.cc -- Texture expression trees compiled into a program
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <map>
+
+#include "util/snogmath.h"
+#include "util/interp.h"
+#include "color/color-math.h"
+
+#include "arith-tex.h"
+#include "cmp-tex.h"
+#include "interp-tex.h"
+#include "rescale-tex.h"
+#include "check-tex.h"
+#include "coord-tex.h"
+#include "intens-tex.h"
+#include "grey-tex.h"
+#include "xform-tex.h"
+#include "perturb-tex.h"
+#include "misc-map-tex.h"
+
+#include "tex-program.h"
+
+
+using namespace snogray;
+
+
+
+// Instruction helpers
+
+namespace { // keep local to file
+
+// Set DST[L] to A[L] OP B[L], for lanes BEGIN through END-1, where OP
+// is an ArithTex operation.
+//
+template<typename T>
+void
+arith (unsigned op, T *dst, const T *a, const T *b,
+       unsigned begin, unsigned end)
+{
+  typename ArithTex<T>::Op aop = static_cast<typename ArithTex<T>::Op> (op);
+  for (unsigned l = begin; l < end; l++)
+    dst[l] = ArithTex<T>::apply (aop, a[l], b[l]);
+}
+
+// Set DST[L] to an expression for all lanes L from BEGIN to END-1.
+//
+#define FOR_LANES(expr) \
+  for (unsigned l = begin; l < end; l++) dst[l] = (expr); \
+  break
+
+// Set DST[L] to 1 if A[L] OP B[L] is true, and 0 otherwise, for lanes
+// BEGIN through END-1, where OP is a CmpTex operation.
+//
+void
+cmp (unsigned op, float *dst, const float *a, const float *b,
+     unsigned begin, unsigned end)
+{
+  typedef CmpTex<float> CT;
+
+  switch (op)
+    {
+    case CT::EQ: FOR_LANES (a[l] == b[l]);
+    case CT::NE: FOR_LANES (a[l] != b[l]);
+    case CT::LT: FOR_LANES (a[l] <  b[l]);
+    case CT::LE: FOR_LANES (a[l] <= b[l]);
+    case CT::GT: FOR_LANES (a[l] >  b[l]);
+    case CT::GE: FOR_LANES (a[l] >= b[l]);
+    default:	 FOR_LANES (0);
+    }
+}
+
+#undef FOR_LANES
+
+} // namespace
+
+
+
+// Interpreter
+
+// Run this program for lanes BEGIN through END-1 of REGS, starting
+// from instruction PC, where COORDS[L] are the texture coordinates
+// for lane L.  The result can be retrieved using
+// TexProgram::get_result.
+//
+void
+TexProgram::run (const TexCoords *coords, unsigned begin, unsigned end,
+		 Regs &regs, unsigned pc)
+  const
+{
+  unsigned code_len = code.size ();
+
+  while (pc < code_len)
+    {
+      const Insn &insn = code[pc++];
+
+      float *fdst = regs.f[insn.dst];
+      Color *cdst = regs.c[insn.dst];
+
+      switch (insn.op)
+	{
+	case LOAD_F:
+	  {
+	    float val = float_consts[insn.arg];
+	    for (unsigned l = begin; l < end; l++)
+	      fdst[l] = val;
+	    break;
+	  }
+
+	case LOAD_C:
+	  {
+	    const Color &val = color_consts[insn.arg];
+	    for (unsigned l = begin; l < end; l++)
+	      cdst[l] = val;
+	    break;
+	  }
+
+	case COORD:
+	  for (unsigned l = begin; l < end; l++)
+	    switch (insn.arg)
+	      {
+	      case CoordTex::X: fdst[l] = coords[l].pos.x; break;
+	      case CoordTex::Y: fdst[l] = coords[l].pos.y; break;
+	      case CoordTex::Z: fdst[l] = coords[l].pos.z; break;
+	      case CoordTex::U: fdst[l] = coords[l].uv.u; break;
+	      case CoordTex::V: fdst[l] = coords[l].uv.v; break;
+	      default: fdst[l] = 0;
+	      }
+	  break;
+
+	case ARITH_F:
+	  arith (insn.arg, fdst, regs.f[insn.src1], regs.f[insn.src2],
+		 begin, end);
+	  break;
+
+	case ARITH_C:
+	  arith (insn.arg, cdst, regs.c[insn.src1], regs.c[insn.src2],
+		 begin, end);
+	  break;
+
+	case CMP:
+	  cmp (insn.arg, fdst, regs.f[insn.src1], regs.f[insn.src2],
+	       begin, end);
+	  break;
+
+	case CHECK_2D:
+	  for (unsigned l = begin; l < end; l++)
+	    {
+	      bool use1 = first_half (coords[l].uv.u);
+	      if (first_half (coords[l].uv.v))
+		use1 = !use1;
+	      fdst[l] = use1;
+	    }
+	  break;
+
+	case CHECK_3D:
+	  for (unsigned l = begin; l < end; l++)
+	    {
+	      bool use1 = false;
+	      if (first_half (coords[l].pos.x))
+		use1 = !use1;
+	      if (first_half (coords[l].pos.y))
+		use1 = !use1;
+	      if (first_half (coords[l].pos.z))
+		use1 = !use1;
+	      fdst[l] = use1;
+	    }
+	  break;
+
+	case JUMP:
+	  pc = insn.arg;
+	  break;
+
+	case JUMP_UNLESS:
+	  {
+	    const float *cond = regs.f[insn.src1];
+
+	    unsigned num_true = 0;
+	    for (unsigned l = begin; l < end; l++)
+	      if (cond[l] != 0)
+		num_true++;
+
+	    if (num_true == 0)
+	      pc = insn.arg;
+	    else if (num_true != end - begin)
+	      {
+		// The lanes disagree, so finish running the program
+		// separately for each lane.
+		//
+		for (unsigned l = begin; l < end; l++)
+		  run (coords, l, l + 1, regs, cond[l] != 0 ? pc : insn.arg);
+		return;
+	      }
+	    break;
+	  }
+
+	case LINTERP_F:
+	  {
+	    const float *c = regs.f[insn.src1];
+	    const float *v1 = regs.f[insn.src2], *v2 = regs.f[insn.src3];
+	    for (unsigned l = begin; l < end; l++)
+	      fdst[l] = linterp (c[l], v1[l], v2[l]);
+	    break;
+	  }
+
+	case LINTERP_C:
+	  {
+	    const float *c = regs.f[insn.src1];
+	    const Color *v1 = regs.c[insn.src2], *v2 = regs.c[insn.src3];
+	    for (unsigned l = begin; l < end; l++)
+	      cdst[l] = linterp (c[l], v1[l], v2[l]);
+	    break;
+	  }
+
+	case SINTERP_F:
+	  {
+	    const float *c = regs.f[insn.src1];
+	    const float *v1 = regs.f[insn.src2], *v2 = regs.f[insn.src3];
+	    for (unsigned l = begin; l < end; l++)
+	      fdst[l] = sinterp (c[l], v1[l], v2[l]);
+	    break;
+	  }
+
+	case SINTERP_C:
+	  {
+	    const float *c = regs.f[insn.src1];
+	    const Color *v1 = regs.c[insn.src2], *v2 = regs.c[insn.src3];
+	    for (unsigned l = begin; l < end; l++)
+	      cdst[l] = sinterp (c[l], v1[l], v2[l]);
+	    break;
+	  }
+
+	case INTENS:
+	  {
+	    const Color *src = regs.c[insn.src1];
+	    for (unsigned l = begin; l < end; l++)
+	      fdst[l] = src[l].intensity ();
+	    break;
+	  }
+
+	case GREY:
+	  {
+	    const float *src = regs.f[insn.src1];
+	    for (unsigned l = begin; l < end; l++)
+	      cdst[l] = src[l];
+	    break;
+	  }
+
+	case CALL_F:
+	  if (end - begin == 1)
+	    fdst[begin] = float_texs[insn.arg]->eval (coords[begin]);
+	  else
+	    float_texs[insn.arg]->eval_batch (coords + begin, end - begin,
+					      fdst + begin);
+	  break;
+
+	case CALL_C:
+	  if (end - begin == 1)
+	    cdst[begin] = color_texs[insn.arg]->eval (coords[begin]);
+	  else
+	    color_texs[insn.arg]->eval_batch (coords + begin, end - begin,
+					      cdst + begin);
+	  break;
+	}
+    }
+}
+
+
+
+// Compiler
+
+// Helper class for compiling a texture expression tree into a
+// TexProgram.
+//
+// Registers are allocated in stack order:  each node leaves its result
+// in a register chosen by its parent, and uses newly allocated
+// registers above that for the values of its inputs, which are freed
+// when it's done.  If a deep tree runs out of registers, the remaining
+// sub-tree is compiled into a separate program, which is called.
+//
+class TexProgram::Compiler
+{
+public:
+
+  Compiler (TexProgram &_prog) : prog (_prog), num_fregs (0), num_cregs (0)
+  { }
+
+  // Compile TEX as the whole program.  If TEX cannot be compiled,
+  // nothing is done and false is returned.
+  //
+  template<typename T>
+  bool compile_root (const Tex<T> &tex)
+  {
+    prog.result_reg = alloc<T> ();
+    return compile_node (tex, prog.result_reg);
+  }
+
+  // If TEX is a texture which can't itself be compiled, but which has
+  // inputs which might be (e.g. XformTex), return a copy of TEX with
+  // compiled inputs; otherwise, return TEX.
+  //
+  template<typename T>
+  static Ref<const Tex<T> > compile_inputs (const Ref<const Tex<T> > &tex)
+  {
+    const Tex<T> *ptr = tex.ptr ();
+
+    if (const XformTex<T> *xt = dynamic_cast<const XformTex<T> *> (ptr))
+      {
+	TexVal<T> input = compile_tex_val (xt->tex);
+	if (changed (xt->tex, input))
+	  return new XformTex<T> (xt->xform, input);
+      }
+    else if (const XformTexUV<T> *xt
+	       = dynamic_cast<const XformTexUV<T> *> (ptr))
+      {
+	TexVal<T> input = compile_tex_val (xt->tex);
+	if (changed (xt->tex, input))
+	  return new XformTexUV<T> (xt->xform, input);
+      }
+    else if (const XformTexPos<T> *xt
+	       = dynamic_cast<const XformTexPos<T> *> (ptr))
+      {
+	TexVal<T> input = compile_tex_val (xt->tex);
+	if (changed (xt->tex, input))
+	  return new XformTexPos<T> (xt->xform, input);
+      }
+    else if (const PerturbPosTex<T> *pt
+	       = dynamic_cast<const PerturbPosTex<T> *> (ptr))
+      {
+	TexVal<T> source = compile_tex_val (pt->source);
+	TexVal<float> x = compile_tex_val (pt->x);
+	TexVal<float> y = compile_tex_val (pt->y);
+	TexVal<float> z = compile_tex_val (pt->z);
+	if (changed (pt->source, source) || changed (pt->x, x)
+	    || changed (pt->y, y) || changed (pt->z, z))
+	  return new PerturbPosTex<T> (source, x, y, z);
+      }
+    else if (const PerturbUvTex<T> *pt
+	       = dynamic_cast<const PerturbUvTex<T> *> (ptr))
+      {
+	TexVal<T> source = compile_tex_val (pt->source);
+	TexVal<float> u = compile_tex_val (pt->u);
+	TexVal<float> v = compile_tex_val (pt->v);
+	if (changed (pt->source, source)
+	    || changed (pt->u, u) || changed (pt->v, v))
+	  return new PerturbUvTex<T> (source, u, v);
+      }
+    else if (const PlaneMapTex<T> *mt
+	       = dynamic_cast<const PlaneMapTex<T> *> (ptr))
+      {
+	Ref<const Tex<T> > input = compile_tex (mt->tex);
+	if (input.ptr () != mt->tex.ptr ())
+	  return new PlaneMapTex<T> (input);
+      }
+    else if (const CylinderMapTex<T> *mt
+	       = dynamic_cast<const CylinderMapTex<T> *> (ptr))
+      {
+	Ref<const Tex<T> > input = compile_tex (mt->tex);
+	if (input.ptr () != mt->tex.ptr ())
+	  return new CylinderMapTex<T> (input);
+      }
+    else if (const LatLongMapTex<T> *mt
+	       = dynamic_cast<const LatLongMapTex<T> *> (ptr))
+      {
+	Ref<const Tex<T> > input = compile_tex (mt->tex);
+	if (input.ptr () != mt->tex.ptr ())
+	  return new LatLongMapTex<T> (input);
+      }
+
+    return tex;
+  }
+
+private:
+
+  // Return VAL with its texture, if any, compiled by compile_tex.
+  //
+  template<typename T>
+  static TexVal<T> compile_tex_val (const TexVal<T> &val)
+  {
+    return val.tex ? TexVal<T> (compile_tex (val.tex)) : val;
+  }
+
+  // Return true if OLD_VAL and NEW_VAL refer to different textures.
+  //
+  template<typename T>
+  static bool changed (const TexVal<T> &old_val, const TexVal<T> &new_val)
+  {
+    return old_val.tex.ptr () != new_val.tex.ptr ();
+  }
+
+  // Compile code to leave the value of TEX in register DST.
+  //
+  template<typename T>
+  void compile (const Tex<T> &tex, unsigned dst)
+  {
+    if (! compile_node (tex, dst))
+      emit_call (compile_tex (Ref<const Tex<T> > (&tex)), dst);
+  }
+
+  // Compile code to leave the value of VAL in register DST.
+  //
+  template<typename T>
+  void compile (const TexVal<T> &val, unsigned dst)
+  {
+    if (val.tex)
+      compile (*val.tex, dst);
+    else
+      emit_load (val.default_val, dst);
+  }
+
+  // If TEX is a type of texture we know how to compile, and there are
+  // enough free registers to do so, compile code to leave its value in
+  // register DST and return true; otherwise just return false.
+  //
+  template<typename T>
+  bool compile_node (const Tex<T> &tex, unsigned dst)
+  {
+    // No node needs more than two temporary registers of each type.
+    //
+    if (num_fregs + 2 > MAX_REGS || num_cregs + 2 > MAX_REGS)
+      return false;
+
+    if (const ArithTex<T> *at = dynamic_cast<const ArithTex<T> *> (&tex))
+      {
+	compile (at->arg1, dst);
+	unsigned arg2 = alloc<T> ();
+	compile (at->arg2, arg2);
+	emit (typed_op (ARITH_F, dst_type (at)), dst, dst, arg2, 0, at->op);
+	release<T> (arg2);
+      }
+    else if (const CmpTex<T> *ct = dynamic_cast<const CmpTex<T> *> (&tex))
+      {
+	unsigned cval1 = alloc<float> ();
+	compile (ct->cval1, cval1);
+	unsigned cval2 = alloc<float> ();
+	compile (ct->cval2, cval2);
+	emit (CMP, cval1, cval1, cval2, 0, ct->op);
+	release<float> (cval2);
+	compile_branches (cval1, ct->rval1, ct->rval2, dst);
+	release<float> (cval1);
+      }
+    else if (const LinterpTex<T> *lt
+	       = dynamic_cast<const LinterpTex<T> *> (&tex))
+      {
+	compile_interp (LINTERP_F, lt->control, lt->val1, lt->val2, dst);
+      }
+    else if (const SinterpTex<T> *st
+	       = dynamic_cast<const SinterpTex<T> *> (&tex))
+      {
+	compile_interp (SINTERP_F, st->control, st->val1, st->val2, dst);
+      }
+    else if (const RescaleTex<T> *rt
+	       = dynamic_cast<const RescaleTex<T> *> (&tex))
+      {
+	// RescaleTex computes (VAL - IN_BIAS) * SCALE + OUT_BIAS.
+	//
+	unsigned char arith_op = typed_op (ARITH_F, dst_type (rt));
+	compile (rt->val, dst);
+	unsigned tmp = alloc<T> ();
+	emit_load (rt->in_bias, tmp);
+	emit (arith_op, dst, dst, tmp, 0, ArithTex<T>::SUB);
+	emit_load (rt->scale, tmp);
+	emit (arith_op, dst, dst, tmp, 0, ArithTex<T>::MUL);
+	emit_load (rt->out_bias, tmp);
+	emit (arith_op, dst, dst, tmp, 0, ArithTex<T>::ADD);
+	release<T> (tmp);
+      }
+    else if (const CheckTex<T> *ct = dynamic_cast<const CheckTex<T> *> (&tex))
+      {
+	unsigned cond = alloc<float> ();
+	emit (CHECK_2D, cond);
+	compile_branches (cond, ct->tex1, ct->tex2, dst);
+	release<float> (cond);
+      }
+    else if (const Check3dTex<T> *ct
+	       = dynamic_cast<const Check3dTex<T> *> (&tex))
+      {
+	unsigned cond = alloc<float> ();
+	emit (CHECK_3D, cond);
+	compile_branches (cond, ct->tex1, ct->tex2, dst);
+	release<float> (cond);
+      }
+    else if (! compile_typed_node (tex, dst))
+      return false;
+
+    return true;
+  }
+
+  // Variants of TexProgram::Compiler::compile_node for texture types
+  // which only exist for a single value type.
+  //
+  bool compile_typed_node (const Tex<float> &tex, unsigned dst)
+  {
+    if (const CoordTex *ct = dynamic_cast<const CoordTex *> (&tex))
+      emit (COORD, dst, 0, 0, 0, ct->kind);
+    else if (const IntensTex *it = dynamic_cast<const IntensTex *> (&tex))
+      {
+	unsigned val = alloc<Color> ();
+	compile (it->val, val);
+	emit (INTENS, dst, val);
+	release<Color> (val);
+      }
+    else
+      return false;
+    return true;
+  }
+  bool compile_typed_node (const Tex<Color> &tex, unsigned dst)
+  {
+    if (const GreyTex *gt = dynamic_cast<const GreyTex *> (&tex))
+      {
+	unsigned val = alloc<float> ();
+	compile (gt->val, val);
+	emit (GREY, dst, val);
+	release<float> (val);
+	return true;
+      }
+    return false;
+  }
+
+  // Compile code to leave the value of either VAL1 (if register COND
+  // is non-zero) or VAL2 (otherwise) in register DST.
+  //
+  template<typename T>
+  void compile_branches (unsigned cond,
+			 const TexVal<T> &val1, const TexVal<T> &val2,
+			 unsigned dst)
+  {
+    unsigned skip_val1 = emit (JUMP_UNLESS, 0, cond);
+    compile (val1, dst);
+    unsigned skip_val2 = emit (JUMP);
+    prog.code[skip_val1].arg = prog.code.size ();
+    compile (val2, dst);
+    prog.code[skip_val2].arg = prog.code.size ();
+  }
+
+  // Compile code for an interpolation between VAL1 and VAL2, controlled
+  // by CONTROL, using the float opcode FLOAT_OP (or the corresponding
+  // color opcode), leaving the result in register DST.
+  //
+  template<typename T>
+  void compile_interp (Opcode float_op, const TexVal<float> &control,
+		       const TexVal<T> &val1, const TexVal<T> &val2,
+		       unsigned dst)
+  {
+    unsigned ctl = alloc<float> ();
+    compile (control, ctl);
+    compile (val1, dst);
+    unsigned v2 = alloc<T> ();
+    compile (val2, v2);
+    emit (typed_op (float_op, &val1.default_val), dst, ctl, dst, v2);
+    release<T> (v2);
+    release<float> (ctl);
+  }
+
+  // Add an instruction to the program, and return its index.
+  //
+  unsigned emit (unsigned char op, unsigned dst = 0,
+		 unsigned src1 = 0, unsigned src2 = 0, unsigned src3 = 0,
+		 unsigned arg = 0)
+  {
+    Insn insn;
+    insn.op = op;
+    insn.dst = dst;
+    insn.src1 = src1;
+    insn.src2 = src2;
+    insn.src3 = src3;
+    insn.arg = arg;
+    prog.code.push_back (insn);
+    return prog.code.size () - 1;
+  }
+
+  // Add instructions to load the constant VAL into register DST.
+  //
+  void emit_load (float val, unsigned dst)
+  {
+    prog.float_consts.push_back (val);
+    emit (LOAD_F, dst, 0, 0, 0, prog.float_consts.size () - 1);
+  }
+  void emit_load (const Color &val, unsigned dst)
+  {
+    prog.color_consts.push_back (val);
+    emit (LOAD_C, dst, 0, 0, 0, prog.color_consts.size () - 1);
+  }
+
+  // Add instructions to call TEX, leaving the result in register DST.
+  //
+  void emit_call (const Ref<const Tex<float> > &tex, unsigned dst)
+  {
+    prog.float_texs.push_back (tex);
+    prog.is_expensive |= tex->expensive ();
+    emit (CALL_F, dst, 0, 0, 0, prog.float_texs.size () - 1);
+  }
+  void emit_call (const Ref<const Tex<Color> > &tex, unsigned dst)
+  {
+    prog.color_texs.push_back (tex);
+    prog.is_expensive |= tex->expensive ();
+    emit (CALL_C, dst, 0, 0, 0, prog.color_texs.size () - 1);
+  }
+
+  // Return the opcode for values of type T corresponding to the float
+  // opcode FLOAT_OP; the type is determined by the type of the unused
+  // pointer argument.  Color opcodes always immediately follow the
+  // corresponding float opcode.
+  //
+  static unsigned char typed_op (Opcode float_op, const float *)
+  {
+    return float_op;
+  }
+  static unsigned char typed_op (Opcode float_op, const Color *)
+  {
+    return float_op + 1;
+  }
+
+  // Return a null pointer to the value type of the texture TEX, for
+  // use with TexProgram::Compiler::typed_op.
+  //
+  template<typename T>
+  static const T *dst_type (const Tex<T> *) { return 0; }
+
+  // Return the number of allocated registers of the type pointed to by
+  // the unused argument.
+  //
+  unsigned &num_regs (const float *) { return num_fregs; }
+  unsigned &num_regs (const Color *) { return num_cregs; }
+
+  // Allocate a register of type T, and return its number.
+  //
+  template<typename T>
+  unsigned alloc ()
+  {
+    return num_regs (static_cast<const T *> (0))++;
+  }
+
+  // Free register REG of type T, and all registers allocated after it.
+  //
+  template<typename T>
+  void release (unsigned reg)
+  {
+    num_regs (static_cast<const T *> (0)) = reg;
+  }
+
+  // The program being compiled.
+  //
+  TexProgram &prog;
+
+  // Number of float and color registers currently allocated.
+  //
+  unsigned num_fregs, num_cregs;
+};
+
+
+// Compile TEX into this program, which should be empty.  Returns false
+// if TEX is not a type of texture which can be compiled (in which case
+// the program is not modified).
+//
+bool
+TexProgram::compile (const Tex<float> &tex)
+{
+  return Compiler (*this).compile_root (tex);
+}
+bool
+TexProgram::compile (const Tex<Color> &tex)
+{
+  return Compiler (*this).compile_root (tex);
+}
+
+
+
+// compile_tex
+
+namespace { // keep local to file
+
+// A table of textures already compiled by compile_tex, mapping each
+// original texture to its compiled result.
+//
+// A texture used in more than one place (for instance, by several
+// material parameters) must always be compiled to the same result, as
+// otherwise each use would get a separate copy, and values cached for
+// it in a TexEvalCache could not be shared.  Each entry holds a
+// reference to the original texture too, so its address can't be
+// reused by another texture while the entry exists.
+//
+// Textures are only compiled while a scene is being loaded, so no
+// locking is needed.
+//
+template<typename T>
+struct CompiledTexTable
+{
+  typedef std::pair<Ref<const Tex<T> >, Ref<const Tex<T> > > Entry;
+  typedef std::map<const Tex<T> *, Entry> Map;
+
+  static Map entries;
+};
+
+template<typename T>
+typename CompiledTexTable<T>::Map CompiledTexTable<T>::entries;
+
+template<typename T>
+Ref<const Tex<T> >
+compile_tex_internal (const Ref<const Tex<T> > &tex)
+{
+  if (! tex)
+    return tex;
+
+  typename CompiledTexTable<T>::Map &table = CompiledTexTable<T>::entries;
+
+  typename CompiledTexTable<T>::Map::iterator prev = table.find (tex.ptr ());
+  if (prev != table.end ())
+    return prev->second.second;
+
+  Ref<const Tex<T> > compiled;
+
+  TexProgram program;
+  if (program.compile (*tex))
+    compiled = new CompiledTex<T> (program);
+  else
+    compiled = TexProgram::Compiler::compile_inputs (tex);
+
+  table[tex.ptr ()] = typename CompiledTexTable<T>::Entry (tex, compiled);
+
+  return compiled;
+}
+
+} // namespace
+
+
+// Return a texture which evaluates to the same value as TEX, but using
+// a TexProgram where possible.  If TEX itself can't be compiled, but
+// has inputs which can (for instance, the input of an XformTex), a
+// copy of TEX with compiled inputs is returned; otherwise TEX itself is
+// returned.  Compiling the same texture again returns the same result.
+//
+Ref<const Tex<float> >
+snogray::compile_tex (const Ref<const Tex<float> > &tex)
+{
+  return compile_tex_internal (tex);
+}
+Ref<const Tex<Color> >
+snogray::compile_tex (const Ref<const Tex<Color> > &tex)
+{
+  return compile_tex_internal (tex);
+}
@@ -0,0 +1,227 @@
+// tex-program.h -- Texture expression trees compiled into a program
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_TEX_PROGRAM_H
+#define SNOGRAY_TEX_PROGRAM_H
+
+#include <vector>
+
+#include "color/color.h"
+#include "tex.h"
+#include "tex-eval-cache.h"
+
+
+namespace snogray {
+
+
+// A "program" which evaluates a texture expression tree.
+//
+// Textures built up from many small nodes (ArithTex, CmpTex,
+// LinterpTex, etc.) normally cost a virtual call and a TexVal
+// indirection per node for every lookup.  A TexProgram flattens such a
+// tree into a linear sequence of simple register-based instructions,
+// which are executed by a single interpreter loop.  Any node which
+// the compiler doesn't know about (noise textures, image textures,
+// etc.) is simply called via a CALL instruction.
+//
+// Each register holds MAX_LANES values, and the interpreter can
+// evaluate the program at up to that many sets of texture coordinates
+// at once, with every instruction operating on all lanes; lanes only
+// go their own way when they disagree about a conditional branch.
+//
+class TexProgram
+{
+public:
+
+  // Maximum number of sets of texture coordinates which can be
+  // evaluated at once.
+  //
+  static const unsigned MAX_LANES = 8;
+
+  // Maximum number of registers of each type.
+  //
+  static const unsigned MAX_REGS = 32;
+
+  // Register storage used while running a program.  This is large, and
+  // deliberately not initialized (Color's default constructor does
+  // nothing, so constructing it costs nothing).
+  //
+  struct Regs
+  {
+    float f[MAX_REGS][MAX_LANES];
+    Color c[MAX_REGS][MAX_LANES];
+  };
+
+  TexProgram () : result_reg (0), is_expensive (false) { }
+
+  // Compile TEX into this program, which should be empty.  Returns
+  // false if TEX is not a type of texture which can be compiled (in
+  // which case the program is not modified).
+  //
+  bool compile (const Tex<float> &tex);
+  bool compile (const Tex<Color> &tex);
+
+  // Run this program for lanes BEGIN through END-1 of REGS, starting
+  // from instruction PC, where COORDS[L] are the texture coordinates
+  // for lane L.  The result can be retrieved using
+  // TexProgram::get_result.
+  //
+  void run (const TexCoords *coords, unsigned begin, unsigned end,
+	    Regs &regs, unsigned pc = 0)
+    const;
+
+  // Set VAL to the result of a previous call to TexProgram::run in
+  // lane LANE of REGS.
+  //
+  void get_result (const Regs &regs, unsigned lane, float &val) const
+  {
+    val = regs.f[result_reg][lane];
+  }
+  void get_result (const Regs &regs, unsigned lane, Color &val) const
+  {
+    val = regs.c[result_reg][lane];
+  }
+
+  // Return true if this program calls any expensive textures (see
+  // Tex::expensive).
+  //
+  bool expensive () const { return is_expensive; }
+
+  // Return the number of instructions in this program.
+  //
+  unsigned size () const { return code.size (); }
+
+  // Helper class for compiling a texture expression tree into a
+  // TexProgram.  Texture classes which the compiler knows about give
+  // it access to their private state by declaring it a friend.
+  //
+  class Compiler;
+  friend class Compiler;
+
+private:
+
+  enum Opcode
+  {
+    LOAD_F, LOAD_C,		// DST = constant ARG
+    COORD,			// DST = coordinate ARG (a CoordTex::Kind)
+    ARITH_F, ARITH_C,		// DST = SRC1 op SRC2 (ARG is an ArithTex op)
+    CMP,			// DST = SRC1 op SRC2 (ARG is a CmpTex op)
+    CHECK_2D, CHECK_3D,		// DST = CheckTex/Check3dTex condition
+    JUMP,			// goto ARG
+    JUMP_UNLESS,		// if (! SRC1) goto ARG
+    LINTERP_F, LINTERP_C,	// DST = linterp (SRC1, SRC2, SRC3)
+    SINTERP_F, SINTERP_C,	// DST = sinterp (SRC1, SRC2, SRC3)
+    INTENS,			// DST = SRC1.intensity ()
+    GREY,			// DST = Color (SRC1)
+    CALL_F, CALL_C		// DST = texture ARG evaluated
+  };
+
+  // A single instruction.  DST and SRC* are register numbers; whether
+  // they refer to float or color registers depends on the opcode.
+  //
+  struct Insn
+  {
+    unsigned char op, dst, src1, src2, src3;
+    unsigned arg;
+  };
+
+  // The program.
+  //
+  std::vector<Insn> code;
+
+  // Constants used by LOAD_F and LOAD_C instructions.
+  //
+  std::vector<float> float_consts;
+  std::vector<Color> color_consts;
+
+  // Textures called by CALL_F and CALL_C instructions.
+  //
+  std::vector<Ref<const Tex<float> > > float_texs;
+  std::vector<Ref<const Tex<Color> > > color_texs;
+
+  // Register holding the final result.
+  //
+  unsigned result_reg;
+
+  // True if any called texture is expensive.
+  //
+  bool is_expensive;
+};
+
+
+// A texture which evaluates a TexProgram.
+//
+template<typename T>
+class CompiledTex : public CachedTex<T>
+{
+public:
+
+  CompiledTex (const TexProgram &_program)
+    : CachedTex<T> (_program.expensive ()), program (_program)
+  { }
+
+  // Evaluate this texture at COORDS, without using any cache.
+  //
+  virtual T eval_uncached (const TexCoords &coords) const
+  {
+    TexProgram::Regs regs;
+    program.run (&coords, 0, 1, regs);
+
+    T val;
+    program.get_result (regs, 0, val);
+    return val;
+  }
+
+  // Evaluate this texture at NUM sets of texture coordinates, COORDS[0]
+  // through COORDS[NUM-1], storing the results in VALS.  Up to
+  // TexProgram::MAX_LANES sets of coordinates are evaluated at once.
+  //
+  virtual void eval_batch_uncached (const TexCoords *coords, unsigned num,
+				    T *vals)
+    const
+  {
+    TexProgram::Regs regs;
+
+    while (num > 0)
+      {
+	unsigned lanes = num;
+	if (lanes > TexProgram::MAX_LANES)
+	  lanes = TexProgram::MAX_LANES;
+
+	program.run (coords, 0, lanes, regs);
+
+	for (unsigned l = 0; l < lanes; l++)
+	  program.get_result (regs, l, vals[l]);
+
+	coords += lanes;
+	vals += lanes;
+	num -= lanes;
+      }
+  }
+
+  TexProgram program;
+};
+
+
+// Return a texture which evaluates to the same value as TEX, but using
+// a TexProgram where possible.  If TEX itself can't be compiled, but
+// has inputs which can (for instance, the input of an XformTex), a
+// copy of TEX with compiled inputs is returned; otherwise TEX itself is
+// returned.  Compiling the same texture again returns the same result.
+//
+Ref<const Tex<float> > compile_tex (const Ref<const Tex<float> > &tex);
+Ref<const Tex<Color> > compile_tex (const Ref<const Tex<Color> > &tex);
+
+
+}
+
+#endif // SNOGRAY_TEX_PROGRAM_H
@@ -33,6 +33,23 @@ public:
   // Evaluate this texture at TEX_COORDS.
   //
   virtual T eval (const TexCoords &tex_coords) const = 0;
+
+  // Evaluate this texture at NUM sets of texture coordinates, COORDS[0]
+  // through COORDS[NUM-1], storing the results in VALS.  Subclasses
+  // which can evaluate several points more efficiently than one at a
+  // time may override this.
+  //
+  virtual void eval_batch (const TexCoords *coords, unsigned num, T *vals)
+    const
+  {
+    for (unsigned i = 0; i < num; i++)
+      vals[i] = eval (coords[i]);
+  }
+
+  // Return true if this texture is expensive enough to evaluate that
+  // its values are worth caching (see TexEvalCache).
+  //
+  virtual bool expensive () const { return false; }
 };
 
 
@@ -73,6 +90,10 @@ public:
     return tex ? tex->eval (tex_coords) : default_val;
   }
 
+  // Return true if this value is an expensive texture.
+  //
+  bool expensive () const { return tex && tex->expensive (); }
+
   Ref<const Tex<T> > tex;
 
   T default_val;
@@ -132,6 +132,49 @@ function texture.mono_image (arg1, ...)
    return raw.mono_image_tex (load.filename_in_cur_load_directory (arg1), ...)
 end
 
+-- Set up the cache used for image textures.  If SIZE_MB is non-zero,
+-- image textures are stored as tiles, which are loaded on demand into
+-- a cache using at most SIZE_MB megabytes of memory.  If TILE_DIR is
+-- given, converted tile files are kept there, and reused by later runs.
+--
+function texture.set_image_cache (size_mb, tile_dir)
+   raw.set_image_tex_cache (size_mb, tile_dir or "")
+end
+
+-- Set the mode used for loading image textures.  MODE may be
+-- "immediate" (load each image when its texture is defined),
+-- "parallel" (load images in the background, using at most
+-- NUM_THREADS threads, defaulting to the number of cores), or "lazy"
+-- (don't load an image until its texture is first used).
+--
+function texture.set_image_load_mode (mode, num_threads)
+   raw.set_image_tex_load_mode (mode, num_threads or 0)
+end
+
+-- Wait for any image textures being loaded in the background to
+-- finish loading.  An error is signaled if any of them failed to load.
+--
+function texture.finish_image_loads ()
+   raw.finish_image_tex_loads ()
+end
+
+-- Return a table of information about the loading of image textures,
+-- with one entry for each image texture defined.  Each entry is a
+-- table with fields "filename", "state" (one of "loaded", "failed",
+-- or "unloaded"), and "time" (the time spent loading it, in seconds).
+--
+function texture.image_load_stats ()
+   local stats = {}
+   for i = 0, raw.num_image_tex_loads () - 1 do
+      stats[#stats + 1] = {
+	 filename = raw.image_tex_load_filename (i),
+	 state = raw.image_tex_load_state (i),
+	 time = raw.image_tex_load_time (i)
+      }
+   end
+   return stats
+end
+
 -- Return a "grey_tex" texture object using the floating-point texture
 -- VAL as a source.  This can be used to convert a floating-point
 -- texture into a color texture.
@@ -579,6 +622,38 @@ function texture.perlin_abs_series (params)
 end
 
 
+----------------------------------------------------------------
+-- Texture compilation
+--
+
+-- If true, texture.compile actually compiles textures.
+--
+texture.compile_enabled = true
+
+-- Enable or disable texture compilation (see texture.compile).
+--
+function texture.set_compile_enabled (enabled)
+   texture.compile_enabled = enabled
+end
+
+-- Return a texture which has the same value as TEX, but where trees
+-- of simple texture operations (arithmetic, comparisons,
+-- interpolation, etc.) have been compiled into a form which is faster
+-- to evaluate.  If TEX is not a texture, or texture compilation has
+-- been disabled, TEX is returned unchanged.
+--
+-- This should be used on completed textures (e.g., by material
+-- constructors), not on intermediate results.
+--
+function texture.compile (tex)
+   if texture.compile_enabled and is_tex (tex) then
+      return raw.compiled_tex (tex)
+   else
+      return tex
+   end
+end
+
+
 --
 -- Not yet documented:
 --
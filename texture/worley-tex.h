@@ -15,7 +15,7 @@
 
 #include "worley.h"
 
-#include "tex.h"
+#include "tex-eval-cache.h"
 
 
 namespace snogray {
@@ -27,19 +27,20 @@ namespace snogray {
 // calculates the final texture value as (C_1 * F_1) + ... + (C_n * F_n);
 // (n is the constant MAX_N).
 //
-class WorleyTex : public Tex<float>
+class WorleyTex : public CachedTex<float>
 {
 public:
 
   static const unsigned MAX_N = 4;
 
   WorleyTex (float _coef[MAX_N])
+    : CachedTex<float> (true)
   {
     for (unsigned i = 0; i < MAX_N; i++)
       coef[i] = _coef[i];
   }
 
-  virtual float eval (const TexCoords &coords) const
+  virtual float eval_uncached (const TexCoords &coords) const
   {
     float F[MAX_N];
 
@@ -64,7 +65,7 @@ private:
 // Similar to WorleyTex, but returns a fixed "id" number for each cell,
 // which is adjusted to fit a specified range..
 //
-class WorleyIdTex : public Tex<float>
+class WorleyIdTex : public CachedTex<float>
 {
 public:
 
@@ -77,13 +78,13 @@ public:
   };
 
   WorleyIdTex (Kind _kind, float max)
-    : kind (_kind), bias (0), scale (max)
+    : CachedTex<float> (true), kind (_kind), bias (0), scale (max)
   { }
   WorleyIdTex (Kind _kind, float min, float max)
-    : kind (_kind), bias (min), scale (max - min)
+    : CachedTex<float> (true), kind (_kind), bias (min), scale (max - min)
   { }
 
-  virtual float eval (const TexCoords &coords) const
+  virtual float eval_uncached (const TexCoords &coords) const
   {
     float F_0;
     unsigned id = worley.eval (coords.pos, 1, &F_0);
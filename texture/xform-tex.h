@@ -16,7 +16,7 @@
 
 #include "geometry/xform.h"
 
-#include "tex.h"
+#include "tex-eval-cache.h"
 
 
 namespace snogray {
@@ -25,12 +25,12 @@ namespace snogray {
 // Base class for XformTex classes
 //
 template<typename T>
-class XformTexBase : public Tex<T>
+class XformTexBase : public CachedTex<T>
 {
 public:
 
   XformTexBase (const Xform &_xform, const TexVal<T> &_tex)
-    : xform (_xform), tex (_tex)
+    : CachedTex<T> (_tex.expensive ()), xform (_xform), tex (_tex)
   { }
 
   // Transformation to use.  The same transform is used for both 2d and 3d
@@ -76,11 +76,11 @@ public:
 
   // Evaluate this texture at TEX_COORDS.
   //
-  virtual T eval (const TexCoords &tex_coords) const
+  virtual T eval_uncached (const TexCoords &tex_coords) const
   {
-    Pos xpos = XformTexBase<T>::xform (tex_coords.pos);
-    UV xuv = XformTexBase<T>::xform (tex_coords.uv);
-    return XformTexBase<T>::tex.eval (TexCoords (xpos, xuv));
+    const Xform &xform = XformTexBase<T>::xform;
+    return XformTexBase<T>::tex.eval (
+	     tex_coords.with_xformed (xform));
   }
 };
 
@@ -100,10 +100,11 @@ public:
 
   // Evaluate this texture at TEX_COORDS.
   //
-  virtual T eval (const TexCoords &tex_coords) const
+  virtual T eval_uncached (const TexCoords &tex_coords) const
   {
-    UV xuv = XformTexBase<T>::xform (tex_coords.uv);
-    return XformTexBase<T>::tex.eval (TexCoords (tex_coords.pos, xuv));
+    const Xform &xform = XformTexBase<T>::xform;
+    return XformTexBase<T>::tex.eval (
+	     tex_coords.with_xformed_uv (xform));
   }
 };
 
@@ -123,10 +124,14 @@ public:
 
   // Evaluate this texture at TEX_COORDS.
   //
-  virtual T eval (const TexCoords &tex_coords) const
+  virtual T eval_uncached (const TexCoords &tex_coords) const
   {
-    Pos xpos = XformTexBase<T>::xform (tex_coords.pos);
-    return XformTexBase<T>::tex.eval (TexCoords (xpos, tex_coords.uv));
+    const Xform &xform = XformTexBase<T>::xform;
+    TexCoords xf_tex_coords (tex_coords);
+    xf_tex_coords.pos = xform (tex_coords.pos);
+    xf_tex_coords.dPdx = xform (tex_coords.dPdx);
+    xf_tex_coords.dPdy = xform (tex_coords.dPdy);
+    return XformTexBase<T>::tex.eval (xf_tex_coords);
   }
 };
 
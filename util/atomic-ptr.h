@@ -0,0 +1,91 @@
+// atomic-ptr.h -- Pointer which may be shared between threads without locking
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+// If std::thread is used, AtomicPtr is a wrapper for std::atomic.
+// Otherwise, it uses gcc's atomic builtins if available, or is just a
+// plain pointer (which is only safe if threading isn't enabled).
+//
+
+#ifndef SNOGRAY_ATOMIC_PTR_H
+#define SNOGRAY_ATOMIC_PTR_H
+
+#include "config.h"
+
+#if USE_STD_THREAD
+# include <atomic>
+#endif
+
+
+namespace snogray {
+
+
+// A pointer to T, which one thread may set while others read it.
+//
+// The usual use is to "publish" an object:  the writer fully
+// initializes the object, and then stores a pointer to it using
+// AtomicPtr::store_release; any reader which gets that pointer from
+// AtomicPtr::load_acquire is then guaranteed to see the initialized
+// object.
+//
+template<typename T>
+class AtomicPtr
+{
+public:
+
+  AtomicPtr (T *init = 0) : ptr (init) { }
+
+  // Return the pointer.  Memory accesses following this cannot be
+  // reordered before it.
+  //
+  T *load_acquire () const
+  {
+#if USE_STD_THREAD
+    return ptr.load (std::memory_order_acquire);
+#elif USE_THREADS && defined (__GNUC__)
+    return __atomic_load_n (&ptr, __ATOMIC_ACQUIRE);
+#else
+    return ptr;
+#endif
+  }
+
+  // Set the pointer to VAL.  Memory accesses preceding this cannot be
+  // reordered after it.
+  //
+  void store_release (T *val)
+  {
+#if USE_STD_THREAD
+    ptr.store (val, std::memory_order_release);
+#elif USE_THREADS && defined (__GNUC__)
+    __atomic_store_n (&ptr, val, __ATOMIC_RELEASE);
+#else
+    ptr = val;
+#endif
+  }
+
+private:
+
+  // AtomicPtrs can't be copied.
+  //
+  AtomicPtr (const AtomicPtr &);
+  AtomicPtr &operator= (const AtomicPtr &);
+
+#if USE_STD_THREAD
+  std::atomic<T *> ptr;
+#else
+  T *ptr;
+#endif
+};
+
+
+}
+
+
+#endif // SNOGRAY_ATOMIC_PTR_H
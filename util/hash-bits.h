@@ -0,0 +1,102 @@
+// hash-bits.h -- Integer hashing and index permutation
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_HASH_BITS_H
+#define SNOGRAY_HASH_BITS_H
+
+
+namespace snogray {
+
+
+// Return a well-mixed 32-bit hash of NUM; every bit of the result
+// depends on every bit of NUM.  This can be used as a "counter-based"
+// random number generator, where successive results are obtained by
+// hashing successive integers.
+//
+// This is the "lowbias32" function found by Chris Wellons' hash
+// prospector.
+//
+static inline unsigned
+mix_bits (unsigned num)
+{
+  num ^= num >> 16;
+  num *= 0x7feb352d;
+  num ^= num >> 15;
+  num *= 0x846ca68b;
+  num ^= num >> 16;
+  return num;
+}
+
+// Return a well-mixed 64-bit hash of NUM.
+//
+// This is the finalizer from the "SplitMix64" generator (itself derived
+// from MurmurHash3), which is a bijection with good avalanche
+// properties.
+//
+static inline unsigned long long
+mix_bits64 (unsigned long long num)
+{
+  num = (num ^ (num >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  num = (num ^ (num >> 27)) * 0x94d049bb133111ebULL;
+  return num ^ (num >> 31);
+}
+
+// Return element INDEX of a pseudo-random permutation of the integers
+// [0, LEN), where SEED selects the permutation.  INDEX must be less
+// than LEN.
+//
+// This is the hash-based permutation from Andrew Kensler's "Correlated
+// Multi-Jittered Sampling"; it works for any LEN, by repeatedly
+// permuting within the next power-of-two until the result is in range.
+// Kensler's final rotation of the result by SEED is omitted, as it
+// costs an integer division and adds little.
+//
+static inline unsigned
+permute_index (unsigned index, unsigned len, unsigned seed)
+{
+  unsigned w = len - 1;
+  w |= w >> 1;
+  w |= w >> 2;
+  w |= w >> 4;
+  w |= w >> 8;
+  w |= w >> 16;
+
+  do
+    {
+      index ^= seed;
+      index *= 0xe170893d;
+      index ^= seed >> 16;
+      index ^= (index & w) >> 4;
+      index ^= seed >> 8;
+      index *= 0x0929eb3f;
+      index ^= seed >> 23;
+      index ^= (index & w) >> 1;
+      index *= 1 | seed >> 27;
+      index *= 0x6935fa69;
+      index ^= (index & w) >> 11;
+      index *= 0x74dcb303;
+      index ^= (index & w) >> 2;
+      index *= 0x9e501cc3;
+      index ^= (index & w) >> 2;
+      index *= 0xc860a3df;
+      index &= w;
+      index ^= index >> 5;
+    }
+  while (index >= len);
+
+  return index;
+}
+
+
+}
+
+#endif // SNOGRAY_HASH_BITS_H
@@ -0,0 +1,95 @@
+// mapped-file.cc -- Read-only memory-mapped file
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "config.h"
+
+#if HAVE_UNISTD_H && HAVE_SYS_MMAN_H && HAVE_SYS_STAT_H
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define USE_MMAP 1
+#endif
+
+#include "excepts.h"
+
+#include "mapped-file.h"
+
+
+using namespace snogray;
+
+
+MappedFile::MappedFile (const std::string &filename, bool sequential)
+  : data (0), _size (0), mapped (0)
+{
+#if USE_MMAP
+
+  int fd = open (filename.c_str (), O_RDONLY);
+  if (fd < 0)
+    throw file_error (filename + ": " + strerror (errno));
+
+  struct stat statb;
+  if (fstat (fd, &statb) == 0 && statb.st_size > 0)
+    {
+      size_t len = statb.st_size;
+      void *contents = mmap (0, len, PROT_READ, MAP_SHARED, fd, 0);
+
+      if (contents != MAP_FAILED)
+	{
+#ifdef MADV_SEQUENTIAL
+	  if (sequential)
+	    madvise (contents, len, MADV_SEQUENTIAL);
+#endif
+
+	  mapped = contents;
+	  data = static_cast<const char *> (contents);
+	  _size = len;
+
+	  close (fd);
+	  return;
+	}
+    }
+
+  close (fd);
+
+#endif // USE_MMAP
+
+  // Couldn't memory-map the file, so just read it.
+
+  (void)sequential;
+
+  std::ifstream stream (filename.c_str (), std::ios::binary);
+  if (! stream)
+    throw file_error (filename + ": " + strerror (errno));
+
+  buf.assign (std::istreambuf_iterator<char> (stream),
+	      std::istreambuf_iterator<char> ());
+
+  if (! buf.empty ())
+    {
+      data = &buf[0];
+      _size = buf.size ();
+    }
+}
+
+MappedFile::~MappedFile ()
+{
+#if USE_MMAP
+  if (mapped)
+    munmap (mapped, _size);
+#endif
+}
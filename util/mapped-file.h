@@ -0,0 +1,65 @@
+// mapped-file.h -- Read-only memory-mapped file
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_MAPPED_FILE_H
+#define SNOGRAY_MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+
+#include "ref.h"
+
+
+namespace snogray {
+
+
+// The read-only contents of a file, memory-mapped if possible,
+// otherwise read into memory.
+//
+// This is reference-counted, so that objects using data stored in
+// the file can keep it alive for as long as they need it.
+//
+class MappedFile : public RefCounted
+{
+public:
+
+  // Map the file called FILENAME.  If SEQUENTIAL is true, the contents
+  // are expected to be accessed mostly sequentially, and the system is
+  // told so.  If the file can't be read, a file_error is thrown.
+  //
+  MappedFile (const std::string &filename, bool sequential = false);
+  ~MappedFile ();
+
+  const char *begin () const { return data; }
+  const char *end () const { return data + _size; }
+
+  size_t size () const { return _size; }
+
+private:
+
+  const char *data;
+  size_t _size;
+
+  // If non-zero, DATA is memory-mapped, and this is the mapping.
+  //
+  void *mapped;
+
+  // If the file couldn't be memory-mapped, its contents are read into
+  // this buffer instead.
+  //
+  std::vector<char> buf;
+};
+
+
+}
+
+#endif // SNOGRAY_MAPPED_FILE_H
@@ -0,0 +1,167 @@
+// mapped-vector.h -- Vector which may refer to externally stored data
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_MAPPED_VECTOR_H
+#define SNOGRAY_MAPPED_VECTOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include "ref.h"
+
+
+namespace snogray {
+
+
+// A vector which either holds its own elements, like std::vector, or
+// refers to a read-only array stored elsewhere, typically in a
+// memory-mapped file (see MappedVector::map).
+//
+// In the latter case, the external array is copied into the vector's
+// own storage the first time the vector is modified, so mapped data
+// costs nothing unless it actually needs to change.
+//
+// Only the operations actually needed by users are supported; any
+// operation that modifies the vector must go through this class, so
+// that MappedVector::elems always points to the current elements.
+//
+template<typename T>
+class MappedVector
+{
+public:
+
+  MappedVector () : elems (0), num_elems (0) { }
+
+  MappedVector (const MappedVector &from)
+    : vec (from.begin (), from.end ()), elems (0), num_elems (0)
+  {
+    update ();
+  }
+
+  MappedVector &operator= (const MappedVector &from)
+  {
+    if (&from != this)
+      {
+	release ();
+	vec.assign (from.begin (), from.end ());
+	update ();
+      }
+    return *this;
+  }
+
+  // Make this vector refer to the NUM elements at DATA, which should
+  // remain valid as long as OWNER is alive.  Any previous contents are
+  // discarded.
+  //
+  void map (const T *data, size_t num, const Ref<const RefCounted> &_owner)
+  {
+    std::vector<T> ().swap (vec);
+    owner = _owner;
+    elems = const_cast<T *> (data);
+    num_elems = num;
+  }
+
+  // Return true if this vector refers to external data.
+  //
+  bool mapped () const { return !!owner; }
+
+  size_t size () const { return num_elems; }
+  bool empty () const { return num_elems == 0; }
+
+  const T &operator[] (size_t i) const { return elems[i]; }
+  T &operator[] (size_t i) { make_private (); return elems[i]; }
+
+  const T *begin () const { return elems; }
+  const T *end () const { return elems + num_elems; }
+
+  void push_back (const T &val)
+  {
+    make_private ();
+    vec.push_back (val);
+    update ();
+  }
+
+  template<typename I>
+  void append (I beg, I end)
+  {
+    make_private ();
+    vec.insert (vec.end (), beg, end);
+    update ();
+  }
+
+  void resize (size_t size)
+  {
+    make_private ();
+    vec.resize (size);
+    update ();
+  }
+
+  void reserve (size_t size)
+  {
+    make_private ();
+    vec.reserve (size);
+    update ();
+  }
+
+  // Remove all elements, and free any memory used for them.
+  //
+  void clear ()
+  {
+    std::vector<T> ().swap (vec);
+    release ();
+    update ();
+  }
+
+private:
+
+  // If this vector refers to external data, copy it into VEC.
+  //
+  void make_private ()
+  {
+    if (owner)
+      {
+	vec.assign (begin (), end ());
+	release ();
+	update ();
+      }
+  }
+
+  // Stop referring to external data.
+  //
+  void release () { owner = static_cast<const RefCounted *> (0); }
+
+  // Update ELEMS and NUM_ELEMS to reflect VEC.
+  //
+  void update ()
+  {
+    num_elems = vec.size ();
+    elems = num_elems ? &vec[0] : 0;
+  }
+
+  // Our own elements, if we're not referring to external data.
+  //
+  std::vector<T> vec;
+
+  // The current elements, either in VEC, or external.
+  //
+  T *elems;
+  size_t num_elems;
+
+  // If non-null, the owner of external data we're referring to.
+  //
+  Ref<const RefCounted> owner;
+};
+
+
+}
+
+#endif // SNOGRAY_MAPPED_VECTOR_H
@@ -92,6 +92,9 @@ public:
     : RealUniqueLock (mutex.real_mutex (), arg)
   { }
 
+  using RealUniqueLock::lock;
+  using RealUniqueLock::unlock;
+
   // Return the underlying type.
   //
   RealUniqueLock &real_unique_lock () { return *this; }
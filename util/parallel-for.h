@@ -0,0 +1,146 @@
+// parallel-for.h -- Call a function on subranges of a range in parallel
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_PARALLEL_FOR_H
+#define SNOGRAY_PARALLEL_FOR_H
+
+#include <vector>
+
+#include "config.h"
+
+#include "num-cores.h"
+#if USE_THREADS
+#include "thread.h"
+#endif
+
+
+namespace snogray {
+
+
+#if USE_THREADS
+
+// Functor used by parallel_for to call FUN for a single subrange in
+// its own thread.
+//
+template<typename F>
+struct ParallelForRange
+{
+  ParallelForRange (F &_fun, unsigned _begin, unsigned _end)
+    : fun (&_fun), begin (_begin), end (_end)
+  { }
+
+  void operator() () const { (*fun) (begin, end); }
+
+  F *fun;
+  unsigned begin, end;
+};
+
+// A set of threads started by parallel_for.  They are joined and
+// deleted when it is destroyed, so that parallel_for waits for them
+// even if the calling thread exits with an exception.
+//
+class ParallelForThreads
+{
+public:
+
+  ParallelForThreads () { }
+  ~ParallelForThreads ()
+  {
+    for (unsigned t = 0; t < threads.size (); t++)
+      {
+	threads[t]->join ();
+	delete threads[t];
+      }
+  }
+
+  // Start a new thread running FUN.  Space is reserved first, so that
+  // recording the thread can't fail once it has started.
+  //
+  template<typename F>
+  void start (const F &fun)
+  {
+    threads.reserve (threads.size () + 1);
+    threads.push_back (new Thread (fun));
+  }
+
+private:
+
+  // ParallelForThreads can't be copied.
+  //
+  ParallelForThreads (const ParallelForThreads &);
+  ParallelForThreads &operator= (const ParallelForThreads &);
+
+  std::vector<Thread *> threads;
+};
+
+#endif // USE_THREADS
+
+
+// Divide the range [BEGIN, END) into disjoint contiguous subranges,
+// and call FUN (SUB_BEGIN, SUB_END) for each of them, in parallel if
+// possible.  The subranges are in ascending order, and each contains at
+// least MIN_SIZE elements (except when the whole range is smaller);
+// at most one subrange per CPU core is used.
+//
+// FUN must be safe to call from multiple threads at once, with
+// different subranges.  parallel_for returns when all calls are done.
+//
+template<typename F>
+void
+parallel_for (unsigned begin, unsigned end, F &fun, unsigned min_size = 1)
+{
+  if (end <= begin)
+    return;
+
+  unsigned size = end - begin;
+
+  unsigned num_ranges = num_cores ();
+  if (min_size == 0)
+    min_size = 1;
+  if (size / min_size < num_ranges)
+    num_ranges = size / min_size;
+  if (num_ranges == 0)
+    num_ranges = 1;
+
+#if USE_THREADS
+
+  if (num_ranges > 1)
+    {
+      // Run all but the first subrange in new threads, and the first in
+      // this thread.  The threads are joined when THREADS is
+      // destroyed.
+
+      ParallelForThreads threads;
+
+      for (unsigned r = 1; r < num_ranges; r++)
+	{
+	  unsigned sub_begin
+	    = begin + (unsigned long long)size * r / num_ranges;
+	  unsigned sub_end
+	    = begin + (unsigned long long)size * (r + 1) / num_ranges;
+	  threads.start (ParallelForRange<F> (fun, sub_begin, sub_end));
+	}
+
+      fun (begin, begin + size / num_ranges);
+
+      return;
+    }
+
+#endif // USE_THREADS
+
+  fun (begin, end);
+}
+
+
+}
+
+#endif // SNOGRAY_PARALLEL_FOR_H
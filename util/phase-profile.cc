@@ -0,0 +1,142 @@
+// phase-profile.cc -- Record time and memory used by startup phases
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#include <stdexcept>
+
+#include "util/timeval.h"
+#include "util/rusage.h"
+
+#include "phase-profile.h"
+
+
+using namespace snogray;
+
+
+// Return a sample of the current resource usage.
+//
+PhaseProfile::Sample
+PhaseProfile::Sample::current ()
+{
+  Rusage ru;
+  Sample sample;
+  sample.wall_time = Timeval (Timeval::TIME_OF_DAY);
+  sample.user_cpu_time = ru.user_cpu_time ();
+  sample.sys_cpu_time = ru.sys_cpu_time ();
+  sample.max_rss = ru.max_rss ();
+  return sample;
+}
+
+// Return the global phase profile.
+//
+PhaseProfile &
+PhaseProfile::global ()
+{
+  // This is never destroyed, as phases may still be running during
+  // program exit.
+  //
+  static PhaseProfile *global_profile = new PhaseProfile;
+  return *global_profile;
+}
+
+// Return the index of the entry for phase NAME, adding a new entry
+// if there is none.
+//
+unsigned
+PhaseProfile::entry_index (const std::string &name)
+{
+  LockGuard guard (mutex);
+
+  // There are never more than a few dozen entries, so a linear search
+  // is fine.
+  //
+  for (unsigned i = 0; i < entries.size (); i++)
+    if (entries[i].name == name)
+      return i;
+
+  entries.push_back (Entry (name));
+  return entries.size () - 1;
+}
+
+// Add a single occurrence of the phase with index ENTRY, which began
+// at BEG and ended at END.
+//
+void
+PhaseProfile::add (unsigned entry, const Sample &beg, const Sample &end)
+{
+  LockGuard guard (mutex);
+
+  Entry &e = entries[entry];
+  e.count++;
+  e.wall_time += end.wall_time - beg.wall_time;
+  e.user_cpu_time += end.user_cpu_time - beg.user_cpu_time;
+  e.sys_cpu_time += end.sys_cpu_time - beg.sys_cpu_time;
+  e.max_rss = end.max_rss;
+}
+
+// Begin and end a phase called NAME.  Unlike Phase objects, these
+// can be used where the beginning and end of a phase aren't in the
+// same C++ scope (e.g., from Lua).
+//
+void
+PhaseProfile::begin_phase (const std::string &name)
+{
+  if (_enabled)
+    {
+      unsigned entry = entry_index (name);
+      open_phases.push_back (std::make_pair (entry, Sample::current ()));
+    }
+}
+void
+PhaseProfile::end_phase ()
+{
+  if (_enabled)
+    {
+      if (open_phases.empty ())
+	throw std::runtime_error ("PhaseProfile::end_phase: no phase active");
+
+      Sample end = Sample::current ();
+      add (open_phases.back ().first, open_phases.back ().second, end);
+      open_phases.pop_back ();
+    }
+}
+
+// Return the number of entries in the profile, and a copy of entry I.
+//
+unsigned
+PhaseProfile::num_entries () const
+{
+  LockGuard guard (mutex);
+  return entries.size ();
+}
+PhaseProfile::Entry
+PhaseProfile::entry (unsigned i) const
+{
+  LockGuard guard (mutex);
+  return entries[i];
+}
+
+
+
+// PhaseProfile::Phase
+
+void
+PhaseProfile::Phase::begin (const char *name)
+{
+  entry = global ().entry_index (name);
+  beg_sample = Sample::current ();
+}
+
+void
+PhaseProfile::Phase::end ()
+{
+  global ().add (entry, beg_sample, Sample::current ());
+}
@@ -0,0 +1,176 @@
+// phase-profile.h -- Record time and memory used by startup phases
+//
+//  Copyright (C) 2013  Miles Bader <miles@gnu.org>
+//
+// This source code is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3, or (at
+// your option) any later version.  See the file COPYING for more details.
+//
+// Written by Miles Bader <miles@gnu.org>
+//
+
+#ifndef SNOGRAY_PHASE_PROFILE_H
+#define SNOGRAY_PHASE_PROFILE_H
+
+#include <string>
+#include <vector>
+
+#include "util/mutex.h"
+
+
+namespace snogray {
+
+
+// A record of the wall-clock time, CPU time, and peak memory use of
+// named "phases" of execution, such as loading a scene or building
+// its acceleration structures, used to find out where startup time
+// goes.
+//
+// Phases are recorded using PhaseProfile::Phase objects, which time
+// their own lifetime.  Recording is disabled by default, and a
+// disabled profile costs only a flag test per phase.
+//
+// All occurrences of phases with the same name are accumulated into a
+// single entry; entries are kept in the order their phases were first
+// started, so outer phases come before nested ones.
+//
+// CPU times are for the whole process, so phases that overlap in time
+// (for instance, nested phases, or phases run in several threads at
+// once) will each include CPU time used by the others.
+//
+class PhaseProfile
+{
+public:
+
+  // Accumulated information about a single named phase.
+  //
+  struct Entry
+  {
+    Entry (const std::string &_name)
+      : name (_name), count (0),
+	wall_time (0), user_cpu_time (0), sys_cpu_time (0), max_rss (0)
+    { }
+
+    std::string name;
+
+    // Number of times the phase has completed.
+    //
+    unsigned count;
+
+    // Total time spent in the phase, in seconds.
+    //
+    double wall_time, user_cpu_time, sys_cpu_time;
+
+    // The process's peak resident set size, in kilobytes, at the end
+    // of the most recent occurrence of the phase.
+    //
+    long max_rss;
+  };
+
+  // The process's resource usage at a particular moment.
+  //
+  struct Sample
+  {
+    Sample ()
+      : wall_time (0), user_cpu_time (0), sys_cpu_time (0), max_rss (0)
+    { }
+
+    // Return a sample of the current resource usage.
+    //
+    static Sample current ();
+
+    double wall_time, user_cpu_time, sys_cpu_time;
+    long max_rss;
+  };
+
+  // A Phase object records a single occurrence of the phase NAME in
+  // the global profile, lasting from its construction until it is
+  // destroyed.  If profiling isn't enabled when it's constructed, it
+  // does nothing.
+  //
+  class Phase
+  {
+  public:
+
+    Phase (const char *name)
+      : active (global ().enabled ())
+    {
+      if (active)
+	begin (name);
+    }
+    ~Phase ()
+    {
+      if (active)
+	end ();
+    }
+
+  private:
+
+    void begin (const char *name);
+    void end ();
+
+    bool active;
+
+    // Index of this phase's entry in the global profile.
+    //
+    unsigned entry;
+
+    Sample beg_sample;
+  };
+
+  PhaseProfile () : _enabled (false) { }
+
+  // Return the global phase profile.
+  //
+  static PhaseProfile &global ();
+
+  // Enable or disable recording of phases.
+  //
+  void enable (bool enable = true) { _enabled = enable; }
+  bool enabled () const { return _enabled; }
+
+  // Begin and end a phase called NAME.  Unlike Phase objects, these
+  // can be used where the beginning and end of a phase aren't in the
+  // same C++ scope (e.g., from Lua).  Phases started with begin_phase
+  // must be ended in reverse order, and from the same thread.  If
+  // profiling isn't enabled, these do nothing.
+  //
+  void begin_phase (const std::string &name);
+  void end_phase ();
+
+  // Return the number of entries in the profile, and a copy of entry I.
+  //
+  unsigned num_entries () const;
+  Entry entry (unsigned i) const;
+
+private:
+
+  // Return the index of the entry for phase NAME, adding a new entry
+  // if there is none.
+  //
+  unsigned entry_index (const std::string &name);
+
+  // Add a single occurrence of the phase with index ENTRY, which began
+  // at BEG and ended at END.
+  //
+  void add (unsigned entry, const Sample &beg, const Sample &end);
+
+  bool _enabled;
+
+  std::vector<Entry> entries;
+
+  // Phases started using begin_phase which haven't been ended yet,
+  // innermost last.
+  //
+  std::vector<std::pair<unsigned, Sample> > open_phases;
+
+  // Protects ENTRIES.
+  //
+  mutable Mutex mutex;
+};
+
+
+}
+
+#endif // SNOGRAY_PHASE_PROFILE_H
@@ -1,6 +1,6 @@
 // radical-inverse.h -- Compute "radical inverse" of a number
 //
-//  Copyright (C) 2010, 2011  Miles Bader <miles@gnu.org>
+//  Copyright (C) 2010, 2011, 2013  Miles Bader <miles@gnu.org>
 //
 // This source code is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License as
@@ -43,6 +43,63 @@ radical_inverse (unsigned num, unsigned base)
 }
 
 
+// Base-2 digit sequences
+//
+// The following functions operate on "fixed-point" fractions in the
+// range [0, 1), represented as a 32-bit unsigned integer whose most
+// significant bit has the value 1/2.  Use fixed_point_to_float to get
+// the actual value.
+
+// Return NUM with the order of its 32 bits reversed.
+//
+static inline unsigned
+reverse_bits (unsigned num)
+{
+  num = (num << 16) | (num >> 16);
+  num = ((num & 0x00FF00FF) << 8) | ((num & 0xFF00FF00) >> 8);
+  num = ((num & 0x0F0F0F0F) << 4) | ((num & 0xF0F0F0F0) >> 4);
+  num = ((num & 0x33333333) << 2) | ((num & 0xCCCCCCCC) >> 2);
+  num = ((num & 0x55555555) << 1) | ((num & 0xAAAAAAAA) >> 1);
+  return num;
+}
+
+// Return the base-2 radical inverse of NUM (the "van der Corput"
+// sequence), as a fixed-point fraction, with its digits scrambled by
+// XORing them with SCRAMBLE.
+//
+static inline unsigned
+van_der_corput (unsigned num, unsigned scramble = 0)
+{
+  return reverse_bits (num) ^ scramble;
+}
+
+// Return element NUM of the second dimension of the Sobol sequence, as
+// a fixed-point fraction, with its digits scrambled by XORing them
+// with SCRAMBLE.  Together with van_der_corput, this gives a 2d
+// (0,2)-sequence.
+//
+static inline unsigned
+sobol2 (unsigned num, unsigned scramble = 0)
+{
+  for (unsigned v = 1U << 31; num != 0; num >>= 1, v ^= v >> 1)
+    if (num & 1)
+      scramble ^= v;
+  return scramble;
+}
+
+// Return the fixed-point fraction FRAC as a float.  The result is
+// always strictly less than 1.
+//
+static inline float
+fixed_point_to_float (unsigned frac)
+{
+  // Only use as many bits as a float can hold exactly, so that
+  // rounding can never yield 1.
+  //
+  return float (frac >> 8) * (1.f / 16777216.f);
+}
+
+
 }
 
 #endif // SNOGRAY_RADICAL_INVERSE_H
@@ -13,20 +13,7 @@
 #ifndef SNOGRAY_RANDOM_H
 #define SNOGRAY_RANDOM_H
 
-#include "config.h"
-
-// Based on our configuration, include an implementation-specific header
-// file to define the classes "RNG" and "FloatRNGAdaptor<>"
-//
-#if USE_STD_RANDOM
-#include "random-std.h"
-#elif USE_STD_TR1_RANDOM
-#include "random-tr1.h"
-#elif USE_BOOST_RANDOM
-#include "random-boost.h"
-#else
-#include "random-rand.h"
-#endif
+#include "hash-bits.h"
 
 
 namespace snogray {
@@ -34,35 +21,115 @@ namespace snogray {
 
 // A class representing a random number generator.
 //
+// This is a "counter-based" generator:  the Nth number generated is
+// simply a hash of N and a 64-bit key (this is the "SplitMix64"
+// generator).  As no value depends on the previous one, it's trivial
+// to split the generator into many independent streams -- e.g., one
+// per pixel and sample -- just by choosing a different key for each,
+// which is what Random::set_stream does.  That makes the numbers
+// generated for a given stream independent of which thread uses it,
+// and in what order, so renders are exactly reproducible regardless
+// of the number of threads.
+//
 class Random
 {
 public:
 
-  Random () : frng (rng) { }
-  Random (unsigned seed) : rng (seed), frng (rng) { }
+  Random (unsigned seed = 0) { this->seed (seed); }
 
   // Return a random floating-point number in the range 0-1.  It isn't
   // defined whether the ends of the range are inclusive or exclusive,
   // so callers should be prepared to handle either case.
   //
-  float operator() () { return frng (); }
+  float operator() () { return bits_to_float (gen_bits ()); }
 
   // Return a random integer in the range [0, N).
   //
-  unsigned operator() (unsigned n) { return rng () % n; }
+  unsigned operator() (unsigned n)
+  {
+    // This scales a random 32-bit number into the desired range using
+    // a multiplication, which is much faster than a division.
+    //
+    return unsigned ((gen_bits () * (unsigned long long)n) >> 32);
+  }
+
+  // Return a random 32-bit unsigned integer, with all bits random.
+  //
+  unsigned gen_bits ()
+  {
+    counter += GAMMA;
+    return unsigned (mix_bits64 (key + counter) >> 32);
+  }
+
+  // Store NUM random floating-point numbers in the range 0-1 into VALS.
+  // This gives the same results as calling operator() NUM times, but
+  // as each iteration is independent, the compiler can vectorize it.
+  //
+  void gen_floats (float *vals, unsigned num)
+  {
+    unsigned long long base = key + counter;
+    for (unsigned i = 0; i < num; i++)
+      {
+	unsigned long long ctr = base + (i + 1) * GAMMA;
+	vals[i] = bits_to_float (unsigned (mix_bits64 (ctr) >> 32));
+      }
+    counter += num * GAMMA;
+  }
 
   // Re-seed this random number generator with integer seed SEED.
+  // This also selects the default stream (see Random::set_stream).
+  //
+  void seed (unsigned seed)
+  {
+    base_seed = seed;
+    set_stream (0);
+  }
+
+  // Switch to the independent random-number stream identified by the
+  // integers K0, K1, and K2 (for instance, the coordinates of a pixel,
+  // and a sample number within it), starting from its beginning.
   //
-  void seed (unsigned seed) { rng.seed (seed); }
-  void seed () { rng.seed (); }
+  // The result depends only on the arguments and the current seed, so
+  // switching to the same stream later will generate exactly the same
+  // sequence of numbers again.  Generators which are meant to produce
+  // the same streams (e.g., those used by different rendering
+  // threads) must therefore be given the same seed.
+  //
+  void set_stream (unsigned k0, unsigned k1 = 0, unsigned k2 = 0)
+  {
+    unsigned long long h = mix_bits64 (base_seed + GAMMA);
+    h = mix_bits64 (h ^ k0);
+    h = mix_bits64 (h ^ k1);
+    h = mix_bits64 (h ^ k2);
+
+    key = h;
+    counter = 0;
+  }
+
+private:
 
-  // Base random number generator.
+  // The SplitMix64 counter increment (the 64-bit "golden ratio").
+  //
+  static const unsigned long long GAMMA = 0x9e3779b97f4a7c15ULL;
+
+  // Return the floating-point number in the range [0, 1) corresponding
+  // to the random bits BITS.
+  //
+  static float bits_to_float (unsigned bits)
+  {
+    // Only use as many bits as a float can hold exactly, so that
+    // rounding can never yield 1.
+    //
+    return float (bits >> 8) * (1.f / 16777216.f);
+  }
+
+  // The seed set by Random::seed, from which stream keys are derived.
   //
-  RNG rng;
+  unsigned base_seed;
 
-  // Floating-point view of RNG.
+  // Key of the current stream, and the position in it.
   //
-  FloatRNGAdaptor<RNG> frng;
+  unsigned long long key, counter;
 };
 
 
@@ -57,6 +57,9 @@ public:
   RealUniqueLock () { }
   explicit RealUniqueLock (RealMutex &) { }
   template<typename A> RealUniqueLock (RealMutex &, const A &) { }
+
+  void lock () { }
+  void unlock () { }
 };
 
 class RealCondVar